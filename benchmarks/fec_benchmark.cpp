@@ -0,0 +1,191 @@
+#include <benchmark/benchmark.h>
+
+#include "imr/mold/downstream/fec_encoder.h"
+#include "imr/mold/fec_decoder.h"
+#include "imr/mold/types.h"
+#include "imr/util/random.h"
+#include "util/binary_io.h"
+
+#include <array>
+#include <vector>
+
+using namespace imr;
+
+namespace
+{
+    constexpr auto mtu{1472UZ};
+    constexpr auto messages_per_packet{35UZ};
+    constexpr auto message_size{40UZ};
+
+    // a full downstream packet laid out like PacketBuilder's: header iovec then one iovec per message
+    struct Packet
+    {
+        std::array<char, mold::types::header::length> header{};
+        std::vector<char> messages;
+        std::vector<iovec> iov;
+
+        explicit Packet(std::uint64_t fill)
+            : messages(messages_per_packet * message_size, static_cast<char>(fill))
+        {
+            std::ranges::copy(std::string_view("SESSION001"), header.begin());
+            util::binary_io::write_at_be(std::span(header),
+                                         mold::types::header::message_count_offset,
+                                         static_cast<mold::types::header::MessageCount>(messages_per_packet));
+
+            iov.push_back({.iov_base = header.data(), .iov_len = header.size()});
+            for (auto i{0UZ}; i < messages_per_packet; ++i)
+            {
+                iov.push_back({.iov_base = messages.data() + (i * message_size), .iov_len = message_size});
+            }
+        }
+
+        void set_sequence_number(mold::types::header::SequenceNumber seq) noexcept
+        {
+            util::binary_io::write_at_be(std::span(header), mold::types::header::sequence_number_offset, seq);
+        }
+    };
+
+    mold::downstream::FecEncoder::Config fec_config(const benchmark::State& state)
+    {
+        return {.mcast_group = "239.0.0.2",
+                .port = 1,
+                .k = static_cast<std::size_t>(state.range(0)),
+                .interleave = static_cast<std::size_t>(state.range(1)),
+                .row_parity = state.range(2) != 0};
+    }
+}
+
+// parity generation cost per downstream packet, what the feed adds after each send
+static void BM_FecEncoderAdd(benchmark::State& state)
+{
+    mold::downstream::FecEncoder encoder(fec_config(state), mtu);
+
+    Packet packet{1};
+    mold::types::header::SequenceNumber seq{1};
+
+    for (auto _ : state)
+    {
+        packet.set_sequence_number(seq);
+        seq += messages_per_packet;
+
+        benchmark::DoNotOptimize(encoder.add(packet.iov));
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * static_cast<std::int64_t>(messages_per_packet * message_size));
+}
+BENCHMARK(BM_FecEncoderAdd)->Args({8, 1, 0})->Args({10, 4, 0})->Args({10, 4, 1})->Args({20, 10, 1});
+
+/** Retransmission requests (one per run of consecutive packets still missing) a consumer makes with and without FEC.
+ *
+ *  Losses follow the fault injector's seeded decisions (`Lines::Impairment`): each packet starts a loss of `burst`
+ *  consecutive packets (a `scripted_drops` range) with probability loss / burst, so burst 1 is plain `drop`.
+ *
+ *  Args: k, interleave, row parity, loss (per 10'000 packets), burst.
+ */
+static void BM_FecRetransmissionRequests(benchmark::State& state)
+{
+    constexpr auto packets{100'000UZ};
+
+    const auto loss{static_cast<double>(state.range(3)) / 10'000.0};
+    const auto burst{static_cast<std::size_t>(state.range(4))};
+
+    std::vector<bool> lost(packets);
+    util::SplitMix64 rng{1};
+    for (auto i{0UZ}; i < packets; ++i)
+    {
+        if (rng.chance(loss / static_cast<double>(burst)))
+        {
+            for (auto j{i}; j < std::min(i + burst, packets); ++j)
+            {
+                lost[j] = true;
+            }
+        }
+    }
+
+    // iovecs point into each Packet, no reallocation
+    std::vector<Packet> contents;
+    contents.reserve(64);
+    for (auto fill{0UZ}; fill < 64; ++fill)
+    {
+        contents.emplace_back(fill);
+    }
+
+    std::size_t without_fec{0};
+    std::size_t with_fec{0};
+    std::size_t parity_bytes{0};
+
+    for (auto _ : state)
+    {
+        mold::downstream::FecEncoder encoder(fec_config(state), mtu);
+        mold::FecDecoder decoder;
+        std::vector<bool> have(packets);
+        parity_bytes = 0;
+
+        const auto apply{[&](std::span<const char> parity) {
+            parity_bytes += parity.size();
+
+            if (const auto rebuilt{decoder.on_parity(parity)}; !rebuilt.empty())
+            {
+                have[util::binary_io::read_at_be<mold::types::header::SequenceNumber>(
+                         rebuilt, mold::types::header::sequence_number_offset) -
+                     1] = true;
+            }
+        }};
+
+        for (auto i{0UZ}; i < packets; ++i)
+        {
+            auto& packet{contents[i % contents.size()]};
+            packet.set_sequence_number(i + 1);
+
+            if (!lost[i])
+            {
+                std::vector<char> received;
+                for (const auto& iov : packet.iov)
+                {
+                    const auto* bytes{static_cast<const char*>(iov.iov_base)};
+                    received.insert(received.end(), bytes, bytes + iov.iov_len);
+                }
+                decoder.on_packet(received);
+                have[i] = true;
+            }
+
+            // parity is sent (and arrives) right after the packet completing its group
+            for (const auto& parity : encoder.add(packet.iov))
+            {
+                apply(parity);
+            }
+        }
+
+        for (const auto& parity : encoder.flush())
+        {
+            apply(parity);
+        }
+
+        without_fec = 0;
+        with_fec = 0;
+        for (auto i{0UZ}; i < packets; ++i)
+        {
+            without_fec += lost[i] && (i == 0 || !lost[i - 1]) ? 1 : 0;
+            with_fec += !have[i] && (i == 0 || have[i - 1]) ? 1 : 0;
+        }
+    }
+
+    const auto data_bytes{packets * (mold::types::header::length + (messages_per_packet * message_size))};
+
+    state.counters["requests_no_fec"] = static_cast<double>(without_fec);
+    state.counters["requests_fec"] = static_cast<double>(with_fec);
+    state.counters["reduction_%"] =
+        without_fec == 0 ? 0.0 : 100.0 * (1.0 - (static_cast<double>(with_fec) / static_cast<double>(without_fec)));
+    state.counters["overhead_%"] = 100.0 * static_cast<double>(parity_bytes) / static_cast<double>(data_bytes);
+}
+BENCHMARK(BM_FecRetransmissionRequests)
+    ->ArgNames({"k", "interleave", "rows", "loss", "burst"})
+    ->Args({10, 1, 0, 10, 1})
+    ->Args({10, 1, 0, 100, 1})
+    ->Args({10, 4, 0, 100, 1})
+    ->Args({10, 1, 0, 10, 4})
+    ->Args({10, 4, 0, 10, 4})
+    ->Args({10, 4, 1, 100, 4})
+    ->Iterations(1)
+    ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,147 @@
+#include <benchmark/benchmark.h>
+
+#include "itch/timestamp.h"
+#include "mold/io.h"
+#include "imr/mold/types.h"
+#include "imr/util/random.h"
+#include "util/binary_io.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+using namespace imr;
+
+namespace
+{
+    struct MessageType
+    {
+        char type;
+        // without the length prefix
+        std::size_t size;
+        // percent of messages
+        std::uint64_t weight;
+    };
+
+    // TotalView-ITCH 5.0 sizes, roughly a regular session's frequencies (adds / deletes dominate)
+    constexpr std::array totalview{
+        MessageType{.type = 'A', .size = 36, .weight = 38},
+        MessageType{.type = 'D', .size = 19, .weight = 33},
+        MessageType{.type = 'U', .size = 35, .weight = 9},
+        MessageType{.type = 'E', .size = 31, .weight = 5},
+        MessageType{.type = 'X', .size = 23, .weight = 4},
+        MessageType{.type = 'I', .size = 50, .weight = 4},
+        MessageType{.type = 'F', .size = 40, .weight = 3},
+        MessageType{.type = 'P', .size = 44, .weight = 2},
+        MessageType{.type = 'C', .size = 36, .weight = 1},
+        MessageType{.type = 'Q', .size = 40, .weight = 1},
+    };
+
+    constexpr std::array add_orders{
+        MessageType{.type = 'A', .size = 36, .weight = 100},
+    };
+
+    // `count` length prefixed messages drawn from `mix`, with increasing ITCH timestamps
+    std::vector<char> make_messages(std::span<const MessageType> mix, std::size_t count)
+    {
+        util::SplitMix64 random{42};
+        std::vector<char> bytes;
+        std::uint64_t timestamp{34'200'000'000'000};
+
+        for (auto i{0UZ}; i < count; ++i)
+        {
+            auto roll{random.next() % 100};
+            auto type{mix.begin()};
+            while (roll >= type->weight)
+            {
+                roll -= type->weight;
+                ++type;
+            }
+
+            auto pos{bytes.size()};
+            bytes.resize(pos + sizeof(mold::types::LengthPrefix) + type->size);
+            util::binary_io::write_be(std::span(bytes), pos, static_cast<mold::types::LengthPrefix>(type->size));
+
+            const auto message{std::span(bytes).subspan(pos)};
+            message[0] = type->type;
+            timestamp += random.next() % 1'000;
+            std::array<char, 8> be{};
+            util::binary_io::write_at_be(std::span(be), 0, timestamp);
+            std::ranges::copy(std::span(be).last(itch::timestamp_size), message.begin() + itch::timestamp_offset);
+        }
+
+        return bytes;
+    }
+
+    std::span<const MessageType> mix_for(std::int64_t arg)
+    {
+        return arg == 0 ? std::span<const MessageType>(totalview) : std::span<const MessageType>(add_orders);
+    }
+}
+
+// walks range(0) messages of mix range(1) (0 TotalView, 1 add orders only), as the downstream's sources do
+static void BM_ReadMessage(benchmark::State& state)
+{
+    const auto count{static_cast<std::size_t>(state.range(0))};
+    const auto bytes{make_messages(mix_for(state.range(1)), count)};
+
+    for (auto _ : state)
+    {
+        std::size_t pos{0};
+        for (auto message{mold::io::read_message(bytes, pos)}; !message.empty(); message = mold::io::read_message(bytes, pos))
+        {
+            benchmark::DoNotOptimize(message.data());
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetBytesProcessed(state.iterations() * static_cast<std::int64_t>(bytes.size()));
+}
+BENCHMARK(BM_ReadMessage)->ArgsProduct({{1 << 10, 1 << 20}, {0, 1}});
+
+// as BM_ReadMessage, only advancing the position (building the retransmission index of a file)
+static void BM_SkipMessage(benchmark::State& state)
+{
+    const auto count{static_cast<std::size_t>(state.range(0))};
+    const auto bytes{make_messages(mix_for(state.range(1)), count)};
+
+    for (auto _ : state)
+    {
+        std::size_t pos{0};
+        while (mold::io::skip_message(bytes, pos))
+        {
+        }
+        benchmark::DoNotOptimize(pos);
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetBytesProcessed(state.iterations() * static_cast<std::int64_t>(bytes.size()));
+}
+BENCHMARK(BM_SkipMessage)->ArgsProduct({{1 << 10, 1 << 20}, {0, 1}});
+
+// the timestamp of each of range(0) TotalView messages, as the pacer and merging sources read them
+static void BM_ExtractTimestamp(benchmark::State& state)
+{
+    const auto count{static_cast<std::size_t>(state.range(0))};
+    const auto bytes{make_messages(totalview, count)};
+
+    std::vector<std::span<const char>> messages;
+    std::size_t pos{0};
+    for (auto message{mold::io::read_message(bytes, pos)}; !message.empty(); message = mold::io::read_message(bytes, pos))
+    {
+        messages.push_back(message.subspan(sizeof(mold::types::LengthPrefix)));
+    }
+
+    for (auto _ : state)
+    {
+        for (const auto message : messages)
+        {
+            benchmark::DoNotOptimize(itch::extract_timestamp(message));
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ExtractTimestamp)->Arg(1 << 10)->Arg(1 << 20);
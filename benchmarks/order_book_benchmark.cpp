@@ -0,0 +1,145 @@
+#include <benchmark/benchmark.h>
+
+#include "itch/order_book.h"
+#include "imr/util/random.h"
+#include "util/binary_io.h"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+using namespace imr;
+
+namespace
+{
+    constexpr auto stream_size{1UZ << 20U};
+    constexpr auto locates{8000U};
+    // a busy TotalView session peaks around a million messages a second
+    constexpr auto live_rate{1e6};
+
+    // synthetic TotalView-like order flow: adds, then deletes / executions / cancels / replaces of resting orders
+    struct Stream
+    {
+        std::vector<char> bytes;
+        std::vector<std::span<const char>> messages;
+
+        explicit Stream(std::size_t count)
+        {
+            util::SplitMix64 random{42};
+            std::vector<std::uint64_t> live;
+            std::vector<std::size_t> offsets;
+            std::uint64_t next_reference{1};
+
+            const auto message{[&](std::size_t size, char type, std::uint64_t reference) -> std::span<char> {
+                offsets.push_back(bytes.size());
+                bytes.resize(bytes.size() + size);
+
+                const std::span out{std::span(bytes).last(size)};
+                out[0] = type;
+                util::binary_io::write_at_be(out, 1, static_cast<std::uint16_t>(1 + (reference % locates)));
+                util::binary_io::write_at_be(out, itch::order_reference_offset, reference);
+                return out;
+            }};
+
+            const auto take_live{[&] {
+                const auto i{random.next() % live.size()};
+                const auto reference{live[i]};
+                live[i] = live.back();
+                live.pop_back();
+                return reference;
+            }};
+
+            for (auto i{0UZ}; i < count; ++i)
+            {
+                const auto roll{random.next() % 100};
+
+                if (live.size() < 1000 || roll < 45)
+                {
+                    const auto reference{next_reference++};
+                    const auto add{message(itch::add_order_size, itch::add_order_type, reference)};
+                    add[itch::side_offset] = (reference & 1U) != 0 ? 'B' : 'S';
+                    util::binary_io::write_at_be(add, itch::add_shares_offset, std::uint32_t{100});
+                    util::binary_io::write_at_be(add, itch::add_price_offset, static_cast<std::uint32_t>(random.next() % 100'000));
+                    live.push_back(reference);
+                }
+                else if (roll < 80)
+                {
+                    message(19, itch::order_delete_type, take_live());
+                }
+                else if (roll < 90)
+                {
+                    // partial executions / cancels leave the order resting
+                    const auto type{roll < 85 ? itch::order_executed_type : itch::order_cancel_type};
+                    const auto reduce{message(31, type, live[random.next() % live.size()])};
+                    util::binary_io::write_at_be(reduce, itch::shares_offset, std::uint32_t{1});
+                }
+                else
+                {
+                    const auto replace{message(35, itch::order_replace_type, take_live())};
+                    const auto reference{next_reference++};
+                    util::binary_io::write_at_be(replace, itch::new_order_reference_offset, reference);
+                    util::binary_io::write_at_be(replace, itch::replace_shares_offset, std::uint32_t{100});
+                    util::binary_io::write_at_be(replace, itch::replace_price_offset, static_cast<std::uint32_t>(random.next() % 100'000));
+                    live.push_back(reference);
+                }
+            }
+
+            offsets.push_back(bytes.size());
+            for (auto i{0UZ}; i + 1 < offsets.size(); ++i)
+            {
+                messages.push_back(std::span(bytes).subspan(offsets[i], offsets[i + 1] - offsets[i]));
+            }
+        }
+    };
+
+    const Stream& stream()
+    {
+        static const Stream s(stream_size);
+        return s;
+    }
+}
+
+// messages the snapshot book applies per second on one core, replay_x is that as a multiple of the live rate
+static void BM_OrderBookApply(benchmark::State& state)
+{
+    const auto& messages{stream().messages};
+    itch::OrderBook book;
+
+    for (auto _ : state)
+    {
+        book.clear();
+        for (const auto message : messages)
+        {
+            book.apply(message);
+        }
+        benchmark::DoNotOptimize(book.order_count());
+    }
+
+    const auto applied{static_cast<double>(state.iterations()) * static_cast<double>(messages.size())};
+    state.SetItemsProcessed(static_cast<std::int64_t>(applied));
+    state.counters["replay_x"] = benchmark::Counter(applied / live_rate, benchmark::Counter::kIsRate);
+    state.counters["resting_orders"] = static_cast<double>(book.order_count());
+}
+BENCHMARK(BM_OrderBookApply)->Unit(benchmark::kMillisecond);
+
+// time a late joiner's snapshot holds the book lock for
+static void BM_OrderBookWriteSnapshot(benchmark::State& state)
+{
+    itch::OrderBook book;
+    for (const auto message : stream().messages)
+    {
+        book.apply(message);
+    }
+
+    std::vector<char> snapshot;
+    for (auto _ : state)
+    {
+        snapshot.clear();
+        book.write_snapshot(snapshot);
+        benchmark::DoNotOptimize(snapshot.data());
+    }
+
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) * static_cast<std::int64_t>(snapshot.size()));
+    state.counters["orders"] = static_cast<double>(book.order_count());
+}
+BENCHMARK(BM_OrderBookWriteSnapshot)->Unit(benchmark::kMillisecond);
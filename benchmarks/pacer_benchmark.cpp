@@ -0,0 +1,47 @@
+#include <benchmark/benchmark.h>
+
+#include "imr/mold/downstream/pacer.h"
+#include "imr/util/virtual_clock.h"
+
+#include <chrono>
+
+using namespace imr;
+
+namespace
+{
+    // a packet's delay per call, ITCH timestamps a microsecond apart from the open
+    template <mold::downstream::ClockConcept Clock>
+    void get_delay(benchmark::State& state)
+    {
+        mold::downstream::Pacer<Clock> pacer({.playback_speed = 1.0, .skip_before = mold::downstream::market_pre});
+        auto timestamp{mold::downstream::market_open};
+
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(pacer.get_delay(timestamp));
+            timestamp += std::chrono::microseconds(1);
+        }
+
+        state.SetItemsProcessed(state.iterations());
+    }
+}
+
+static void BM_PacerGetDelaySteady(benchmark::State& state)
+{
+    get_delay<std::chrono::steady_clock>(state);
+}
+BENCHMARK(BM_PacerGetDelaySteady);
+
+static void BM_PacerGetDelaySystem(benchmark::State& state)
+{
+    get_delay<std::chrono::system_clock>(state);
+}
+BENCHMARK(BM_PacerGetDelaySystem);
+
+// wait::Virtual's clock, a thread local read instead of a clock_gettime()
+static void BM_PacerGetDelayVirtual(benchmark::State& state)
+{
+    util::VirtualClock::set(std::chrono::steady_clock::now());
+    get_delay<util::VirtualClock>(state);
+}
+BENCHMARK(BM_PacerGetDelayVirtual);
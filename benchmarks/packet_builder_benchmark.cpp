@@ -0,0 +1,79 @@
+#include <benchmark/benchmark.h>
+
+#include "imr/mold/packet_builder.h"
+#include "imr/mold/types.h"
+#include "imr/util/random.h"
+#include "util/binary_io.h"
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+using namespace imr;
+
+namespace
+{
+    constexpr auto stream_messages{1UZ << 16U};
+
+    // TotalView-ITCH 5.0 message sizes (without the length prefix), weighted like a regular session
+    constexpr std::array<std::size_t, 20> sizes{36, 36, 36, 36, 36, 36, 36, 36, 19, 19, 19, 19, 19, 19, 35, 35, 31, 23, 50, 40};
+
+    struct Stream
+    {
+        std::vector<char> bytes;
+        std::vector<std::span<const char>> messages;
+
+        Stream()
+        {
+            util::SplitMix64 random{42};
+            std::vector<std::size_t> offsets;
+
+            for (auto i{0UZ}; i < stream_messages; ++i)
+            {
+                const auto size{sizes[random.next() % sizes.size()]};
+                auto pos{bytes.size()};
+                offsets.push_back(pos);
+                bytes.resize(pos + sizeof(mold::types::LengthPrefix) + size, 'A');
+                util::binary_io::write_be(std::span(bytes), pos, static_cast<mold::types::LengthPrefix>(size));
+            }
+
+            for (auto i{0UZ}; i < offsets.size(); ++i)
+            {
+                const auto end{i + 1 < offsets.size() ? offsets[i + 1] : bytes.size()};
+                messages.emplace_back(bytes.data() + offsets[i], end - offsets[i]);
+            }
+        }
+    };
+}
+
+// reset / try_add until full / finalize, the downstream's per packet work, at MTU range(0)
+static void BM_PacketBuilderBuild(benchmark::State& state)
+{
+    const Stream stream;
+    mold::PacketBuilder builder({.session = "SESSION001", .MTU = static_cast<std::size_t>(state.range(0))});
+
+    mold::types::header::SequenceNumber seq{1};
+    auto next{0UZ};
+    std::int64_t messages{0};
+
+    for (auto _ : state)
+    {
+        builder.reset(seq);
+        while (builder.try_add(stream.messages[next]))
+        {
+            next = (next + 1) & (stream_messages - 1);
+        }
+
+        const auto packet{builder.finalize()};
+        benchmark::DoNotOptimize(packet.data());
+
+        seq += builder.message_count();
+        messages += builder.message_count();
+    }
+
+    state.SetItemsProcessed(messages);
+    state.counters["messages_per_packet"] = benchmark::Counter(static_cast<double>(messages), benchmark::Counter::kAvgIterations);
+}
+// a small MTU, ethernet, jumbo frames
+BENCHMARK(BM_PacketBuilderBuild)->Arg(512)->Arg(1472)->Arg(8972);
@@ -0,0 +1,111 @@
+#include <benchmark/benchmark.h>
+
+#include "imr/mold/retransmission_buffer.h"
+#include "imr/util/random.h"
+
+#include <cstdint>
+#include <memory>
+
+using namespace imr;
+
+namespace
+{
+    // a power of two (masked index) and a size next to it that isn't (modulo)
+    constexpr std::int64_t masked{1 << 16};
+    constexpr std::int64_t modulo{(1 << 16) + 1};
+
+    std::unique_ptr<mold::RetransmissionBuffer> shared;
+
+    void fill(mold::RetransmissionBuffer& buffer)
+    {
+        for (mold::types::header::SequenceNumber seq{1}; seq <= buffer.size(); ++seq)
+        {
+            buffer.push({.sequence_number = seq, .file_position = seq * 40});
+        }
+    }
+
+    void setup_shared(const benchmark::State& state)
+    {
+        shared = std::make_unique<mold::RetransmissionBuffer>(static_cast<std::size_t>(state.range(0)));
+        fill(*shared);
+    }
+
+    void teardown_shared(const benchmark::State&)
+    {
+        shared.reset();
+    }
+}
+
+// the downstream recording a message, buffer size range(0)
+static void BM_RetransmissionBufferPush(benchmark::State& state)
+{
+    mold::RetransmissionBuffer buffer(static_cast<std::size_t>(state.range(0)));
+    mold::types::header::SequenceNumber seq{1};
+
+    for (auto _ : state)
+    {
+        buffer.push({.sequence_number = seq, .file_position = seq * 40});
+        ++seq;
+    }
+
+    benchmark::DoNotOptimize(buffer.written());
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RetransmissionBufferPush)->Arg(masked)->Arg(modulo);
+
+// a retransmission request resolving sequence numbers anywhere in a full buffer of size range(0)
+static void BM_RetransmissionBufferLookup(benchmark::State& state)
+{
+    mold::RetransmissionBuffer buffer(static_cast<std::size_t>(state.range(0)));
+    fill(buffer);
+
+    util::SplitMix64 random{42};
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(buffer.file_position_for(1 + (random.next() % buffer.size())));
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RetransmissionBufferLookup)->Arg(masked)->Arg(modulo);
+
+/** Thread 0 pushes like the downstream while the others look up recent sequence numbers like retransmission
+ *  threads: the cost of a lookup (and of a push) with that many readers on the buffer's cache lines.
+ */
+static void BM_RetransmissionBufferConcurrent(benchmark::State& state)
+{
+    auto& buffer{*shared};
+    const auto size{buffer.size()};
+
+    if (state.thread_index() == 0)
+    {
+        auto seq{size + 1};
+        for (auto _ : state)
+        {
+            buffer.push({.sequence_number = seq, .file_position = seq * 40});
+            ++seq;
+        }
+    }
+    else
+    {
+        util::SplitMix64 random{static_cast<std::uint64_t>(state.thread_index())};
+        for (auto _ : state)
+        {
+            // within the last half of the buffer, rarely lapped by the writer
+            const auto back{random.next() % (size / 2)};
+            benchmark::DoNotOptimize(buffer.file_position_for(buffer.written() - back));
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RetransmissionBufferConcurrent)
+    ->Arg(masked)
+    ->Arg(modulo)
+    ->Setup(setup_shared)
+    ->Teardown(teardown_shared)
+    ->Threads(2)
+    ->Threads(4)
+    ->Threads(8)
+    ->UseRealTime();
@@ -0,0 +1,35 @@
+# cmake -DBENCHMARKS="<exe>|<exe>..." -DOUT_DIR=<dir> -DSOURCE_DIR=<repo> -P run_benchmarks.cmake
+#
+# Runs each benchmark with JSON output to OUT_DIR/<commit>/<name>.json, the commit as `git describe --always --dirty`
+# has it at run time (not configure time, so one build directory serves several commits).
+
+execute_process(
+    COMMAND git describe --always --dirty
+    WORKING_DIRECTORY ${SOURCE_DIR}
+    OUTPUT_VARIABLE commit
+    OUTPUT_STRIP_TRAILING_WHITESPACE
+    RESULT_VARIABLE result
+)
+if(NOT result EQUAL 0 OR commit STREQUAL "")
+    set(commit unknown)
+endif()
+
+set(dir ${OUT_DIR}/${commit})
+file(MAKE_DIRECTORY ${dir})
+
+string(REPLACE "|" ";" benchmarks "${BENCHMARKS}")
+foreach(benchmark ${benchmarks})
+    get_filename_component(name ${benchmark} NAME_WE)
+    message(STATUS "${name} -> ${dir}/${name}.json")
+
+    execute_process(
+        COMMAND ${benchmark}
+            --benchmark_out=${dir}/${name}.json
+            --benchmark_out_format=json
+            --benchmark_context=commit=${commit}
+        RESULT_VARIABLE result
+    )
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "${name} failed: ${result}")
+    endif()
+endforeach()
@@ -0,0 +1,114 @@
+#include <benchmark/benchmark.h>
+
+#include "imr/mold/downstream/shm_writer.h"
+#include "imr/mold/shm.h"
+#include "imr/mold/types.h"
+#include "imr/util/file_descriptor.h"
+#include "util/binary_io.h"
+
+#include <array>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+using namespace imr;
+
+namespace
+{
+    constexpr auto mtu{1472UZ};
+    constexpr auto message_size{36UZ};
+
+    // a downstream packet of `count` add order sized messages, PacketBuilder's layout
+    struct Packet
+    {
+        std::array<char, mold::types::header::length> header{};
+        std::vector<char> messages;
+        std::vector<iovec> iov;
+
+        explicit Packet(std::size_t count)
+            : messages(count * (sizeof(mold::types::LengthPrefix) + message_size), 'A')
+        {
+            util::binary_io::write_at_be(std::span(header),
+                                         mold::types::header::message_count_offset,
+                                         static_cast<mold::types::header::MessageCount>(count));
+
+            iov.push_back({.iov_base = header.data(), .iov_len = header.size()});
+            for (auto i{0UZ}; i < count; ++i)
+            {
+                auto* message{messages.data() + (i * (sizeof(mold::types::LengthPrefix) + message_size))};
+                message[0] = 0;
+                message[1] = static_cast<char>(message_size);
+                iov.push_back({.iov_base = message, .iov_len = sizeof(mold::types::LengthPrefix) + message_size});
+            }
+        }
+
+        void set_sequence_number(mold::types::header::SequenceNumber seq) noexcept
+        {
+            util::binary_io::write_at_be(std::span(header), mold::types::header::sequence_number_offset, seq);
+        }
+    };
+}
+
+// publish + read back of one packet (range(0) messages) through the ring, packet or message entries (range(1))
+static void BM_ShmPublishRead(benchmark::State& state)
+{
+    const auto count{static_cast<std::size_t>(state.range(0))};
+    const auto content{state.range(1) == 0 ? mold::shm::Content::packets : mold::shm::Content::messages};
+
+    mold::downstream::ShmWriter writer({.path = {}, .slot_count = 1U << 12U, .content = content}, mtu);
+    mold::shm::Reader reader(writer.path());
+
+    Packet packet(count);
+    mold::types::header::SequenceNumber seq{1};
+
+    for (auto _ : state)
+    {
+        packet.set_sequence_number(seq);
+        writer.publish(packet.iov);
+        seq += count;
+
+        for (auto entry{reader.try_read()}; entry.has_value(); entry = reader.try_read())
+        {
+            benchmark::DoNotOptimize(entry->data.data());
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(count));
+}
+BENCHMARK(BM_ShmPublishRead)->Args({1, 0})->Args({35, 0})->Args({1, 1})->Args({35, 1});
+
+// the same packet over multicast loopback's path: sendmsg then recv on a loopback UDP socket
+static void BM_UdpLoopbackSendRecv(benchmark::State& state)
+{
+    const auto count{static_cast<std::size_t>(state.range(0))};
+
+    const util::FileDescriptor sender{socket(AF_INET, SOCK_DGRAM, 0)};
+    const util::FileDescriptor receiver{socket(AF_INET, SOCK_DGRAM, 0)};
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(receiver.get(), reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+    socklen_t length{sizeof(address)};
+    getsockname(receiver.get(), reinterpret_cast<sockaddr*>(&address), &length);
+
+    Packet packet(count);
+    std::array<char, mtu> buffer{};
+
+    for (auto _ : state)
+    {
+        msghdr msg{};
+        msg.msg_name = &address;
+        msg.msg_namelen = sizeof(address);
+        msg.msg_iov = packet.iov.data();
+        msg.msg_iovlen = packet.iov.size();
+
+        sendmsg(sender.get(), &msg, 0);
+        benchmark::DoNotOptimize(recv(receiver.get(), buffer.data(), buffer.size(), 0));
+    }
+
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(count));
+}
+BENCHMARK(BM_UdpLoopbackSendRecv)->Arg(1)->Arg(35);
@@ -0,0 +1,138 @@
+#include <benchmark/benchmark.h>
+
+#include "imr/mold/message_store.h"
+#include "imr/mold/retransmission_buffer.h"
+#include "imr/mold/soup/feed.h"
+#include "imr/mold/types.h"
+#include "imr/util/file_descriptor.h"
+
+#include <array>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+using namespace imr;
+
+namespace
+{
+    constexpr std::string_view session{"SESSION001"};
+    constexpr auto file_messages{1UZ << 16U};
+    // a typical ITCH add order
+    constexpr auto message_size{36UZ};
+    constexpr auto frame_size{sizeof(mold::types::soup::Length) + 1 + message_size};
+    constexpr auto chunk{16'384UZ};
+
+    std::vector<char> make_file()
+    {
+        std::vector<char> file;
+        for (auto i{0UZ}; i < file_messages; ++i)
+        {
+            file.push_back(0);
+            file.push_back(static_cast<char>(message_size));
+            file.insert(file.end(), message_size, 'A');
+        }
+        return file;
+    }
+
+    // one connection per client, every fd needs raising past the usual soft limit of 1024
+    void raise_fd_limit()
+    {
+        rlimit limit{};
+        getrlimit(RLIMIT_NOFILE, &limit);
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    util::FileDescriptor logged_in_client(std::uint16_t port)
+    {
+        util::FileDescriptor client{socket(AF_INET, SOCK_STREAM, 0)};
+
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        connect(client.get(), reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+
+        std::string login{"\0\0L", 3};
+        login.append(mold::types::soup::username_size + mold::types::soup::password_size + session.size(), ' ');
+        login.append(mold::types::soup::sequence_number_size - 1, ' ');
+        login.push_back('1');
+        login[1] = static_cast<char>(login.size() - sizeof(mold::types::soup::Length));
+        send(client.get(), login.data(), login.size(), 0);
+
+        std::array<char, sizeof(mold::types::soup::Length) + 1 + mold::types::soup::login_accepted_size> accepted{};
+        recv(client.get(), accepted.data(), accepted.size(), MSG_WAITALL);
+
+        return client;
+    }
+}
+
+// sequenced data delivered to every one of N clients, chunk by chunk, read back by one epoll thread
+static void BM_SoupFanOut(benchmark::State& state)
+{
+    raise_fd_limit();
+
+    const auto file{make_file()};
+    mold::RetransmissionBuffer retransmission_buffer(1U << 20U);
+
+    mold::soup::Feed::Config cfg{.address = "127.0.0.1", .port = 0};
+    cfg.heartbeat_period = std::chrono::hours(1);
+    mold::soup::Feed feed(cfg, session, mold::MessageStore(file), retransmission_buffer);
+    std::jthread thread([&feed](std::stop_token st) { feed.start(st); });
+
+    const auto clients_count{static_cast<std::size_t>(state.range(0))};
+    std::vector<util::FileDescriptor> clients;
+    const util::FileDescriptor epoll_fd{epoll_create1(0)};
+
+    for (auto i{0UZ}; i < clients_count; ++i)
+    {
+        clients.push_back(logged_in_client(feed.port()));
+
+        epoll_event event{.events = EPOLLIN, .data = {.u64 = i}};
+        epoll_ctl(epoll_fd.get(), EPOLL_CTL_ADD, clients.back().get(), &event);
+    }
+
+    std::vector<std::size_t> received(clients_count);
+    std::vector<char> buffer(1 << 20U);
+    std::vector<epoll_event> events(clients_count);
+    mold::types::header::SequenceNumber seq{0};
+
+    for (auto _ : state)
+    {
+        for (auto i{0UZ}; i < chunk; ++i)
+        {
+            ++seq;
+            retransmission_buffer.push({.sequence_number = seq, .file_position = ((seq - 1) % file_messages) * (2 + message_size)});
+        }
+
+        const auto expected{seq * frame_size};
+        for (auto done{0UZ}; done < clients_count;)
+        {
+            const auto nfds{epoll_wait(epoll_fd.get(), events.data(), static_cast<int>(events.size()), 1000)};
+
+            for (auto i{0}; i < nfds; ++i)
+            {
+                const auto client{events[static_cast<std::size_t>(i)].data.u64};
+                const auto bytes{recv(clients[client].get(), buffer.data(), buffer.size(), MSG_DONTWAIT)};
+
+                if (bytes > 0)
+                {
+                    const auto before{received[client]};
+                    received[client] += static_cast<std::size_t>(bytes);
+                    done += before < expected && received[client] >= expected ? 1 : 0;
+                }
+            }
+        }
+    }
+
+    const auto per_client{static_cast<double>(state.iterations() * chunk)};
+    state.SetItemsProcessed(static_cast<std::int64_t>(per_client * static_cast<double>(clients_count)));
+    state.counters["msgs_per_client"] = benchmark::Counter(per_client, benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_SoupFanOut)->Arg(1)->Arg(100)->Arg(1000)->Unit(benchmark::kMillisecond)->UseRealTime();
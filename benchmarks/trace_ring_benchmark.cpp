@@ -0,0 +1,26 @@
+#include <benchmark/benchmark.h>
+
+#include "imr/mold/downstream/trace_ring.h"
+#include "imr/mold/trace.h"
+
+#include <chrono>
+
+using namespace imr;
+
+// what a downstream packet adds to the send path with a trace ring: the TSC read and the record
+static void BM_TraceRingRecord(benchmark::State& state)
+{
+    mold::downstream::TraceRing ring({.path = {}, .capacity = 1U << 16U, .dump = {}, .dump_signal = 0});
+
+    mold::types::header::SequenceNumber seq{1};
+    const auto due{std::chrono::steady_clock::now()};
+
+    for (auto _ : state)
+    {
+        ring.record(seq, 4, seq * 40, std::chrono::nanoseconds(seq), due, mold::trace::tsc(), seq, mold::trace::Result::sent);
+        seq += 4;
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TraceRingRecord);
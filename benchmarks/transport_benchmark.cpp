@@ -0,0 +1,68 @@
+#include <benchmark/benchmark.h>
+
+#include "imr/mold/downstream/feed.h"
+#include "imr/mold/downstream/file_source.h"
+#include "imr/mold/packet_builder.h"
+#include "imr/mold/retransmission_buffer.h"
+#include "imr/mold/transport.h"
+
+#include <vector>
+
+using namespace imr;
+
+namespace
+{
+    constexpr auto file_messages{1UZ << 16U};
+    // a typical ITCH add order
+    constexpr auto message_size{36UZ};
+
+    std::vector<char> make_file()
+    {
+        std::vector<char> file;
+        for (auto i{0UZ}; i < file_messages; ++i)
+        {
+            file.push_back(0);
+            file.push_back(static_cast<char>(message_size));
+            file.insert(file.end(), message_size, 'A');
+        }
+        return file;
+    }
+
+    // the same replay (no pacing) through each transport, so the socket's cost shows next to building packets alone
+    void replay(benchmark::State& state, mold::transport::Kind transport)
+    {
+        const auto file{make_file()};
+        const mold::PacketBuilder::Config packet_builder_cfg{.session = "SESSION001"};
+
+        for (auto _ : state)
+        {
+            mold::downstream::FileSource source{file};
+            mold::RetransmissionBuffer retransmission_buffer(file_messages);
+
+            mold::downstream::Feed feed({.mcast_group = "127.0.0.1",
+                                         .port = 9,
+                                         .heartbeat_period = std::chrono::hours(1),
+                                         .pacer_cfg = {.skip_before = std::chrono::nanoseconds{0}},
+                                         .transport = transport,
+                                         .wait = util::wait::Kind::none},
+                                        packet_builder_cfg,
+                                        source,
+                                        retransmission_buffer);
+            feed.start({});
+        }
+
+        state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * file_messages));
+    }
+}
+
+static void BM_ReplayNull(benchmark::State& state)
+{
+    replay(state, mold::transport::Kind::null);
+}
+BENCHMARK(BM_ReplayNull)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_ReplayUdp(benchmark::State& state)
+{
+    replay(state, mold::transport::Kind::udp);
+}
+BENCHMARK(BM_ReplayUdp)->Unit(benchmark::kMillisecond)->UseRealTime();
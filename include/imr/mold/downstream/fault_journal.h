@@ -0,0 +1,94 @@
+#pragma once
+
+#include "imr/mold/types.h"
+#include "imr/util/file_descriptor.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+namespace imr::mold::downstream
+{
+    /** Compact binary log of every fault `Lines` injects, so a consumer's gap detection / recovery can be checked
+     *  against exactly what was done to the feed.
+     *
+     *  The file is `magic` followed by fixed size big endian records (`record_length` bytes each), staged in a buffer
+     *  and written with a single write() per `buffer_size` bytes.
+     */
+    class FaultJournal
+    {
+      public:
+        /// @ingroup config
+        struct Config
+        {
+            /// File to create (truncated if it exists).
+            std::filesystem::path path;
+            /// Bytes staged before each write().
+            std::size_t buffer_size{1UZ << 16U};
+        };
+
+        enum class Fault : std::uint8_t
+        {
+            drop,
+            duplicate,
+            /// `detail` is the number of later packets sent first.
+            reorder,
+            /// `detail` is the delay in microseconds.
+            delay,
+            /// `detail` is the index of the `Lines::ScriptedDrop`.
+            scripted_drop,
+        };
+
+        struct Record
+        {
+            /// ITCH timestamp of the packet's first message.
+            std::chrono::nanoseconds timestamp;
+            types::header::SequenceNumber sequence_number;
+            types::header::MessageCount message_count;
+            /// Index of the line, 0 is the primary.
+            std::uint8_t line;
+            Fault fault;
+            std::uint32_t detail;
+
+            bool operator==(const Record&) const = default;
+        };
+
+        static constexpr std::array magic{'I', 'M', 'R', 'F', 'J', '0', '0', '1'};
+        static constexpr std::size_t record_length{8 + 8 + 2 + 1 + 1 + 4};
+
+        /**
+         @throws std::invalid_argument if cfg.path is empty or a directory
+         @throws std::system_error if the file can't be created or the magic can't be written
+        */
+        explicit FaultJournal(const Config& cfg);
+
+        FaultJournal(const FaultJournal&) = delete;
+        FaultJournal& operator=(const FaultJournal&) = delete;
+
+        FaultJournal(FaultJournal&&) = delete;
+        FaultJournal& operator=(FaultJournal&&) = delete;
+
+        /// Flushes any staged records.
+        ~FaultJournal();
+
+        void record(const Record& record) noexcept;
+
+        /// Writes staged records to the file.
+        void flush() noexcept;
+
+        /** Decodes a journal file's contents.
+         *
+         *  @throws std::invalid_argument if `journal` doesn't start with `magic` or ends mid record
+         */
+        [[nodiscard]]
+        static std::vector<Record> parse(std::span<const char> journal);
+
+      private:
+        util::FileDescriptor fd_;
+        std::vector<char> buffer_;
+        std::size_t used_{0};
+    };
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "imr/mold/types.h"
+#include "imr/util/zstring_view.h"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <netinet/in.h>
+#include <sys/uio.h>
+
+namespace imr::mold::downstream
+{
+    /** Builds XOR parity packets (`types::fec`) over downstream packets for a separate multicast group, so consumers
+     *  can rebuild a single lost packet per parity packet locally instead of requesting a retransmission.
+     *
+     *  Packets are dealt round robin to `interleave` column groups, each emitting parity every `k` packets, so a burst
+     *  of up to `interleave` consecutive losses costs each group one packet. `row_parity` also covers every
+     *  `interleave` consecutive packets, recovering a second loss in a column. Parity is XORed into preallocated
+     *  buffers as each packet is added; nothing is copied or allocated per packet.
+     */
+    class FecEncoder
+    {
+      public:
+        /// @ingroup config
+        struct Config
+        {
+            /// Multicast group parity packets go to.
+            util::zstring_view mcast_group;
+            /// Multicast port.
+            std::uint16_t port;
+            /// Packets per column parity packet.
+            std::size_t k{8};
+            /// Column groups packets are dealt across.
+            std::size_t interleave{1};
+            /// Also emit a parity packet per `interleave` consecutive packets.
+            bool row_parity{false};
+        };
+
+        /**
+         @param max_packet_size largest downstream packet (the MTU). Parity packets are up to
+                `types::fec::payload_offset(max(k, interleave)) - types::header::sequence_number_offset` bytes larger.
+
+         @throws std::invalid_argument if cfg.mcast_group is not a valid IPv4 address or k / interleave is 0 or over
+                 `types::fec::max_count`
+        */
+        FecEncoder(const Config& cfg, std::size_t max_packet_size);
+
+        [[nodiscard]]
+        const sockaddr_in& destination() const noexcept;
+
+        /** XORs `packet` (starting with its MoldUDP64 header) into its groups.
+         *
+         *  @returns parity packets completed by this packet, valid until the next `add()` / `flush()`.
+         */
+        [[nodiscard]]
+        std::span<const std::span<const char>> add(std::span<const iovec> packet) noexcept;
+
+        /// Parity packets of every partially filled group (end of session), valid until the next `add()` / `flush()`.
+        [[nodiscard]]
+        std::span<const std::span<const char>> flush() noexcept;
+
+      private:
+        struct Group
+        {
+            // header, room for `capacity` sequence numbers, then the XOR payload
+            std::vector<char> packet;
+            types::fec::Kind kind;
+            std::size_t capacity;
+            std::size_t count{0};
+            std::size_t max_length{0};
+            std::uint16_t length_xor{0};
+        };
+
+        sockaddr_in destination_{};
+        std::vector<Group> columns_;
+        // row group after the columns if enabled
+        std::vector<Group> rows_;
+        std::size_t next_column_{0};
+
+        std::vector<std::span<const char>> ready_;
+
+        [[nodiscard]]
+        static Group make_group(types::fec::Kind kind, std::size_t capacity, std::size_t max_packet_size);
+
+        static void accumulate(Group& group, std::span<const iovec> packet) noexcept;
+
+        [[nodiscard]]
+        static std::span<const char> emit(Group& group) noexcept;
+    };
+}
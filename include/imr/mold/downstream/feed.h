@@ -1,25 +1,51 @@
 #pragma once
 
+#include "imr/mold/downstream/fault_journal.h"
+#include "imr/mold/downstream/fec_encoder.h"
 #include "imr/mold/downstream/heartbeat.h"
+#include "imr/mold/downstream/lines.h"
 #include "imr/mold/packet_builder.h"
 #include "imr/mold/retransmission_buffer.h"
 #include "imr/mold/downstream/pacer.h"
+#include "imr/mold/downstream/pcap_writer.h"
+#include "imr/mold/downstream/shm_writer.h"
+#include "imr/mold/downstream/source.h"
+#include "imr/mold/downstream/trace_ring.h"
+#include "imr/mold/downstream/tx_timestamper.h"
 
+#include "imr/mold/transport.h"
 #include "imr/mold/types.h"
 #include "imr/util/file_descriptor.h"
+#include "imr/util/histogram.h"
+#include "imr/util/metrics.h"
+#include "imr/util/wait.h"
 #include "imr/util/zstring_view.h"
 
+#include <atomic>
+#include <memory>
 #include <netinet/in.h>
+#include <optional>
 #include <stop_token>
 #include <sys/socket.h>
+#include <vector>
 
 namespace imr::mold::downstream
 {
     /** Replays a MoldUDP64 downstream feed over multicast.
      *
      *  Sends heartbeats on a fixed period while running, then
-     *  end of session packets for `end_of_session_duration` once the file
+     *  end of session packets for `end_of_session_duration` once the source
      *  is exhausted or `start()`'s stop_token is triggered.
+     *
+     *  Packets, heartbeats and end of session packets go out on `mcast_group` and every `redundant_lines` entry (A/B
+     *  lines), each line with its own impairment (see `Lines`).
+     *
+     *  Playlist sources are followed from item to item on the same socket and thread, rolling the session per
+     *  `Config::rollover`.
+     *
+     *  Where packets go (`Config::transport`) and how the feed waits for them to be due (`Config::wait`) are chosen at
+     *  runtime: `start()` runs the replay loop instantiated for the pair, so the same build can measure building packets
+     *  alone (null transport, no wait) next to the full socket cost.
      */
     class Feed
     {
@@ -50,49 +76,211 @@ namespace imr::mold::downstream
             std::chrono::nanoseconds end_of_session_duration{std::chrono::seconds(30)};
             /// Controls playback speed and pre-market message skipping.
             Pacer<std::chrono::steady_clock>::Config pacer_cfg{};
+            /** Write packets to a pcap file instead of sending them.
+             *
+             *  Heartbeats and end of session packets are written inline at the times they would have been sent, see
+             *  `PcapWriter::Config::Timestamps`.
+             */
+            std::optional<PcapWriter::Config> pcap_output;
+
+            /// What happens when the source moves to its next playlist item (see `PlaylistSource`).
+            enum class Rollover
+            {
+                /// End of session packets for `end_of_session_duration`, then a new session (`types::header::roll_session()`) from sequence 1.
+                session,
+                /// Same session, sequence numbers carry on.
+                sequence,
+            };
+            Rollover rollover{Rollover::session};
+            /// Drop / reorder / delay applied to `mcast_group` (the A line). Not applied to `pcap_output`.
+            Lines::Impairment impairment{};
+            /// Further lines (B, C...) every packet is also sent on, e.g. another group on another interface.
+            std::vector<Lines::Line> redundant_lines;
+            /// Log every fault injected by `impairment` / the redundant lines' impairments to this file.
+            std::optional<FaultJournal::Config> fault_journal;
+            /// Publish XOR parity of the downstream packets to a separate group (see `FecEncoder`). Not written to `pcap_output`.
+            std::optional<FecEncoder::Config> fec;
+            /** Also publish packets (and end of session) into a shared memory ring for consumers on this host, see
+             *  `ShmWriter`. Published before the packet is sent, unimpaired. Not written with `pcap_output`.
+             */
+            std::optional<ShmWriter::Config> shm_output;
+            /** Where packets, heartbeats and end of session packets go: the socket, only `shm_output`, `memory_sink()`
+             *  or `null_sink()`. `pcap_output` takes the place of the transport when set.
+             */
+            transport::Kind transport{transport::Kind::udp};
+            /** How to wait for a packet to be due. `none` replays as fast as packets can be built and sends a single
+             *  end of session packet. `virtual_time` replays as fast too, but on a simulated clock: packets, impairment
+             *  delays, heartbeats (sent inline, no heartbeat thread) and end of session packets keep the timing they'd
+             *  have had, stamped by that clock in `memory_sink()`. Writing `pcap_output` with ITCH timestamps never waits.
+             */
+            util::wait::Kind wait{util::wait::Kind::sleep};
+            /** Read back kernel (or NIC) transmit timestamps of everything sent on the socket, to see how far each
+             *  packet's departure was from its schedule and whether the pacing loop or the kernel added it (see
+             *  `TxTimestamper`). Serialises the heartbeat's sends with the feed's. Requires the udp transport and no
+             *  `pcap_output`.
+             */
+            std::optional<TxTimestamper::Config> tx_timestamps;
+            /** Record every data packet (sequence number, file position, ITCH timestamp, when due and sent, result) in
+             *  an always on shared memory ring, dumped at each end of session, for a post-mortem of a gap or latency
+             *  spike (see `TraceRing`).
+             */
+            std::optional<TraceRing::Config> trace;
         };
 
         /** Constructs the feed ready to begin downstream on configured multicast group/port
 
-         @throws std::invalid_argument if cfg.mcast_group is not a valid IPv4 address
+         @param source messages to replay; must outlive this object.
 
-         @throws std::system_error if socket creation / configuration fails
+         @throws std::invalid_argument if cfg.mcast_group / a redundant line's group / the fec group is not a valid IPv4 address,
+                                       or cfg.transport is shm without cfg.shm_output,
+                                       or cfg.tx_timestamps is set with another transport / cfg.pcap_output,
+                                       or cfg.trace is invalid (see `TraceRing`)
+
+         @throws std::system_error if socket creation / configuration fails, or a shared memory ring can't be created
         */
         explicit Feed(const Config& cfg,
                       const PacketBuilder::Config& packet_builder_cfg,
-                      std::span<const char> file,
+                      Source& source,
                       RetransmissionBuffer& retransmission_buffer);
 
-        /** Replays the file until EOF or `st` stopped, then send end of session packets for configured duration
+        /** Replays the source until exhausted or `st` stopped, then send end of session packets for configured duration
          *
          *  Blocks until finished.
          */
         void start(std::stop_token st);
 
+        /** Publishes the feed's counters (packets, bytes, messages, send errors, heartbeats, TX timestamps read /
+         *  missed) and gauges (lateness behind the pacer's schedule of the last packet, file position of its last
+         *  message) in `registry`.
+         *
+         *  Call before `start()`. @throws std::invalid_argument if the registry is full.
+         */
+        void attach_metrics(util::metrics::Registry& registry, std::string_view labels);
+
+        /** How late each data packet went out behind the pacer's schedule, in nanoseconds (early counts as 0).
+         *
+         *  Empty with `util::wait::Kind::none`, which has no schedule. Readable while `start()` runs.
+         */
+        [[nodiscard]]
+        const util::Histogram& lateness() const noexcept;
+
+        /** Counts the replay thread in `threads` while it's in its allocation free replay loop (`util::hot_path`), from
+         *  after startup until the source is exhausted, not across playlist items / session rollovers. `threads` must
+         *  outlive the feed.
+         *
+         *  Call before `start()`.
+         */
+        void count_hot_path(std::atomic<std::size_t>& threads) noexcept;
+
+        /// Packets sent with `transport::Kind::memory`.
+        [[nodiscard]]
+        const transport::Memory& memory_sink() const noexcept;
+
+        /// Packets sent with `transport::Kind::null` / `transport::Kind::shm`.
+        [[nodiscard]]
+        const transport::Null& null_sink() const noexcept;
+
+        /// Null unless `Config::tx_timestamps` is set.
+        [[nodiscard]]
+        const TxTimestamper* tx_timestamper() const noexcept;
+
+        /// Null unless `Config::trace` is set.
+        [[nodiscard]]
+        const TraceRing* trace_ring() const noexcept;
+
       private:
         util::FileDescriptor socket_{[] { return socket(AF_INET, SOCK_DGRAM, 0); }};
         sockaddr_in mcast_group_;
-        msghdr send_hdr_{};
+        std::unique_ptr<FaultJournal> fault_journal_;
+        Lines lines_;
+        transport::Kind transport_;
+        util::wait::Kind wait_;
+        transport::Udp udp_{socket_.get()};
+        transport::Memory memory_;
+        transport::Null null_;
+        std::optional<FecEncoder> fec_encoder_;
+        std::unique_ptr<ShmWriter> shm_writer_;
+        // sends in place of udp_ when set
+        std::unique_ptr<TxTimestamper> tx_timestamper_;
+        std::unique_ptr<TraceRing> trace_ring_;
+        // data packets sent, each its own send batch
+        std::uint64_t batch_{0};
 
-        std::span<const char> file_;
-        std::size_t file_pos_{0};
+        Source* source_;
         types::header::SequenceNumber sequence_number_{1};
         std::atomic<types::header::SequenceNumber> sent_sequence_number_{1};
 
         RetransmissionBuffer* retransmission_buffer_;
 
-        Pacer<std::chrono::steady_clock> pacer_;
+        Pacer<std::chrono::steady_clock>::Config pacer_cfg_;
         PacketBuilder packet_builder_;
         Heartbeat heartbeat_;
+        // when the next heartbeat is due in virtual time (`util::wait::Kind::virtual_time`)
+        Lines::Clock::time_point next_heartbeat_;
+
+        // updated by the replay thread only
+        struct Metrics
+        {
+            util::metrics::Counter packets;
+            util::metrics::Counter bytes;
+            util::metrics::Counter messages;
+            util::metrics::Gauge lateness;
+            util::metrics::Gauge file_position;
+            util::Histogram lateness_distribution;
+        };
+        Metrics metrics_;
+        std::atomic<std::size_t>* hot_path_threads_{nullptr};
 
         std::chrono::nanoseconds end_of_session_duration_;
+        Config::Rollover rollover_;
+
+        std::optional<PcapWriter> pcap_writer_;
+        // capture timestamp of the last packet written to pcap_writer_
+        std::optional<std::chrono::nanoseconds> last_capture_time_;
+        // added to ITCH capture times, one day per playlist item so a multi day playlist stays in time order
+        std::chrono::nanoseconds capture_day_offset_{0};
 
         [[nodiscard]]
         sockaddr_in configure_socket(const Config& cfg) const;
 
-        void build_packet();
-        void send_packet() noexcept;
+        template <transport::Transport T>
+        void run(std::stop_token st, T& transport);
+
+        template <transport::Transport T, util::wait::WaitStrategy W>
+        void replay(std::stop_token st, T& transport);
+
+        // waits for `due`, releasing delayed packets (and sending virtual time heartbeats) due meanwhile
+        template <transport::Transport T, util::wait::WaitStrategy W>
+        void wait_until(Lines::Clock::time_point due, T& transport);
+
+        template <transport::Transport T, util::wait::WaitStrategy W>
+        void start_heartbeat(T& transport);
+
+        template <transport::Transport T>
+        void send_heartbeat(T& transport) noexcept;
+
+        // returns the file position of the packet's last message
+        std::size_t build_packet();
+
+        template <transport::Transport T>
+        void send_packet(std::chrono::nanoseconds timestamp,
+                         std::size_t position,
+                         T& transport,
+                         Lines::Clock::time_point now,
+                         Lines::Clock::time_point due = {}) noexcept;
+
+        template <transport::Transport T>
+        void send_parity(std::span<const std::span<const char>> parity, T& transport) noexcept;
+
+        void capture_packet(std::span<const iovec> packet, std::chrono::nanoseconds timestamp) noexcept;
+
+        template <transport::Transport T, util::wait::WaitStrategy W>
+        void end_of_session(std::stop_token st, T& transport);
+
+        template <transport::Transport T, util::wait::WaitStrategy W>
+        void roll_over(std::stop_token st, T& transport);
 
-        void end_of_session(std::stop_token st);
+        template <transport::Transport T, util::wait::WaitStrategy W>
+        void roll_session(std::stop_token st, T& transport);
     };
 }
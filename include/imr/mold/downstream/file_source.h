@@ -0,0 +1,33 @@
+#pragma once
+
+#include "imr/mold/downstream/source.h"
+
+#include <span>
+
+namespace imr::mold::downstream
+{
+    /// Replays length prefixed ITCH messages from a file in memory (usually `util::MemoryMappedFile::as_span()`).
+    class FileSource final : public Source
+    {
+      public:
+        explicit FileSource(std::span<const char> file) noexcept;
+
+        [[nodiscard]]
+        std::optional<std::chrono::nanoseconds> peek_timestamp() override;
+
+        bool skip() override;
+
+        [[nodiscard]]
+        types::header::SequenceNumber fill(PacketBuilder& packet_builder,
+                                           RetransmissionBuffer& retransmission_buffer,
+                                           types::header::SequenceNumber next_seq) override;
+
+        /// Positions are offsets into the file.
+        [[nodiscard]]
+        MessageStore message_store() const noexcept override;
+
+      private:
+        std::span<const char> file_;
+        std::size_t file_pos_{0};
+    };
+}
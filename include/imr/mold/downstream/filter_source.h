@@ -0,0 +1,69 @@
+#pragma once
+
+#include "imr/mold/downstream/source.h"
+
+#include <bitset>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace imr::mold::downstream
+{
+    /** Replays the messages of a length prefixed ITCH file that match a stock locate / message type filter.
+     *
+     *  Surviving messages get contiguous sequence numbers, the retransmission buffer maps them back to their file
+     *  offsets. Non matching messages are skipped before each peek, so pacing follows the messages actually sent.
+     */
+    class FilterSource final : public Source
+    {
+      public:
+        /// @ingroup config
+        struct Config
+        {
+            /// Tickers to replay (e.g. "AAPL"), resolved to locates via the file's stock directory ('R') messages. With
+            /// `locates` also empty, every stock is replayed.
+            std::vector<std::string> symbols;
+            /// Stock locates to replay, in addition to `symbols`.
+            std::vector<std::uint16_t> locates;
+            /// ITCH message types to replay (e.g. "AEFXDUP"), empty replays every type.
+            std::string message_types;
+            /// Also replay messages not tied to a stock (locate 0: system events, MWCB, ...), as does listing 0 in `locates`.
+            bool market_wide{true};
+        };
+
+        /**
+         @throws std::invalid_argument if a symbol is not in the file's stock directory
+        */
+        FilterSource(std::span<const char> file, const Config& cfg);
+
+        [[nodiscard]]
+        std::optional<std::chrono::nanoseconds> peek_timestamp() override;
+
+        bool skip() override;
+
+        [[nodiscard]]
+        types::header::SequenceNumber fill(PacketBuilder& packet_builder,
+                                           RetransmissionBuffer& retransmission_buffer,
+                                           types::header::SequenceNumber next_seq) override;
+
+        /// Positions are offsets into the file.
+        [[nodiscard]]
+        MessageStore message_store() const noexcept override;
+
+      private:
+        std::span<const char> file_;
+        // always at a matching message or the end of the file
+        std::size_t file_pos_{0};
+
+        // 8 KiB + 32 bytes, both stay in L1 while scanning
+        std::bitset<1UZ << 16U> locates_;
+        std::bitset<1UZ << 8U> types_;
+
+        [[nodiscard]]
+        bool matches(std::size_t pos) const noexcept;
+
+        // advances file_pos_ to the next matching message
+        void seek() noexcept;
+    };
+}
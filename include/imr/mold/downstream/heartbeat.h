@@ -1,11 +1,15 @@
 #pragma once
 
 #include "imr/mold/types.h"
-#include "imr/util/file_descriptor.h"
+#include "imr/util/metrics.h"
 
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
 #include <netinet/in.h>
+#include <span>
 #include <thread>
 
 namespace imr::mold::downstream
@@ -14,31 +18,41 @@ namespace imr::mold::downstream
     class Heartbeat
     {
       public:
+        /// Sends a heartbeat packet (on every line), called from the heartbeat's thread.
+        using Send = std::function<void(std::span<const char> packet)>;
+
         /**
          @param period      Interval between heartbeat packets.
-         @param socket      UDP socket to send on
          @param next_seq    Sequence number read on each send; must outlive this object.
         */
         Heartbeat(std::chrono::nanoseconds period,
-                  util::FileDescriptor& socket,
-                  const sockaddr_in& mcast_group,
                   std::string_view session,
                   const std::atomic<types::header::SequenceNumber>& next_seq);
 
-        void start();
+        void start(Send sender);
 
         void stop();
 
+        /// Session written to subsequent heartbeats. Only call while stopped.
+        void set_session(std::string_view session) noexcept;
+
         [[nodiscard]]
         std::chrono::nanoseconds period() const noexcept;
 
+        /// Heartbeats sent, counted by the heartbeat's thread.
+        [[nodiscard]]
+        util::metrics::Counter& sent() noexcept;
+
       private:
         std::array<char, types::header::length> packet_{};
         std::chrono::nanoseconds period_;
-        util::FileDescriptor* socket_;
+        Send send_;
 
-        sockaddr_in mcast_group_;
         const std::atomic<types::header::SequenceNumber>* next_seq_;
+        // waits out the period, woken early by stop()
+        std::mutex mutex_;
+        std::condition_variable_any wake_;
+        util::metrics::Counter sent_;
         std::jthread thread_;
 
         void send() noexcept;
@@ -0,0 +1,273 @@
+#pragma once
+
+#include "imr/mold/downstream/fault_journal.h"
+#include "imr/mold/transport.h"
+#include "imr/mold/types.h"
+#include "imr/util/random.h"
+#include "imr/util/zstring_view.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+namespace imr::mold::downstream
+{
+    /** Publishes downstream packets on one or more multicast lines (A/B redundancy).
+     *
+     *  All lines share the feed's socket and each packet goes out on every line with a single sendmmsg() reusing the
+     *  packet's iovecs. A line with its own egress interface selects it per message (IP_PKTINFO).
+     *
+     *  Each line applies its own seeded impairment (fault injection between `PacketBuilder::finalize()` and the socket)
+     *  so consumers' gap detection and line arbitration can be tested reproducibly. Only packets an impairment holds
+     *  back (reorder / delay) are copied, into slots preallocated per line. Every injected fault can be logged to a
+     *  `FaultJournal`.
+     *
+     *  Every send takes the `transport::Transport` the batch goes out on, the overloads without one send on the socket.
+     */
+    class Lines
+    {
+      public:
+        using Clock = std::chrono::steady_clock;
+
+        /// Drops every packet carrying any of sequence numbers `first`..`last` sent from ITCH time `at` on.
+        /// @ingroup config
+        struct ScriptedDrop
+        {
+            std::chrono::nanoseconds at{0};
+            types::header::SequenceNumber first;
+            types::header::SequenceNumber last;
+        };
+
+        /// @ingroup config
+        struct Impairment
+        {
+            /// Probability a packet is dropped on this line.
+            double drop{0.0};
+            /// Probability a packet is sent twice on this line.
+            double duplicate{0.0};
+            /// Probability a packet is held back until 1..`reorder_depth` (uniform) later packets went out on this line.
+            double reorder{0.0};
+            std::size_t reorder_depth{1};
+            /// Latency added to every packet on this line (e.g. B line lagging A).
+            std::chrono::nanoseconds delay{0};
+            /// Uniform extra latency in [0, delay_jitter) per packet, packets overtake each other as it varies.
+            std::chrono::nanoseconds delay_jitter{0};
+            std::vector<ScriptedDrop> scripted_drops;
+            /// Packets a line can hold back at once, beyond this packets go out unimpaired.
+            std::size_t max_held{4096};
+            /// Seeds this line's random decisions.
+            std::uint64_t seed{1};
+        };
+
+        /// @ingroup config
+        struct Line
+        {
+            /// Multicast group to send to.
+            util::zstring_view mcast_group;
+            /// Multicast port.
+            std::uint16_t port;
+            /// Interface to send from, INADDR_ANY uses the socket's IP_MULTICAST_IF.
+            in_addr egress_interface{.s_addr = htonl(INADDR_ANY)};
+            Impairment impairment{};
+        };
+
+        /**
+         @param primary destination of the first line (the feed's `mcast_group`), sent from the socket's interface.
+         @param max_packet_size largest packet sent (the MTU), sizes the slots for held back packets.
+         @param journal logs every injected fault if not null; must outlive this object.
+
+         @throws std::invalid_argument if a line's mcast_group isn't valid IPv4 or its egress_interface isn't a local address
+        */
+        Lines(int socket,
+              const sockaddr_in& primary,
+              const Impairment& primary_impairment,
+              std::span<const Line> redundant,
+              std::size_t max_packet_size,
+              FaultJournal* journal = nullptr);
+
+        /** Sends `packet` on every line per its impairment, plus any held back packets now due.
+         *
+         *  `packet` starts with a MoldUDP64 header (in its first iovec), `timestamp` is its first message's ITCH timestamp.
+         *
+         *  @returns false if the transport failed to send some of it.
+         */
+        template <transport::Transport T>
+        bool send(T& transport, std::span<const iovec> packet, std::chrono::nanoseconds timestamp, Clock::time_point now) noexcept
+        {
+            queue_packet(packet, timestamp, now);
+            return transmit(transport);
+        }
+
+        bool send(std::span<const iovec> packet, std::chrono::nanoseconds timestamp, Clock::time_point now) noexcept
+        {
+            transport::Udp udp{socket_};
+            return send(udp, packet, timestamp, now);
+        }
+
+        /// Sends a heartbeat / end of session packet on every line, unimpaired. Safe to call concurrently with `send()`
+        /// if `transport` is.
+        template <transport::Transport T>
+        void send(T& transport, std::span<const char> packet) const noexcept
+        {
+            iovec iov{.iov_base = const_cast<char*>(packet.data()), .iov_len = packet.size()};
+
+            for (const auto& line : lines_)
+            {
+                auto msg{message(line, {&iov, 1})};
+                transport.send({&msg, 1});
+            }
+        }
+
+        void send(std::span<const char> packet) const noexcept
+        {
+            transport::Udp udp{socket_};
+            send(udp, packet);
+        }
+
+        /// Earliest time a delayed packet is due, std::nullopt if none are held.
+        [[nodiscard]]
+        std::optional<Clock::time_point> next_release() const noexcept;
+
+        /// Sends delayed packets due by `now`.
+        template <transport::Transport T>
+        void release(T& transport, Clock::time_point now) noexcept
+        {
+            queue_release(now);
+            transmit(transport);
+        }
+
+        void release(Clock::time_point now) noexcept
+        {
+            transport::Udp udp{socket_};
+            release(udp, now);
+        }
+
+        /// Sends every held back packet regardless of its due time (end of session).
+        template <transport::Transport T>
+        void flush(T& transport) noexcept
+        {
+            queue_flush();
+            transmit(transport);
+        }
+
+        void flush() noexcept
+        {
+            transport::Udp udp{socket_};
+            flush(udp);
+        }
+
+        [[nodiscard]]
+        std::size_t size() const noexcept;
+
+      private:
+        static constexpr std::uint32_t no_slot{~0U};
+
+        // what the journal records about a packet
+        struct PacketInfo
+        {
+            std::chrono::nanoseconds timestamp;
+            types::header::SequenceNumber sequence_number;
+            types::header::MessageCount message_count;
+        };
+
+        struct Slot
+        {
+            PacketInfo info;
+            std::size_t length{0};
+            Clock::time_point due;
+            // breaks ties between equal due times, keeping send order
+            std::uint64_t order{0};
+            // later packets to go out before this one is released (reorder)
+            std::size_t countdown{0};
+        };
+
+        // heap order on (due, order), earliest on top
+        struct Later
+        {
+            const std::vector<Slot>* slots;
+
+            bool operator()(std::uint32_t lhs, std::uint32_t rhs) const noexcept;
+        };
+
+        struct State
+        {
+            State(const sockaddr_in& line_destination, const Impairment& line_impairment)
+                : destination{line_destination},
+                  impairment{line_impairment},
+                  rng{line_impairment.seed}
+            {
+            }
+
+            sockaddr_in destination;
+            // IP_PKTINFO selecting the egress interface, empty control length if none
+            alignas(cmsghdr) std::array<char, CMSG_SPACE(sizeof(in_pktinfo))> control{};
+            std::size_t control_length{0};
+
+            Impairment impairment;
+            util::SplitMix64 rng;
+
+            std::vector<char> storage;
+            std::vector<Slot> slots;
+            std::vector<std::uint32_t> free_slots;
+            // waiting for their countdown, in hold order
+            std::vector<std::uint32_t> reordering;
+            // min heap of delayed slots by due time
+            std::vector<std::uint32_t> delayed;
+            std::uint64_t next_order{0};
+        };
+
+        int socket_;
+        std::size_t max_packet_size_;
+        FaultJournal* journal_;
+        std::vector<State> lines_;
+
+        // sendmmsg batch, one iovec per held slot sent
+        std::vector<mmsghdr> batch_;
+        std::vector<iovec> slot_iovecs_;
+        // (line, slot) pairs to free once the batch is sent
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> sent_slots_;
+
+        [[nodiscard]]
+        static State make_state(const sockaddr_in& destination, in_addr egress_interface, const Impairment& impairment,
+                                std::size_t max_packet_size);
+
+        [[nodiscard]]
+        std::uint32_t hold(State& line, std::span<const iovec> packet, const PacketInfo& info) noexcept;
+
+        void journal(std::uint32_t line_index, const PacketInfo& info, FaultJournal::Fault fault, std::uint64_t detail) noexcept;
+
+        // false if the packet was held back for reordering
+        bool output(std::uint32_t line_index, std::span<const iovec> packet, const PacketInfo& info, Clock::time_point now) noexcept;
+        void delay(std::uint32_t line_index, std::span<const iovec> packet, const PacketInfo& info, Clock::time_point now) noexcept;
+        void output_slot(std::uint32_t line_index, std::uint32_t slot, Clock::time_point now) noexcept;
+        [[nodiscard]]
+        static mmsghdr message(const State& line, std::span<iovec> iov) noexcept;
+        void queue(const State& line, std::span<iovec> iov) noexcept;
+        void queue_slot(std::uint32_t line_index, std::uint32_t slot) noexcept;
+        void release_reordered(std::uint32_t line_index, Clock::time_point now) noexcept;
+        void release_delayed(std::uint32_t line_index, std::optional<Clock::time_point> now) noexcept;
+
+        void queue_packet(std::span<const iovec> packet, std::chrono::nanoseconds timestamp, Clock::time_point now) noexcept;
+        void queue_release(Clock::time_point now) noexcept;
+        void queue_flush() noexcept;
+
+        template <transport::Transport T>
+        bool transmit(T& transport) noexcept
+        {
+            const auto ok{batch_.empty() || transport.send(batch_)};
+
+            sent();
+            return ok;
+        }
+
+        // returns the batch's held slots to their lines
+        void sent() noexcept;
+    };
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "imr/mold/downstream/source.h"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace imr::mold::downstream
+{
+    /** Merges several length prefixed ITCH files into one stream ordered by ITCH timestamp.
+     *
+     *  The next message is picked with a loser tree over the files' head messages: advancing one file replays a single
+     *  leaf to root path (log2 N comparisons) over a few flat arrays, with no allocation after construction.
+     *  Messages with equal timestamps keep file order, then position within the file, so a merge is deterministic.
+     */
+    class MergeSource final : public Source
+    {
+      public:
+        /**
+         @param files ITCH files in memory, index is the file id recorded in retransmission positions.
+
+         @throws std::invalid_argument if files is empty or holds more than `MessageStore::max_files` files
+        */
+        explicit MergeSource(std::vector<std::span<const char>> files);
+
+        [[nodiscard]]
+        std::optional<std::chrono::nanoseconds> peek_timestamp() override;
+
+        bool skip() override;
+
+        [[nodiscard]]
+        types::header::SequenceNumber fill(PacketBuilder& packet_builder,
+                                           RetransmissionBuffer& retransmission_buffer,
+                                           types::header::SequenceNumber next_seq) override;
+
+        /// Positions are `MessageStore::position(file id, offset)` pairs.
+        [[nodiscard]]
+        MessageStore message_store() const noexcept override;
+
+      private:
+        // key of an exhausted file, and of the padding leaves
+        static constexpr std::uint64_t exhausted{~0ULL};
+
+        std::vector<std::span<const char>> files_;
+        std::vector<std::size_t> file_pos_;
+
+        // (timestamp << 8 | file id) of each leaf's head message, padded to a power of two leaves
+        std::vector<std::uint64_t> keys_;
+        // tree_[0] is the winning leaf, tree_[1..] the loser at each internal node
+        std::vector<std::uint32_t> tree_;
+
+        void load_key(std::uint32_t leaf) noexcept;
+        void replay(std::uint32_t leaf) noexcept;
+    };
+}
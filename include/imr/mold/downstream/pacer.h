@@ -3,6 +3,7 @@
 #include "imr/util/log.h"
 #include <chrono>
 #include <concepts>
+#include <optional>
 
 namespace imr::mold::downstream
 {
@@ -78,8 +79,25 @@ namespace imr::mold::downstream
         [[nodiscard]]
         std::chrono::nanoseconds get_delay(std::chrono::nanoseconds packet_timestamp)
         {
-            if (!replay_origin_.has_value())
+            const auto send_at{send_time(packet_timestamp)};
+            const auto now{Clock::now()};
 
+            if (send_at <= now)
+            {
+                return std::chrono::nanoseconds{0};
+            }
+
+            return std::chrono::nanoseconds(send_at - now);
+        }
+
+        /** When a packet with `packet_timestamp` is due, however late that already is.
+         *
+         * Sets the replay origin like `get_delay()` the first time it's called.
+         */
+        [[nodiscard]]
+        Clock::time_point send_time(std::chrono::nanoseconds packet_timestamp)
+        {
+            if (!replay_origin_.has_value())
             {
                 replay_origin_ = packet_timestamp;
                 wall_origin_ = Clock::now();
@@ -89,18 +107,6 @@ namespace imr::mold::downstream
                                  wall_origin_.time_since_epoch().count());
             }
 
-            return calculate_delay(packet_timestamp);
-        }
-
-      private:
-        double playback_speed_;
-        std::chrono::nanoseconds skip_before_;
-        Clock::time_point wall_origin_;
-        std::optional<std::chrono::nanoseconds> replay_origin_;
-
-        [[nodiscard]]
-        std::chrono::nanoseconds calculate_delay(std::chrono::nanoseconds packet_timestamp)
-        {
             const auto replay_offset{packet_timestamp - *replay_origin_};
 
             const auto scaled_offset{
@@ -108,16 +114,19 @@ namespace imr::mold::downstream
                     static_cast<int64_t>(static_cast<double>(replay_offset.count()) / playback_speed_)),
             };
 
-            const auto send_at{wall_origin_ + scaled_offset};
-
-            const auto now{Clock::now()};
-
-            if (send_at <= now)
-            {
-                return std::chrono::nanoseconds{0};
-            }
+            return wall_origin_ + scaled_offset;
+        }
 
-            return std::chrono::nanoseconds(send_at - now);
+        /// Forgets the replay origin, the next `get_delay()` starts pacing afresh (timestamps restart with each playlist item).
+        void reset() noexcept
+        {
+            replay_origin_.reset();
         }
+
+      private:
+        double playback_speed_;
+        std::chrono::nanoseconds skip_before_;
+        Clock::time_point wall_origin_;
+        std::optional<std::chrono::nanoseconds> replay_origin_;
     };
 }
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "imr/mold/downstream/source.h"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace imr::mold::downstream
+{
+    /** Replays MoldUDP64 packets from a pcap / pcapng capture in memory (usually `util::MemoryMappedFile::as_span()`).
+     *
+     *  Walks Ethernet (optionally VLAN tagged), Linux cooked (SLL) or raw IPv4 frames down to the UDP payload, in
+     *  place over the capture. Each captured MoldUDP64 packet is replayed with its original message grouping (a
+     *  captured packet only spills into a second packet if it doesn't fit under the configured MTU), renumbered
+     *  into this feed's sequence space. Heartbeats, end of session packets and anything that isn't IPv4/UDP are skipped.
+     *
+     *  Retransmission positions are offsets of the messages inside the capture, so retransmission feeds read them
+     *  in place just like a plain ITCH file.
+     */
+    class PcapSource final : public Source
+    {
+      public:
+        /// @ingroup config
+        struct Config
+        {
+            enum class Timing
+            {
+                /// Pace by the ITCH timestamp of each packet's first message (same as plain ITCH files).
+                itch,
+                /** Pace by the capture timestamp of each packet.
+                 *
+                 *  Timestamps are then nanoseconds since the epoch, so leave `Pacer::Config::skip_before` at its default.
+                 */
+                capture,
+            };
+
+            Timing timing{Timing::itch};
+            /// Only replay UDP datagrams sent to this destination port. 0 replays every port.
+            std::uint16_t port{0};
+            /** Drop messages whose original MoldUDP64 sequence number was already replayed in their session.
+             *
+             *  Captures of redundant A/B lines or of retransmissions contain each message more than once. Sequence
+             *  numbers are tracked per session, so a capture spanning a session rollover replays the new session
+             *  from its sequence 1.
+             */
+            bool deduplicate{true};
+        };
+
+        /** @throws std::invalid_argument if `capture` doesn't start with a pcap or pcapng header */
+        PcapSource(std::span<const char> capture, const Config& cfg);
+
+        [[nodiscard]]
+        std::optional<std::chrono::nanoseconds> peek_timestamp() override;
+
+        bool skip() override;
+
+        [[nodiscard]]
+        types::header::SequenceNumber fill(PacketBuilder& packet_builder,
+                                           RetransmissionBuffer& retransmission_buffer,
+                                           types::header::SequenceNumber next_seq) override;
+
+        /// Positions are offsets of messages inside the capture.
+        [[nodiscard]]
+        MessageStore message_store() const noexcept override;
+
+      private:
+        struct Interface
+        {
+            std::uint16_t link_type;
+            std::uint64_t ticks_per_second;
+        };
+
+        std::span<const char> capture_;
+        Config::Timing timing_;
+        std::uint16_t port_;
+        bool deduplicate_;
+
+        bool pcapng_{false};
+        // capture written on a host of the other endianness
+        bool swapped_{false};
+        // classic pcap has a single link type, pcapng one per interface description block
+        std::vector<Interface> interfaces_;
+
+        // next record / block to parse
+        std::size_t record_pos_{0};
+
+        // remainder of the packet currently being replayed
+        std::size_t msg_pos_{0};
+        std::size_t packet_end_{0};
+        types::header::MessageCount msgs_left_{0};
+        std::chrono::nanoseconds packet_timestamp_{0};
+
+        // per original session, the sequence number following the last message replayed
+        struct Watermark
+        {
+            types::header::Session session;
+            types::header::SequenceNumber next_seq;
+        };
+        std::vector<Watermark> watermarks_;
+        // of the last packet's session
+        std::size_t watermark_{0};
+
+        /// Makes sure there is a current packet with messages left. False at end of capture.
+        bool load_packet();
+
+        /// Dedup watermark of `session`, starting at 0 the first time it's seen.
+        types::header::SequenceNumber& watermark_for(std::span<const char, sizeof(types::header::Session)> session);
+
+        /// Next captured frame with its timestamp and link type, advancing `record_pos_`. False at end of capture.
+        bool next_frame(std::span<const char>& frame, std::chrono::nanoseconds& timestamp, std::uint16_t& link_type);
+
+        /// Consumes the next message of the current packet. Empty span if it overruns the packet.
+        std::span<const char> next_message() noexcept;
+
+        template <typename T>
+        [[nodiscard]]
+        T read_at(std::size_t offset) const noexcept;
+    };
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "imr/util/file_descriptor.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+#include <netinet/in.h>
+#include <sys/uio.h>
+
+namespace imr::mold::downstream
+{
+    /** Writes MoldUDP64 packets to a pcap file (nanosecond timestamps, Ethernet link type) as Ethernet / IPv4 / UDP frames.
+     *
+     *  Records are staged in a large buffer and written with a single write() per `buffer_size` bytes.
+     */
+    class PcapWriter
+    {
+      public:
+        /// @ingroup config
+        struct Config
+        {
+            enum class Timestamps
+            {
+                /** `session_date` + the ITCH timestamp of each packet's first message.
+                 *
+                 *  No wall clock time passes: the feed doesn't sleep, and heartbeats / end of session packets are
+                 *  written at the times they would have been sent, so a full day converts as fast as the disk allows.
+                 */
+                itch,
+                /// Wall clock time the packet was written (the feed paces as if sending).
+                wall,
+            };
+
+            /// File to create (truncated if it exists).
+            std::filesystem::path path;
+            Timestamps timestamps{Timestamps::itch};
+            /// Midnight of the session day, added to ITCH timestamps (nanoseconds since midnight) for `Timestamps::itch`.
+            std::chrono::sys_seconds session_date{};
+            /// IPv4 source address written to each frame.
+            in_addr source_address{.s_addr = htonl(INADDR_LOOPBACK)};
+            /// UDP source port written to each frame.
+            std::uint16_t source_port{0};
+            /// Bytes staged before each write().
+            std::size_t buffer_size{1UZ << 22U};
+        };
+
+        /**
+         @param destination address / port written to each frame, multicast groups get the matching multicast MAC.
+
+         @throws std::invalid_argument if cfg.path is empty or a directory
+         @throws std::system_error if the file can't be created or the header can't be written
+        */
+        PcapWriter(const Config& cfg, const sockaddr_in& destination);
+
+        PcapWriter(const PcapWriter&) = delete;
+        PcapWriter& operator=(const PcapWriter&) = delete;
+
+        PcapWriter(PcapWriter&&) = delete;
+        PcapWriter& operator=(PcapWriter&&) = delete;
+
+        /// Flushes any staged records.
+        ~PcapWriter();
+
+        /// Appends a record for the datagram made of `packet`'s iovecs, at `timestamp` (since the epoch).
+        void write(std::span<const iovec> packet, std::chrono::nanoseconds timestamp) noexcept;
+
+        /// Appends a record for a contiguous datagram (heartbeats / end of session).
+        void write(std::span<const char> packet, std::chrono::nanoseconds timestamp) noexcept;
+
+        /// Writes staged records to the file.
+        void flush() noexcept;
+
+        [[nodiscard]]
+        Config::Timestamps timestamps() const noexcept;
+
+        [[nodiscard]]
+        std::chrono::sys_seconds session_date() const noexcept;
+
+      private:
+        static constexpr std::size_t frame_header_length{14 + 20 + 8};
+
+        util::FileDescriptor fd_;
+        Config::Timestamps timestamps_;
+        std::chrono::sys_seconds session_date_;
+
+        std::vector<char> buffer_;
+        std::size_t used_{0};
+
+        // ethernet / IPv4 / UDP headers, lengths + checksum patched per record
+        std::array<char, frame_header_length> frame_header_{};
+        std::uint16_t ip_id_{0};
+    };
+}
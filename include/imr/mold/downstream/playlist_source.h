@@ -0,0 +1,76 @@
+#pragma once
+
+#include "imr/mold/downstream/source.h"
+
+#include <cstddef>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace imr::mold::downstream
+{
+    /** Replays length prefixed ITCH files back to back, optionally looping, for soak tests.
+     *
+     *  `advance()` moves to the next file (or rewinds to the first) without the feed tearing down its socket or threads;
+     *  `Feed::Config::rollover` decides whether that starts a new session. The next file's pages are touched on a
+     *  background thread while the current one plays so the switch doesn't stall on page faults. A malformed tail ends
+     *  its file (logged) rather than the playlist.
+     */
+    class PlaylistSource final : public Source
+    {
+      public:
+        /// @ingroup config
+        struct Config
+        {
+            /// Times to play the whole playlist, 0 loops until the feed is stopped.
+            std::size_t loops{1};
+            /// Touch the next file's pages while the current one plays.
+            bool prefault{true};
+        };
+
+        /**
+         @param files ITCH files in memory, played in order. Index is the file id recorded in retransmission positions.
+
+         @throws std::invalid_argument if files is empty or holds more than `MessageStore::max_files` files
+        */
+        PlaylistSource(std::vector<std::span<const char>> files, const Config& cfg);
+
+        void start(std::stop_token st) override;
+
+        [[nodiscard]]
+        std::optional<std::chrono::nanoseconds> peek_timestamp() override;
+
+        bool skip() override;
+
+        bool advance() override;
+
+        [[nodiscard]]
+        types::header::SequenceNumber fill(PacketBuilder& packet_builder,
+                                           RetransmissionBuffer& retransmission_buffer,
+                                           types::header::SequenceNumber next_seq) override;
+
+        /// Positions are `MessageStore::position(file id, offset)` pairs.
+        [[nodiscard]]
+        MessageStore message_store() const noexcept override;
+
+      private:
+        std::vector<std::span<const char>> files_;
+        std::size_t loops_;
+        bool prefault_;
+
+        std::size_t file_id_{0};
+        std::size_t file_pos_{0};
+        // completed passes over the whole playlist
+        std::size_t loop_{0};
+
+        std::jthread prefault_thread_;
+
+        // a malformed tail ends its file rather than the playlist
+        void end_file() noexcept;
+
+        [[nodiscard]]
+        std::size_t next_file_id() const noexcept;
+
+        void prefault_next();
+    };
+}
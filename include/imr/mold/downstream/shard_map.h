@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace imr::mold::downstream
+{
+    /** Assigns stock locates to downstream channels for a sharded replay.
+     *
+     *  Market wide messages (locate 0) aren't assigned, every channel replays them.
+     */
+    class ShardMap
+    {
+      public:
+        /// @ingroup config
+        struct Config
+        {
+            enum class Mapping
+            {
+                /// Contiguous, equally sized locate ranges up to the file's highest stock directory locate.
+                range,
+                /// Multiplicative hash of the locate.
+                hash,
+                /// Explicit `table`.
+                table,
+            };
+
+            Mapping mapping{Mapping::range};
+            /// Mapping::table: channel of each locate (indexed by locate), locates past the end go to channel 0.
+            std::vector<std::size_t> table;
+        };
+
+        /**
+         @param file ITCH file, scanned for stock directory messages by Mapping::range.
+
+         @throws std::invalid_argument if channels is 0 or over 65535, or a table entry is not below channels
+        */
+        ShardMap(const Config& cfg, std::size_t channels, std::span<const char> file);
+
+        [[nodiscard]]
+        std::size_t channel_for(std::uint16_t locate) const noexcept;
+
+        /// Locates assigned to `channel`, for its `FilterSource::Config::locates`.
+        [[nodiscard]]
+        std::vector<std::uint16_t> locates_for(std::size_t channel) const;
+
+        [[nodiscard]]
+        std::size_t channels() const noexcept;
+
+      private:
+        std::size_t channels_;
+        // channel of each locate
+        std::vector<std::uint16_t> channel_of_;
+    };
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "imr/mold/shm.h"
+#include "imr/util/file_descriptor.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+#include <sys/types.h>
+#include <sys/uio.h>
+
+namespace imr::mold::downstream
+{
+    /** Publishes downstream packets (or their messages) into a shared memory broadcast ring for co-located consumers,
+     *  see `shm::Reader`.
+     *
+     *  Publishing is a copy into the next slot between two version stores, no system calls, and never waits on readers:
+     *  a reader too slow for the ring is lapped and notices by itself.
+     */
+    class ShmWriter
+    {
+      public:
+        /// @ingroup config
+        struct Config
+        {
+            /** File backing the ring, created / truncated (e.g. under /dev/shm, or a hugetlbfs mount with `huge_pages`).
+             *
+             *  Empty for an anonymous memfd, which readers attach to through `path()` (/proc/<pid>/fd/<fd>).
+             */
+            std::filesystem::path path;
+            /// Entries the ring holds before overwriting the oldest, a power of two.
+            std::size_t slot_count{1U << 16U};
+            shm::Content content{shm::Content::packets};
+            /// Back the memfd with huge pages (MFD_HUGETLB) and round the ring up to 2MB pages.
+            bool huge_pages{false};
+        };
+
+        struct ReaderLag
+        {
+            pid_t pid;
+            /// Entries published the reader hasn't consumed.
+            std::uint64_t lag;
+        };
+
+        /** Creates and maps the ring with room for packets up to `max_packet_size` (the MTU).
+         *
+         * @throws std::invalid_argument if slot_count isn't a power of two.
+         * @throws std::system_error if the file can't be created / sized / mapped.
+         */
+        ShmWriter(const Config& cfg, std::size_t max_packet_size);
+
+        ~ShmWriter();
+
+        ShmWriter(const ShmWriter&) = delete;
+        ShmWriter& operator=(const ShmWriter&) = delete;
+
+        ShmWriter(ShmWriter&&) = delete;
+        ShmWriter& operator=(ShmWriter&&) = delete;
+
+        /** Publishes a finalized packet (header iovec then one per length prefixed message), or an end of session
+         *  header. Message entries are published one by one, end of session as an empty entry.
+         */
+        void publish(std::span<const iovec> packet) noexcept;
+
+        /// Path readers open to attach.
+        [[nodiscard]]
+        const std::filesystem::path& path() const noexcept;
+
+        /// Registered readers and how far behind they are.
+        [[nodiscard]]
+        std::vector<ReaderLag> readers() const;
+
+      private:
+        util::FileDescriptor fd_;
+        std::filesystem::path path_;
+        std::size_t length_;
+        void* mapping_{nullptr};
+        shm::Header* header_{nullptr};
+        std::byte* slots_{nullptr};
+        std::uint64_t mask_;
+        std::size_t slot_size_;
+        shm::Content content_;
+        // local copy of header_->write_index, only this writer moves it
+        std::uint64_t write_index_{0};
+
+        void publish_entry(types::header::SequenceNumber sequence_number,
+                           types::header::MessageCount message_count,
+                           std::span<const iovec> data) noexcept;
+    };
+}
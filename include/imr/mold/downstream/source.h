@@ -0,0 +1,57 @@
+#pragma once
+
+#include "imr/mold/message_store.h"
+#include "imr/mold/packet_builder.h"
+#include "imr/mold/retransmission_buffer.h"
+#include "imr/mold/types.h"
+
+#include <chrono>
+#include <optional>
+#include <stop_token>
+
+namespace imr::mold::downstream
+{
+    /** Input the downstream feed replays messages from.
+     *
+     *  Called once per packet rather than once per message (the per message loop lives in `fill()`), so the
+     *  virtual dispatch is amortised over a whole packet.
+     */
+    class Source
+    {
+      public:
+        virtual ~Source() = default;
+
+        /// Called once by `Feed::start()` before the first packet, with the same stop_token.
+        virtual void start([[maybe_unused]] std::stop_token st) {}
+
+        /// ITCH timestamp of the next message, or std::nullopt at end of input.
+        [[nodiscard]]
+        virtual std::optional<std::chrono::nanoseconds> peek_timestamp() = 0;
+
+        /// Discards the next message without sending it. Returns false at end of input.
+        virtual bool skip() = 0;
+
+        /** Moves to the next input of a playlist once `peek_timestamp()` returned std::nullopt.
+         *
+         *  @returns false if there is none (single inputs never advance).
+         */
+        virtual bool advance()
+        {
+            return false;
+        }
+
+        /** Adds messages to `packet_builder` until it is full or input runs out, recording each in
+         *  `retransmission_buffer` under consecutive sequence numbers starting at `next_seq`.
+         *
+         *  @returns the sequence number following the last message added.
+         */
+        [[nodiscard]]
+        virtual types::header::SequenceNumber fill(PacketBuilder& packet_builder,
+                                                   RetransmissionBuffer& retransmission_buffer,
+                                                   types::header::SequenceNumber next_seq) = 0;
+
+        /// How the retransmission feeds resolve the positions this source records.
+        [[nodiscard]]
+        virtual MessageStore message_store() const noexcept = 0;
+    };
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "imr/mold/downstream/source.h"
+#include "imr/util/byte_ring.h"
+#include "imr/util/file_descriptor.h"
+
+#include <chrono>
+#include <filesystem>
+
+namespace imr::mold::downstream
+{
+    /** Replays length prefixed ITCH messages from a non-seekable stream (pipe, stdin, unix socket).
+     *
+     *  Bytes are read into a `util::ByteRing` which both the downstream packet builder (in place) and the
+     *  retransmission feeds (via `message_store()`) read from, positions are absolute stream offsets. Retransmission
+     *  can reach back as far as the ring retains, so size it alongside `Server::Config::retransmission_buffer_size`.
+     */
+    class StreamSource final : public Source
+    {
+      public:
+        /// @ingroup config
+        struct Config
+        {
+            /** Stream to read from.
+             *
+             *  "-" reads stdin, a unix domain socket path is connected to (SOCK_STREAM), anything else (FIFO,
+             *  /dev/fd/N, regular file) is opened read only.
+             */
+            std::filesystem::path path{"-"};
+            /// Bytes retained for downstream + retransmission. Rounded up to a power of two multiple of the page size.
+            std::size_t ring_size{1UZ << 28U};
+            /// How long a read blocks before re-checking for stop.
+            std::chrono::milliseconds poll_interval{100};
+        };
+
+        /**
+         *  @throws std::invalid_argument if cfg.path does not exist or is a directory
+         *  @throws std::system_error if opening / connecting the stream or creating the ring fails
+         */
+        explicit StreamSource(const Config& cfg);
+
+        void start(std::stop_token st) override;
+
+        [[nodiscard]]
+        std::optional<std::chrono::nanoseconds> peek_timestamp() override;
+
+        bool skip() override;
+
+        [[nodiscard]]
+        types::header::SequenceNumber fill(PacketBuilder& packet_builder,
+                                           RetransmissionBuffer& retransmission_buffer,
+                                           types::header::SequenceNumber next_seq) override;
+
+        /// Positions are absolute stream offsets into `ring()`.
+        [[nodiscard]]
+        MessageStore message_store() const noexcept override;
+
+        [[nodiscard]]
+        const util::ByteRing& ring() const noexcept;
+
+      private:
+        util::FileDescriptor fd_;
+        util::ByteRing ring_;
+        std::chrono::milliseconds poll_interval_;
+        std::stop_token stop_token_;
+
+        // next unconsumed message
+        std::size_t read_pos_{0};
+        // first message of the packet being built; its iovecs point into the ring so it must not be overwritten
+        std::size_t pinned_pos_{0};
+        bool eof_{false};
+
+        /// Reads until `length` bytes are buffered past `read_pos_`. False on EOF / stop / read error.
+        bool ensure(std::size_t length);
+
+        /// Length of the next message including its prefix, buffering all of it.
+        [[nodiscard]]
+        std::optional<std::size_t> next_message_length();
+    };
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "imr/mold/trace.h"
+#include "imr/mold/types.h"
+#include "imr/util/file_descriptor.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+namespace imr::mold::downstream
+{
+    /** Always on record of the downstream's last `Config::capacity` packets in a shared memory ring (see `trace`):
+     *  sequence number, file position, ITCH timestamp, when it was due and sent, send batch and result.
+     *
+     *  Recording is a store of one cache line between two version stores, no system call or read-modify-write, from the
+     *  feed's thread only. The ring is dumped to `Config::dump` at each end of session, and on `Config::dump_signal`
+     *  (async signal safe, the process carries on). Backed by a file, the ring itself outlives a crash.
+     */
+    class TraceRing
+    {
+      public:
+        /// @ingroup config
+        struct Config
+        {
+            /// File backing the ring, created / truncated (e.g. under /dev/shm). Empty for an anonymous memfd.
+            std::filesystem::path path;
+            /// Packets kept, a power of two.
+            std::size_t capacity{1U << 16U};
+            /// File to dump the ring to at each end of session and on `dump_signal`, empty for none.
+            std::filesystem::path dump;
+            /** Signal dumping the ring, 0 for none: SIGUSR1, SIGUSR2 or a real time signal, as the process carries on
+             *  after the dump (a terminating signal such as SIGTERM / SIGINT would no longer stop it). Replaces the
+             *  signal's action while a ring watches it, the previous one is restored once the last such ring is gone.
+             */
+            int dump_signal{0};
+        };
+
+        /** @throws std::invalid_argument if capacity isn't a power of two, or dump_signal is set without dump / isn't one
+         *          of the signals allowed / more rings than the signal handler tracks want it.
+         *  @throws std::system_error if the file can't be created / sized / mapped, or the signal handler installed.
+         */
+        explicit TraceRing(const Config& cfg);
+
+        ~TraceRing();
+
+        TraceRing(const TraceRing&) = delete;
+        TraceRing& operator=(const TraceRing&) = delete;
+
+        TraceRing(TraceRing&&) = delete;
+        TraceRing& operator=(TraceRing&&) = delete;
+
+        /// Records a packet, `send_tsc` read with `trace::tsc()` as it went to the transport.
+        void record(types::header::SequenceNumber sequence_number,
+                    types::header::MessageCount message_count,
+                    std::uint64_t file_position,
+                    std::chrono::nanoseconds itch_timestamp,
+                    std::chrono::steady_clock::time_point due,
+                    std::uint64_t send_tsc,
+                    std::uint64_t batch,
+                    trace::Result result) noexcept
+        {
+            auto& entry{entries_[write_index_ & mask_]};
+
+            entry.version.store((2 * write_index_) + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            entry.sequence_number = sequence_number;
+            entry.file_position = file_position;
+            entry.itch_timestamp = itch_timestamp.count();
+            entry.due = due.time_since_epoch().count();
+            entry.send_tsc = send_tsc;
+            entry.batch = batch;
+            entry.message_count = message_count;
+            entry.result = result;
+
+            entry.version.store((2 * write_index_) + 2, std::memory_order_release);
+            header_->write_index.store(++write_index_, std::memory_order_release);
+        }
+
+        /** Writes the ring to `Config::dump` (if set), only async signal safe calls. Skipped while a dump on
+         *  `Config::dump_signal` is being written. Errors are logged.
+         */
+        void dump() noexcept;
+
+        /// Path readers open (`trace::read()`), `/proc/<pid>/fd/<fd>` for a memfd.
+        [[nodiscard]]
+        const std::filesystem::path& path() const noexcept;
+
+      private:
+        util::FileDescriptor fd_;
+        std::filesystem::path path_;
+        // c_str() kept for the signal handler
+        std::string dump_path_;
+        int dump_signal_;
+        // held while the ring is dumped, by dump() or the signal handler
+        std::atomic_flag dumping_;
+        std::size_t length_;
+        void* mapping_{nullptr};
+        trace::Header* header_{nullptr};
+        trace::Entry* entries_{nullptr};
+        std::uint64_t mask_;
+        std::uint64_t write_index_{0};
+    };
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+#include "imr/mold/types.h"
+#include "imr/util/file_descriptor.h"
+#include "imr/util/histogram.h"
+#include "imr/util/metrics.h"
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <span>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+#include <netinet/in.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+
+namespace imr::mold::downstream
+{
+    /** Sends on the downstream socket like `transport::Udp`, with kernel transmit timestamps (SO_TIMESTAMPING) read
+     *  back for every datagram, to tell jitter of the pacing loop from queueing in the qdisc / driver below sendmsg().
+     *
+     *  The kernel numbers the datagrams sent on the socket (SOF_TIMESTAMPING_OPT_ID) and hands each one's timestamps
+     *  back on the socket's error queue under that number. `send()` mirrors the numbering (sends from the feed and
+     *  heartbeat threads are serialised for it), keeping each datagram's MoldUDP64 sequence number, message count, send
+     *  time and schedule (`set_schedule()`) until a thread of its own reads the timestamps off the error queue.
+     *
+     *  Per datagram that gives its schedule (the ITCH timestamp as paced), when sendmsg() was called, when it entered
+     *  the qdisc and when the driver sent it (or the NIC, with `Config::hardware`): reported per packet
+     *  (`Config::report`) and as distributions (`pacing()`, `kernel()`, `departure()`).
+     */
+    class TxTimestamper
+    {
+      public:
+        using Clock = std::chrono::steady_clock;
+
+        /// @ingroup config
+        struct Config
+        {
+            /** Ask the NIC for timestamps, software ones still where it has none.
+             *
+             *  Needs hardware timestamping enabled on the interface (e.g. `hwstamp_ctl -i eth0 -t 1`) and its clock
+             *  synced to CLOCK_REALTIME (`phc2sys`) to compare with the schedule.
+             */
+            bool hardware{false};
+            /** CSV file to write a row per datagram to, empty for none: kind, sequence number, message count, then
+             *  scheduled, sendmsg(), qdisc and departure times in CLOCK_REALTIME nanoseconds, and whether departure
+             *  is a hardware timestamp.
+             */
+            std::filesystem::path report;
+            /// Datagrams sent but not timestamped yet kept track of, rounded up to a power of two.
+            std::size_t capacity{1UZ << 16U};
+        };
+
+        /** Enables SO_TIMESTAMPING on `socket` and starts reading its error queue.
+         *
+         * @param parity_destination FEC parity packets' group, those aren't MoldUDP64 packets (nullptr if none).
+         *
+         * @throws std::invalid_argument if capacity is 0.
+         * @throws std::system_error if timestamping can't be enabled or the report can't be opened.
+         */
+        TxTimestamper(int socket, const Config& cfg, const sockaddr_in* parity_destination);
+
+        /// Reads the timestamps already queued, then logs the distributions.
+        ~TxTimestamper();
+
+        TxTimestamper(const TxTimestamper&) = delete;
+        TxTimestamper& operator=(const TxTimestamper&) = delete;
+
+        TxTimestamper(TxTimestamper&&) = delete;
+        TxTimestamper& operator=(TxTimestamper&&) = delete;
+
+        /// `transport::Transport`, safe to call from several threads (feed and heartbeat).
+        bool send(std::span<mmsghdr> batch) noexcept;
+
+        /// When the packet starting at `sequence_number` was due, for the feed to call before sending it.
+        void set_schedule(types::header::SequenceNumber sequence_number, Clock::time_point due) noexcept;
+
+        /// sendmsg() called minus scheduled, of data packets, in nanoseconds.
+        [[nodiscard]]
+        const util::Histogram& pacing() const noexcept;
+
+        /// Departure minus sendmsg() called, of every datagram, in nanoseconds.
+        [[nodiscard]]
+        const util::Histogram& kernel() const noexcept;
+
+        /// Departure minus scheduled, of data packets, in nanoseconds.
+        [[nodiscard]]
+        const util::Histogram& departure() const noexcept;
+
+        /// Datagrams whose departure was read back.
+        [[nodiscard]]
+        util::metrics::Counter& timestamped() noexcept;
+
+        /// Datagrams whose departure never came back (dropped off a full error queue / `Config::capacity` exceeded).
+        [[nodiscard]]
+        util::metrics::Counter& missed() noexcept;
+
+        /// Failed sends (each logged).
+        [[nodiscard]]
+        util::metrics::Counter& errors() noexcept;
+
+      private:
+        enum class Kind : std::uint8_t
+        {
+            data,
+            heartbeat,
+            end_of_session,
+            parity,
+        };
+
+        // a datagram sent, until its departure is read back
+        struct Pending
+        {
+            bool waiting{false};
+            Kind kind{Kind::data};
+            std::uint32_t id{0};
+            types::header::SequenceNumber sequence_number{0};
+            types::header::MessageCount message_count{0};
+            bool scheduled{false};
+            // sendmsg() called minus scheduled
+            std::chrono::nanoseconds pacing{0};
+            // CLOCK_REALTIME
+            std::chrono::nanoseconds sent{0};
+            std::chrono::nanoseconds qdisc{0};
+        };
+
+        int socket_;
+        const sockaddr_in* parity_destination_;
+
+        // taken by send() and the reader, sends must number datagrams in the kernel's order
+        std::mutex mutex_;
+        std::vector<Pending> pending_;
+        std::uint32_t mask_;
+        std::uint32_t next_id_{0};
+        types::header::SequenceNumber schedule_sequence_number_{0};
+        Clock::time_point schedule_due_;
+
+        // recorded by the reader thread only
+        util::Histogram pacing_;
+        util::Histogram kernel_;
+        util::Histogram departure_;
+        util::metrics::Counter timestamped_;
+        // under mutex_
+        util::metrics::Counter missed_;
+        util::metrics::Counter errors_;
+        std::ofstream report_;
+
+        util::FileDescriptor wake_{[] { return eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK); }};
+        std::jthread reader_;
+
+        void track(const msghdr& msg, Clock::time_point sent_at, std::chrono::nanoseconds sent) noexcept;
+
+        void read(std::stop_token st) noexcept;
+
+        void drain() noexcept;
+
+        void complete(std::uint32_t id, std::uint32_t type, std::chrono::nanoseconds time, bool hardware) noexcept;
+    };
+}
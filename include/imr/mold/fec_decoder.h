@@ -0,0 +1,42 @@
+#pragma once
+
+#include "imr/mold/types.h"
+
+#include <deque>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace imr::mold
+{
+    /** Reference consumer side decoder for the FEC stream (`downstream::FecEncoder`).
+     *
+     *  Remembers the last `window` downstream packets received and rebuilds the one packet a parity packet protects
+     *  when exactly one of them is missing. Written for clarity over speed.
+     */
+    class FecDecoder
+    {
+      public:
+        explicit FecDecoder(std::size_t window = 4096);
+
+        /// Records a downstream packet received (heartbeats / end of session packets are ignored).
+        void on_packet(std::span<const char> packet);
+
+        /** Applies a parity packet.
+         *
+         *  @returns the rebuilt downstream packet if exactly one of those it protects is missing (it is also recorded),
+         *           empty if none or more than one are, or the parity packet is malformed.
+         */
+        [[nodiscard]]
+        std::vector<char> on_parity(std::span<const char> parity);
+
+        [[nodiscard]]
+        bool has(types::header::SequenceNumber sequence_number) const noexcept;
+
+      private:
+        std::size_t window_;
+        std::unordered_map<types::header::SequenceNumber, std::vector<char>> packets_;
+        // eviction order
+        std::deque<types::header::SequenceNumber> received_;
+    };
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "imr/util/byte_ring.h"
+
+#include <cstddef>
+#include <span>
+
+namespace imr::mold
+{
+    /** Resolves the positions recorded in `RetransmissionBuffer` back to message bytes for the retransmission feeds.
+     *
+     *  Backed either by mapped files, where messages are returned in place, or by a `util::ByteRing` (streaming
+     *  input), where messages are copied into caller provided scratch space and validated against the downstream
+     *  overwriting them.
+     *
+     *  File positions pack a (file id, offset) pair into one `std::size_t` (see `position()`) so retransmission
+     *  buffer entries stay 16 bytes. A single file is file id 0, so its positions are plain offsets.
+     */
+    class MessageStore
+    {
+      public:
+        /// Bits of a position holding the offset, the rest hold the file id.
+        static constexpr unsigned offset_bits{56};
+        /// Most files a store can address.
+        static constexpr std::size_t max_files{1UZ << (64 - offset_bits)};
+
+        /// Packs a file id and byte offset into that file into a position.
+        [[nodiscard]]
+        static constexpr std::size_t position(std::size_t file_id, std::size_t offset) noexcept
+        {
+            return (file_id << offset_bits) | offset;
+        }
+
+        /// Positions are offsets into `file`.
+        MessageStore(std::span<const char> file) noexcept;
+
+        /// Positions are `position(file id, offset)` pairs, file id indexing `files`. `files` must outlive the store.
+        explicit MessageStore(std::span<const std::span<const char>> files) noexcept;
+
+        /// Positions are absolute `ring` offsets.
+        explicit MessageStore(const util::ByteRing& ring) noexcept;
+
+        /** Returns the message (including length prefix) at `position`.
+         *
+         *  @param scratch copy destination for ring backed stores, the returned span points into it. Unused for file backed stores.
+         *
+         *  @returns empty span if the message is truncated, doesn't fit in `scratch`, or was overwritten.
+         */
+        [[nodiscard]]
+        std::span<const char> read(std::size_t position, std::span<char> scratch) const noexcept;
+
+        /// True if `read()` copies into its scratch argument (callers must then not reuse that part of scratch).
+        [[nodiscard]]
+        bool copies() const noexcept;
+
+      private:
+        std::span<const char> file_;
+        std::span<const std::span<const char>> files_;
+        const util::ByteRing* ring_{nullptr};
+    };
+}
@@ -64,9 +64,14 @@ namespace imr::mold
         /// Number of messages added since last `reset()`.
         [[nodiscard]]
         types::header::MessageCount message_count() const noexcept;
+        /// Bytes in the packet, header included.
+        [[nodiscard]]
+        std::size_t size() const noexcept;
         /// Returns the configured MoldUDP64 session from header
         [[nodiscard]]
         std::string_view session() const noexcept;
+        /// Writes a new MoldUDP64 session to the header (session rollover).
+        void set_session(const types::header::Session& session) noexcept;
 
       private:
         std::size_t MTU_;
@@ -1,11 +1,18 @@
 #pragma once
 
+#include "imr/mold/message_store.h"
 #include "imr/mold/retransmission_buffer.h"
+#include "imr/mold/transport.h"
 #include "imr/util/file_descriptor.h"
+#include "imr/util/histogram.h"
+#include "imr/util/metrics.h"
 #include "imr/util/zstring_view.h"
 #include "imr/mold/packet_builder.h"
 
 #include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
 
 #include <netinet/in.h>
 #include <sys/socket.h>
@@ -13,10 +20,22 @@
 
 namespace imr::mold::retransmission
 {
-    /// MoldUDP64 retransmission server.
+    /** MoldUDP64 retransmission server.
+     *
+     *  Serves one or more downstream channels, routing each request to the channel with the request's session.
+     */
     class Feed
     {
       public:
+        /// A downstream channel's messages.
+        struct Channel
+        {
+            /// Session the channel starts with, followed through rollovers via `RetransmissionBuffer::session_index()`.
+            types::header::Session session;
+            MessageStore message_store;
+            const RetransmissionBuffer* retransmission_buffer;
+        };
+
         /// @ingroup config
         struct Config
         {
@@ -24,30 +43,75 @@ namespace imr::mold::retransmission
             util::zstring_view address;
             /// Port to bind to. Pass 0 to let the OS assign an ephemeral port.
             std::uint16_t port;
+            /// Where responses go: back to the client on the socket, `memory_sink()` or `null_sink()`. Requests are always
+            /// received on the socket.
+            transport::Kind transport{transport::Kind::udp};
         };
         /** Constructs and binds the retransmission socket.
          *
+         * @param message_store resolves positions recorded in `retransmission_buffer` to messages.
          * @param shutdown_fd fd polled alongside the socket; writing to this will cause `start()` to exit stopping the event loop.
          * Must be > 0 (0 is reserved for stdin, which epoll rejects with EPERM).
          *
-         * @throws std::invalid_argument if shutdown_fd <= 0, or if cfg.address is not valid IPv4.
+         * @throws std::invalid_argument if shutdown_fd <= 0, if cfg.address is not valid IPv4, or cfg.transport is shm.
          *
          * @throws std::system_error if network resource creation / config fails
          */
         explicit Feed(const Config& cfg,
                       const PacketBuilder::Config& packet_builder_cfg,
-                      std::span<const char> file,
+                      MessageStore message_store,
                       const RetransmissionBuffer& retransmission_buffer,
                       int shutdown_fd);
+
+        /** Serves several channels (sharded replay), `packet_builder_cfg.session` is unused.
+         *
+         * @throws std::invalid_argument as above, or if channels is empty
+         */
+        explicit Feed(const Config& cfg,
+                      const PacketBuilder::Config& packet_builder_cfg,
+                      std::vector<Channel> channels,
+                      int shutdown_fd);
         /** Runs the event loop, blocking until shutdown_fd becomes readable.
          *  Dispatches incoming client requests to handle_request().
          */
         void start();
 
+        /** Publishes the feed's counters (requests, served, out of range, bad session, bytes, send errors) in `registry`.
+         *
+         *  Call before `start()`. @throws std::invalid_argument if the registry is full.
+         */
+        void attach_metrics(util::metrics::Registry& registry, std::string_view labels);
+
+        /** Records the service time of each request answered, from `recvfrom()` returning to the response sent, in
+         *  nanoseconds. `histogram` must outlive the feed, which is its only writer.
+         *
+         *  Call before `start()`.
+         */
+        void record_service_time(util::Histogram& histogram) noexcept;
+
+        /** Counts the feed's thread in `threads` while it's in its allocation free event loop (`util::hot_path`), from
+         *  after startup until shutdown. `threads` must outlive the feed.
+         *
+         *  Call before `start()`.
+         */
+        void count_hot_path(std::atomic<std::size_t>& threads) noexcept;
+
+        /// Responses sent with `transport::Kind::memory`.
+        [[nodiscard]]
+        const transport::Memory& memory_sink() const noexcept;
+
+        /// Responses sent with `transport::Kind::null`.
+        [[nodiscard]]
+        const transport::Null& null_sink() const noexcept;
+
       private:
         util::FileDescriptor socket_{[] { return socket(AF_INET, SOCK_DGRAM, 0); }};
         util::FileDescriptor epoll_fd_{[] { return epoll_create1(0); }};
         int shutdown_fd_;
+        transport::Kind transport_;
+        transport::Udp udp_{socket_.get()};
+        transport::Memory memory_;
+        transport::Null null_;
         /**
          * @tparam N = 2, 1 for shutdown_fd_, 1 for request
          */
@@ -56,12 +120,38 @@ namespace imr::mold::retransmission
         std::array<char, types::header::length> recv_buffer_{};
         PacketBuilder packet_builder_;
 
-        std::span<const char> file_;
-        const RetransmissionBuffer* retransmission_buffer_;
+        struct Route
+        {
+            Channel channel;
+            // `RetransmissionBuffer::session_index()` channel.session corresponds to
+            std::uint32_t session_index{0};
+        };
+        std::vector<Route> routes_;
+
+        // copy destination for stores that don't hand out messages in place, MTU sized
+        std::vector<char> scratch_;
 
-        void handle_request(int client_fd);
+        // updated by the event loop's thread only
+        struct Metrics
+        {
+            util::metrics::Counter requests;
+            util::metrics::Counter served;
+            util::metrics::Counter out_of_range;
+            util::metrics::Counter bad_session;
+            util::metrics::Counter bytes;
+            util::Histogram* service_time{nullptr};
+        };
+        Metrics metrics_;
+        std::atomic<std::size_t>* hot_path_threads_{nullptr};
+
+        template <transport::Transport T>
+        void run(T& transport);
+
+        template <transport::Transport T>
+        void handle_request(int client_fd, T& transport);
         struct RequestContext
         {
+            const Route* route;
             sockaddr_in client_address;
             types::header::SequenceNumber starting_sequence;
             types::header::MessageCount msg_count;
@@ -71,7 +161,11 @@ namespace imr::mold::retransmission
 
         void build_packet(const RequestContext& ctx);
 
-        void send_packet(const sockaddr_in& client_address);
+        // rolls route's session to follow downstream session rollovers
+        static void follow_session(Route& route) noexcept;
+
+        template <transport::Transport T>
+        void send_packet(const sockaddr_in& client_address, T& transport) noexcept;
 
         void configure_socket(const Config& cfg);
     };
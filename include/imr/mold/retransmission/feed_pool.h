@@ -1,8 +1,13 @@
 #pragma once
+#include "imr/mold/message_store.h"
 #include "imr/mold/packet_builder.h"
 #include "imr/mold/retransmission/feed.h"
 #include "imr/mold/retransmission_buffer.h"
+#include "imr/util/histogram.h"
+#include "imr/util/metrics.h"
 #include <sys/eventfd.h>
+#include <atomic>
+#include <memory>
 #include <vector>
 #include <thread>
 namespace imr::mold::retransmission
@@ -19,13 +24,24 @@ namespace imr::mold::retransmission
          *
          * Each thread construct an instance of `imr::mold::retransmission::Feed` and then starts it immediately.
          *
+         * @param metrics if not null, each feed publishes its counters in it labelled `thread="<index>"`; must outlive
+         * this object.
+         *
          * @throws std::system_error if the shutdown eventfd fails to be created.
          */
         FeedPool(std::size_t num_feeds,
                  const Feed::Config& feed_cfg,
                  const PacketBuilder::Config& packet_builder_cfg,
-                 std::span<const char> file,
-                 const RetransmissionBuffer& retransmission_buffer);
+                 MessageStore message_store,
+                 const RetransmissionBuffer& retransmission_buffer,
+                 util::metrics::Registry* metrics = nullptr);
+
+        /// As above, each feed serving every channel (sharded replay).
+        FeedPool(std::size_t num_feeds,
+                 const Feed::Config& feed_cfg,
+                 const PacketBuilder::Config& packet_builder_cfg,
+                 std::vector<Feed::Channel> channels,
+                 util::metrics::Registry* metrics = nullptr);
         /** Signals all feed threads to stop by writing to the shared shutdown_fd_.
          *
          *  This is async so retransmission feeds meaning retransmission feeds might finish requests in their epoll set before
@@ -35,8 +51,19 @@ namespace imr::mold::retransmission
          */
         void stop() const;
 
+        /// Service times (see `Feed::record_service_time()`) of every feed so far, merged.
+        [[nodiscard]]
+        util::Histogram::Snapshot service_time() const;
+
+        /// Feed threads in their event loop (see `Feed::count_hot_path()`), `num_feeds` once all have started up.
+        [[nodiscard]]
+        std::size_t hot_path_threads() const noexcept;
+
       private:
         util::FileDescriptor shutdown_fd_{[] { return eventfd(0, EFD_CLOEXEC); }};
+        // one per feed, each recorded by its thread only, outlive the threads
+        std::vector<std::unique_ptr<util::Histogram>> service_times_;
+        std::atomic<std::size_t> hot_path_threads_{0};
         std::vector<std::jthread> feeds_;
         // we have to store these as members otherwise have to copy them N times in constructor
         // (if we pass reference from constructor then it can go out of scope before threads have finished using them)
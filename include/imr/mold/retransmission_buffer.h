@@ -3,6 +3,7 @@
 #include <vector>
 #include <atomic>
 #include <cstddef>
+#include <cstdint>
 #include <optional>
 namespace imr::mold
 {
@@ -25,6 +26,7 @@ namespace imr::mold
         struct MessageRecord
         {
             types::header::SequenceNumber sequence_number;
+            /// Where the message is in the input, resolved by `MessageStore` (file id + offset for multi file inputs).
             std::size_t file_position;
         };
 
@@ -35,6 +37,24 @@ namespace imr::mold
         [[nodiscard]]
         std::optional<std::size_t> file_position_for(types::header::SequenceNumber seq_num) const noexcept;
 
+        /** Starts a new MoldUDP64 session: sequence numbers restart at 1 and earlier records are no longer returned.
+         *
+         *  Readers compare `session_index()` before and after a lookup to detect a rollover in between.
+         */
+        void roll_session() noexcept;
+
+        /// Number of `roll_session()` calls so far.
+        [[nodiscard]]
+        std::uint32_t session_index() const noexcept;
+
+        /// File position of the last message pushed, 0 if none. Writer thread only, no lookup unlike `file_position_for()`.
+        [[nodiscard]]
+        std::size_t last_file_position() const noexcept;
+
+        /// Sequence number of the last message pushed this session, 0 if none.
+        [[nodiscard]]
+        types::header::SequenceNumber written() const noexcept;
+
         /// Capacity of the buffer, in messages.
         [[nodiscard]]
         std::size_t size() const noexcept;
@@ -44,8 +64,11 @@ namespace imr::mold
 
         std::size_t mask_;
         bool use_mask_;
+        // writer side
+        std::size_t last_file_position_{0};
 
         alignas(64) std::atomic<types::header::SequenceNumber> write_seq_{0};
+        std::atomic<std::uint32_t> session_index_{0};
 
         [[nodiscard]]
         std::size_t index_for(types::header::SequenceNumber seq_num) const noexcept;
@@ -0,0 +1,161 @@
+#pragma once
+
+#include "imr/mold/types.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include <sys/types.h>
+
+/** Shared memory broadcast ring the downstream publishes into for co-located consumers (`downstream::ShmWriter`).
+ *
+ *  One writer, any number of reader processes mapping the same file. Entries go into fixed, cache line aligned slots
+ *  (slot `n % slot_count` for the nth entry). Each slot carries a seqlock version so a reader detects an entry being
+ *  overwritten under it, the writer never waits for readers.
+ */
+namespace imr::mold::shm
+{
+    inline constexpr std::array<char, 8> magic{'I', 'M', 'R', 'S', 'H', 'M', '0', '1'};
+    inline constexpr std::size_t cache_line{64};
+    inline constexpr std::size_t max_readers{16};
+
+    enum class Content : std::uint32_t
+    {
+        /// An entry per downstream packet: the MoldUDP64 packet exactly as sent (header + length prefixed messages).
+        packets,
+        /// An entry per message: the ITCH message without its length prefix, `sequence_number` its own.
+        messages,
+    };
+
+    /// Where a registered reader is, so the writer can report its lag.
+    struct alignas(cache_line) ReaderSlot
+    {
+        std::atomic<pid_t> pid;
+        /// Entries the reader has consumed.
+        std::atomic<std::uint64_t> position;
+    };
+
+    struct alignas(cache_line) Header
+    {
+        std::array<char, 8> magic;
+        Content content;
+        std::uint32_t slot_size;
+        std::uint64_t slot_count;
+
+        /// Entries published, entry n is in slot n % slot_count.
+        alignas(cache_line) std::atomic<std::uint64_t> write_index;
+
+        std::array<ReaderSlot, max_readers> readers;
+    };
+
+    struct Slot
+    {
+        /// 2n + 1 while entry n is written, 2n + 2 once it's complete (0 never written).
+        std::atomic<std::uint64_t> version;
+        /// The packet's first sequence number / the message's sequence number.
+        types::header::SequenceNumber sequence_number;
+        std::uint32_t length;
+        /// Messages in the packet (1 per message entry), `types::header::end_of_session_msg_count` for end of session.
+        types::header::MessageCount message_count;
+        std::uint16_t reserved;
+    };
+
+    inline constexpr std::size_t slot_data_offset{sizeof(Slot)};
+
+    /// Bytes per slot for entries of up to `max_length`, a whole number of cache lines.
+    constexpr std::size_t slot_size(std::size_t max_length) noexcept
+    {
+        return (slot_data_offset + max_length + cache_line - 1) / cache_line * cache_line;
+    }
+
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free && std::atomic<pid_t>::is_always_lock_free,
+                  "shared memory atomics must be lock free");
+
+    /** Reads a ring published by `downstream::ShmWriter`, from this or another process.
+     *
+     *  Each reader has its own position and registers it in the ring (while one of `max_readers` slots is free) so the
+     *  writer can report how far behind it is. The slot of a reader that died without detaching is reclaimed by the next
+     *  one to register. A reader lapped by the writer skips to the oldest entry still in the ring,
+     *  counting what it missed in `dropped()`.
+     *
+     * @code{.cpp}
+     * imr::mold::shm::Reader reader{path};
+     *
+     * while (running)
+     * {
+     *     if (const auto entry{reader.try_read()}; entry.has_value())
+     *     {
+     *         handle(entry->sequence_number, entry->data);
+     *     }
+     * }
+     * @endcode
+     */
+    class Reader
+    {
+      public:
+        enum class Start
+        {
+            /// Only entries published after attaching.
+            latest,
+            /// The oldest entry still in the ring.
+            oldest,
+        };
+
+        struct Entry
+        {
+            types::header::SequenceNumber sequence_number;
+            types::header::MessageCount message_count;
+            /// Valid until the next `try_read()`.
+            std::span<const char> data;
+        };
+
+        /** Maps the ring at `path` (`downstream::ShmWriter::path()`).
+         *
+         * @throws std::invalid_argument if the file isn't a ring.
+         * @throws std::system_error if it can't be opened / mapped.
+         */
+        explicit Reader(const std::filesystem::path& path, Start start = Start::latest);
+
+        ~Reader();
+
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+
+        Reader(Reader&&) = delete;
+        Reader& operator=(Reader&&) = delete;
+
+        /// The next entry, nullopt if the writer hasn't published one yet.
+        [[nodiscard]]
+        std::optional<Entry> try_read() noexcept;
+
+        /// Entries published but not read yet.
+        [[nodiscard]]
+        std::uint64_t lag() const noexcept;
+
+        /// Entries overwritten before this reader got to them.
+        [[nodiscard]]
+        std::uint64_t dropped() const noexcept;
+
+        [[nodiscard]]
+        Content content() const noexcept;
+
+      private:
+        std::size_t length_{0};
+        void* mapping_{nullptr};
+        Header* header_{nullptr};
+        std::byte* slots_{nullptr};
+        std::uint64_t mask_{0};
+        std::size_t slot_size_{0};
+
+        ReaderSlot* registration_{nullptr};
+        std::uint64_t position_{0};
+        std::uint64_t dropped_{0};
+
+        std::vector<char> entry_;
+    };
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "imr/mold/message_store.h"
+#include "imr/mold/retransmission_buffer.h"
+#include "imr/mold/types.h"
+#include "imr/util/file_descriptor.h"
+#include "imr/util/zstring_view.h"
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <vector>
+
+#include <sys/socket.h>
+
+namespace itch
+{
+    class OrderBook;
+}
+
+namespace imr::mold::snapshot
+{
+    /** GLIMPSE style snapshot service for late joining consumers.
+     *
+     *  An order book follows the messages the downstream feed records in its `RetransmissionBuffer` (the same
+     *  messages, in sequence order, off the downstream's path). Each TCP client connecting is sent the book as length
+     *  prefixed ITCH messages (see `itch::OrderBook::write_snapshot()`) as of sequence number N, then an end of
+     *  snapshot message ('G' + N + 1, the sequence number to resume the live feed from, left justified in 20 ASCII
+     *  characters), and the connection is closed.
+     *
+     *  The book restarts empty when the downstream rolls its session. Clients are served one at a time, a client not
+     *  reading its snapshot is dropped after `Config::send_timeout` (or at once on stop) rather than holding up the
+     *  next.
+     */
+    class Service
+    {
+      public:
+        /// @ingroup config
+        struct Config
+        {
+            /// Address to listen on.
+            util::zstring_view address;
+            /// Port to listen on. Pass 0 to let the OS assign an ephemeral port.
+            std::uint16_t port;
+            /// How long the book waits for the downstream when it has caught up.
+            std::chrono::nanoseconds poll_interval{std::chrono::microseconds(100)};
+            /// Messages applied per hold of the book lock, bounds how long a snapshot waits.
+            std::size_t batch_size{4096};
+            /// Longest a send to a client may block (SO_SNDTIMEO) before the client is dropped.
+            std::chrono::nanoseconds send_timeout{std::chrono::seconds(5)};
+        };
+
+        static constexpr char end_of_snapshot_type{'G'};
+        static constexpr std::size_t end_of_snapshot_size{1 + 20};
+
+        /** Binds and listens.
+         *
+         * @param message_store resolves positions recorded in `retransmission_buffer` to messages.
+         *
+         * @throws std::invalid_argument if cfg.address is not valid IPv4.
+         * @throws std::system_error if the socket can't be created / bound.
+         */
+        Service(const Config& cfg, MessageStore message_store, const RetransmissionBuffer& retransmission_buffer);
+
+        ~Service();
+
+        Service(const Service&) = delete;
+        Service& operator=(const Service&) = delete;
+
+        Service(Service&&) = delete;
+        Service& operator=(Service&&) = delete;
+
+        /// Runs the book, serving snapshots from a second thread, until `st` is stopped. Blocks.
+        void start(std::stop_token st);
+
+        /// Port listened on (the assigned one if `Config::port` was 0).
+        [[nodiscard]]
+        std::uint16_t port() const;
+
+      private:
+        util::FileDescriptor socket_{[] { return socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0); }};
+        MessageStore message_store_;
+        const RetransmissionBuffer* retransmission_buffer_;
+        std::chrono::nanoseconds poll_interval_;
+        std::size_t batch_size_;
+        std::chrono::nanoseconds send_timeout_;
+
+        // client being sent a snapshot, -1 if none, shut down on stop
+        std::mutex client_mutex_;
+        int client_{-1};
+
+        // guards book_ and applied_
+        std::mutex mutex_;
+        std::unique_ptr<itch::OrderBook> book_;
+        types::header::SequenceNumber applied_{0};
+
+        void run_book(std::stop_token st);
+        void serve(std::stop_token st);
+        void send_snapshot(int client);
+    };
+}
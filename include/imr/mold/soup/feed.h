@@ -0,0 +1,155 @@
+#pragma once
+
+#include "imr/mold/message_store.h"
+#include "imr/mold/retransmission_buffer.h"
+#include "imr/mold/types.h"
+#include "imr/util/file_descriptor.h"
+#include "imr/util/zstring_view.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+namespace imr::mold::soup
+{
+    /** SoupBinTCP server streaming the downstream's sequenced messages to TCP clients (`types::soup`).
+     *
+     *  Follows the messages the downstream feed records in its `RetransmissionBuffer`, so clients see exactly the
+     *  multicast sequence without touching the downstream's thread. Each client logs in with the sequence number to
+     *  start from (1 for the whole session, 0 for the next new message) and has its own cursor, so it is replayed up to
+     *  date at its own pace then streamed live. Frames are gathered into one `sendmsg` (`MSG_NOSIGNAL`, a client that
+     *  went away is an error rather than a SIGPIPE) straight from the input (no copies for mapped files), and a client
+     *  whose socket is full is simply skipped until writable, so one slow consumer never holds up the others or the
+     *  downstream. A client that stays unwritable for `slow_consumer_timeout`, or falls so far behind its messages are
+     *  overwritten in the retransmission buffer, is disconnected.
+     *
+     *  When the downstream rolls its session, clients get an end of session packet and are disconnected. On stop,
+     *  clients are served up to the last recorded message (for at most `drain_timeout`), sent end of session and
+     *  disconnected.
+     */
+    class Feed
+    {
+      public:
+        /// @ingroup config
+        struct Config
+        {
+            /// Address to listen on.
+            util::zstring_view address;
+            /// Port to listen on. Pass 0 to let the OS assign an ephemeral port.
+            std::uint16_t port;
+            /// Login credentials required, any are accepted when empty.
+            std::string_view username;
+            std::string_view password;
+            /// Clients beyond this are disconnected on accept.
+            std::size_t max_clients{1024};
+            /// How long the event loop waits for socket events before checking for new messages.
+            std::chrono::nanoseconds poll_interval{std::chrono::microseconds(100)};
+            /// Server heartbeat sent after this long without sending a client anything.
+            std::chrono::nanoseconds heartbeat_period{std::chrono::seconds(1)};
+            /// Clients sending nothing (not even heartbeats) for this long are disconnected.
+            std::chrono::nanoseconds client_timeout{std::chrono::seconds(15)};
+            /// Clients behind the feed whose socket stays full for this long are disconnected.
+            std::chrono::nanoseconds slow_consumer_timeout{std::chrono::seconds(5)};
+            /// How long clients have to catch up after `start()`'s stop token is stopped.
+            std::chrono::nanoseconds drain_timeout{std::chrono::seconds(5)};
+        };
+
+        /** Binds and listens.
+         *
+         * @param session the downstream's session, followed through rollovers via `RetransmissionBuffer::session_index()`.
+         * @param message_store resolves positions recorded in `retransmission_buffer` to messages.
+         *
+         * @throws std::invalid_argument if cfg.address is not valid IPv4, session isn't 10 characters or the credentials
+         * are longer than their SoupBinTCP fields.
+         * @throws std::system_error if the socket can't be created / bound.
+         */
+        Feed(const Config& cfg,
+             std::string_view session,
+             MessageStore message_store,
+             const RetransmissionBuffer& retransmission_buffer);
+
+        ~Feed();
+
+        Feed(const Feed&) = delete;
+        Feed& operator=(const Feed&) = delete;
+
+        Feed(Feed&&) = delete;
+        Feed& operator=(Feed&&) = delete;
+
+        /// Runs the event loop until `st` is stopped and clients are drained. Blocks.
+        void start(std::stop_token st);
+
+        /// Port listened on (the assigned one if `Config::port` was 0).
+        [[nodiscard]]
+        std::uint16_t port() const;
+
+      private:
+        struct Client;
+
+        using Clock = std::chrono::steady_clock;
+
+        // sequenced data frames gathered per sendmsg, 2 iovecs each (header, message)
+        static constexpr std::size_t batch_size{512};
+
+        util::FileDescriptor socket_{[] { return socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0); }};
+        util::FileDescriptor epoll_fd_{[] { return epoll_create1(EPOLL_CLOEXEC); }};
+        std::array<epoll_event, 256> epoll_events_{};
+
+        std::array<char, types::soup::username_size> username_{};
+        std::array<char, types::soup::password_size> password_{};
+        bool authenticate_;
+
+        types::header::Session session_{};
+        std::uint32_t session_index_;
+        MessageStore message_store_;
+        const RetransmissionBuffer* retransmission_buffer_;
+
+        std::size_t max_clients_;
+        std::chrono::nanoseconds poll_interval_;
+        std::chrono::nanoseconds heartbeat_period_;
+        std::chrono::nanoseconds client_timeout_;
+        std::chrono::nanoseconds slow_consumer_timeout_;
+        std::chrono::nanoseconds drain_timeout_;
+
+        std::vector<std::unique_ptr<Client>> clients_;
+
+        // one sendmsg's worth of frame headers / iovecs, shared as clients are written one at a time
+        std::array<std::array<char, types::soup::payload_offset>, batch_size> frame_headers_{};
+        std::array<iovec, 2 * batch_size> iov_{};
+        // copy destination for stores that don't hand out messages in place
+        std::vector<char> staging_;
+
+        void accept_clients();
+        void read_client(Client& client, Clock::time_point now);
+        void handle_packet(Client& client, char type, std::span<const char> payload);
+        void login(Client& client, std::span<const char> payload);
+
+        // heartbeats, timeouts and writes of one client, true if it has more to send right away
+        bool service_client(Client& client, types::header::SequenceNumber written, Clock::time_point now);
+        // false once the socket is full
+        bool write_data(Client& client, types::header::SequenceNumber written, Clock::time_point now);
+        bool write_control(Client& client);
+
+        void queue(Client& client, char type, std::span<const char> payload) const;
+        // waits for EPOLLOUT before writing the client again
+        void block(Client& client, Clock::time_point now);
+        void want_writable(Client& client, bool writable);
+        void disconnect(Client& client, std::string_view reason);
+        void end_session();
+        void remove_disconnected();
+
+        [[nodiscard]]
+        bool drained(types::header::SequenceNumber written) const noexcept;
+
+        void configure_socket(const Config& cfg);
+    };
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "imr/mold/types.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/** Flight recorder of the downstream's last packets (`downstream::TraceRing`), to reconstruct what the server was doing
+ *  around a gap or latency spike a consumer reports.
+ *
+ *  The ring lives in a shared memory file: a header, then `capacity` cache line sized entries (entry n in slot
+ *  `n % capacity`), each carrying a seqlock version like `shm::Slot`. A dump of the ring is the same layout, so `read()`
+ *  takes a live ring, one left behind by a dead process or a dump alike.
+ */
+namespace imr::mold::trace
+{
+    inline constexpr std::array<char, 8> magic{'I', 'M', 'R', 'T', 'R', 'C', '0', '1'};
+    inline constexpr std::size_t cache_line{64};
+
+    enum class Result : std::uint8_t
+    {
+        /// Handed to the transport.
+        sent,
+        /// The transport reported an error sending it (logged and counted as a send error).
+        send_error,
+        /// Written to the pcap output instead.
+        captured,
+    };
+
+    /// TSC and clocks read together, to convert send TSCs (steady_clock for lateness, CLOCK_REALTIME for wall time).
+    struct Calibration
+    {
+        std::uint64_t tsc;
+        std::int64_t steady_ns;
+        std::int64_t realtime_ns;
+    };
+
+    struct alignas(cache_line) Header
+    {
+        std::array<char, 8> magic;
+        std::uint64_t capacity;
+        /// When the ring was created.
+        Calibration origin;
+        /// When it was last dumped, the TSC rate is what the two are apart.
+        Calibration latest;
+
+        /// Entries written, entry n is in slot n % capacity.
+        alignas(cache_line) std::atomic<std::uint64_t> write_index;
+    };
+
+    struct alignas(cache_line) Entry
+    {
+        /// 2n + 1 while entry n is written, 2n + 2 once it's complete (0 never written).
+        std::atomic<std::uint64_t> version;
+        /// The packet's first sequence number.
+        types::header::SequenceNumber sequence_number;
+        /// Of the packet's last message, as `RetransmissionBuffer` has it.
+        std::uint64_t file_position;
+        /// ITCH timestamp of the packet's first message, nanoseconds since midnight.
+        std::int64_t itch_timestamp;
+        /// When the pacer had it due, steady_clock nanoseconds, 0 if there was no schedule (no wait / virtual time).
+        std::int64_t due;
+        /// `tsc()` right before it went to the transport.
+        std::uint64_t send_tsc;
+        /// Downstream send batch (sendmmsg() of the packet on every line) it went out in, numbered from 0.
+        std::uint64_t batch;
+        types::header::MessageCount message_count;
+        Result result;
+    };
+
+    static_assert(sizeof(Entry) == cache_line);
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "shared memory atomics must be lock free");
+
+    inline std::uint64_t tsc() noexcept
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+    }
+
+    /// Reads the TSC and clocks now.
+    [[nodiscard]]
+    Calibration calibrate() noexcept;
+
+    /// An entry as read back.
+    struct Record
+    {
+        types::header::SequenceNumber sequence_number;
+        types::header::MessageCount message_count;
+        std::uint64_t file_position;
+        std::chrono::nanoseconds itch_timestamp;
+        /// steady_clock nanoseconds, 0 if none.
+        std::int64_t due;
+        std::uint64_t send_tsc;
+        std::uint64_t batch;
+        Result result;
+    };
+
+    struct Trace
+    {
+        Calibration origin;
+        Calibration latest;
+        /// Oldest first. Entries the writer was overwriting while read are left out.
+        std::vector<Record> records;
+    };
+
+    /** Reads a ring (`downstream::TraceRing::path()`), one left behind in a file or a dump of one.
+     *
+     *  A live ring is read on this host: its latest calibration is taken now.
+     *
+     * @throws std::invalid_argument if the file isn't a trace ring / dump.
+     * @throws std::system_error if it can't be opened / mapped.
+     */
+    [[nodiscard]]
+    Trace read(const std::filesystem::path& path);
+
+    /** Copies the ring at `from` to a dump file `to`, calibrated now.
+     *
+     * @throws as `read()`, and std::system_error if `to` can't be written.
+     */
+    void dump(const std::filesystem::path& from, const std::filesystem::path& to);
+
+    /** A CSV row per record: sequence number, message count, file position, ITCH timestamp, due and send time (wall
+     *  clock nanoseconds, empty if unknown), how late it was sent (ns), send TSC, batch, result.
+     */
+    void write_csv(const Trace& trace, std::ostream& out);
+}
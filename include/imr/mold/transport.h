@@ -0,0 +1,109 @@
+#pragma once
+
+#include "imr/util/metrics.h"
+
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <vector>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+/** Where the feeds' packets go, chosen per feed at runtime (`Kind`) and resolved at compile time below that.
+ *
+ *  A feed dispatches once, when it starts, to its event loop instantiated for the transport, so sending a packet is a
+ *  direct (inlinable) call into the transport, no virtual dispatch on the hot path. Every transport takes a batch of
+ *  sendmmsg() style messages, each with its destination, iovecs and (optional) control data, and returns whether all
+ *  of it went out.
+ */
+namespace imr::mold::transport
+{
+    enum class Kind
+    {
+        /// Sent on the feed's UDP socket.
+        udp,
+        /// Downstream only: published to `downstream::Feed::Config::shm_output` and nowhere else.
+        shm,
+        /// Copied into a `Memory` sink, for tests.
+        memory,
+        /// Counted by a `Null` sink and dropped, to measure everything but the system call.
+        null,
+    };
+
+    template <typename T>
+    concept Transport = requires(T transport, std::span<mmsghdr> batch) {
+        { transport.send(batch) } noexcept -> std::same_as<bool>;
+    };
+
+    class Udp
+    {
+      public:
+        explicit Udp(int socket) noexcept
+            : socket_{socket}
+        {
+        }
+
+        bool send(std::span<mmsghdr> batch) noexcept;
+
+        /// Failed sends (each logged), from every thread sending through this transport (a downstream feed's and its
+        /// heartbeat's).
+        [[nodiscard]]
+        util::metrics::Counter& errors() noexcept;
+
+      private:
+        int socket_;
+        util::metrics::Counter errors_;
+    };
+
+    /// Keeps a copy of every packet. Safe to send to from several threads (feed and heartbeat).
+    class Memory
+    {
+      public:
+        using Now = std::chrono::steady_clock::time_point (*)() noexcept;
+
+        struct Packet
+        {
+            /// When it was sent, per the clock set with `set_clock()`.
+            std::chrono::steady_clock::time_point time;
+            sockaddr_in destination;
+            std::vector<char> bytes;
+        };
+
+        bool send(std::span<mmsghdr> batch) noexcept;
+
+        /// Clock stamping packets sent from now on, e.g. `util::VirtualClock::now` (steady_clock by default).
+        void set_clock(Now now) noexcept;
+
+        /// Copy of the packets sent so far.
+        [[nodiscard]]
+        std::vector<Packet> packets() const;
+
+      private:
+        mutable std::mutex mutex_;
+        std::vector<Packet> packets_;
+        std::atomic<Now> now_{&std::chrono::steady_clock::now};
+    };
+
+    /// Counts what would have been sent.
+    class Null
+    {
+      public:
+        bool send(std::span<mmsghdr> batch) noexcept;
+
+        [[nodiscard]]
+        std::uint64_t packets() const noexcept;
+
+        [[nodiscard]]
+        std::uint64_t bytes() const noexcept;
+
+      private:
+        std::atomic<std::uint64_t> packets_{0};
+        std::atomic<std::uint64_t> bytes_{0};
+    };
+
+    static_assert(Transport<Udp> && Transport<Memory> && Transport<Null>);
+}
@@ -2,6 +2,7 @@
 
 #include <cstdint>
 #include <array>
+#include <cstddef>
 
 namespace imr::mold::types
 {
@@ -21,6 +22,98 @@ namespace imr::mold::types
         inline constexpr MessageCount heartbeat_msg_count{0};
         inline constexpr MessageCount end_of_session_msg_count{0xFFFF};
 
+        /** Name of the session following `session`: its trailing digits incremented as a decimal counter
+         *  (SESSION009 -> SESSION010, wrapping to zeros). A name without trailing digits gets '1' as its last character.
+         */
+        constexpr Session roll_session(Session session) noexcept
+        {
+            auto i{session.size()};
+
+            if (session[i - 1] < '0' || session[i - 1] > '9')
+            {
+                session[i - 1] = '1';
+                return session;
+            }
+
+            while (i > 0 && session[i - 1] == '9')
+            {
+                session[--i] = '0';
+            }
+
+            if (i > 0 && session[i - 1] >= '0' && session[i - 1] < '9')
+            {
+                ++session[i - 1];
+            }
+
+            return session;
+        }
+    }
+
+    /** Parity packets of the FEC stream (`downstream::FecEncoder`).
+     *
+     *  Each protects up to 255 downstream packets (by their first sequence number) with the XOR of their bytes after
+     *  the session, zero padded to the longest. A consumer missing exactly one of them rebuilds it from the others.
+     */
+    namespace fec
+    {
+        enum class Kind : std::uint8_t
+        {
+            /// `FecEncoder::Config::k` packets `interleave` apart.
+            column,
+            /// `FecEncoder::Config::interleave` consecutive packets.
+            row,
+        };
+
+        inline constexpr std::size_t session_offset{0};
+        inline constexpr std::size_t kind_offset{sizeof(header::Session)};
+        inline constexpr std::size_t count_offset{kind_offset + sizeof(Kind)};
+        /// XOR of the protected lengths (each packet's length minus the session).
+        inline constexpr std::size_t length_offset{count_offset + sizeof(std::uint8_t)};
+        inline constexpr std::size_t sequence_numbers_offset{length_offset + sizeof(std::uint16_t)};
+
+        inline constexpr std::size_t max_count{0xFF};
+
+        constexpr std::size_t payload_offset(std::size_t count) noexcept
+        {
+            return sequence_numbers_offset + (count * sizeof(header::SequenceNumber));
+        }
+    }
+
+    /** SoupBinTCP 4.0 packets (`soup::Feed`): a 2 byte big endian length (of what follows), a type and its payload.
+     *
+     *  https://www.nasdaqtrader.com/content/technicalsupport/specifications/dataproducts/soupbintcp.pdf
+     */
+    namespace soup
+    {
+        using Length = std::uint16_t;
+
+        inline constexpr std::size_t type_offset{sizeof(Length)};
+        inline constexpr std::size_t payload_offset{type_offset + 1};
+
+        // server -> client
+        inline constexpr char login_accepted_type{'A'};
+        inline constexpr char login_rejected_type{'J'};
+        inline constexpr char sequenced_data_type{'S'};
+        inline constexpr char server_heartbeat_type{'H'};
+        inline constexpr char end_of_session_type{'Z'};
+
+        // client -> server
+        inline constexpr char login_request_type{'L'};
+        inline constexpr char client_heartbeat_type{'R'};
+        inline constexpr char logout_request_type{'O'};
+
+        inline constexpr std::size_t username_size{6};
+        inline constexpr std::size_t password_size{10};
+        /// ASCII, left justified / space padded alphanumerics, right justified / space padded numerics.
+        inline constexpr std::size_t sequence_number_size{20};
+
+        /// Login request payload: username, password, requested session (blank for current), requested sequence number.
+        inline constexpr std::size_t login_request_size{username_size + password_size + sizeof(header::Session) + sequence_number_size};
+        /// Login accepted payload: session, sequence number of the next sequenced data packet.
+        inline constexpr std::size_t login_accepted_size{sizeof(header::Session) + sequence_number_size};
+
+        inline constexpr char reject_not_authorized{'A'};
+        inline constexpr char reject_session_not_available{'S'};
     }
 
     using LengthPrefix = std::uint16_t;
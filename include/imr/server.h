@@ -5,11 +5,26 @@
 #include "imr/mold/retransmission_buffer.h"
 #include "imr/mold/retransmission/feed_pool.h"
 #include "imr/mold/downstream/feed.h"
+#include "imr/mold/downstream/filter_source.h"
+#include "imr/mold/downstream/merge_source.h"
+#include "imr/mold/downstream/pcap_source.h"
+#include "imr/mold/downstream/playlist_source.h"
+#include "imr/mold/downstream/shard_map.h"
+#include "imr/mold/downstream/source.h"
+#include "imr/mold/downstream/stream_source.h"
+#include "imr/mold/snapshot/service.h"
+#include "imr/mold/soup/feed.h"
+#include "imr/util/histogram.h"
+#include "imr/util/metrics.h"
 
+#include <atomic>
 #include <thread>
 #include <memory>
+#include <optional>
+#include <string_view>
 #include <expected>
 #include <algorithm>
+#include <vector>
 
 /**
  *
@@ -56,6 +71,21 @@ namespace imr
          * @brief Configuration structs for each component of the server.
          */
 
+        /** A downstream channel of a sharded replay.
+         *
+         * @ingroup config
+         */
+        struct ChannelConfig
+        {
+            /// Multicast group / port, heartbeats etc. of this channel.
+            mold::downstream::Feed::Config downstream_feed_config;
+            /// MoldUDP64 session of this channel, must be 10 characters and differ from the other channels' (retransmission
+            /// requests are routed by it), as must `downstream_feed_config`'s group:port.
+            std::string_view session;
+            /// Core to pin this channel's downstream thread to.
+            std::optional<unsigned> cpu;
+        };
+
         /** Aggregate for configuration of all server components.
          *
          * @ingroup config
@@ -63,6 +93,46 @@ namespace imr
         struct Config
         {
             util::MemoryMappedFile::Config mapped_itch_file_cfg;
+            /**
+             Further ITCH files merged with `mapped_itch_file_cfg` by timestamp into one sequenced stream.
+
+             `mapped_itch_file_cfg` is file id 0 and these follow in order (ties on timestamp go to the lower id).
+             Not supported with `stream_input_cfg` or `pcap_input_cfg`.
+             */
+            std::vector<util::MemoryMappedFile::Config> merge_itch_file_cfgs;
+            /**
+             Play `mapped_itch_file_cfg` then `playlist_itch_file_cfgs` back to back (looping per `loops`) on the same
+             sockets and threads instead of once. See `downstream_feed_config.rollover` for session handling.
+
+             Not supported with `stream_input_cfg`, `pcap_input_cfg` or `merge_itch_file_cfgs`.
+             */
+            std::optional<mold::downstream::PlaylistSource::Config> playlist_cfg;
+            /// Files played after `mapped_itch_file_cfg` when `playlist_cfg` is set.
+            std::vector<util::MemoryMappedFile::Config> playlist_itch_file_cfgs;
+            /**
+             Only replay messages of `mapped_itch_file_cfg` matching these stocks / message types, renumbered from 1.
+
+             Not supported with the other input options.
+             */
+            std::optional<mold::downstream::FilterSource::Config> filter_cfg;
+            /**
+             Shard `mapped_itch_file_cfg` across these channels by stock locate (see `shard_map_cfg`) instead of replaying
+             it on `downstream_feed_config`.
+
+             Each channel has its own sequence numbers and retransmission buffer (`retransmission_buffer_size` each),
+             market wide messages go to every channel. The retransmission feeds serve all channels, routing requests by
+             session. Not supported with the other input options.
+             */
+            std::vector<ChannelConfig> channel_cfgs;
+            mold::downstream::ShardMap::Config shard_map_cfg;
+            /**
+             Read messages from a pipe / stdin / unix socket instead of mapping `mapped_itch_file_cfg.path`.
+
+             Retransmission can only reach back as far as `ring_size` bytes of the stream.
+             */
+            std::optional<mold::downstream::StreamSource::Config> stream_input_cfg;
+            /// Treat the file at `mapped_itch_file_cfg.path` as a pcap / pcapng capture of a MoldUDP64 feed.
+            std::optional<mold::downstream::PcapSource::Config> pcap_input_cfg;
             mold::PacketBuilder::Config packet_builder_cfg;
             mold::downstream::Feed::Config downstream_feed_config;
             /**
@@ -78,12 +148,33 @@ namespace imr
              Defaults to either 1 or one less than the hardware thread count for multicore systems to leave one thread for the downstream feed
              */
             std::size_t num_retransmission_feeds{std::max(std::thread::hardware_concurrency() - 1, 1U)};
+            /**
+             Serve TCP snapshots of the order book (built from the replayed messages) so late joiners can start
+             without replaying the whole session through retransmission requests.
+
+             Not supported with `channel_cfgs`.
+             */
+            std::optional<mold::snapshot::Service::Config> snapshot_cfg;
+            /**
+             Also stream the replay to SoupBinTCP clients, for consumers that can't join multicast. Clients log in with
+             `packet_builder_cfg.session` (or blank) and the sequence number to start from.
+
+             Not supported with `channel_cfgs`.
+             */
+            std::optional<mold::soup::Feed::Config> soup_cfg;
+            /**
+             Publish counters / gauges of the feeds in a shared memory segment (downstream per `channel`, retransmission
+             per `thread`), readable with `util::metrics::Reader`.
+             */
+            std::optional<util::metrics::Registry::Config> metrics_cfg;
+            /// Also serve them for Prometheus to scrape. Requires `metrics_cfg`.
+            std::optional<util::metrics::Endpoint::Config> metrics_endpoint_cfg;
         };
 
         /**
          Constructs server ready to start
 
-         @throws std::invalid_arugment if configuration passed is invalid
+         @throws std::invalid_arugment if configuration passed is invalid (including both `stream_input_cfg` and `pcap_input_cfg` set, or more than one of `merge_itch_file_cfgs` / `playlist_cfg` / `filter_cfg` / `channel_cfgs` / either of those, `snapshot_cfg` / `soup_cfg` with `channel_cfgs`, `metrics_endpoint_cfg` without `metrics_cfg`, or a filter symbol not in the file)
          @throws std::system_error if system calls to setup server fail
         */
         explicit Server(const Config& cfg);
@@ -96,7 +187,7 @@ namespace imr
          */
         void start();
 
-        /// Blocks caller until downstream replay finishes.
+        /// Blocks caller until downstream replay (of every channel) finishes.
         void wait_for_downstream();
 
         /// Stop all feeds early (before downstream reaches end of file).
@@ -110,14 +201,70 @@ namespace imr
         Server& operator=(const Server&) = delete;
         Server& operator=(Server&&) = delete;
 
+        /// Null unless `Config::metrics_cfg` is set.
+        [[nodiscard]]
+        const util::metrics::Registry* metrics() const noexcept;
+
+        /** How late downstream packets went out behind their paced send time, in nanoseconds, across channels.
+         *
+         *  Callable while running, logged with `retransmission_service_time()` when the downstream finishes.
+         */
+        [[nodiscard]]
+        util::Histogram::Snapshot downstream_lateness() const;
+
+        /// Time from receiving a retransmission request to sending its response, in nanoseconds, across threads.
+        [[nodiscard]]
+        util::Histogram::Snapshot retransmission_service_time() const;
+
+        /** Downstream and retransmission threads currently in their hot path (see `util::hot_path`): the steady state
+         *  loops that don't allocate, entered once a thread's startup is done and exited as it finishes.
+         *
+         *  Reaches one per channel plus `Config::num_retransmission_feeds` once everything has started up, hooks
+         *  installed with `util::hot_path::set_hooks()` see each thread enter / exit on the thread itself.
+         */
+        [[nodiscard]]
+        std::size_t hot_path_threads() const noexcept;
+
       private:
-        util::MemoryMappedFile mapped_itch_file_;
-        mold::RetransmissionBuffer retransmission_buffer_;
-        mold::downstream::Feed downstream_feed_;
-        std::jthread downstream_thread_;
+        // source, retransmission buffer, downstream feed and thread of one channel
+        struct Channel;
+
+        // null unless `Config::metrics_cfg` is set, outlives the feeds updating it
+        std::unique_ptr<util::metrics::Registry> metrics_;
+        // null unless `Config::metrics_endpoint_cfg` is set
+        std::unique_ptr<util::metrics::Endpoint> metrics_endpoint_;
+        std::jthread metrics_thread_;
+        // empty when replaying from `Config::stream_input_cfg`
+        std::vector<util::MemoryMappedFile> mapped_itch_files_;
+        // a single channel unless `Config::channel_cfgs` is set
+        std::vector<std::unique_ptr<Channel>> channels_;
+        // last channel to finish stops the retransmission feeds
+        std::atomic<std::size_t> running_channels_{0};
+        // downstream threads in their replay loop
+        std::atomic<std::size_t> downstream_hot_path_threads_{0};
         mold::retransmission::FeedPool retransmission_feeds_;
+        // null unless `Config::snapshot_cfg` is set
+        std::unique_ptr<mold::snapshot::Service> snapshot_service_;
+        std::jthread snapshot_thread_;
+        // null unless `Config::soup_cfg` is set
+        std::unique_ptr<mold::soup::Feed> soup_feed_;
+        std::jthread soup_thread_;
+
+        [[nodiscard]]
+        static std::unique_ptr<util::metrics::Registry> make_metrics(const Config& cfg);
+
+        [[nodiscard]]
+        static std::vector<std::unique_ptr<Channel>> make_channels(const Config& cfg,
+                                                                   const std::vector<util::MemoryMappedFile>& mapped_itch_files);
+
+        [[nodiscard]]
+        std::vector<mold::retransmission::Feed::Channel> retransmission_channels() const;
+
+        [[nodiscard]]
+        std::unique_ptr<mold::snapshot::Service> make_snapshot_service(const Config& cfg) const;
 
-        void join_downstream();
+        [[nodiscard]]
+        std::unique_ptr<mold::soup::Feed> make_soup_feed(const Config& cfg) const;
     };
 
     /**
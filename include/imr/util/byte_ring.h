@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <span>
+
+namespace imr::util
+{
+    /** Bounded byte ring addressed by absolute (ever increasing) offsets.
+     *
+     *  Backed by a memfd mapped twice back to back, so any range of up to `capacity()` bytes is contiguous in memory
+     *  regardless of where it wraps, and can be handed straight to `PacketBuilder::try_add`.
+     *
+     *  Single writer, N readers. The writer owns everything between `tail()` and `head()`; readers on other threads
+     *  must go through `copy_to()`, which validates the copy against concurrent overwrite (seqlock style) rather
+     *  than holding a view.
+     */
+    class ByteRing
+    {
+      public:
+        /**
+         *  @param capacity size of the ring in bytes. Rounded up to a power of two multiple of the page size.
+         *
+         *  @throws std::invalid_argument if capacity is 0.
+         *  @throws std::system_error if the memfd / mappings fail.
+         */
+        explicit ByteRing(std::size_t capacity);
+
+        ByteRing(const ByteRing&) = delete;
+        ByteRing& operator=(const ByteRing&) = delete;
+
+        ByteRing(ByteRing&&) = delete;
+        ByteRing& operator=(ByteRing&&) = delete;
+
+        ~ByteRing();
+
+        /// Capacity of the ring, in bytes.
+        [[nodiscard]]
+        std::size_t capacity() const noexcept;
+
+        /// Absolute offset one past the last committed byte.
+        [[nodiscard]]
+        std::size_t head() const noexcept;
+
+        /// Oldest absolute offset that has not been (or is not about to be) overwritten.
+        [[nodiscard]]
+        std::size_t tail() const noexcept;
+
+        /** Contiguous view of `length` bytes starting at absolute `offset`.
+         *
+         *  Writer thread only (or any caller that otherwise knows the range can't be overwritten while in use).
+         */
+        [[nodiscard]]
+        std::span<const char> view(std::size_t offset, std::size_t length) const noexcept;
+
+        /** Writer: returns `length` writable bytes at `head()`.
+         *
+         *  Anything older than `head() + length - capacity()` is invalidated before the span is returned, so
+         *  concurrent `copy_to()` calls on that range fail instead of returning torn data.
+         */
+        [[nodiscard]]
+        std::span<char> prepare(std::size_t length) noexcept;
+
+        /// Writer: publishes `length` bytes of the last `prepare()` to readers.
+        void commit(std::size_t length) noexcept;
+
+        /** Reader (any thread): copies `dst.size()` bytes starting at absolute `offset` into `dst`.
+         *
+         *  @returns false if any part of the range is not committed yet or was overwritten during the copy.
+         */
+        [[nodiscard]]
+        bool copy_to(std::size_t offset, std::span<char> dst) const noexcept;
+
+      private:
+        std::size_t capacity_;
+        std::size_t mask_;
+        char* data_{nullptr};
+
+        alignas(64) std::atomic<std::size_t> head_{0};
+        alignas(64) std::atomic<std::size_t> tail_{0};
+    };
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+namespace imr::util
+{
+    /** Log bucketed histogram of non negative values (nanoseconds, bytes...), in the manner of HdrHistogram.
+     *
+     *  Values below `sub_bucket_count` are counted exactly, larger ones in buckets whose width doubles with each power
+     *  of two so every bucket stays within 1 / `sub_bucket_half` (< 0.8%) of the values it holds, across the whole
+     *  std::uint64_t range. Counts live in a fixed array: recording never allocates.
+     *
+     *  Single writer, like `metrics::Counter::increment()`: one thread records (a relaxed load and store), any thread
+     *  takes a `Snapshot` at any time. Record per thread and `Snapshot::add()` each thread's histogram to merge them.
+     *
+     * @code{.cpp}
+     * imr::util::Histogram latency;
+     * latency.record(elapsed.count());
+     *
+     * imr::util::Histogram::Snapshot snapshot;
+     * snapshot.add(latency);
+     * std::println("p99 {}ns", snapshot.percentile(99.0));
+     * @endcode
+     */
+    class Histogram
+    {
+      public:
+        static constexpr unsigned sub_bucket_bits{8};
+        static constexpr std::size_t sub_bucket_count{1UZ << sub_bucket_bits};
+        static constexpr std::size_t sub_bucket_half{sub_bucket_count / 2};
+        static constexpr std::size_t bucket_count{(64 - sub_bucket_bits + 2) * sub_bucket_half};
+
+        /// Merged, non atomic copy of histograms' counts to query.
+        class Snapshot
+        {
+          public:
+            Snapshot();
+
+            /// Adds `histogram`'s counts so far.
+            void add(const Histogram& histogram);
+
+            [[nodiscard]]
+            std::uint64_t count() const noexcept;
+
+            /// 0 if empty.
+            [[nodiscard]]
+            std::uint64_t min() const noexcept;
+
+            /// Highest value equivalent to the largest recorded, 0 if empty.
+            [[nodiscard]]
+            std::uint64_t max() const noexcept;
+
+            /// Exact, 0 if empty.
+            [[nodiscard]]
+            double mean() const noexcept;
+
+            /** Value at or below which `percentile` % of the recorded values are, as the highest value equivalent to
+             *  it (0 if empty). `percentile` is clamped to [0, 100].
+             */
+            [[nodiscard]]
+            std::uint64_t percentile(double percentile) const noexcept;
+
+          private:
+            std::vector<std::uint64_t> counts_;
+            std::uint64_t count_{0};
+            std::uint64_t sum_{0};
+        };
+
+        Histogram() noexcept = default;
+
+        Histogram(const Histogram&) = delete;
+        Histogram& operator=(const Histogram&) = delete;
+
+        Histogram(Histogram&&) = delete;
+        Histogram& operator=(Histogram&&) = delete;
+
+        void record(std::uint64_t value) noexcept
+        {
+            auto& count{counts_[index_of(value)]};
+            count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            sum_.store(sum_.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        }
+
+        [[nodiscard]]
+        static constexpr std::size_t index_of(std::uint64_t value) noexcept
+        {
+            if (value < sub_bucket_count)
+            {
+                return value;
+            }
+
+            // the top sub_bucket_bits bits of value pick the slot within its power of two
+            const auto shift{static_cast<unsigned>(std::bit_width(value)) - sub_bucket_bits};
+            return (shift * sub_bucket_half) + (value >> shift);
+        }
+
+        [[nodiscard]]
+        static constexpr std::uint64_t lowest_equivalent(std::size_t index) noexcept
+        {
+            if (index < sub_bucket_count)
+            {
+                return index;
+            }
+
+            const auto shift{(index / sub_bucket_half) - 1};
+            return (sub_bucket_half + (index % sub_bucket_half)) << shift;
+        }
+
+        [[nodiscard]]
+        static constexpr std::uint64_t highest_equivalent(std::size_t index) noexcept
+        {
+            if (index < sub_bucket_count)
+            {
+                return index;
+            }
+
+            const auto shift{(index / sub_bucket_half) - 1};
+            return lowest_equivalent(index) + ((1UZ << shift) - 1);
+        }
+
+      private:
+        std::array<std::atomic<std::uint64_t>, bucket_count> counts_{};
+        // wraps after ~584 years of nanoseconds
+        std::atomic<std::uint64_t> sum_{0};
+    };
+
+    static_assert(Histogram::index_of(~0ULL) == Histogram::bucket_count - 1);
+    static_assert(Histogram::highest_equivalent(Histogram::bucket_count - 1) == ~0ULL);
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/** Marks the steady state loops of the replay and retransmission threads, the code that is meant not to allocate.
+ *
+ *  A feed thread enters its hot path once its startup is done (sockets, heartbeat thread, log registration) and exits
+ *  it to finish, or around the rare steps in between that may allocate (opening the next playlist item, rolling the
+ *  session). Hooks installed with `set_hooks()` are called on that thread as it does, which is how an allocation
+ *  counter interposing `operator new` / `malloc` tells startup allocations from steady state ones.
+ */
+namespace imr::util::hot_path
+{
+    enum class Kind : std::uint8_t
+    {
+        none,
+        downstream,
+        retransmission,
+    };
+
+    /// Called on the thread entering / exiting its hot path, must not allocate or throw.
+    struct Hooks
+    {
+        void (*entered)(Kind) noexcept{nullptr};
+        void (*exited)(Kind) noexcept{nullptr};
+    };
+
+    /// Process wide, install before starting a server and keep until it's stopped.
+    void set_hooks(Hooks hooks) noexcept;
+
+    /// The hot path the calling thread is in, `Kind::none` outside one.
+    [[nodiscard]]
+    Kind current() noexcept;
+
+    /// The calling thread is in its `kind` hot path for the scope's lifetime, counted in `threads` if given.
+    class Scope
+    {
+      public:
+        Scope(Kind kind, std::atomic<std::size_t>* threads) noexcept;
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope(Scope&&) = delete;
+
+        Scope& operator=(const Scope&) = delete;
+        Scope& operator=(Scope&&) = delete;
+
+      private:
+        friend class Pause;
+
+        void enter() noexcept;
+        void exit() noexcept;
+
+        Kind kind_;
+        std::atomic<std::size_t>* threads_;
+    };
+
+    /// Steps out of `scope` for a step allowed to allocate, back in when it's done.
+    class Pause
+    {
+      public:
+        explicit Pause(Scope& scope) noexcept;
+        ~Pause();
+
+        Pause(const Pause&) = delete;
+        Pause(Pause&&) = delete;
+
+        Pause& operator=(const Pause&) = delete;
+        Pause& operator=(Pause&&) = delete;
+
+      private:
+        Scope* scope_;
+    };
+}
@@ -1,9 +1,33 @@
 #pragma once
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <cstring>
 #include <format>
 #include <print>
 #include <source_location>
+#include <span>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
 #include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/** Logging filtered at compile time (`IMR_LOG_LEVEL`), written by a background thread.
+ *
+ *  A call copies its format string, arguments (strings by value, truncated to fit) and a TSC timestamp into a fixed
+ *  size record on a ring of the calling thread's own and returns: no formatting, stdio lock or system call on the
+ *  caller's path, so a send error logged per packet doesn't stall the replay. The background thread formats records of
+ *  every thread in timestamp order. A full ring drops the record, the drops are reported instead.
+ *
+ *  Arguments of other types than arithmetic / enum / strings are formatted and written inline.
+ */
 namespace imr::util::log
 {
     namespace detail
@@ -18,6 +42,14 @@ namespace imr::util::log
         inline constexpr std::string_view color_info{"\033[36m"};
         inline constexpr std::string_view color_debug{"\033[35m"};
 
+        enum class Level : std::uint8_t
+        {
+            error,
+            warn,
+            info,
+            debug,
+        };
+
         template <typename... Args>
         void base(std::FILE* stream, std::string_view tag, std::string_view color, std::format_string<Args...> fmt, Args&&... args)
         {
@@ -27,13 +59,288 @@ namespace imr::util::log
                 std::print(stream, "[imr:{}] ", tag);
             std::println(stream, fmt, std::forward<Args>(args)...);
         }
+
+        inline constexpr std::size_t record_size{256};
+
+        struct Record;
+        /// Formats a record's message, instantiated per format string's argument types: the format string's id.
+        using Format = std::string (*)(Record& record);
+
+        struct alignas(64) Record
+        {
+            Format format;
+            std::uint64_t tsc;
+            Level level;
+            /// The std::format_string, then the arguments.
+            std::array<std::byte, record_size - 24> payload;
+        };
+
+        static_assert(sizeof(Record) == record_size);
+
+        /// Single producer (the owner thread), single consumer (the background thread).
+        class Ring
+        {
+          public:
+            static constexpr std::size_t capacity{512};
+
+            /// Slot to fill then `publish()`, nullptr (counted as dropped) if full.
+            Record* claim() noexcept
+            {
+                const auto head{head_.load(std::memory_order_relaxed)};
+                if (head - tail_.load(std::memory_order_acquire) == capacity)
+                {
+                    dropped_.store(dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                    return nullptr;
+                }
+                return &records_[head % capacity];
+            }
+
+            void publish() noexcept
+            {
+                head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+            }
+
+            /// Consumer: the next record, nullptr if empty.
+            Record* front() noexcept
+            {
+                const auto tail{tail_.load(std::memory_order_relaxed)};
+                return tail == head_.load(std::memory_order_acquire) ? nullptr : &records_[tail % capacity];
+            }
+
+            /// Consumer: done with `front()`.
+            void pop() noexcept
+            {
+                tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+            }
+
+            [[nodiscard]]
+            std::uint64_t dropped() const noexcept
+            {
+                return dropped_.load(std::memory_order_relaxed);
+            }
+
+          private:
+            alignas(64) std::atomic<std::uint64_t> head_{0};
+            alignas(64) std::atomic<std::uint64_t> tail_{0};
+            alignas(64) std::atomic<std::uint64_t> dropped_{0};
+            std::array<Record, capacity> records_{};
+        };
+
+        /// The calling thread's ring, registered with the background thread on first use (nullptr if that fails).
+        Ring* ring() noexcept;
+
+        inline std::uint64_t timestamp() noexcept
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            return __rdtsc();
+#else
+            return static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+        }
+
+        class Writer
+        {
+          public:
+            explicit Writer(std::span<std::byte> out) noexcept
+                : out_{out}
+            {
+            }
+
+            template <typename T>
+            void value(const T& value) noexcept
+            {
+                std::memcpy(out_.data(), &value, sizeof(T));
+                out_ = out_.subspan(sizeof(T));
+            }
+
+            /// Length, characters, NUL. Truncated to the space left past what the remaining arguments need.
+            void text(std::string_view text, std::size_t reserved) noexcept
+            {
+                const auto length{std::min(text.size(), out_.size() - reserved - sizeof(std::uint16_t) - 1)};
+                value(static_cast<std::uint16_t>(length));
+                std::memcpy(out_.data(), text.data(), length);
+                out_[length] = std::byte{0};
+                out_ = out_.subspan(length + 1);
+            }
+
+          private:
+            std::span<std::byte> out_;
+        };
+
+        class Reader
+        {
+          public:
+            explicit Reader(std::span<std::byte> in) noexcept
+                : in_{in}
+            {
+            }
+
+            template <typename T>
+            T value() noexcept
+            {
+                std::array<std::byte, sizeof(T)> bytes{};
+                std::memcpy(bytes.data(), in_.data(), sizeof(T));
+                in_ = in_.subspan(sizeof(T));
+                return std::bit_cast<T>(bytes);
+            }
+
+            /// NUL terminated, in the record.
+            char* text() noexcept
+            {
+                const auto length{value<std::uint16_t>()};
+                auto* text{reinterpret_cast<char*>(in_.data())};
+                in_ = in_.subspan(length + 1UZ);
+                return text;
+            }
+
+          private:
+            std::span<std::byte> in_;
+        };
+
+        /// How an argument of type T travels in a record, undefined for types formatted inline.
+        template <typename T>
+        struct Arg;
+
+        template <typename T>
+            requires std::is_arithmetic_v<T> || std::is_enum_v<T>
+        struct Arg<T>
+        {
+            static constexpr std::size_t size{sizeof(T)};
+
+            static void put(Writer& writer, T value, std::size_t /*reserved*/) noexcept
+            {
+                writer.value(value);
+            }
+
+            static T get(Reader& reader) noexcept
+            {
+                return reader.value<T>();
+            }
+        };
+
+        template <typename T>
+            requires std::is_same_v<T, const char*> || std::is_same_v<T, char*>
+        struct Arg<T>
+        {
+            static constexpr std::size_t size{sizeof(std::uint16_t) + 1};
+
+            static void put(Writer& writer, const char* value, std::size_t reserved) noexcept
+            {
+                writer.text(value, reserved);
+            }
+
+            static T get(Reader& reader) noexcept
+            {
+                return reader.text();
+            }
+        };
+
+        template <typename T>
+            requires std::is_same_v<T, std::string_view> || std::is_same_v<T, std::string>
+        struct Arg<T>
+        {
+            static constexpr std::size_t size{sizeof(std::uint16_t) + 1};
+
+            static void put(Writer& writer, std::string_view value, std::size_t reserved) noexcept
+            {
+                writer.text(value, reserved);
+            }
+
+            static T get(Reader& reader)
+            {
+                return T(reader.text());
+            }
+        };
+
+        /// Arguments a record can carry (string literals, as arrays, are formatted inline).
+        template <typename... Args>
+        concept Deferrable = (requires { Arg<std::decay_t<Args>>::size; } && ...) &&
+                             (!std::is_array_v<std::remove_reference_t<Args>> && ...) &&
+                             std::is_trivially_copyable_v<std::format_string<Args...>> &&
+                             sizeof(std::format_string<Args...>) + (0UZ + ... + Arg<std::decay_t<Args>>::size) <=
+                                 sizeof(Record::payload);
+
+        template <typename... Args>
+        std::string format(Record& record)
+        {
+            Reader reader(record.payload);
+            const auto fmt{reader.value<std::format_string<Args...>>()};
+
+            // braced, so the arguments are read in order
+            std::tuple<std::decay_t<Args>...> values{Arg<std::decay_t<Args>>::get(reader)...};
+
+            return std::apply([&fmt](auto&... value) { return std::format<Args...>(fmt, static_cast<Args&&>(value)...); },
+                              values);
+        }
+
+        template <std::size_t I, typename Tuple>
+        void put(Writer& writer, const Tuple& args) noexcept
+        {
+            if constexpr (I < std::tuple_size_v<Tuple>)
+            {
+                using T = std::decay_t<std::tuple_element_t<I, Tuple>>;
+
+                // what the arguments after this one need at least
+                constexpr auto reserved{[]<std::size_t... J>(std::index_sequence<J...>) {
+                    return (0UZ + ... + Arg<std::decay_t<std::tuple_element_t<I + 1 + J, Tuple>>>::size);
+                }(std::make_index_sequence<std::tuple_size_v<Tuple> - I - 1>{})};
+
+                Arg<T>::put(writer, std::get<I>(args), reserved);
+                put<I + 1>(writer, args);
+            }
+        }
+
+        template <typename... Args>
+        void log(Level severity, std::FILE* stream, std::string_view tag, std::string_view color, std::format_string<Args...> fmt, Args&&... args)
+        {
+            if constexpr (Deferrable<Args...>)
+            {
+                if (auto* const own{ring()}; own != nullptr) [[likely]]
+                {
+                    auto* const record{own->claim()};
+                    if (record == nullptr)
+                    {
+                        return;
+                    }
+
+                    record->format = &format<Args...>;
+                    record->tsc = timestamp();
+                    record->level = severity;
+
+                    Writer writer(record->payload);
+                    writer.value(fmt);
+                    put<0>(writer, std::tie(args...));
+
+                    own->publish();
+                    return;
+                }
+            }
+
+            base(stream, tag, color, fmt, std::forward<Args>(args)...);
+        }
     }
+
+    /// Blocks until what this and every other thread logged so far is written out.
+    void flush();
+
+    /** Registers the calling thread's ring (starting the background thread) ahead of its first record.
+     *
+     *  Registering allocates: threads call this before loops that mustn't, whose first record may be an error.
+     */
+    inline void register_thread() noexcept
+    {
+        if constexpr (detail::level >= 0)
+        {
+            static_cast<void>(detail::ring());
+        }
+    }
+
     template <typename... Args>
     void error(std::format_string<Args...> fmt, Args&&... args)
     {
         if constexpr (detail::level >= 0)
         {
-            detail::base(stderr, "error", detail::color_error, fmt, std::forward<Args>(args)...);
+            detail::log(detail::Level::error, stderr, "error", detail::color_error, fmt, std::forward<Args>(args)...);
         }
     }
     // mimics std::perror but never any msg other than loc.function_name
@@ -49,7 +356,7 @@ namespace imr::util::log
     {
         if constexpr (detail::level >= 1)
         {
-            detail::base(stdout, "warn", detail::color_warn, fmt, std::forward<Args>(args)...);
+            detail::log(detail::Level::warn, stdout, "warn", detail::color_warn, fmt, std::forward<Args>(args)...);
         }
     }
     template <typename... Args>
@@ -57,7 +364,7 @@ namespace imr::util::log
     {
         if constexpr (detail::level >= 2)
         {
-            detail::base(stdout, "info", detail::color_info, fmt, std::forward<Args>(args)...);
+            detail::log(detail::Level::info, stdout, "info", detail::color_info, fmt, std::forward<Args>(args)...);
         }
     }
     template <typename... Args>
@@ -65,7 +372,7 @@ namespace imr::util::log
     {
         if constexpr (detail::level >= 3)
         {
-            detail::base(stdout, "debug", detail::color_debug, fmt, std::forward<Args>(args)...);
+            detail::log(detail::Level::debug, stdout, "debug", detail::color_debug, fmt, std::forward<Args>(args)...);
         }
     }
     template <typename... Args>
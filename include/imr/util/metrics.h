@@ -0,0 +1,267 @@
+#pragma once
+
+#include "imr/util/file_descriptor.h"
+#include "imr/util/zstring_view.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <span>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+/** Counters and gauges of a running server, published in a shared memory segment (`Registry`) that other processes
+ *  read (`Reader`) and scraped over HTTP in the Prometheus text format (`Endpoint`).
+ *
+ *  A metric normally has a single writer, the thread owning it (a feed registers its own per thread series), so an
+ *  update is one relaxed load and store into a slot on a cache line of its own. The few counters more than one thread
+ *  updates (a downstream's send errors, counted by its heartbeat thread too) use `Counter::increment_shared()`, an
+ *  atomic add. Series registered twice under the same name and labels are summed when read.
+ */
+namespace imr::util::metrics
+{
+    inline constexpr std::array<char, 8> magic{'I', 'M', 'R', 'M', 'E', 'T', '0', '1'};
+    inline constexpr std::size_t cache_line{64};
+    inline constexpr std::size_t name_size{48};
+    inline constexpr std::size_t labels_size{64};
+
+    enum class Kind : std::uint32_t
+    {
+        counter,
+        gauge,
+    };
+
+    struct alignas(cache_line) Slot
+    {
+        /// The metric's value, a gauge's std::int64_t bit cast.
+        std::atomic<std::uint64_t> value;
+        Kind kind;
+        /// NUL padded.
+        std::array<char, name_size> name;
+        /// Prometheus label list without the braces, e.g. `thread="1"`, NUL padded.
+        std::array<char, labels_size> labels;
+    };
+
+    struct alignas(cache_line) Header
+    {
+        std::array<char, 8> magic;
+        std::uint32_t capacity;
+        /// Slots registered, a slot is complete before it's counted.
+        std::atomic<std::uint32_t> count;
+    };
+
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free && std::atomic<std::uint32_t>::is_always_lock_free,
+                  "shared memory atomics must be lock free");
+
+    /// Monotonic count, updated by its owner thread (`increment()`) or by several (`increment_shared()` only).
+    class Counter
+    {
+      public:
+        Counter() noexcept = default;
+
+        Counter(const Counter&) = delete;
+        Counter& operator=(const Counter&) = delete;
+
+        Counter(Counter&&) = delete;
+        Counter& operator=(Counter&&) = delete;
+
+        void increment(std::uint64_t n = 1) noexcept
+        {
+            value_->store(value_->load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        }
+
+        /// For a counter more than one thread updates, which must all use this.
+        void increment_shared(std::uint64_t n = 1) noexcept
+        {
+            value_->fetch_add(n, std::memory_order_relaxed);
+        }
+
+        [[nodiscard]]
+        std::uint64_t value() const noexcept
+        {
+            return value_->load(std::memory_order_relaxed);
+        }
+
+      private:
+        friend class Registry;
+
+        // until attached to a registry slot
+        std::atomic<std::uint64_t> own_{0};
+        std::atomic<std::uint64_t>* value_{&own_};
+    };
+
+    /// Last value set, updated only by its owner thread.
+    class Gauge
+    {
+      public:
+        Gauge() noexcept = default;
+
+        Gauge(const Gauge&) = delete;
+        Gauge& operator=(const Gauge&) = delete;
+
+        Gauge(Gauge&&) = delete;
+        Gauge& operator=(Gauge&&) = delete;
+
+        void set(std::int64_t value) noexcept
+        {
+            value_->store(static_cast<std::uint64_t>(value), std::memory_order_relaxed);
+        }
+
+        [[nodiscard]]
+        std::int64_t value() const noexcept
+        {
+            return static_cast<std::int64_t>(value_->load(std::memory_order_relaxed));
+        }
+
+      private:
+        friend class Registry;
+
+        std::atomic<std::uint64_t> own_{0};
+        std::atomic<std::uint64_t>* value_{&own_};
+    };
+
+    /// A metric as read from the segment.
+    struct Sample
+    {
+        std::string name;
+        std::string labels;
+        Kind kind;
+        std::int64_t value;
+    };
+
+    /// Prometheus text exposition of `samples`, series with the same name and labels summed.
+    [[nodiscard]]
+    std::string prometheus(std::span<const Sample> samples);
+
+    /** Owns the shared memory segment metrics are registered in.
+     *
+     *  Metrics work unattached (counting into themselves), attaching moves them into a slot of the segment keeping the
+     *  value so far. Attach before the owner thread starts updating the metric.
+     */
+    class Registry
+    {
+      public:
+        /// @ingroup config
+        struct Config
+        {
+            /// File to create the segment as (e.g. under /dev/shm), empty for a memfd (see `path()`).
+            std::filesystem::path path;
+            /// Metrics the segment has room for.
+            std::size_t capacity{1024};
+        };
+
+        /// @throws std::system_error if the segment can't be created / mapped.
+        explicit Registry(const Config& cfg);
+
+        ~Registry();
+
+        Registry(const Registry&) = delete;
+        Registry& operator=(const Registry&) = delete;
+
+        Registry(Registry&&) = delete;
+        Registry& operator=(Registry&&) = delete;
+
+        /** Thread safe.
+         *
+         * @throws std::invalid_argument if name / labels don't fit a slot or the segment is full.
+         */
+        void attach(Counter& counter, std::string_view name, std::string_view labels = {});
+        void attach(Gauge& gauge, std::string_view name, std::string_view labels = {});
+
+        /// Where readers map the segment from, `/proc/<pid>/fd/<fd>` for a memfd.
+        [[nodiscard]]
+        const std::filesystem::path& path() const noexcept;
+
+        [[nodiscard]]
+        std::vector<Sample> read() const;
+
+      private:
+        FileDescriptor fd_;
+        std::filesystem::path path_;
+        std::size_t length_;
+        void* mapping_{nullptr};
+        Header* header_{nullptr};
+        Slot* slots_{nullptr};
+        std::mutex mutex_;
+
+        [[nodiscard]]
+        std::atomic<std::uint64_t>& add(Kind kind, std::string_view name, std::string_view labels, std::uint64_t value);
+    };
+
+    /// Maps a `Registry`'s segment read only, from this or another process.
+    class Reader
+    {
+      public:
+        /** @throws std::invalid_argument if the file isn't a metrics segment.
+         *  @throws std::system_error if it can't be opened / mapped.
+         */
+        explicit Reader(const std::filesystem::path& path);
+
+        ~Reader();
+
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+
+        Reader(Reader&&) = delete;
+        Reader& operator=(Reader&&) = delete;
+
+        [[nodiscard]]
+        std::vector<Sample> read() const;
+
+      private:
+        std::size_t length_{0};
+        const void* mapping_{nullptr};
+        const Header* header_{nullptr};
+        const Slot* slots_{nullptr};
+    };
+
+    /// Serves a registry at `GET /metrics` (HTTP/1.0, one request per connection), for a local Prometheus to scrape.
+    /// Connections are served one at a time, one sending nothing (e.g. a port scan) is dropped after `Config::timeout`.
+    class Endpoint
+    {
+      public:
+        /// @ingroup config
+        struct Config
+        {
+            /// Address to listen on, keep it local.
+            util::zstring_view address{"127.0.0.1"};
+            /// Port to listen on. Pass 0 to let the OS assign an ephemeral port.
+            std::uint16_t port{9464};
+            /// Longest a connection may block the endpoint receiving its request or sending the response.
+            std::chrono::nanoseconds timeout{std::chrono::seconds(1)};
+        };
+
+        /** Binds and listens.
+         *
+         * @throws std::invalid_argument if cfg.address is not valid IPv4.
+         * @throws std::system_error if the socket can't be set up.
+         */
+        Endpoint(const Config& cfg, const Registry& registry);
+
+        /// Serves scrapes until `st` is stopped. Blocks.
+        void start(std::stop_token st);
+
+        /// Port listened on (the assigned one if `Config::port` was 0).
+        [[nodiscard]]
+        std::uint16_t port() const;
+
+      private:
+        FileDescriptor socket_{[] { return socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0); }};
+        const Registry* registry_;
+        std::chrono::nanoseconds timeout_;
+
+        // connection being served, -1 if none, shut down on stop
+        std::mutex client_mutex_;
+        int client_{-1};
+
+        void serve(int client) const noexcept;
+    };
+}
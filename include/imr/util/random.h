@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+
+namespace imr::util
+{
+    /** splitmix64 generator for seeded, reproducible impairment decisions.
+     *
+     *  Unlike std:: distributions, the sequence is identical across standard libraries and platforms.
+     */
+    class SplitMix64
+    {
+      public:
+        explicit constexpr SplitMix64(std::uint64_t seed) noexcept
+            : state_{seed}
+        {
+        }
+
+        constexpr std::uint64_t next() noexcept
+        {
+            std::uint64_t z{state_ += 0x9E3779B97F4A7C15ULL};
+            z = (z ^ (z >> 30U)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27U)) * 0x94D049BB133111EBULL;
+            return z ^ (z >> 31U);
+        }
+
+        /// Uniform in [0, 1).
+        constexpr double uniform() noexcept
+        {
+            return static_cast<double>(next() >> 11U) * 0x1p-53;
+        }
+
+        /// True with `probability` (always false for <= 0, always true for >= 1).
+        constexpr bool chance(double probability) noexcept
+        {
+            return probability > 0.0 && (probability >= 1.0 || uniform() < probability);
+        }
+
+      private:
+        std::uint64_t state_;
+    };
+}
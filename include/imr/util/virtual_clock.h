@@ -0,0 +1,43 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+
+namespace imr::util
+{
+    /** Simulated steady clock, advanced explicitly instead of by wall time (`wait::Virtual`).
+     *
+     *  Satisfies `downstream::ClockConcept` and shares `std::chrono::steady_clock`'s time_point, so code written against
+     *  steady time points (pacing, impairment delays) runs unchanged on it. The time is per thread: each feed's replay
+     *  thread has a clock of its own.
+     */
+    struct VirtualClock
+    {
+        using duration = std::chrono::steady_clock::duration;
+        using rep = duration::rep;
+        using period = duration::period;
+        using time_point = std::chrono::steady_clock::time_point;
+        static constexpr bool is_steady{true};
+
+        [[nodiscard]]
+        static time_point now() noexcept
+        {
+            return now_;
+        }
+
+        /// Moves the clock forward to `t`, never back.
+        static void advance_to(time_point t) noexcept
+        {
+            now_ = std::max(now_, t);
+        }
+
+        /// Sets the clock, e.g. to the wall time a replay starts at.
+        static void set(time_point t) noexcept
+        {
+            now_ = t;
+        }
+
+      private:
+        static inline thread_local time_point now_{};
+    };
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "imr/util/virtual_clock.h"
+
+#include <chrono>
+#include <concepts>
+#include <thread>
+
+/** How the feeds wait until a packet is due, chosen per feed at runtime (`Kind`) and resolved at compile time below
+ *  that (see `mold::transport`).
+ */
+namespace imr::util::wait
+{
+    enum class Kind
+    {
+        /// Sleep until due, frees the core.
+        sleep,
+        /// Busy wait until due, lowest jitter at the cost of a core.
+        spin,
+        /// Don't wait, replay as fast as packets can be built (benchmarks, tests).
+        none,
+        /** Don't wait, advance a `VirtualClock` to when the wait would have ended instead. Replays as fast as `none`
+         *  while everything timed off the clock (pacing, heartbeats, end of session) keeps its relative timing.
+         */
+        virtual_time,
+    };
+
+    /// `W::Clock` tells the time waits are measured in, `W::until()` waits for it.
+    template <typename W>
+    concept WaitStrategy = requires(std::chrono::steady_clock::time_point due) {
+        requires std::same_as<typename W::Clock::time_point, std::chrono::steady_clock::time_point>;
+        { W::Clock::now() } -> std::same_as<std::chrono::steady_clock::time_point>;
+        { W::until(due) } noexcept;
+    };
+
+    struct Sleep
+    {
+        using Clock = std::chrono::steady_clock;
+
+        static void until(std::chrono::steady_clock::time_point due) noexcept
+        {
+            std::this_thread::sleep_until(due);
+        }
+    };
+
+    struct Spin
+    {
+        using Clock = std::chrono::steady_clock;
+
+        static void until(std::chrono::steady_clock::time_point due) noexcept
+        {
+            while (std::chrono::steady_clock::now() < due)
+            {
+#if defined(__x86_64__) || defined(__i386__)
+                __builtin_ia32_pause();
+#endif
+            }
+        }
+    };
+
+    struct None
+    {
+        using Clock = std::chrono::steady_clock;
+
+        static void until(std::chrono::steady_clock::time_point) noexcept {}
+    };
+
+    struct Virtual
+    {
+        using Clock = VirtualClock;
+
+        static void until(std::chrono::steady_clock::time_point due) noexcept
+        {
+            VirtualClock::advance_to(due);
+        }
+    };
+
+    static_assert(WaitStrategy<Sleep> && WaitStrategy<Spin> && WaitStrategy<None> && WaitStrategy<Virtual>);
+}
@@ -0,0 +1,358 @@
+#include "order_book.h"
+
+#include "symbol_directory.h"
+#include "timestamp.h"
+#include "../util/binary_io.h"
+#include "imr/mold/types.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+namespace itch
+{
+    namespace
+    {
+        using imr::util::binary_io::read_at_be;
+
+        constexpr auto initial_index_size{1UZ << 16U};
+
+        [[nodiscard]]
+        std::size_t home(std::uint64_t reference, std::size_t mask) noexcept
+        {
+            // fibonacci hashing, order references are sequential so mix the high bits down
+            const auto hash{reference * 0x9E3779B97F4A7C15ULL};
+            return static_cast<std::size_t>(hash ^ (hash >> 32U)) & mask;
+        }
+
+        template <std::size_t N>
+        [[nodiscard]]
+        std::optional<std::array<char, N>> copy_of(std::span<const char> message) noexcept
+        {
+            if (message.size() < N)
+            {
+                return std::nullopt;
+            }
+
+            std::array<char, N> copy{};
+            std::ranges::copy(message.first(N), copy.begin());
+            return copy;
+        }
+
+        void append(std::vector<char>& out, std::span<const char> message)
+        {
+            const auto prefix{imr::util::binary_io::to_be(static_cast<imr::mold::types::LengthPrefix>(message.size()))};
+            const auto prefix_bytes{std::bit_cast<std::array<char, sizeof(prefix)>>(prefix)};
+
+            out.insert(out.end(), prefix_bytes.begin(), prefix_bytes.end());
+            out.insert(out.end(), message.begin(), message.end());
+        }
+    }
+
+    OrderBook::OrderBook()
+        : index_(initial_index_size),
+          index_mask_{initial_index_size - 1}
+    {
+    }
+
+    void OrderBook::apply(std::span<const char> message)
+    {
+        if (message.size() < order_reference_offset)
+        {
+            return;
+        }
+
+        const auto locate{read_at_be<std::uint16_t>(message, stock_locate_offset)};
+
+        switch (message[message_type_offset])
+        {
+        case add_order_type:
+        case add_order_mpid_type:
+            if (message.size() >= add_order_size)
+            {
+                add(read_at_be<std::uint64_t>(message, order_reference_offset),
+                    locate,
+                    message[side_offset],
+                    read_at_be<std::uint32_t>(message, add_shares_offset),
+                    read_at_be<std::uint32_t>(message, add_price_offset),
+                    static_cast<std::uint64_t>(extract_timestamp(message).count()),
+                    message.subspan(add_stock_offset, stock_size));
+            }
+            break;
+        case order_executed_type:
+        case order_executed_price_type:
+        case order_cancel_type:
+            if (message.size() >= shares_offset + sizeof(std::uint32_t))
+            {
+                reduce(read_at_be<std::uint64_t>(message, order_reference_offset), read_at_be<std::uint32_t>(message, shares_offset));
+            }
+            break;
+        case order_delete_type:
+            if (message.size() >= order_reference_offset + sizeof(std::uint64_t))
+            {
+                remove(read_at_be<std::uint64_t>(message, order_reference_offset));
+            }
+            break;
+        case order_replace_type:
+            if (message.size() >= replace_price_offset + sizeof(std::uint32_t))
+            {
+                const auto original{find(read_at_be<std::uint64_t>(message, order_reference_offset))};
+                if (!original.has_value())
+                {
+                    break;
+                }
+
+                // the replacement loses time priority, queued as a new order
+                remove(original->reference);
+                add(read_at_be<std::uint64_t>(message, new_order_reference_offset),
+                    original->locate,
+                    original->side,
+                    read_at_be<std::uint32_t>(message, replace_shares_offset),
+                    read_at_be<std::uint32_t>(message, replace_price_offset),
+                    static_cast<std::uint64_t>(extract_timestamp(message).count()),
+                    {});
+            }
+            break;
+        case stock_directory_type:
+            if (auto directory{copy_of<stock_directory_size>(message)}; directory.has_value())
+            {
+                auto& entry{stock(locate)};
+                std::ranges::copy(message.subspan(stock_offset, stock_size), entry.symbol.begin());
+                entry.directory = directory;
+            }
+            break;
+        case stock_trading_action_type:
+            if (auto trading_action{copy_of<stock_trading_action_size>(message)}; trading_action.has_value())
+            {
+                stock(locate).trading_action = trading_action;
+            }
+            break;
+        case system_event_type:
+            if (auto system_event{copy_of<system_event_size>(message)}; system_event.has_value())
+            {
+                system_event_ = system_event;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    void OrderBook::clear() noexcept
+    {
+        nodes_.clear();
+        free_nodes_.clear();
+        stocks_.clear();
+        system_event_.reset();
+        std::ranges::fill(index_, Slot{});
+        order_count_ = 0;
+    }
+
+    void OrderBook::write_snapshot(std::vector<char>& out) const
+    {
+        if (system_event_.has_value())
+        {
+            append(out, *system_event_);
+        }
+
+        for (auto locate{0UZ}; locate < stocks_.size(); ++locate)
+        {
+            const auto& entry{stocks_[locate]};
+
+            if (entry.directory.has_value())
+            {
+                append(out, *entry.directory);
+            }
+
+            if (entry.trading_action.has_value())
+            {
+                append(out, *entry.trading_action);
+            }
+
+            for (auto node{entry.head}; node != none; node = nodes_[node].next)
+            {
+                const auto& order{nodes_[node].order};
+
+                std::array<char, add_order_size> add{};
+                const std::span message{add};
+
+                message[message_type_offset] = add_order_type;
+                imr::util::binary_io::write_at_be(message, stock_locate_offset, order.locate);
+                // 6 byte timestamp, tracking number left 0
+                imr::util::binary_io::write_at_be(message, timestamp_offset, static_cast<std::uint16_t>(order.timestamp >> 32U));
+                imr::util::binary_io::write_at_be(message, timestamp_offset + 2, static_cast<std::uint32_t>(order.timestamp));
+                imr::util::binary_io::write_at_be(message, order_reference_offset, order.reference);
+                message[side_offset] = order.side;
+                imr::util::binary_io::write_at_be(message, add_shares_offset, order.shares);
+                std::ranges::copy(entry.symbol, message.begin() + add_stock_offset);
+                imr::util::binary_io::write_at_be(message, add_price_offset, order.price);
+
+                append(out, message);
+            }
+        }
+    }
+
+    std::optional<OrderBook::Order> OrderBook::find(std::uint64_t reference) const noexcept
+    {
+        const auto& slot{index_[slot_for(reference)]};
+        return slot.node == none ? std::nullopt : std::optional{nodes_[slot.node].order};
+    }
+
+    std::size_t OrderBook::order_count() const noexcept
+    {
+        return order_count_;
+    }
+
+    OrderBook::Stock& OrderBook::stock(std::uint16_t locate)
+    {
+        if (locate >= stocks_.size())
+        {
+            stocks_.resize(locate + 1UZ);
+        }
+
+        return stocks_[locate];
+    }
+
+    void OrderBook::add(std::uint64_t reference,
+                        std::uint16_t locate,
+                        char side,
+                        std::uint32_t shares,
+                        std::uint32_t price,
+                        std::uint64_t timestamp,
+                        std::span<const char> symbol)
+    {
+        if ((order_count_ + 1) * 2 > index_.size())
+        {
+            grow_index();
+        }
+
+        auto& slot{index_[slot_for(reference)]};
+        if (slot.node != none)
+        {
+            // duplicate reference, keep the first
+            return;
+        }
+
+        auto& entry{stock(locate)};
+        if (!symbol.empty() && !entry.directory.has_value())
+        {
+            std::ranges::copy(symbol, entry.symbol.begin());
+        }
+
+        std::uint32_t node{};
+        if (free_nodes_.empty())
+        {
+            node = static_cast<std::uint32_t>(nodes_.size());
+            nodes_.emplace_back();
+        }
+        else
+        {
+            node = free_nodes_.back();
+            free_nodes_.pop_back();
+        }
+
+        nodes_[node] = {
+            .order = {.reference = reference,
+                      .timestamp = timestamp,
+                      .shares = shares,
+                      .price = price,
+                      .locate = locate,
+                      .side = side},
+            .prev = entry.tail,
+            .next = none,
+        };
+
+        if (entry.tail == none)
+        {
+            entry.head = node;
+        }
+        else
+        {
+            nodes_[entry.tail].next = node;
+        }
+        entry.tail = node;
+
+        slot = {.reference = reference, .node = node};
+        ++order_count_;
+    }
+
+    void OrderBook::reduce(std::uint64_t reference, std::uint32_t shares) noexcept
+    {
+        const auto& slot{index_[slot_for(reference)]};
+        if (slot.node == none)
+        {
+            return;
+        }
+
+        auto& order{nodes_[slot.node].order};
+        if (shares >= order.shares)
+        {
+            remove(reference);
+            return;
+        }
+
+        order.shares -= shares;
+    }
+
+    void OrderBook::remove(std::uint64_t reference) noexcept
+    {
+        auto i{slot_for(reference)};
+        const auto node{index_[i].node};
+
+        if (node == none)
+        {
+            return;
+        }
+
+        auto& entry{stocks_[nodes_[node].order.locate]};
+        const auto [prev, next]{std::pair{nodes_[node].prev, nodes_[node].next}};
+
+        (prev == none ? entry.head : nodes_[prev].next) = next;
+        (next == none ? entry.tail : nodes_[next].prev) = prev;
+
+        free_nodes_.push_back(node);
+        --order_count_;
+
+        // backward shift: pull later entries of the probe run into the hole unless they'd move before their home slot
+        for (auto j{(i + 1) & index_mask_}; index_[j].node != none; j = (j + 1) & index_mask_)
+        {
+            const auto k{home(index_[j].reference, index_mask_)};
+            const auto stays{i <= j ? (i < k && k <= j) : (i < k || k <= j)};
+
+            if (!stays)
+            {
+                index_[i] = index_[j];
+                i = j;
+            }
+        }
+
+        index_[i] = Slot{};
+    }
+
+    std::size_t OrderBook::slot_for(std::uint64_t reference) const noexcept
+    {
+        auto i{home(reference, index_mask_)};
+
+        while (index_[i].node != none && index_[i].reference != reference)
+        {
+            i = (i + 1) & index_mask_;
+        }
+
+        return i;
+    }
+
+    void OrderBook::grow_index()
+    {
+        std::vector<Slot> old(index_.size() * 2);
+        old.swap(index_);
+        index_mask_ = index_.size() - 1;
+
+        for (const auto& slot : old)
+        {
+            if (slot.node != none)
+            {
+                index_[slot_for(slot.reference)] = slot;
+            }
+        }
+    }
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace itch
+{
+    // https://www.nasdaqtrader.com/content/technicalsupport/specifications/dataproducts/NQTVITCHSpecification.pdf
+    inline constexpr char system_event_type{'S'};
+    inline constexpr char stock_trading_action_type{'H'};
+    inline constexpr char add_order_type{'A'};
+    inline constexpr char add_order_mpid_type{'F'};
+    inline constexpr char order_executed_type{'E'};
+    inline constexpr char order_executed_price_type{'C'};
+    inline constexpr char order_cancel_type{'X'};
+    inline constexpr char order_delete_type{'D'};
+    inline constexpr char order_replace_type{'U'};
+
+    inline constexpr auto order_reference_offset{11UZ};
+    // add order
+    inline constexpr auto side_offset{19UZ};
+    inline constexpr auto add_shares_offset{20UZ};
+    inline constexpr auto add_stock_offset{24UZ};
+    inline constexpr auto add_price_offset{32UZ};
+    inline constexpr auto add_order_size{36UZ};
+    // executed / executed with price / cancel
+    inline constexpr auto shares_offset{19UZ};
+    // replace
+    inline constexpr auto new_order_reference_offset{19UZ};
+    inline constexpr auto replace_shares_offset{27UZ};
+    inline constexpr auto replace_price_offset{31UZ};
+
+    inline constexpr auto system_event_size{12UZ};
+    inline constexpr auto stock_directory_size{39UZ};
+    inline constexpr auto stock_trading_action_size{25UZ};
+
+    /** Full depth book of every stock, built from the add / execute / cancel / delete / replace messages of a
+     *  TotalView-ITCH 5.0 stream plus its system event, stock directory and trading action state.
+     *
+     *  Orders live in one contiguous pool, linked per stock locate in time priority and found by reference through an
+     *  open addressing index, so applying a message touches a handful of cache lines and never allocates once warm.
+     */
+    class OrderBook
+    {
+      public:
+        struct Order
+        {
+            std::uint64_t reference;
+            std::uint64_t timestamp;
+            std::uint32_t shares;
+            std::uint32_t price;
+            std::uint16_t locate;
+            char side;
+        };
+
+        OrderBook();
+
+        /// Applies an ITCH message (without its length prefix). Unknown types / orders are ignored.
+        void apply(std::span<const char> message);
+
+        /// Forgets every order and all stock state (new session).
+        void clear() noexcept;
+
+        /** Appends the book as length prefixed ITCH messages, GLIMPSE style: the last system event, then per stock
+         *  its directory, trading action and an add order ('A') per resting order in time priority.
+         */
+        void write_snapshot(std::vector<char>& out) const;
+
+        [[nodiscard]]
+        std::optional<Order> find(std::uint64_t reference) const noexcept;
+
+        [[nodiscard]]
+        std::size_t order_count() const noexcept;
+
+      private:
+        static constexpr std::uint32_t none{~0U};
+
+        struct Node
+        {
+            Order order;
+            std::uint32_t prev;
+            std::uint32_t next;
+        };
+
+        struct Stock
+        {
+            std::array<char, 8> symbol{' ', ' ', ' ', ' ', ' ', ' ', ' ', ' '};
+            std::uint32_t head{none};
+            std::uint32_t tail{none};
+            std::optional<std::array<char, stock_directory_size>> directory;
+            std::optional<std::array<char, stock_trading_action_size>> trading_action;
+        };
+
+        std::vector<Node> nodes_;
+        std::vector<std::uint32_t> free_nodes_;
+        std::vector<Stock> stocks_;
+        std::optional<std::array<char, system_event_size>> system_event_;
+
+        // order reference -> node, linear probing with backward shift deletion (no tombstones)
+        struct Slot
+        {
+            std::uint64_t reference;
+            std::uint32_t node{none};
+        };
+        std::vector<Slot> index_;
+        std::size_t index_mask_;
+        std::size_t order_count_{0};
+
+        Stock& stock(std::uint16_t locate);
+
+        void add(std::uint64_t reference, std::uint16_t locate, char side, std::uint32_t shares, std::uint32_t price,
+                 std::uint64_t timestamp, std::span<const char> symbol);
+        void reduce(std::uint64_t reference, std::uint32_t shares) noexcept;
+        void remove(std::uint64_t reference) noexcept;
+
+        [[nodiscard]]
+        std::size_t slot_for(std::uint64_t reference) const noexcept;
+        void grow_index();
+    };
+}
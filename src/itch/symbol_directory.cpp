@@ -0,0 +1,68 @@
+#include "symbol_directory.h"
+
+#include "../mold/io.h"
+#include "../util/binary_io.h"
+#include "imr/mold/types.h"
+
+#include <algorithm>
+
+namespace itch
+{
+    SymbolDirectory::SymbolDirectory(std::span<const char> file)
+    {
+        for (auto pos{0UZ}; pos < file.size();)
+        {
+            const auto msg{imr::mold::io::read_message(file, pos)};
+
+            if (msg.empty())
+            {
+                break;
+            }
+
+            const auto body{msg.subspan(sizeof(imr::mold::types::LengthPrefix))};
+
+            if (body.empty())
+            {
+                continue;
+            }
+
+            if (!directory_section_types.contains(body[message_type_offset]))
+            {
+                break;
+            }
+
+            if (body[message_type_offset] != stock_directory_type || body.size() < stock_offset + stock_size)
+            {
+                continue;
+            }
+
+            std::string_view stock(body.data() + stock_offset, stock_size);
+            stock = stock.substr(0, stock.find_last_not_of(' ') + 1);
+
+            const auto locate{imr::util::binary_io::read_at_be<std::uint16_t>(body, stock_locate_offset)};
+
+            locates_.insert_or_assign(std::string(stock), locate);
+            max_locate_ = std::max(max_locate_, locate);
+        }
+    }
+
+    std::optional<std::uint16_t> SymbolDirectory::locate_for(std::string_view symbol) const
+    {
+        if (const auto it{locates_.find(std::string(symbol))}; it != locates_.end())
+        {
+            return it->second;
+        }
+
+        return std::nullopt;
+    }
+
+    std::size_t SymbolDirectory::size() const noexcept
+    {
+        return locates_.size();
+    }
+
+    std::uint16_t SymbolDirectory::max_locate() const noexcept
+    {
+        return max_locate_;
+    }
+}
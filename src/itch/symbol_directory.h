@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace itch
+{
+    // https://www.nasdaqtrader.com/content/technicalsupport/specifications/dataproducts/NQTVITCHSpecification.pdf
+    // every message starts with its type then (where it applies, else 0) the stock locate
+    inline constexpr auto message_type_offset{0UZ};
+    inline constexpr auto stock_locate_offset{1UZ};
+
+    inline constexpr char stock_directory_type{'R'};
+    // the pre-open section the directory is sent in: system event, stock directory, trading action, Reg SHO, market
+    // participant position, MWCB levels (then IPO, LULD and operational halt messages, which may also come intraday)
+    inline constexpr std::string_view directory_section_types{"SRHYLVKJh"};
+    inline constexpr auto stock_offset{11UZ};
+    inline constexpr auto stock_size{8UZ};
+
+    /// Ticker -> stock locate, from the stock directory ('R') messages of a length prefixed ITCH file.
+    class SymbolDirectory
+    {
+      public:
+        /// Walks the file up to the end of its directory section, the first message of another type (an order, trade,
+        /// ...). Symbols only added by intraday 'R' messages past it are not found.
+        explicit SymbolDirectory(std::span<const char> file);
+
+        /// `symbol` without the space padding ITCH uses, e.g. "AAPL".
+        [[nodiscard]]
+        std::optional<std::uint16_t> locate_for(std::string_view symbol) const;
+
+        [[nodiscard]]
+        std::size_t size() const noexcept;
+
+        /// Highest locate in the directory, 0 if empty.
+        [[nodiscard]]
+        std::uint16_t max_locate() const noexcept;
+
+      private:
+        std::unordered_map<std::string, std::uint16_t> locates_;
+        std::uint16_t max_locate_{0};
+    };
+}
@@ -8,5 +8,8 @@ namespace itch
     [[nodiscard]]
     std::chrono::nanoseconds extract_timestamp(std::span<const char> bytes);
 
+    // https://www.nasdaqtrader.com/content/technicalsupport/specifications/dataproducts/NQTVITCHSpecification.pdf
+    // all TotalView ITCH messages have timestamp at offset of 5
+    inline constexpr auto timestamp_offset{5UZ};
     inline constexpr auto timestamp_size{6UZ};
 };
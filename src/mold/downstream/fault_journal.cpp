@@ -0,0 +1,103 @@
+#include "imr/mold/downstream/fault_journal.h"
+
+#include "../../util/binary_io.h"
+#include "../../util/write_all.h"
+#include "imr/util/log.h"
+
+#include <algorithm>
+#include <format>
+#include <source_location>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+
+namespace imr::mold::downstream
+{
+    FaultJournal::FaultJournal(const Config& cfg)
+        : fd_{[&cfg] {
+              if (cfg.path.empty() || std::filesystem::is_directory(cfg.path))
+              {
+                  throw std::invalid_argument(std::format("{}: fault journal path is not a file {}",
+                                                          std::source_location::current().function_name(),
+                                                          cfg.path.c_str()));
+              }
+              return open(cfg.path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+          }},
+          buffer_(std::max(cfg.buffer_size, record_length))
+    {
+        if (!util::write_all(fd_.get(), magic))
+        {
+            throw std::system_error(errno, std::system_category(), std::source_location::current().function_name());
+        }
+
+        util::log::debug();
+    }
+
+    FaultJournal::~FaultJournal()
+    {
+        flush();
+    }
+
+    void FaultJournal::record(const Record& record) noexcept
+    {
+        if (record_length > buffer_.size() - used_)
+        {
+            flush();
+        }
+
+        const auto out{std::span(buffer_).subspan(used_, record_length)};
+
+        std::size_t pos{0};
+        util::binary_io::write_be(out, pos, static_cast<std::uint64_t>(record.timestamp.count()));
+        util::binary_io::write_be(out, pos, record.sequence_number);
+        util::binary_io::write_be(out, pos, record.message_count);
+        util::binary_io::write(out, pos, record.line);
+        util::binary_io::write(out, pos, std::to_underlying(record.fault));
+        util::binary_io::write_be(out, pos, record.detail);
+
+        used_ += record_length;
+    }
+
+    void FaultJournal::flush() noexcept
+    {
+        if (used_ == 0)
+        {
+            return;
+        }
+
+        if (!util::write_all(fd_.get(), std::span(buffer_).first(used_)))
+        {
+            util::log::perror();
+        }
+
+        used_ = 0;
+    }
+
+    std::vector<FaultJournal::Record> FaultJournal::parse(std::span<const char> journal)
+    {
+        if (journal.size() < magic.size() || !std::ranges::equal(journal.first(magic.size()), magic) ||
+            (journal.size() - magic.size()) % record_length != 0)
+        {
+            throw std::invalid_argument(std::format("{}: not a fault journal", std::source_location::current().function_name()));
+        }
+
+        std::vector<Record> records;
+        records.reserve((journal.size() - magic.size()) / record_length);
+
+        for (std::size_t pos{magic.size()}; pos < journal.size();)
+        {
+            Record record{};
+            record.timestamp = std::chrono::nanoseconds{util::binary_io::read_be<std::int64_t>(journal, pos)};
+            record.sequence_number = util::binary_io::read_be<types::header::SequenceNumber>(journal, pos);
+            record.message_count = util::binary_io::read_be<types::header::MessageCount>(journal, pos);
+            record.line = util::binary_io::read<std::uint8_t>(journal, pos);
+            record.fault = static_cast<Fault>(util::binary_io::read<std::uint8_t>(journal, pos));
+            record.detail = util::binary_io::read_be<std::uint32_t>(journal, pos);
+
+            records.push_back(record);
+        }
+
+        return records;
+    }
+}
@@ -0,0 +1,166 @@
+#include "imr/mold/downstream/fec_encoder.h"
+
+#include "../../util/binary_io.h"
+#include "../../util/xor.h"
+#include "imr/util/log.h"
+
+#include <algorithm>
+#include <cstring>
+#include <format>
+#include <source_location>
+#include <stdexcept>
+#include <utility>
+
+#include <arpa/inet.h>
+
+namespace imr::mold::downstream
+{
+    FecEncoder::FecEncoder(const Config& cfg, std::size_t max_packet_size)
+    {
+        if (cfg.k == 0 || cfg.k > types::fec::max_count || cfg.interleave == 0 || cfg.interleave > types::fec::max_count)
+        {
+            throw std::invalid_argument(std::format("{}: k and interleave must be 1-{}",
+                                                    std::source_location::current().function_name(),
+                                                    types::fec::max_count));
+        }
+
+        destination_.sin_family = AF_INET;
+        destination_.sin_port = htons(cfg.port);
+
+        if (inet_pton(AF_INET, cfg.mcast_group.c_str(), &destination_.sin_addr) != 1)
+        {
+            throw std::invalid_argument(std::format("{}: invalid ip format for fec group {}",
+                                                    std::source_location::current().function_name(),
+                                                    cfg.mcast_group.c_str()));
+        }
+
+        columns_.reserve(cfg.interleave);
+        for (auto i{0UZ}; i < cfg.interleave; ++i)
+        {
+            columns_.push_back(make_group(types::fec::Kind::column, cfg.k, max_packet_size));
+        }
+
+        if (cfg.row_parity)
+        {
+            rows_.push_back(make_group(types::fec::Kind::row, cfg.interleave, max_packet_size));
+        }
+
+        ready_.reserve(columns_.size() + rows_.size());
+
+        util::log::debug();
+    }
+
+    FecEncoder::Group FecEncoder::make_group(types::fec::Kind kind, std::size_t capacity, std::size_t max_packet_size)
+    {
+        return {.packet = std::vector<char>(types::fec::payload_offset(capacity) + max_packet_size), .kind = kind, .capacity = capacity};
+    }
+
+    const sockaddr_in& FecEncoder::destination() const noexcept
+    {
+        return destination_;
+    }
+
+    std::span<const std::span<const char>> FecEncoder::add(std::span<const iovec> packet) noexcept
+    {
+        ready_.clear();
+
+        auto& column{columns_[next_column_]};
+        next_column_ = (next_column_ + 1) % columns_.size();
+
+        accumulate(column, packet);
+        if (column.count == column.capacity)
+        {
+            ready_.push_back(emit(column));
+        }
+
+        for (auto& row : rows_)
+        {
+            accumulate(row, packet);
+            if (row.count == row.capacity)
+            {
+                ready_.push_back(emit(row));
+            }
+        }
+
+        return ready_;
+    }
+
+    std::span<const std::span<const char>> FecEncoder::flush() noexcept
+    {
+        ready_.clear();
+
+        for (auto* groups : {&columns_, &rows_})
+        {
+            for (auto& group : *groups)
+            {
+                if (group.count > 0)
+                {
+                    ready_.push_back(emit(group));
+                }
+            }
+        }
+
+        // the next session's groups start from the first column again
+        next_column_ = 0;
+
+        return ready_;
+    }
+
+    void FecEncoder::accumulate(Group& group, std::span<const iovec> packet) noexcept
+    {
+        const std::span out{group.packet};
+        const std::span header{static_cast<const char*>(packet.front().iov_base), packet.front().iov_len};
+
+        const auto payload{out.subspan(types::fec::payload_offset(group.capacity))};
+
+        // first packet of a group, clear the last group's payload (left in place until now so it could be sent)
+        if (group.count == 0)
+        {
+            std::memcpy(out.data() + types::fec::session_offset, header.data(), sizeof(types::header::Session));
+            out[types::fec::kind_offset] = static_cast<char>(std::to_underlying(group.kind));
+            std::memset(payload.data(), 0, group.max_length);
+
+            group.max_length = 0;
+            group.length_xor = 0;
+        }
+
+        // copied as is, already big endian
+        std::memcpy(out.data() + types::fec::payload_offset(group.count),
+                    header.data() + types::header::sequence_number_offset,
+                    sizeof(types::header::SequenceNumber));
+
+        // everything after the session is protected
+        auto length{0UZ};
+
+        for (auto skip{sizeof(types::header::Session)}; const auto& iov : packet)
+        {
+            const std::span bytes{static_cast<const char*>(iov.iov_base) + skip, iov.iov_len - skip};
+            util::xor_into(payload.subspan(length), bytes);
+            length += bytes.size();
+            skip = 0;
+        }
+
+        group.length_xor ^= static_cast<std::uint16_t>(length);
+        group.max_length = std::max(group.max_length, length);
+        ++group.count;
+    }
+
+    std::span<const char> FecEncoder::emit(Group& group) noexcept
+    {
+        const std::span out{group.packet};
+        const auto payload_offset{types::fec::payload_offset(group.count)};
+
+        // a partial group's sequence numbers end early, close the gap before the payload
+        if (group.count < group.capacity)
+        {
+            std::memmove(out.data() + payload_offset, out.data() + types::fec::payload_offset(group.capacity), group.max_length);
+        }
+
+        out[types::fec::count_offset] = static_cast<char>(group.count);
+        util::binary_io::write_at_be(out, types::fec::length_offset, group.length_xor);
+
+        group.count = 0;
+
+        return out.first(payload_offset + group.max_length);
+    }
+}
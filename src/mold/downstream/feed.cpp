@@ -1,11 +1,13 @@
 #include "imr/mold/downstream/feed.h"
 
-#include "../io.h"
-#include "../../itch/timestamp.h"
 #include "imr/mold/types.h"
+#include "imr/util/hot_path.h"
 #include "imr/util/log.h"
 #include "util/binary_io.h"
+#include "util/probe.h"
 
+#include <algorithm>
+#include <array>
 #include <atomic>
 #include <cassert>
 #include <chrono>
@@ -15,19 +17,24 @@
 #include <stop_token>
 #include <thread>
 #include <format>
+#include <type_traits>
 
 namespace
 {
-    std::optional<std::chrono::nanoseconds> peek_timestamp(std::span<const char> bytes)
+    using namespace imr::mold;
+
+    std::array<char, types::header::length> make_header(std::string_view session,
+                                                        types::header::SequenceNumber seq,
+                                                        types::header::MessageCount msg_count) noexcept
     {
-        using namespace imr;
+        std::array<char, types::header::length> header{};
+        std::span header_span(header);
 
-        if (bytes.size() < sizeof(mold::types::LengthPrefix) + itch::timestamp_size) [[unlikely]]
-        {
-            return std::nullopt;
-        }
+        imr::util::binary_io::write_at(header_span, types::header::session_offset, session);
+        imr::util::binary_io::write_at_be(header_span, types::header::sequence_number_offset, seq);
+        imr::util::binary_io::write_at_be(header_span, types::header::message_count_offset, msg_count);
 
-        return itch::extract_timestamp(bytes.subspan(sizeof(mold::types::LengthPrefix)));
+        return header;
     }
 }
 
@@ -35,46 +42,197 @@ namespace imr::mold::downstream
 {
     Feed::Feed(const Config& cfg,
                const PacketBuilder::Config& packet_builder_cfg,
-               std::span<const char> file,
+               Source& source,
                RetransmissionBuffer& retransmission_buffer)
         : mcast_group_{configure_socket(cfg)},
-          file_(file),
+          fault_journal_{cfg.fault_journal.has_value() ? std::make_unique<FaultJournal>(*cfg.fault_journal) : nullptr},
+          lines_(socket_.get(), mcast_group_, cfg.impairment, cfg.redundant_lines, packet_builder_cfg.MTU, fault_journal_.get()),
+          transport_{cfg.transport},
+          wait_{cfg.wait},
+          fec_encoder_{cfg.fec.has_value() ? std::make_optional<FecEncoder>(*cfg.fec, packet_builder_cfg.MTU) : std::nullopt},
+          shm_writer_{cfg.shm_output.has_value() ? std::make_unique<ShmWriter>(*cfg.shm_output, packet_builder_cfg.MTU) : nullptr},
+          tx_timestamper_{cfg.tx_timestamps.has_value()
+                              ? std::make_unique<TxTimestamper>(socket_.get(),
+                                                                *cfg.tx_timestamps,
+                                                                fec_encoder_.has_value() ? &fec_encoder_->destination() : nullptr)
+                              : nullptr},
+          trace_ring_{cfg.trace.has_value() ? std::make_unique<TraceRing>(*cfg.trace) : nullptr},
+          source_(&source),
           retransmission_buffer_(&retransmission_buffer),
-          pacer_(cfg.pacer_cfg),
+          pacer_cfg_(cfg.pacer_cfg),
           packet_builder_{packet_builder_cfg},
-          heartbeat_(cfg.heartbeat_period, socket_, mcast_group_, packet_builder_cfg.session, sent_sequence_number_),
-          end_of_session_duration_{cfg.end_of_session_duration}
+          heartbeat_(cfg.heartbeat_period, packet_builder_cfg.session, sent_sequence_number_),
+          end_of_session_duration_{cfg.end_of_session_duration},
+          rollover_{cfg.rollover}
     {
-        send_hdr_.msg_name = &mcast_group_;
-        send_hdr_.msg_namelen = sizeof(mcast_group_);
+        if (transport_ == transport::Kind::shm && shm_writer_ == nullptr)
+        {
+            throw std::invalid_argument(std::format("{}: shm transport without shm_output", std::source_location::current().function_name()));
+        }
+
+        if (tx_timestamper_ != nullptr && (transport_ != transport::Kind::udp || cfg.pcap_output.has_value()))
+        {
+            throw std::invalid_argument(std::format("{}: tx_timestamps requires the udp transport without pcap_output",
+                                                    std::source_location::current().function_name()));
+        }
+
+        if (cfg.pcap_output.has_value())
+        {
+            pcap_writer_.emplace(*cfg.pcap_output, mcast_group_);
+        }
 
         util::log::debug();
     }
 
     void Feed::start(std::stop_token st)
+    {
+        switch (transport_)
+        {
+        case transport::Kind::udp:
+            if (tx_timestamper_ != nullptr)
+            {
+                run(st, *tx_timestamper_);
+            }
+            else
+            {
+                run(st, udp_);
+            }
+            break;
+        case transport::Kind::memory:
+            run(st, memory_);
+            break;
+        // shm_writer_ publishes ahead of the transport
+        case transport::Kind::shm:
+        case transport::Kind::null:
+            run(st, null_);
+            break;
+        }
+    }
+
+    void Feed::attach_metrics(util::metrics::Registry& registry, std::string_view labels)
+    {
+        registry.attach(metrics_.packets, "imr_downstream_packets_total", labels);
+        registry.attach(metrics_.bytes, "imr_downstream_bytes_total", labels);
+        registry.attach(metrics_.messages, "imr_downstream_messages_total", labels);
+        registry.attach(tx_timestamper_ != nullptr ? tx_timestamper_->errors() : udp_.errors(), "imr_downstream_send_errors_total", labels);
+        registry.attach(heartbeat_.sent(), "imr_downstream_heartbeats_total", labels);
+        registry.attach(metrics_.lateness, "imr_downstream_lateness_ns", labels);
+        registry.attach(metrics_.file_position, "imr_downstream_file_position", labels);
+
+        if (tx_timestamper_ != nullptr)
+        {
+            registry.attach(tx_timestamper_->timestamped(), "imr_downstream_tx_timestamped_total", labels);
+            registry.attach(tx_timestamper_->missed(), "imr_downstream_tx_timestamps_missed_total", labels);
+        }
+    }
+
+    const util::Histogram& Feed::lateness() const noexcept
+    {
+        return metrics_.lateness_distribution;
+    }
+
+    void Feed::count_hot_path(std::atomic<std::size_t>& threads) noexcept
+    {
+        hot_path_threads_ = &threads;
+    }
+
+    const transport::Memory& Feed::memory_sink() const noexcept
+    {
+        return memory_;
+    }
+
+    const transport::Null& Feed::null_sink() const noexcept
+    {
+        return null_;
+    }
+
+    const TxTimestamper* Feed::tx_timestamper() const noexcept
+    {
+        return tx_timestamper_.get();
+    }
+
+    const TraceRing* Feed::trace_ring() const noexcept
+    {
+        return trace_ring_.get();
+    }
+
+    template <transport::Transport T>
+    void Feed::run(std::stop_token st, T& transport)
+    {
+        // pcap output with ITCH timestamps runs as fast as the disk allows
+        const bool offline{pcap_writer_.has_value() &&
+                           pcap_writer_->timestamps() == PcapWriter::Config::Timestamps::itch};
+
+        switch (offline ? util::wait::Kind::none : wait_)
+        {
+        case util::wait::Kind::sleep:
+            replay<T, util::wait::Sleep>(st, transport);
+            break;
+        case util::wait::Kind::spin:
+            replay<T, util::wait::Spin>(st, transport);
+            break;
+        case util::wait::Kind::none:
+            replay<T, util::wait::None>(st, transport);
+            break;
+        case util::wait::Kind::virtual_time:
+            replay<T, util::wait::Virtual>(st, transport);
+            break;
+        }
+    }
+
+    template <transport::Transport T, util::wait::WaitStrategy W>
+    void Feed::replay(std::stop_token st, T& transport)
     {
         util::log::info("Downstream feed: started");
 
-        util::log::info("DIAGNOSTIC: file_size = {}, file_pos = {}, stop_requested = {}",
-                        file_.size(),
-                        file_pos_,
-                        st.stop_requested());
+        // virtual time starts from the wall clock, then only moves as the replay waits
+        if constexpr (std::is_same_v<W, util::wait::Virtual>)
+        {
+            util::VirtualClock::set(std::chrono::steady_clock::now());
+        }
+        memory_.set_clock(&W::Clock::now);
+
+        Pacer<typename W::Clock> pacer({.playback_speed = pacer_cfg_.playback_speed, .skip_before = pacer_cfg_.skip_before});
 
-        heartbeat_.start();
+        source_->start(st);
 
-        while (file_pos_ < file_.size() && !st.stop_requested())
+        // pcap output writes heartbeats inline
+        if (!pcap_writer_.has_value())
         {
-            std::optional timestamp{peek_timestamp(file_.subspan(file_pos_))};
+            start_heartbeat<T, W>(transport);
+        }
+
+        // a send error is the likely first record
+        util::log::register_thread();
+
+        // a scope of its own, ended before the end of session
+        std::optional<util::hot_path::Scope> hot_path;
+        hot_path.emplace(util::hot_path::Kind::downstream, hot_path_threads_);
+
+        while (!st.stop_requested())
+        {
+            std::optional timestamp{source_->peek_timestamp()};
 
             if (!timestamp.has_value())
             {
-                break;
+                // the next item's mapping, session rollover and heartbeat restart may allocate
+                const util::hot_path::Pause pause(*hot_path);
+
+                if (!source_->advance())
+                {
+                    break;
+                }
+
+                // next item's timestamps start again from its own first message
+                pacer.reset();
+                roll_over<T, W>(st, transport);
+                continue;
             }
 
-            if (pacer_.should_skip(*timestamp))
+            if (pacer.should_skip(*timestamp))
             {
                 // eof / malformed
-                if (!io::skip_message(file_, file_pos_))
+                if (!source_->skip())
                 {
                     break;
                 }
@@ -82,122 +240,357 @@ namespace imr::mold::downstream
                 continue;
             }
 
-            build_packet();
+            const auto position{build_packet()};
+
+            // malformed input: a source that ended the item there (playlist) advances next time round, otherwise it
+            // couldn't make progress so don't spin sending empty packets
+            if (packet_builder_.message_count() == 0) [[unlikely]]
+            {
+                if (source_->peek_timestamp().has_value())
+                {
+                    break;
+                }
+
+                continue;
+            }
 
-#ifndef DEBUG_NO_SLEEP
-            std::this_thread::sleep_for(pacer_.get_delay(*timestamp));
-#endif
+            if constexpr (std::is_same_v<W, util::wait::None>)
+            {
+                send_packet(*timestamp, position, transport, W::Clock::now());
+            }
+            else
+            {
+                const auto send_at{pacer.send_time(*timestamp)};
+                IMR_PROBE(pacer_delay,
+                          sequence_number_ - packet_builder_.message_count(),
+                          timestamp->count(),
+                          send_at.time_since_epoch().count());
+                wait_until<T, W>(send_at, transport);
+
+                const auto now{W::Clock::now()};
+                const auto lateness{(now - send_at).count()};
+                metrics_.lateness.set(lateness);
+                metrics_.lateness_distribution.record(static_cast<std::uint64_t>(std::max<std::int64_t>(lateness, 0)));
+
+                // virtual time isn't comparable with the kernel's
+                if constexpr (std::is_same_v<T, TxTimestamper> && !std::is_same_v<W, util::wait::Virtual>)
+                {
+                    transport.set_schedule(sequence_number_ - packet_builder_.message_count(), send_at);
+                }
 
-            send_packet();
+                // a virtual time schedule means nothing next to the send TSC
+                send_packet(*timestamp, position, transport, now, std::is_same_v<W, util::wait::Virtual> ? Lines::Clock::time_point{} : send_at);
+            }
         }
 
+        hot_path.reset();
+
         // end of session replaces heartbeat (same period) so we stop it now
         heartbeat_.stop();
-        end_of_session(st);
+        end_of_session<T, W>(st, transport);
 
         util::log::info("Downstream feed: finished");
     }
 
-    void Feed::build_packet()
+    template <transport::Transport T, util::wait::WaitStrategy W>
+    void Feed::wait_until(Lines::Clock::time_point due, T& transport)
     {
-        packet_builder_.reset(sequence_number_);
-
-        while (file_pos_ < file_.size())
+        // delayed lines release their packets (and in virtual time, heartbeats go out) while we wait for this one
+        while (true)
         {
+            const auto release{lines_.next_release()};
+            const bool releasing{release.has_value() && *release < due};
 
-            const std::size_t msg_file_pos{file_pos_};
-
-            const std::span msg{mold::io::read_message(file_, file_pos_)};
-
-            if (msg.empty()) [[unlikely]]
+            if constexpr (std::is_same_v<W, util::wait::Virtual>)
             {
-                return;
+                if (heartbeat_.period() > std::chrono::nanoseconds{0} && next_heartbeat_ <= due &&
+                    (!releasing || next_heartbeat_ <= *release))
+                {
+                    W::until(next_heartbeat_);
+                    send_heartbeat(transport);
+                    continue;
+                }
             }
 
-            // rollback when packet is full
-            if (!packet_builder_.try_add(msg))
+            if (!releasing)
             {
-                file_pos_ = msg_file_pos;
-                return;
+                break;
             }
 
-            assert(retransmission_buffer_ != nullptr);
-            retransmission_buffer_->push({
-                .sequence_number = sequence_number_++,
-                .file_position = msg_file_pos,
-            });
+            W::until(*release);
+            lines_.release(transport, W::Clock::now());
         }
+
+        W::until(due);
     }
 
-    void Feed::send_packet() noexcept
+    template <transport::Transport T, util::wait::WaitStrategy W>
+    void Feed::start_heartbeat(T& transport)
     {
+        // no thread ticking on wall time, wait_until() sends heartbeats as virtual time passes them
+        if constexpr (std::is_same_v<W, util::wait::Virtual>)
+        {
+            next_heartbeat_ = W::Clock::now();
+        }
+        else
+        {
+            heartbeat_.start([this, &transport](std::span<const char> packet) { lines_.send(transport, packet); });
+        }
+    }
 
-        [[maybe_unused]]
+    template <transport::Transport T>
+    void Feed::send_heartbeat(T& transport) noexcept
+    {
+        const auto heartbeat{make_header(packet_builder_.session(),
+                                         sent_sequence_number_.load(std::memory_order_relaxed),
+                                         types::header::heartbeat_msg_count)};
+        IMR_PROBE(heartbeat, sent_sequence_number_.load(std::memory_order_relaxed));
+        lines_.send(transport, heartbeat);
+        heartbeat_.sent().increment();
+
+        next_heartbeat_ += heartbeat_.period();
+    }
+
+    std::size_t Feed::build_packet()
+    {
+        IMR_PROBE(packet_build_start, sequence_number_);
+        packet_builder_.reset(sequence_number_);
+
+        assert(retransmission_buffer_ != nullptr);
+        const auto first{sequence_number_};
+        sequence_number_ = source_->fill(packet_builder_, *retransmission_buffer_, sequence_number_);
+        IMR_PROBE(packet_build_end, first, packet_builder_.message_count(), packet_builder_.size());
+
+        return retransmission_buffer_->last_file_position();
+    }
+
+    template <transport::Transport T>
+    void Feed::send_packet(std::chrono::nanoseconds timestamp,
+                           std::size_t position,
+                           T& transport,
+                           Lines::Clock::time_point now,
+                           Lines::Clock::time_point due) noexcept
+    {
         const std::span packet{packet_builder_.finalize()};
+        const auto first{sequence_number_ - packet_builder_.message_count()};
 
         sent_sequence_number_.store(sequence_number_, std::memory_order_relaxed);
 
-#ifndef DEBUG_NO_NETWORK
-        send_hdr_.msg_iov = packet.data();
-        send_hdr_.msg_iovlen = packet.size();
+        metrics_.packets.increment();
+        metrics_.messages.increment(packet_builder_.message_count());
+        metrics_.bytes.increment(packet_builder_.size());
+        metrics_.file_position.set(static_cast<std::int64_t>(position));
+
+        const auto batch{batch_++};
+
+        if (pcap_writer_.has_value())
+        {
+            const auto send_tsc{trace::tsc()};
+            capture_packet(packet, timestamp);
+
+            if (trace_ring_ != nullptr)
+            {
+                trace_ring_->record(first, packet_builder_.message_count(), position, timestamp, due, send_tsc, batch, trace::Result::captured);
+            }
+            return;
+        }
+
+        // co-located consumers first, a memcpy away
+        if (shm_writer_ != nullptr)
+        {
+            shm_writer_->publish(packet);
+        }
+
+        const auto send_tsc{trace_ring_ != nullptr ? trace::tsc() : 0};
+
+        IMR_PROBE(packet_send_start, first, packet_builder_.size());
+        const auto sent{lines_.send(transport, packet, timestamp, now)};
+        IMR_PROBE(packet_send_end, first, packet_builder_.size());
+
+        if (trace_ring_ != nullptr)
+        {
+            trace_ring_->record(first,
+                                packet_builder_.message_count(),
+                                position,
+                                timestamp,
+                                due,
+                                send_tsc,
+                                batch,
+                                sent ? trace::Result::sent : trace::Result::send_error);
+        }
 
-        if (const auto bytes_sent{sendmsg(socket_.get(), &send_hdr_, 0)}; bytes_sent < 0)
+        // parity follows the packet completing its group, off the packet's own path
+        if (fec_encoder_.has_value())
         {
-            util::log::perror();
+            send_parity(fec_encoder_->add(packet), transport);
         }
-        // todo: fix this condition because iovec size doesnt = the packet sent size
-        else if (static_cast<std::size_t>(bytes_sent) != packet.size())
+    }
+
+    template <transport::Transport T>
+    void Feed::send_parity(std::span<const std::span<const char>> parity, T& transport) noexcept
+    {
+        for (const auto& packet : parity)
         {
-            // std::println(stderr, "sendto: only sent {} of {} bytes", bytes_sent, packet.size());
+            iovec iov{.iov_base = const_cast<char*>(packet.data()), .iov_len = packet.size()};
+
+            mmsghdr msg{};
+            msg.msg_hdr.msg_name = const_cast<sockaddr_in*>(&fec_encoder_->destination());
+            msg.msg_hdr.msg_namelen = sizeof(sockaddr_in);
+            msg.msg_hdr.msg_iov = &iov;
+            msg.msg_hdr.msg_iovlen = 1;
+
+            transport.send({&msg, 1});
         }
-#endif
     }
 
-    void Feed::end_of_session([[maybe_unused]] std::stop_token st)
+    void Feed::capture_packet(std::span<const iovec> packet, std::chrono::nanoseconds timestamp) noexcept
+    {
+        const auto capture_time{pcap_writer_->timestamps() == PcapWriter::Config::Timestamps::itch
+                                    ? pcap_writer_->session_date().time_since_epoch() + capture_day_offset_ + timestamp
+                                    : std::chrono::system_clock::now().time_since_epoch()};
+
+        // heartbeats the heartbeat thread would have sent while the feed was idle since the last packet
+        if (last_capture_time_.has_value() && heartbeat_.period() > std::chrono::nanoseconds{0})
+        {
+            const auto heartbeat{make_header(packet_builder_.session(),
+                                             sequence_number_ - packet_builder_.message_count(),
+                                             types::header::heartbeat_msg_count)};
+
+            for (auto t{*last_capture_time_ + heartbeat_.period()}; t < capture_time; t += heartbeat_.period())
+            {
+                pcap_writer_->write(heartbeat, t);
+            }
+        }
+
+        pcap_writer_->write(packet, capture_time);
+        last_capture_time_ = capture_time;
+    }
+
+    template <transport::Transport T, util::wait::WaitStrategy W>
+    void Feed::roll_over(std::stop_token st, T& transport)
+    {
+        capture_day_offset_ += std::chrono::days{1};
+
+        if (rollover_ == Config::Rollover::session)
+        {
+            roll_session<T, W>(st, transport);
+        }
+
+        // no idle heartbeats across the (overnight) gap between items
+        last_capture_time_.reset();
+    }
+
+    template <transport::Transport T, util::wait::WaitStrategy W>
+    void Feed::roll_session(std::stop_token st, T& transport)
+    {
+        if (!pcap_writer_.has_value())
+        {
+            heartbeat_.stop();
+        }
+
+        end_of_session<T, W>(st, transport);
+
+        std::string_view old_session{packet_builder_.session()};
+        types::header::Session session{};
+        std::ranges::copy(old_session, session.begin());
+        session = types::header::roll_session(session);
+
+        util::log::info("Downstream feed: rolling session {} -> {}", old_session, std::string_view(session.data(), session.size()));
+
+        packet_builder_.set_session(session);
+        heartbeat_.set_session(std::string_view(session.data(), session.size()));
+
+        sequence_number_ = 1;
+        sent_sequence_number_.store(sequence_number_, std::memory_order_relaxed);
+        retransmission_buffer_->roll_session();
+
+        if (!pcap_writer_.has_value())
+        {
+            start_heartbeat<T, W>(transport);
+        }
+    }
+
+    template <transport::Transport T, util::wait::WaitStrategy W>
+    void Feed::end_of_session(std::stop_token st, T& transport)
     {
         util::log::debug("Downstream feed: end of session");
 
-#ifndef DEBUG_NO_NETWORK
-        std::array<char, types::header::length> eos_packet{};
+        if (trace_ring_ != nullptr)
+        {
+            trace_ring_->dump();
+        }
 
         using namespace imr::mold::types;
-        std::span eos_packet_span(eos_packet);
-
-        util::binary_io::write_at(eos_packet_span, header::session_offset, packet_builder_.session());
-        util::binary_io::write_at_be(eos_packet_span, header::sequence_number_offset, sequence_number_);
-        util::binary_io::write_at_be(eos_packet_span, header::message_count_offset, header::end_of_session_msg_count);
 
-        const auto start{std::chrono::high_resolution_clock::now()};
-        const auto end{start + end_of_session_duration_};
+        const auto eos_packet{make_header(packet_builder_.session(), sequence_number_, header::end_of_session_msg_count)};
 
-        while (!st.stop_requested() && end > std::chrono::high_resolution_clock::now())
+        if (pcap_writer_.has_value())
         {
-            if (const auto bytes_sent{sendto(socket_.get(),
-                                             eos_packet.data(),
-                                             sizeof(eos_packet),
-                                             0,
-                                             reinterpret_cast<sockaddr*>(&mcast_group_),
-                                             sizeof(mcast_group_))};
-                bytes_sent < 0)
+            const auto start{last_capture_time_.value_or(pcap_writer_->session_date().time_since_epoch())};
+
+            for (auto elapsed{std::chrono::nanoseconds{0}};
+                 elapsed < end_of_session_duration_ && heartbeat_.period() > std::chrono::nanoseconds{0};
+                 elapsed += heartbeat_.period())
             {
-                util::log::perror();
+                pcap_writer_->write(eos_packet, start + elapsed);
             }
-            else if (static_cast<std::size_t>(bytes_sent) < eos_packet.size())
-            {
 
-                util::log::error("{}: only sent {} of {} bytes",
-                                 std::source_location::current().function_name(),
-                                 bytes_sent,
-                                 eos_packet.size());
+            pcap_writer_->flush();
+            return;
+        }
+
+        // held back packets go out before the session ends
+        lines_.flush(transport);
+
+        if (fec_encoder_.has_value())
+        {
+            send_parity(fec_encoder_->flush(), transport);
+        }
+
+        if (fault_journal_ != nullptr)
+        {
+            fault_journal_->flush();
+        }
+
+        if (shm_writer_ != nullptr)
+        {
+            const std::array eos{iovec{.iov_base = const_cast<char*>(eos_packet.data()), .iov_len = eos_packet.size()}};
+            shm_writer_->publish(eos);
+
+            for (const auto& reader : shm_writer_->readers())
+            {
+                util::log::info("Downstream feed: shared memory reader {} is {} entries behind", reader.pid, reader.lag);
             }
+        }
+
+        // not waiting, one end of session packet is enough for consumers to see the session end
+        if constexpr (std::is_same_v<W, util::wait::None>)
+        {
+            IMR_PROBE(end_of_session, sequence_number_);
+            lines_.send(transport, eos_packet);
+            return;
+        }
+
+        const auto end{W::Clock::now() + end_of_session_duration_};
+
+        while (!st.stop_requested() && end > W::Clock::now())
+        {
+            IMR_PROBE(end_of_session, sequence_number_);
+            lines_.send(transport, eos_packet);
 
             util::log::debug();
 
-#ifndef DEBUG_NO_SLEEP
-            std::this_thread::sleep_for(heartbeat_.period());
-#endif
+            // virtual time doesn't move without a period to wait
+            if constexpr (std::is_same_v<W, util::wait::Virtual>)
+            {
+                if (heartbeat_.period() <= std::chrono::nanoseconds{0})
+                {
+                    break;
+                }
+            }
+
+            W::until(W::Clock::now() + heartbeat_.period());
         }
-#endif
     }
 
     sockaddr_in Feed::configure_socket(const Config& cfg) const
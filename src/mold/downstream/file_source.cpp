@@ -0,0 +1,66 @@
+#include "imr/mold/downstream/file_source.h"
+
+#include "../io.h"
+#include "../../itch/timestamp.h"
+#include "imr/mold/types.h"
+
+namespace imr::mold::downstream
+{
+    FileSource::FileSource(std::span<const char> file) noexcept
+        : file_{file}
+    {
+    }
+
+    std::optional<std::chrono::nanoseconds> FileSource::peek_timestamp()
+    {
+        const auto bytes{file_.subspan(file_pos_)};
+
+        if (bytes.size() < sizeof(types::LengthPrefix) + itch::timestamp_offset + itch::timestamp_size) [[unlikely]]
+        {
+            return std::nullopt;
+        }
+
+        return itch::extract_timestamp(bytes.subspan(sizeof(types::LengthPrefix)));
+    }
+
+    bool FileSource::skip()
+    {
+        return io::skip_message(file_, file_pos_);
+    }
+
+    types::header::SequenceNumber FileSource::fill(PacketBuilder& packet_builder,
+                                                   RetransmissionBuffer& retransmission_buffer,
+                                                   types::header::SequenceNumber next_seq)
+    {
+        while (file_pos_ < file_.size())
+        {
+            const std::size_t msg_file_pos{file_pos_};
+
+            const std::span msg{io::read_message(file_, file_pos_)};
+
+            if (msg.empty()) [[unlikely]]
+            {
+                break;
+            }
+
+            // rollback when packet is full
+            if (!packet_builder.try_add(msg))
+            {
+                file_pos_ = msg_file_pos;
+                break;
+            }
+
+            retransmission_buffer.push({
+                .sequence_number = next_seq++,
+                .file_position = msg_file_pos,
+            });
+        }
+
+        return next_seq;
+    }
+
+    MessageStore FileSource::message_store() const noexcept
+    {
+        return {file_};
+    }
+}
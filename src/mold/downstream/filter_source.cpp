@@ -0,0 +1,166 @@
+#include "imr/mold/downstream/filter_source.h"
+
+#include "../io.h"
+#include "../../itch/symbol_directory.h"
+#include "../../itch/timestamp.h"
+#include "../../util/binary_io.h"
+#include "imr/mold/types.h"
+#include "imr/util/log.h"
+
+#include <format>
+#include <source_location>
+#include <stdexcept>
+
+namespace imr::mold::downstream
+{
+    FilterSource::FilterSource(std::span<const char> file, const Config& cfg)
+        : file_{file}
+    {
+        if (!cfg.symbols.empty())
+        {
+            const itch::SymbolDirectory directory(file_);
+
+            for (const auto& symbol : cfg.symbols)
+            {
+                const auto locate{directory.locate_for(symbol)};
+
+                if (!locate.has_value())
+                {
+                    throw std::invalid_argument(std::format("{}: symbol {} not in stock directory ({} symbols)",
+                                                            std::source_location::current().function_name(),
+                                                            symbol,
+                                                            directory.size()));
+                }
+
+                locates_.set(*locate);
+            }
+        }
+
+        for (const auto locate : cfg.locates)
+        {
+            locates_.set(locate);
+        }
+
+        // no stocks given replays every stock, like no types every type
+        if (cfg.symbols.empty() && cfg.locates.empty())
+        {
+            locates_.set();
+            locates_.set(0, cfg.market_wide);
+        }
+        else
+        {
+            // an explicit locate 0 also replays the market wide messages
+            locates_.set(0, locates_.test(0) || cfg.market_wide);
+        }
+
+        if (cfg.message_types.empty())
+        {
+            types_.set();
+        }
+
+        for (const auto type : cfg.message_types)
+        {
+            types_.set(static_cast<unsigned char>(type));
+        }
+
+        util::log::info("Filter: {} locates, {} message types", locates_.count(), types_.count());
+
+        seek();
+    }
+
+    bool FilterSource::matches(std::size_t pos) const noexcept
+    {
+        const auto body{file_.subspan(pos + sizeof(types::LengthPrefix))};
+
+        const auto type{static_cast<unsigned char>(body[itch::message_type_offset])};
+        const auto locate{util::binary_io::read_at_be<std::uint16_t>(body, itch::stock_locate_offset)};
+
+        return types_[type] && locates_[locate];
+    }
+
+    void FilterSource::seek() noexcept
+    {
+        // type + locate
+        constexpr auto min_length{itch::stock_locate_offset + sizeof(std::uint16_t)};
+
+        while (file_pos_ + sizeof(types::LengthPrefix) <= file_.size())
+        {
+            const auto length{util::binary_io::read_at_be<types::LengthPrefix>(file_, file_pos_)};
+            const auto next_pos{file_pos_ + sizeof(types::LengthPrefix) + length};
+
+            // truncated, left for read_message() to reject
+            if (next_pos > file_.size()) [[unlikely]]
+            {
+                return;
+            }
+
+            if (length >= min_length && matches(file_pos_))
+            {
+                return;
+            }
+
+            file_pos_ = next_pos;
+        }
+    }
+
+    std::optional<std::chrono::nanoseconds> FilterSource::peek_timestamp()
+    {
+        const auto bytes{file_.subspan(file_pos_)};
+
+        if (bytes.size() < sizeof(types::LengthPrefix) + itch::timestamp_offset + itch::timestamp_size) [[unlikely]]
+        {
+            return std::nullopt;
+        }
+
+        return itch::extract_timestamp(bytes.subspan(sizeof(types::LengthPrefix)));
+    }
+
+    bool FilterSource::skip()
+    {
+        if (!io::skip_message(file_, file_pos_))
+        {
+            return false;
+        }
+
+        seek();
+        return true;
+    }
+
+    types::header::SequenceNumber FilterSource::fill(PacketBuilder& packet_builder,
+                                                     RetransmissionBuffer& retransmission_buffer,
+                                                     types::header::SequenceNumber next_seq)
+    {
+        while (file_pos_ < file_.size())
+        {
+            const std::size_t msg_file_pos{file_pos_};
+
+            const std::span msg{io::read_message(file_, file_pos_)};
+
+            if (msg.empty()) [[unlikely]]
+            {
+                break;
+            }
+
+            // rollback when packet is full
+            if (!packet_builder.try_add(msg))
+            {
+                file_pos_ = msg_file_pos;
+                break;
+            }
+
+            retransmission_buffer.push({
+                .sequence_number = next_seq++,
+                .file_position = msg_file_pos,
+            });
+
+            seek();
+        }
+
+        return next_seq;
+    }
+
+    MessageStore FilterSource::message_store() const noexcept
+    {
+        return {file_};
+    }
+}
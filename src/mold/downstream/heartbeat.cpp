@@ -1,21 +1,17 @@
 #include "imr/mold/downstream/heartbeat.h"
 
 #include "imr/mold/types.h"
-#include "imr/util/file_descriptor.h"
 #include "imr/util/log.h"
 #include "util/binary_io.h"
+#include "util/probe.h"
 #include <stop_token>
 
 namespace imr::mold::downstream
 {
     Heartbeat::Heartbeat(std::chrono::nanoseconds period,
-                         util::FileDescriptor& socket,
-                         const sockaddr_in& mcast_group,
                          std::string_view session,
                          const std::atomic<types::header::SequenceNumber>& next_seq)
         : period_{period},
-          socket_{&socket},
-          mcast_group_{mcast_group},
           next_seq_{&next_seq}
     {
         // write header
@@ -27,17 +23,20 @@ namespace imr::mold::downstream
         util::log::debug();
     }
 
-    void Heartbeat::start()
+    void Heartbeat::start(Send sender)
     {
         util::log::info("Hearbeat started");
 
+        send_ = std::move(sender);
+
         thread_ = std::jthread([this](std::stop_token st) {
             while (!st.stop_requested())
             {
                 send();
                 util::log::debug();
 
-                std::this_thread::sleep_for(period_);
+                std::unique_lock lock(mutex_);
+                wake_.wait_for(lock, st, period_, [] { return false; });
             }
         });
     }
@@ -54,26 +53,30 @@ namespace imr::mold::downstream
         util::log::info("Downstream heartbeat requested stop");
     }
 
+    void Heartbeat::set_session(std::string_view session) noexcept
+    {
+        util::binary_io::write_at(std::span(packet_), types::header::session_offset, session);
+    }
+
     std::chrono::nanoseconds Heartbeat::period() const noexcept
     {
         return period_;
     }
 
+    util::metrics::Counter& Heartbeat::sent() noexcept
+    {
+        return sent_;
+    }
+
     void Heartbeat::send() noexcept
     {
         const auto seq{next_seq_->load(std::memory_order_relaxed)};
 
         util::binary_io::write_at_be(std::span(packet_), types::header::sequence_number_offset, seq);
 
-        if (sendto(socket_->get(),
-                   packet_.data(),
-                   packet_.size(),
-                   0,
-                   reinterpret_cast<const sockaddr*>(&mcast_group_),
-                   sizeof(mcast_group_)) < 0)
-        {
-            util::log::perror();
-        }
+        IMR_PROBE(heartbeat, seq);
+        send_(packet_);
+        sent_.increment();
     }
 
 }
@@ -0,0 +1,445 @@
+#include "imr/mold/downstream/lines.h"
+
+#include "imr/util/log.h"
+#include "../../util/binary_io.h"
+
+#include <algorithm>
+#include <cstring>
+#include <format>
+#include <limits>
+#include <memory>
+#include <source_location>
+#include <stdexcept>
+#include <system_error>
+#include <tuple>
+
+#include <arpa/inet.h>
+#include <ifaddrs.h>
+#include <net/if.h>
+
+namespace imr::mold::downstream
+{
+    namespace
+    {
+        unsigned interface_index(in_addr address)
+        {
+            ifaddrs* interfaces{nullptr};
+            if (getifaddrs(&interfaces) < 0)
+            {
+                throw std::system_error(errno, std::system_category(), std::source_location::current().function_name());
+            }
+
+            const std::unique_ptr<ifaddrs, decltype(&freeifaddrs)> owner{interfaces, &freeifaddrs};
+
+            for (const auto* it{interfaces}; it != nullptr; it = it->ifa_next)
+            {
+                if (it->ifa_addr == nullptr || it->ifa_addr->sa_family != AF_INET)
+                {
+                    continue;
+                }
+
+                sockaddr_in interface_address{};
+                std::memcpy(&interface_address, it->ifa_addr, sizeof(interface_address));
+
+                if (interface_address.sin_addr.s_addr == address.s_addr)
+                {
+                    return if_nametoindex(it->ifa_name);
+                }
+            }
+
+            std::array<char, INET_ADDRSTRLEN> text{};
+            inet_ntop(AF_INET, &address, text.data(), text.size());
+            throw std::invalid_argument(std::format("{}: {} is not a local interface address",
+                                                    std::source_location::current().function_name(),
+                                                    text.data()));
+        }
+
+        // index of the first scripted drop covering any of the packet's sequence numbers
+        std::optional<std::size_t> scripted_drop(std::span<const Lines::ScriptedDrop> drops,
+                                                 std::chrono::nanoseconds timestamp,
+                                                 types::header::SequenceNumber sequence_number,
+                                                 types::header::MessageCount message_count) noexcept
+        {
+            const auto last{sequence_number + std::max<types::header::SequenceNumber>(message_count, 1) - 1};
+
+            for (auto i{0UZ}; i < drops.size(); ++i)
+            {
+                if (timestamp >= drops[i].at && sequence_number <= drops[i].last && last >= drops[i].first)
+                {
+                    return i;
+                }
+            }
+
+            return std::nullopt;
+        }
+    }
+
+    Lines::Lines(int socket,
+                 const sockaddr_in& primary,
+                 const Impairment& primary_impairment,
+                 std::span<const Line> redundant,
+                 std::size_t max_packet_size,
+                 FaultJournal* journal)
+        : socket_{socket},
+          max_packet_size_{max_packet_size},
+          journal_{journal}
+    {
+        lines_.reserve(1 + redundant.size());
+        lines_.push_back(make_state(primary, {.s_addr = htonl(INADDR_ANY)}, primary_impairment, max_packet_size_));
+
+        for (const auto& line : redundant)
+        {
+            sockaddr_in destination{};
+            destination.sin_family = AF_INET;
+            destination.sin_port = htons(line.port);
+
+            if (inet_pton(AF_INET, line.mcast_group.c_str(), &destination.sin_addr) != 1)
+            {
+                throw std::invalid_argument(std::format("{}: invalid ip format for line group {}",
+                                                        std::source_location::current().function_name(),
+                                                        line.mcast_group.c_str()));
+            }
+
+            lines_.push_back(make_state(destination, line.egress_interface, line.impairment, max_packet_size_));
+        }
+
+        // worst case batch: every line sends the current packet twice (duplicated) and everything it holds
+        auto max_batch{0UZ};
+        for (const auto& line : lines_)
+        {
+            max_batch += 2 + line.slots.size();
+        }
+
+        batch_.reserve(max_batch);
+        slot_iovecs_.reserve(max_batch);
+        sent_slots_.reserve(max_batch);
+
+        util::log::info("Downstream lines: {}", lines_.size());
+    }
+
+    Lines::State Lines::make_state(const sockaddr_in& destination,
+                                   in_addr egress_interface,
+                                   const Impairment& impairment,
+                                   std::size_t max_packet_size)
+    {
+        State line(destination, impairment);
+
+        if (egress_interface.s_addr != htonl(INADDR_ANY))
+        {
+            auto* cmsg{reinterpret_cast<cmsghdr*>(line.control.data())};
+            cmsg->cmsg_level = IPPROTO_IP;
+            cmsg->cmsg_type = IP_PKTINFO;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(in_pktinfo));
+
+            in_pktinfo info{};
+            info.ipi_ifindex = static_cast<int>(interface_index(egress_interface));
+            info.ipi_spec_dst = egress_interface;
+            std::memcpy(CMSG_DATA(cmsg), &info, sizeof(info));
+
+            line.control_length = CMSG_SPACE(sizeof(in_pktinfo));
+        }
+
+        const auto holds{impairment.reorder > 0.0 || impairment.delay > std::chrono::nanoseconds{0} ||
+                         impairment.delay_jitter > std::chrono::nanoseconds{0}};
+
+        if (holds)
+        {
+            line.storage.resize(impairment.max_held * max_packet_size);
+            line.slots.resize(impairment.max_held);
+            line.delayed.reserve(impairment.max_held);
+            line.reordering.reserve(impairment.max_held);
+
+            line.free_slots.reserve(impairment.max_held);
+            for (auto slot{static_cast<std::uint32_t>(impairment.max_held)}; slot > 0; --slot)
+            {
+                line.free_slots.push_back(slot - 1);
+            }
+        }
+
+        return line;
+    }
+
+    void Lines::queue_packet(std::span<const iovec> packet, std::chrono::nanoseconds timestamp, Clock::time_point now) noexcept
+    {
+        const std::span header{static_cast<const char*>(packet.front().iov_base), packet.front().iov_len};
+        const PacketInfo info{
+            .timestamp = timestamp,
+            .sequence_number = util::binary_io::read_at_be<types::header::SequenceNumber>(header, types::header::sequence_number_offset),
+            .message_count = util::binary_io::read_at_be<types::header::MessageCount>(header, types::header::message_count_offset),
+        };
+
+        for (auto i{0U}; i < lines_.size(); ++i)
+        {
+            auto& line{lines_[i]};
+
+            release_delayed(i, now);
+
+            if (const auto drop{scripted_drop(line.impairment.scripted_drops, timestamp, info.sequence_number, info.message_count)};
+                drop.has_value())
+            {
+                journal(i, info, FaultJournal::Fault::scripted_drop, *drop);
+                continue;
+            }
+
+            if (line.rng.chance(line.impairment.drop))
+            {
+                journal(i, info, FaultJournal::Fault::drop, 0);
+                continue;
+            }
+
+            auto copies{1};
+            if (line.rng.chance(line.impairment.duplicate))
+            {
+                journal(i, info, FaultJournal::Fault::duplicate, 0);
+                copies = 2;
+            }
+
+            auto sent{false};
+            for (auto copy{0}; copy < copies; ++copy)
+            {
+                sent = output(i, packet, info, now) || sent;
+            }
+
+            // held back packets count down the packets that actually went out after them
+            if (sent)
+            {
+                release_reordered(i, now);
+            }
+        }
+    }
+
+    std::optional<Lines::Clock::time_point> Lines::next_release() const noexcept
+    {
+        std::optional<Clock::time_point> next;
+
+        for (const auto& line : lines_)
+        {
+            if (!line.delayed.empty())
+            {
+                const auto due{line.slots[line.delayed.front()].due};
+                next = next.has_value() ? std::min(*next, due) : due;
+            }
+        }
+
+        return next;
+    }
+
+    void Lines::queue_release(Clock::time_point now) noexcept
+    {
+        for (auto i{0U}; i < lines_.size(); ++i)
+        {
+            release_delayed(i, now);
+        }
+    }
+
+    void Lines::queue_flush() noexcept
+    {
+        for (auto i{0U}; i < lines_.size(); ++i)
+        {
+            release_delayed(i, std::nullopt);
+
+            for (const auto slot : lines_[i].reordering)
+            {
+                queue_slot(i, slot);
+            }
+            lines_[i].reordering.clear();
+        }
+    }
+
+    std::size_t Lines::size() const noexcept
+    {
+        return lines_.size();
+    }
+
+    std::uint32_t Lines::hold(State& line, std::span<const iovec> packet, const PacketInfo& info) noexcept
+    {
+        auto length{0UZ};
+        for (const auto& iov : packet)
+        {
+            length += iov.iov_len;
+        }
+
+        if (line.free_slots.empty() || length > max_packet_size_) [[unlikely]]
+        {
+            return no_slot;
+        }
+
+        const auto slot{line.free_slots.back()};
+        line.free_slots.pop_back();
+
+        auto* dst{line.storage.data() + (slot * max_packet_size_)};
+        for (const auto& iov : packet)
+        {
+            std::memcpy(dst, iov.iov_base, iov.iov_len);
+            dst += iov.iov_len;
+        }
+
+        line.slots[slot].info = info;
+        line.slots[slot].length = length;
+        return slot;
+    }
+
+    void Lines::journal(std::uint32_t line_index, const PacketInfo& info, FaultJournal::Fault fault, std::uint64_t detail) noexcept
+    {
+        if (journal_ == nullptr)
+        {
+            return;
+        }
+
+        journal_->record({
+            .timestamp = info.timestamp,
+            .sequence_number = info.sequence_number,
+            .message_count = info.message_count,
+            .line = static_cast<std::uint8_t>(line_index),
+            .fault = fault,
+            .detail = static_cast<std::uint32_t>(std::min<std::uint64_t>(detail, std::numeric_limits<std::uint32_t>::max())),
+        });
+    }
+
+    bool Lines::output(std::uint32_t line_index, std::span<const iovec> packet, const PacketInfo& info, Clock::time_point now) noexcept
+    {
+        auto& line{lines_[line_index]};
+
+        if (line.rng.chance(line.impairment.reorder))
+        {
+            if (const auto slot{hold(line, packet, info)}; slot != no_slot)
+            {
+                const auto depth{1 + (line.rng.next() % std::max(line.impairment.reorder_depth, 1UZ))};
+
+                line.slots[slot].countdown = depth;
+                line.reordering.push_back(slot);
+
+                journal(line_index, info, FaultJournal::Fault::reorder, depth);
+                return false;
+            }
+        }
+
+        delay(line_index, packet, info, now);
+        return true;
+    }
+
+    void Lines::delay(std::uint32_t line_index, std::span<const iovec> packet, const PacketInfo& info, Clock::time_point now) noexcept
+    {
+        auto& line{lines_[line_index]};
+
+        if (line.impairment.delay > std::chrono::nanoseconds{0} || line.impairment.delay_jitter > std::chrono::nanoseconds{0})
+        {
+            if (const auto slot{hold(line, packet, info)}; slot != no_slot)
+            {
+                output_slot(line_index, slot, now);
+                return;
+            }
+        }
+
+        // sendmmsg doesn't write through msg_iov
+        queue(line, {const_cast<iovec*>(packet.data()), packet.size()});
+    }
+
+    void Lines::output_slot(std::uint32_t line_index, std::uint32_t slot, Clock::time_point now) noexcept
+    {
+        auto& line{lines_[line_index]};
+
+        auto delay{line.impairment.delay};
+        if (const auto jitter{line.impairment.delay_jitter.count()}; jitter > 0)
+        {
+            delay += std::chrono::nanoseconds{static_cast<std::int64_t>(line.rng.next() % static_cast<std::uint64_t>(jitter))};
+        }
+
+        if (delay == std::chrono::nanoseconds{0})
+        {
+            queue_slot(line_index, slot);
+            return;
+        }
+
+        line.slots[slot].due = now + delay;
+        line.slots[slot].order = line.next_order++;
+        line.delayed.push_back(slot);
+        std::ranges::push_heap(line.delayed, Later{&line.slots});
+
+        journal(line_index,
+                line.slots[slot].info,
+                FaultJournal::Fault::delay,
+                static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(delay).count()));
+    }
+
+    mmsghdr Lines::message(const State& line, std::span<iovec> iov) noexcept
+    {
+        mmsghdr msg{};
+        msg.msg_hdr.msg_name = const_cast<sockaddr_in*>(&line.destination);
+        msg.msg_hdr.msg_namelen = sizeof(line.destination);
+        msg.msg_hdr.msg_iov = iov.data();
+        msg.msg_hdr.msg_iovlen = iov.size();
+        msg.msg_hdr.msg_control = line.control_length > 0 ? const_cast<char*>(line.control.data()) : nullptr;
+        msg.msg_hdr.msg_controllen = line.control_length;
+
+        return msg;
+    }
+
+    void Lines::queue(const State& line, std::span<iovec> iov) noexcept
+    {
+        batch_.push_back(message(line, iov));
+    }
+
+    void Lines::queue_slot(std::uint32_t line_index, std::uint32_t slot) noexcept
+    {
+        auto& line{lines_[line_index]};
+
+        slot_iovecs_.push_back({.iov_base = line.storage.data() + (slot * max_packet_size_),
+                                .iov_len = line.slots[slot].length});
+        queue(line, {&slot_iovecs_.back(), 1});
+        sent_slots_.emplace_back(line_index, slot);
+    }
+
+    void Lines::release_reordered(std::uint32_t line_index, Clock::time_point now) noexcept
+    {
+        auto& line{lines_[line_index]};
+
+        auto kept{0UZ};
+        for (auto i{0UZ}; i < line.reordering.size(); ++i)
+        {
+            const auto slot{line.reordering[i]};
+
+            if (--line.slots[slot].countdown == 0)
+            {
+                output_slot(line_index, slot, now);
+            }
+            else
+            {
+                line.reordering[kept++] = slot;
+            }
+        }
+
+        line.reordering.resize(kept);
+    }
+
+    void Lines::release_delayed(std::uint32_t line_index, std::optional<Clock::time_point> now) noexcept
+    {
+        auto& line{lines_[line_index]};
+
+        while (!line.delayed.empty() && (!now.has_value() || line.slots[line.delayed.front()].due <= *now))
+        {
+            std::ranges::pop_heap(line.delayed, Later{&line.slots});
+            queue_slot(line_index, line.delayed.back());
+            line.delayed.pop_back();
+        }
+    }
+
+    bool Lines::Later::operator()(std::uint32_t lhs, std::uint32_t rhs) const noexcept
+    {
+        const auto& a{(*slots)[lhs]};
+        const auto& b{(*slots)[rhs]};
+        return std::tie(a.due, a.order) > std::tie(b.due, b.order);
+    }
+
+    void Lines::sent() noexcept
+    {
+        for (const auto& [line_index, slot] : sent_slots_)
+        {
+            lines_[line_index].free_slots.push_back(slot);
+        }
+
+        batch_.clear();
+        slot_iovecs_.clear();
+        sent_slots_.clear();
+    }
+}
@@ -0,0 +1,174 @@
+#include "imr/mold/downstream/merge_source.h"
+
+#include "../io.h"
+#include "../../itch/timestamp.h"
+#include "imr/mold/types.h"
+
+#include <bit>
+#include <format>
+#include <source_location>
+#include <stdexcept>
+#include <utility>
+
+namespace imr::mold::downstream
+{
+    namespace
+    {
+        // timestamps are nanoseconds since midnight (< 2^47), leaving the low byte for the file id tie break
+        constexpr unsigned file_id_bits{8};
+        static_assert(MessageStore::max_files == 1UZ << file_id_bits);
+    }
+
+    MergeSource::MergeSource(std::vector<std::span<const char>> files)
+        : files_{std::move(files)}
+    {
+        if (files_.empty() || files_.size() > MessageStore::max_files)
+        {
+            throw std::invalid_argument(std::format("{}: expected 1 to {} files, got {}",
+                                                    std::source_location::current().function_name(),
+                                                    MessageStore::max_files,
+                                                    files_.size()));
+        }
+
+        const auto leaves{static_cast<std::uint32_t>(std::bit_ceil(files_.size()))};
+
+        file_pos_.resize(files_.size(), 0);
+        keys_.resize(leaves, exhausted);
+        tree_.resize(leaves, 0);
+
+        for (auto leaf{0U}; leaf < files_.size(); ++leaf)
+        {
+            load_key(leaf);
+        }
+
+        // build bottom up: winners[node] is the leaf winning the subtree at node, the loser stays in tree_
+        std::vector<std::uint32_t> winners(2UZ * leaves);
+        for (auto leaf{0U}; leaf < leaves; ++leaf)
+        {
+            winners[leaves + leaf] = leaf;
+        }
+
+        for (auto node{leaves - 1}; node > 0; --node)
+        {
+            auto left{winners[2UZ * node]};
+            auto right{winners[(2UZ * node) + 1]};
+
+            if (keys_[right] < keys_[left])
+            {
+                std::swap(left, right);
+            }
+
+            winners[node] = left;
+            tree_[node] = right;
+        }
+
+        tree_[0] = winners[1];
+    }
+
+    void MergeSource::load_key(std::uint32_t leaf) noexcept
+    {
+        const auto bytes{files_[leaf].subspan(file_pos_[leaf])};
+
+        if (bytes.size() < sizeof(types::LengthPrefix) + itch::timestamp_offset + itch::timestamp_size) [[unlikely]]
+        {
+            keys_[leaf] = exhausted;
+            return;
+        }
+
+        const auto timestamp{itch::extract_timestamp(bytes.subspan(sizeof(types::LengthPrefix)))};
+        keys_[leaf] = (static_cast<std::uint64_t>(timestamp.count()) << file_id_bits) | leaf;
+    }
+
+    void MergeSource::replay(std::uint32_t leaf) noexcept
+    {
+        auto winner{leaf};
+
+        for (auto node{static_cast<std::uint32_t>((keys_.size() + leaf) / 2)}; node > 0; node /= 2)
+        {
+            if (keys_[tree_[node]] < keys_[winner])
+            {
+                std::swap(tree_[node], winner);
+            }
+        }
+
+        tree_[0] = winner;
+    }
+
+    std::optional<std::chrono::nanoseconds> MergeSource::peek_timestamp()
+    {
+        const auto key{keys_[tree_[0]]};
+
+        if (key == exhausted)
+        {
+            return std::nullopt;
+        }
+
+        return std::chrono::nanoseconds{key >> file_id_bits};
+    }
+
+    bool MergeSource::skip()
+    {
+        const auto leaf{tree_[0]};
+
+        if (keys_[leaf] == exhausted)
+        {
+            return false;
+        }
+
+        if (io::skip_message(files_[leaf], file_pos_[leaf]))
+        {
+            load_key(leaf);
+        }
+        else [[unlikely]]
+        {
+            // truncated tail, drop this file from the merge like fill() does
+            keys_[leaf] = exhausted;
+        }
+
+        replay(leaf);
+        return keys_[tree_[0]] != exhausted;
+    }
+
+    types::header::SequenceNumber MergeSource::fill(PacketBuilder& packet_builder,
+                                                    RetransmissionBuffer& retransmission_buffer,
+                                                    types::header::SequenceNumber next_seq)
+    {
+        while (keys_[tree_[0]] != exhausted)
+        {
+            const auto leaf{tree_[0]};
+            const std::size_t msg_file_pos{file_pos_[leaf]};
+
+            const std::span msg{io::read_message(files_[leaf], file_pos_[leaf])};
+
+            if (msg.empty()) [[unlikely]]
+            {
+                // truncated tail, drop this file from the merge
+                keys_[leaf] = exhausted;
+                replay(leaf);
+                continue;
+            }
+
+            // rollback when packet is full
+            if (!packet_builder.try_add(msg))
+            {
+                file_pos_[leaf] = msg_file_pos;
+                break;
+            }
+
+            retransmission_buffer.push({
+                .sequence_number = next_seq++,
+                .file_position = MessageStore::position(leaf, msg_file_pos),
+            });
+
+            load_key(leaf);
+            replay(leaf);
+        }
+
+        return next_seq;
+    }
+
+    MessageStore MergeSource::message_store() const noexcept
+    {
+        return MessageStore{files_};
+    }
+}
@@ -0,0 +1,535 @@
+#include "imr/mold/downstream/pcap_source.h"
+
+#include "../io.h"
+#include "../../itch/timestamp.h"
+#include "../../pcap/format.h"
+#include "../../util/binary_io.h"
+#include "imr/mold/types.h"
+#include "imr/util/log.h"
+
+#include <algorithm>
+#include <bit>
+#include <format>
+#include <source_location>
+#include <stdexcept>
+
+namespace
+{
+    using namespace imr;
+
+    constexpr std::uint64_t nanos_per_second{1'000'000'000};
+
+    __extension__ using uint128 = unsigned __int128;
+
+    std::chrono::nanoseconds ticks_to_ns(std::uint64_t ticks, std::uint64_t ticks_per_second) noexcept
+    {
+        // split, the remainder times 10^9 overflowing 64 bits once a tick is finer than 1ns (if_tsresol goes down to
+        // 10^-19 s / 2^-63 s), so it's multiplied in 128 bits
+        const auto ns{(ticks / ticks_per_second) * nanos_per_second +
+                      static_cast<std::uint64_t>(static_cast<uint128>(ticks % ticks_per_second) * nanos_per_second / ticks_per_second)};
+        return std::chrono::nanoseconds{static_cast<std::chrono::nanoseconds::rep>(ns)};
+    }
+
+    // if_tsresol: MSB clear is a negative power of 10, set is a negative power of 2
+    std::uint64_t ticks_per_second_from_tsresol(std::uint8_t tsresol) noexcept
+    {
+        if ((tsresol & 0x80U) != 0)
+        {
+            return 1ULL << std::min(tsresol & 0x7FU, 63U);
+        }
+
+        std::uint64_t ticks{1};
+        for (auto i{0U}; i < std::min(static_cast<unsigned>(tsresol), 19U); ++i)
+        {
+            ticks *= 10;
+        }
+        return ticks;
+    }
+
+    // walks link / IPv4 / UDP headers. Empty span if not an unfragmented IPv4 UDP datagram to `port` (0 = any)
+    std::span<const char> udp_payload(std::span<const char> frame, std::uint16_t link_type, std::uint16_t port) noexcept
+    {
+        using util::binary_io::read_at_be;
+
+        std::size_t ip_offset{0};
+
+        switch (link_type)
+        {
+        case pcap::link_type_ethernet:
+        {
+            std::size_t type_offset{pcap::ethernet_type_offset};
+
+            if (frame.size() < pcap::ethernet_header_length)
+            {
+                return {};
+            }
+
+            auto ether_type{read_at_be<std::uint16_t>(frame, type_offset)};
+
+            while ((ether_type == pcap::ether_type_vlan || ether_type == pcap::ether_type_qinq) &&
+                   frame.size() >= type_offset + pcap::vlan_tag_length + sizeof(std::uint16_t))
+            {
+                type_offset += pcap::vlan_tag_length;
+                ether_type = read_at_be<std::uint16_t>(frame, type_offset);
+            }
+
+            if (ether_type != pcap::ether_type_ipv4)
+            {
+                return {};
+            }
+
+            ip_offset = type_offset + sizeof(std::uint16_t);
+            break;
+        }
+        case pcap::link_type_linux_sll:
+            if (frame.size() < pcap::linux_sll_header_length ||
+                read_at_be<std::uint16_t>(frame, pcap::linux_sll_protocol_offset) != pcap::ether_type_ipv4)
+            {
+                return {};
+            }
+
+            ip_offset = pcap::linux_sll_header_length;
+            break;
+        case pcap::link_type_raw:
+        case pcap::link_type_ipv4:
+            break;
+        default:
+            return {};
+        }
+
+        if (frame.size() < ip_offset + pcap::ipv4_min_header_length)
+        {
+            return {};
+        }
+
+        const auto ip{frame.subspan(ip_offset)};
+        const auto version_ihl{static_cast<std::uint8_t>(ip[0])};
+        const std::size_t ihl{(version_ihl & 0x0FU) * 4U};
+        const std::size_t total_length{read_at_be<std::uint16_t>(ip, pcap::ipv4_total_length_offset)};
+
+        if ((version_ihl >> 4U) != 4 ||
+            ihl < pcap::ipv4_min_header_length ||
+            total_length < ihl + pcap::udp_header_length ||
+            total_length > ip.size() ||
+            static_cast<std::uint8_t>(ip[pcap::ipv4_protocol_offset]) != pcap::ipv4_protocol_udp ||
+            (read_at_be<std::uint16_t>(ip, pcap::ipv4_fragment_offset) & pcap::ipv4_fragment_mask) != 0)
+        {
+            return {};
+        }
+
+        const auto udp{ip.subspan(ihl, total_length - ihl)};
+        const std::size_t udp_length{read_at_be<std::uint16_t>(udp, pcap::udp_length_offset)};
+
+        if (udp_length < pcap::udp_header_length || udp_length > udp.size() ||
+            (port != 0 && read_at_be<std::uint16_t>(udp, pcap::udp_destination_port_offset) != port))
+        {
+            return {};
+        }
+
+        return udp.subspan(pcap::udp_header_length, udp_length - pcap::udp_header_length);
+    }
+}
+
+namespace imr::mold::downstream
+{
+    PcapSource::PcapSource(std::span<const char> capture, const Config& cfg)
+        : capture_{capture},
+          timing_{cfg.timing},
+          port_{cfg.port},
+          deduplicate_{cfg.deduplicate}
+    {
+        const auto magic{capture_.size() >= sizeof(std::uint32_t) ? util::binary_io::read_at<std::uint32_t>(capture_, 0) : 0};
+
+        if (magic == pcap::ng::section_header_block)
+        {
+            // byte order is read from each section header as it's reached
+            pcapng_ = true;
+            return;
+        }
+
+        const auto is_magic{[magic](std::uint32_t expected) {
+            return magic == expected || magic == std::byteswap(expected);
+        }};
+
+        if ((!is_magic(pcap::magic_microseconds) && !is_magic(pcap::magic_nanoseconds)) ||
+            capture_.size() < pcap::file_header_length)
+        {
+            throw std::invalid_argument(std::format("{}: capture is not pcap or pcapng",
+                                                    std::source_location::current().function_name()));
+        }
+
+        swapped_ = magic == std::byteswap(pcap::magic_microseconds) || magic == std::byteswap(pcap::magic_nanoseconds);
+
+        interfaces_.push_back({
+            // upper 16 bits hold FCS info
+            .link_type = static_cast<std::uint16_t>(read_at<std::uint32_t>(pcap::file_header_link_type_offset) & 0xFFFFU),
+            .ticks_per_second = is_magic(pcap::magic_nanoseconds) ? nanos_per_second : 1'000'000,
+        });
+
+        record_pos_ = pcap::file_header_length;
+
+        util::log::debug();
+    }
+
+    std::optional<std::chrono::nanoseconds> PcapSource::peek_timestamp()
+    {
+        while (load_packet())
+        {
+            if (timing_ == Config::Timing::capture)
+            {
+                return packet_timestamp_;
+            }
+
+            if (packet_end_ - msg_pos_ >= sizeof(types::LengthPrefix) + itch::timestamp_offset + itch::timestamp_size) [[likely]]
+            {
+                return itch::extract_timestamp(capture_.subspan(msg_pos_ + sizeof(types::LengthPrefix)));
+            }
+
+            // truncated capture / malformed packet, drop the rest of it
+            msgs_left_ = 0;
+        }
+
+        return std::nullopt;
+    }
+
+    bool PcapSource::skip()
+    {
+        if (!load_packet())
+        {
+            return false;
+        }
+
+        [[maybe_unused]]
+        const auto skipped{next_message()};
+
+        return true;
+    }
+
+    types::header::SequenceNumber PcapSource::fill(PacketBuilder& packet_builder,
+                                                   RetransmissionBuffer& retransmission_buffer,
+                                                   types::header::SequenceNumber next_seq)
+    {
+        // only the current captured packet, to keep its original grouping
+        if (!load_packet())
+        {
+            return next_seq;
+        }
+
+        while (msgs_left_ > 0)
+        {
+            const auto msg_pos{msg_pos_};
+            const auto msgs_left{msgs_left_};
+
+            const std::span msg{next_message()};
+
+            if (msg.empty()) [[unlikely]]
+            {
+                break;
+            }
+
+            // rollback when packet is full, the rest goes out in the next packet
+            if (!packet_builder.try_add(msg))
+            {
+                msg_pos_ = msg_pos;
+                msgs_left_ = msgs_left;
+                break;
+            }
+
+            retransmission_buffer.push({
+                .sequence_number = next_seq++,
+                .file_position = msg_pos,
+            });
+        }
+
+        return next_seq;
+    }
+
+    MessageStore PcapSource::message_store() const noexcept
+    {
+        return {capture_};
+    }
+
+    types::header::SequenceNumber& PcapSource::watermark_for(std::span<const char, sizeof(types::header::Session)> session)
+    {
+        // almost always the last packet's session
+        if (watermark_ < watermarks_.size() && std::ranges::equal(watermarks_[watermark_].session, session)) [[likely]]
+        {
+            return watermarks_[watermark_].next_seq;
+        }
+
+        const auto it{std::ranges::find_if(watermarks_, [&session](const Watermark& watermark) {
+            return std::ranges::equal(watermark.session, session);
+        })};
+
+        if (it != watermarks_.end())
+        {
+            watermark_ = static_cast<std::size_t>(it - watermarks_.begin());
+        }
+        else
+        {
+            Watermark watermark{.session = {}, .next_seq = 0};
+            std::ranges::copy(session, watermark.session.begin());
+
+            watermark_ = watermarks_.size();
+            watermarks_.push_back(watermark);
+        }
+
+        return watermarks_[watermark_].next_seq;
+    }
+
+    bool PcapSource::load_packet()
+    {
+        using util::binary_io::read_at_be;
+
+        if (msgs_left_ > 0)
+        {
+            return true;
+        }
+
+        std::span<const char> frame;
+        std::chrono::nanoseconds timestamp{};
+        std::uint16_t link_type{};
+
+        while (next_frame(frame, timestamp, link_type))
+        {
+            const auto payload{udp_payload(frame, link_type, port_)};
+
+            if (payload.size() < types::header::length)
+            {
+                continue;
+            }
+
+            const auto msg_count{read_at_be<types::header::MessageCount>(payload, types::header::message_count_offset)};
+
+            if (msg_count == types::header::heartbeat_msg_count || msg_count == types::header::end_of_session_msg_count)
+            {
+                continue;
+            }
+
+            const auto payload_pos{static_cast<std::size_t>(payload.data() - capture_.data())};
+
+            msg_pos_ = payload_pos + types::header::message_block_offset;
+            packet_end_ = payload_pos + payload.size();
+            msgs_left_ = msg_count;
+            packet_timestamp_ = timestamp;
+
+            if (deduplicate_)
+            {
+                const auto original_seq{read_at_be<types::header::SequenceNumber>(payload, types::header::sequence_number_offset)};
+                auto& next_original_seq{watermark_for(payload.first<sizeof(types::header::Session)>())};
+
+                for (auto seq{original_seq}; seq < next_original_seq && msgs_left_ > 0; ++seq)
+                {
+                    [[maybe_unused]]
+                    const auto duplicate{next_message()};
+                }
+
+                next_original_seq = std::max(next_original_seq, original_seq + msg_count);
+            }
+
+            if (msgs_left_ > 0)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool PcapSource::next_frame(std::span<const char>& frame, std::chrono::nanoseconds& timestamp, std::uint16_t& link_type)
+    {
+        if (!pcapng_)
+        {
+            if (record_pos_ + pcap::record_header_length > capture_.size())
+            {
+                return false;
+            }
+
+            const auto seconds{read_at<std::uint32_t>(record_pos_ + pcap::record_ts_sec_offset)};
+            const auto fraction{read_at<std::uint32_t>(record_pos_ + pcap::record_ts_frac_offset)};
+            const auto captured_length{read_at<std::uint32_t>(record_pos_ + pcap::record_captured_length_offset)};
+            const auto data_pos{record_pos_ + pcap::record_header_length};
+
+            if (data_pos + captured_length > capture_.size())
+            {
+                util::log::warn("Pcap source: capture truncated at {}", record_pos_);
+                return false;
+            }
+
+            const auto& interface{interfaces_.front()};
+
+            frame = capture_.subspan(data_pos, captured_length);
+            timestamp = std::chrono::seconds{seconds} + ticks_to_ns(fraction, interface.ticks_per_second);
+            link_type = interface.link_type;
+            record_pos_ = data_pos + captured_length;
+
+            return true;
+        }
+
+        while (record_pos_ + pcap::ng::block_overhead <= capture_.size())
+        {
+            const auto block_pos{record_pos_};
+            const auto block_type{read_at<std::uint32_t>(block_pos)};
+
+            if (block_type == pcap::ng::section_header_block)
+            {
+                const auto byte_order{util::binary_io::read_at<std::uint32_t>(capture_, block_pos + pcap::ng::block_body_offset)};
+
+                if (byte_order != pcap::ng::byte_order_magic && byte_order != std::byteswap(pcap::ng::byte_order_magic))
+                {
+                    util::log::error("{}: bad section header at {}", std::source_location::current().function_name(), block_pos);
+                    return false;
+                }
+
+                swapped_ = byte_order != pcap::ng::byte_order_magic;
+                interfaces_.clear();
+            }
+
+            const std::size_t block_length{read_at<std::uint32_t>(block_pos + sizeof(std::uint32_t))};
+
+            if (block_length < pcap::ng::block_overhead || block_pos + block_length > capture_.size())
+            {
+                util::log::warn("Pcap source: capture truncated at {}", block_pos);
+                return false;
+            }
+
+            record_pos_ = block_pos + block_length;
+
+            const auto body_pos{block_pos + pcap::ng::block_body_offset};
+            // trailing block length
+            const auto body_end{record_pos_ - sizeof(std::uint32_t)};
+
+            switch (block_type)
+            {
+            case pcap::ng::interface_description_block:
+            {
+                // link type (2) reserved (2) snap length (4)
+                constexpr auto options_offset{8UZ};
+
+                // later packets' interface ids would be off by one without it
+                if (body_end - body_pos < options_offset)
+                {
+                    util::log::warn("Pcap source: short interface description block at {}", block_pos);
+                    return false;
+                }
+
+                Interface interface{
+                    .link_type = read_at<std::uint16_t>(body_pos),
+                    .ticks_per_second = 1'000'000,
+                };
+
+                for (auto option_pos{body_pos + options_offset}; option_pos + 4 <= body_end;)
+                {
+                    const auto code{read_at<std::uint16_t>(option_pos)};
+                    const std::size_t length{read_at<std::uint16_t>(option_pos + sizeof(std::uint16_t))};
+
+                    if (code == pcap::ng::option_end)
+                    {
+                        break;
+                    }
+
+                    if (code == pcap::ng::option_if_tsresol && length >= 1 && option_pos + 4 < body_end)
+                    {
+                        interface.ticks_per_second = ticks_per_second_from_tsresol(static_cast<std::uint8_t>(capture_[option_pos + 4]));
+                    }
+
+                    // values are padded to 32 bits
+                    option_pos += 4 + ((length + 3) & ~3UZ);
+                }
+
+                interfaces_.push_back(interface);
+                break;
+            }
+            case pcap::ng::enhanced_packet_block:
+            {
+                // interface id (4) timestamp high (4) timestamp low (4) captured length (4) original length (4)
+                constexpr auto data_offset{20UZ};
+
+                if (body_end - body_pos < data_offset)
+                {
+                    util::log::warn("Pcap source: short enhanced packet block at {}", block_pos);
+                    continue;
+                }
+
+                const auto interface_id{read_at<std::uint32_t>(body_pos)};
+                const std::size_t captured_length{read_at<std::uint32_t>(body_pos + 12)};
+                const auto data_pos{body_pos + data_offset};
+
+                if (interface_id >= interfaces_.size() || data_pos + captured_length > body_end)
+                {
+                    continue;
+                }
+
+                const auto& interface{interfaces_[interface_id]};
+                const auto ticks{(static_cast<std::uint64_t>(read_at<std::uint32_t>(body_pos + 4)) << 32U) |
+                                 read_at<std::uint32_t>(body_pos + 8)};
+
+                frame = capture_.subspan(data_pos, captured_length);
+                timestamp = ticks_to_ns(ticks, interface.ticks_per_second);
+                link_type = interface.link_type;
+
+                return true;
+            }
+            case pcap::ng::simple_packet_block:
+            {
+                // original length (4), no timestamp so reuse the previous packet's
+                constexpr auto data_offset{4UZ};
+
+                if (body_end - body_pos < data_offset)
+                {
+                    util::log::warn("Pcap source: short simple packet block at {}", block_pos);
+                    continue;
+                }
+
+                if (interfaces_.empty())
+                {
+                    continue;
+                }
+
+                const auto data_pos{body_pos + data_offset};
+
+                const std::size_t original_length{read_at<std::uint32_t>(body_pos)};
+
+                frame = capture_.subspan(data_pos, std::min(original_length, body_end - data_pos));
+                timestamp = packet_timestamp_;
+                link_type = interfaces_.front().link_type;
+
+                return true;
+            }
+            default:
+                break;
+            }
+        }
+
+        return false;
+    }
+
+    std::span<const char> PcapSource::next_message() noexcept
+    {
+        if (msgs_left_ == 0)
+        {
+            return {};
+        }
+
+        std::size_t pos{msg_pos_};
+        const std::span msg{io::read_message(capture_.first(packet_end_), pos)};
+
+        if (msg.empty()) [[unlikely]]
+        {
+            msgs_left_ = 0;
+            return {};
+        }
+
+        msg_pos_ = pos;
+        --msgs_left_;
+
+        return msg;
+    }
+
+    template <typename T>
+    T PcapSource::read_at(std::size_t offset) const noexcept
+    {
+        const auto value{util::binary_io::read_at<T>(capture_, offset)};
+        return swapped_ ? std::byteswap(value) : value;
+    }
+}
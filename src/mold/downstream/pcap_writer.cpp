@@ -0,0 +1,191 @@
+#include "imr/mold/downstream/pcap_writer.h"
+
+#include "../../pcap/format.h"
+#include "../../util/binary_io.h"
+#include "../../util/write_all.h"
+#include "imr/util/log.h"
+
+#include <algorithm>
+#include <format>
+#include <numeric>
+#include <source_location>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace
+{
+    using namespace imr;
+
+    constexpr auto ip_offset{pcap::ethernet_header_length};
+    constexpr auto udp_offset{ip_offset + pcap::ipv4_min_header_length};
+
+    std::uint16_t ipv4_checksum(std::span<const char> header) noexcept
+    {
+        std::uint32_t sum{0};
+        for (auto i{0UZ}; i + 1 < header.size(); i += 2)
+        {
+            sum += util::binary_io::read_at_be<std::uint16_t>(header, i);
+        }
+
+        while ((sum >> 16U) != 0)
+        {
+            sum = (sum & 0xFFFFU) + (sum >> 16U);
+        }
+
+        return static_cast<std::uint16_t>(~sum);
+    }
+}
+
+namespace imr::mold::downstream
+{
+    PcapWriter::PcapWriter(const Config& cfg, const sockaddr_in& destination)
+        : fd_{[&cfg] {
+              if (cfg.path.empty() || std::filesystem::is_directory(cfg.path))
+              {
+                  throw std::invalid_argument(std::format("{}: pcap output path is not a file {}",
+                                                          std::source_location::current().function_name(),
+                                                          cfg.path.c_str()));
+              }
+              return open(cfg.path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+          }},
+          timestamps_{cfg.timestamps},
+          session_date_{cfg.session_date},
+          buffer_(std::max(cfg.buffer_size, pcap::record_header_length + frame_header_length + 0xFFFFUZ))
+    {
+        std::array<char, pcap::file_header_length> file_header{};
+        std::size_t pos{0};
+
+        // native byte order, readers detect it from the magic
+        util::binary_io::write(std::span(file_header), pos, pcap::magic_nanoseconds);
+        util::binary_io::write(std::span(file_header), pos, std::uint16_t{2});
+        util::binary_io::write(std::span(file_header), pos, std::uint16_t{4});
+        util::binary_io::write(std::span(file_header), pos, std::uint32_t{0});
+        util::binary_io::write(std::span(file_header), pos, std::uint32_t{0});
+        util::binary_io::write(std::span(file_header), pos, std::uint32_t{0xFFFF});
+        util::binary_io::write(std::span(file_header), pos, static_cast<std::uint32_t>(pcap::link_type_ethernet));
+
+        if (!util::write_all(fd_.get(), file_header))
+        {
+            throw std::system_error(errno, std::system_category(), std::source_location::current().function_name());
+        }
+
+        const std::span header{frame_header_};
+        const auto destination_ip{ntohl(destination.sin_addr.s_addr)};
+
+        // multicast groups map onto 01:00:5e + low 23 bits of the group, anything else gets a locally administered MAC
+        if ((destination_ip >> 28U) == 0xE)
+        {
+            util::binary_io::write_at_be(header, 0, static_cast<std::uint16_t>(0x0100));
+            util::binary_io::write_at_be(header, 2, 0x5E000000U | (destination_ip & 0x7FFFFFU));
+        }
+        else
+        {
+            util::binary_io::write_at_be(header, 0, static_cast<std::uint16_t>(0x0200));
+            util::binary_io::write_at_be(header, 2, destination_ip);
+        }
+
+        util::binary_io::write_at_be(header, 6, static_cast<std::uint16_t>(0x0200));
+        util::binary_io::write_at(header, 8, cfg.source_address.s_addr);
+        util::binary_io::write_at_be(header, pcap::ethernet_type_offset, pcap::ether_type_ipv4);
+
+        // version 4, 20 byte header
+        header[ip_offset] = 0x45;
+        header[ip_offset + pcap::ipv4_ttl_offset] = 1;
+        header[ip_offset + pcap::ipv4_protocol_offset] = static_cast<char>(pcap::ipv4_protocol_udp);
+        util::binary_io::write_at(header, ip_offset + pcap::ipv4_source_offset, cfg.source_address.s_addr);
+        util::binary_io::write_at(header, ip_offset + pcap::ipv4_destination_offset, destination.sin_addr.s_addr);
+
+        util::binary_io::write_at_be(header, udp_offset + pcap::udp_source_port_offset, cfg.source_port);
+        // already network order
+        util::binary_io::write_at(header, udp_offset + pcap::udp_destination_port_offset, destination.sin_port);
+
+        util::log::debug();
+    }
+
+    PcapWriter::~PcapWriter()
+    {
+        flush();
+    }
+
+    void PcapWriter::write(std::span<const iovec> packet, std::chrono::nanoseconds timestamp) noexcept
+    {
+        const auto payload_length{std::accumulate(packet.begin(), packet.end(), 0UZ, [](std::size_t sum, const iovec& iov) {
+            return sum + iov.iov_len;
+        })};
+
+        const auto frame_length{frame_header_length + payload_length};
+        const auto record_length{pcap::record_header_length + frame_length};
+
+        if (record_length > buffer_.size() - used_)
+        {
+            flush();
+        }
+
+        if (payload_length > 0xFFFFUZ - pcap::ipv4_min_header_length - pcap::udp_header_length) [[unlikely]]
+        {
+            util::log::error("{}: {} byte datagram too large", std::source_location::current().function_name(), payload_length);
+            return;
+        }
+
+        const auto record{std::span(buffer_).subspan(used_, record_length)};
+        const auto seconds{std::chrono::duration_cast<std::chrono::seconds>(timestamp)};
+
+        std::size_t pos{0};
+        util::binary_io::write(record, pos, static_cast<std::uint32_t>(seconds.count()));
+        util::binary_io::write(record, pos, static_cast<std::uint32_t>((timestamp - seconds).count()));
+        util::binary_io::write(record, pos, static_cast<std::uint32_t>(frame_length));
+        util::binary_io::write(record, pos, static_cast<std::uint32_t>(frame_length));
+
+        const auto frame{record.subspan(pos)};
+        std::ranges::copy(frame_header_, frame.begin());
+
+        const auto ip_header{frame.subspan(ip_offset, pcap::ipv4_min_header_length)};
+        util::binary_io::write_at_be(ip_header, pcap::ipv4_total_length_offset, static_cast<std::uint16_t>(frame_length - ip_offset));
+        util::binary_io::write_at_be(ip_header, 4, ip_id_++);
+        util::binary_io::write_at_be(ip_header, pcap::ipv4_checksum_offset, ipv4_checksum(ip_header));
+        // checksum 0 = none, allowed for UDP over IPv4
+        util::binary_io::write_at_be(frame, udp_offset + pcap::udp_length_offset, static_cast<std::uint16_t>(frame_length - udp_offset));
+
+        pos += frame_header_length;
+        for (const auto& iov : packet)
+        {
+            util::binary_io::write(record, pos, std::span(static_cast<const char*>(iov.iov_base), iov.iov_len));
+        }
+
+        used_ += record_length;
+    }
+
+    void PcapWriter::write(std::span<const char> packet, std::chrono::nanoseconds timestamp) noexcept
+    {
+        const std::array iov{iovec{.iov_base = const_cast<char*>(packet.data()), .iov_len = packet.size()}};
+        write(iov, timestamp);
+    }
+
+    void PcapWriter::flush() noexcept
+    {
+        if (used_ == 0)
+        {
+            return;
+        }
+
+        if (!util::write_all(fd_.get(), std::span(buffer_).first(used_)))
+        {
+            util::log::perror();
+        }
+
+        used_ = 0;
+    }
+
+    PcapWriter::Config::Timestamps PcapWriter::timestamps() const noexcept
+    {
+        return timestamps_;
+    }
+
+    std::chrono::sys_seconds PcapWriter::session_date() const noexcept
+    {
+        return session_date_;
+    }
+}
@@ -0,0 +1,155 @@
+#include "imr/mold/downstream/playlist_source.h"
+
+#include "../io.h"
+#include "../../itch/timestamp.h"
+#include "imr/mold/types.h"
+#include "imr/util/log.h"
+
+#include <format>
+#include <source_location>
+#include <stdexcept>
+#include <utility>
+
+#include <unistd.h>
+
+namespace imr::mold::downstream
+{
+    PlaylistSource::PlaylistSource(std::vector<std::span<const char>> files, const Config& cfg)
+        : files_{std::move(files)},
+          loops_{cfg.loops},
+          prefault_{cfg.prefault}
+    {
+        if (files_.empty() || files_.size() > MessageStore::max_files)
+        {
+            throw std::invalid_argument(std::format("{}: expected 1 to {} files, got {}",
+                                                    std::source_location::current().function_name(),
+                                                    MessageStore::max_files,
+                                                    files_.size()));
+        }
+    }
+
+    void PlaylistSource::start([[maybe_unused]] std::stop_token st)
+    {
+        prefault_next();
+    }
+
+    std::optional<std::chrono::nanoseconds> PlaylistSource::peek_timestamp()
+    {
+        const auto bytes{files_[file_id_].subspan(file_pos_)};
+
+        if (bytes.size() < sizeof(types::LengthPrefix) + itch::timestamp_offset + itch::timestamp_size) [[unlikely]]
+        {
+            return std::nullopt;
+        }
+
+        return itch::extract_timestamp(bytes.subspan(sizeof(types::LengthPrefix)));
+    }
+
+    bool PlaylistSource::skip()
+    {
+        if (!io::skip_message(files_[file_id_], file_pos_)) [[unlikely]]
+        {
+            end_file();
+        }
+
+        // the rest of the playlist is still to play
+        return true;
+    }
+
+    bool PlaylistSource::advance()
+    {
+        if (file_id_ + 1 == files_.size())
+        {
+            if (loops_ != 0 && loop_ + 1 >= loops_)
+            {
+                return false;
+            }
+
+            ++loop_;
+        }
+
+        file_id_ = next_file_id();
+        file_pos_ = 0;
+
+        util::log::info("Playlist: playing file {} (pass {})", file_id_, loop_ + 1);
+
+        prefault_next();
+        return true;
+    }
+
+    types::header::SequenceNumber PlaylistSource::fill(PacketBuilder& packet_builder,
+                                                       RetransmissionBuffer& retransmission_buffer,
+                                                       types::header::SequenceNumber next_seq)
+    {
+        const auto file{files_[file_id_]};
+
+        while (file_pos_ < file.size())
+        {
+            const std::size_t msg_file_pos{file_pos_};
+
+            const std::span msg{io::read_message(file, file_pos_)};
+
+            if (msg.empty()) [[unlikely]]
+            {
+                end_file();
+                break;
+            }
+
+            // rollback when packet is full
+            if (!packet_builder.try_add(msg))
+            {
+                file_pos_ = msg_file_pos;
+                break;
+            }
+
+            retransmission_buffer.push({
+                .sequence_number = next_seq++,
+                .file_position = MessageStore::position(file_id_, msg_file_pos),
+            });
+        }
+
+        return next_seq;
+    }
+
+    MessageStore PlaylistSource::message_store() const noexcept
+    {
+        return MessageStore{files_};
+    }
+
+    void PlaylistSource::end_file() noexcept
+    {
+        util::log::warn("Playlist: file {} malformed at {}, moving on to the next", file_id_, file_pos_);
+
+        // peek_timestamp() runs out, the feed advances
+        file_pos_ = files_[file_id_].size();
+    }
+
+    std::size_t PlaylistSource::next_file_id() const noexcept
+    {
+        return (file_id_ + 1) % files_.size();
+    }
+
+    void PlaylistSource::prefault_next()
+    {
+        const auto next{next_file_id()};
+
+        // a single looping file is already resident after its first pass
+        if (!prefault_ || next == file_id_)
+        {
+            return;
+        }
+
+        // replacing the jthread stops and joins the previous prefault if still running
+        prefault_thread_ = std::jthread([file = files_[next]](std::stop_token st) {
+            const auto page_size{static_cast<std::size_t>(sysconf(_SC_PAGESIZE))};
+
+            [[maybe_unused]]
+            volatile char touched{};
+
+            for (auto i{0UZ}; i < file.size() && !st.stop_requested(); i += page_size)
+            {
+                touched = file[i];
+            }
+        });
+    }
+}
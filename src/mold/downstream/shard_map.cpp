@@ -0,0 +1,107 @@
+#include "imr/mold/downstream/shard_map.h"
+
+#include "../../itch/symbol_directory.h"
+#include "imr/util/log.h"
+
+#include <algorithm>
+#include <format>
+#include <limits>
+#include <source_location>
+#include <stdexcept>
+
+namespace imr::mold::downstream
+{
+    namespace
+    {
+        constexpr std::size_t num_locates{std::numeric_limits<std::uint16_t>::max() + 1UZ};
+    }
+
+    ShardMap::ShardMap(const Config& cfg, std::size_t channels, std::span<const char> file)
+        : channels_{channels},
+          channel_of_(num_locates, 0)
+    {
+        if (channels_ == 0 || channels_ > std::numeric_limits<std::uint16_t>::max())
+        {
+            throw std::invalid_argument(std::format("{}: invalid channel count {}",
+                                                    std::source_location::current().function_name(),
+                                                    channels_));
+        }
+
+        using Mapping = Config::Mapping;
+
+        switch (cfg.mapping)
+        {
+        case Mapping::range:
+        {
+            const auto max_locate{std::max<std::size_t>(itch::SymbolDirectory(file).max_locate(), 1)};
+
+            for (auto locate{1UZ}; locate < num_locates; ++locate)
+            {
+                // locates past the directory (added intraday) go to the last channel
+                const auto channel{std::min(((locate - 1) * channels_) / max_locate, channels_ - 1)};
+                channel_of_[locate] = static_cast<std::uint16_t>(channel);
+            }
+            break;
+        }
+        case Mapping::hash:
+            for (auto locate{1UZ}; locate < num_locates; ++locate)
+            {
+                // fibonacci hashing, spreads neighbouring locates (often related symbols) across channels: the high bits
+                // of the product mix every bit of the locate (its low bits only the locate's low bits), then scaled
+                // into [0, channels) rather than reduced modulo
+                const std::uint64_t hash{(locate * 0x9E3779B97F4A7C15ULL) >> 32U};
+                channel_of_[locate] = static_cast<std::uint16_t>((hash * channels_) >> 32U);
+            }
+            break;
+        case Mapping::table:
+            if (cfg.table.size() > num_locates)
+            {
+                throw std::invalid_argument(std::format("{}: table has more than {} entries",
+                                                        std::source_location::current().function_name(),
+                                                        num_locates));
+            }
+
+            for (auto locate{0UZ}; locate < cfg.table.size(); ++locate)
+            {
+                if (cfg.table[locate] >= channels_)
+                {
+                    throw std::invalid_argument(std::format("{}: locate {} mapped to channel {} of {}",
+                                                            std::source_location::current().function_name(),
+                                                            locate,
+                                                            cfg.table[locate],
+                                                            channels_));
+                }
+
+                channel_of_[locate] = static_cast<std::uint16_t>(cfg.table[locate]);
+            }
+            break;
+        }
+
+        util::log::info("Shard map: {} channels", channels_);
+    }
+
+    std::size_t ShardMap::channel_for(std::uint16_t locate) const noexcept
+    {
+        return channel_of_[locate];
+    }
+
+    std::vector<std::uint16_t> ShardMap::locates_for(std::size_t channel) const
+    {
+        std::vector<std::uint16_t> locates;
+
+        for (auto locate{1UZ}; locate < num_locates; ++locate)
+        {
+            if (channel_of_[locate] == channel)
+            {
+                locates.push_back(static_cast<std::uint16_t>(locate));
+            }
+        }
+
+        return locates;
+    }
+
+    std::size_t ShardMap::channels() const noexcept
+    {
+        return channels_;
+    }
+}
@@ -0,0 +1,157 @@
+#include "imr/mold/downstream/shm_writer.h"
+
+#include "../../util/binary_io.h"
+#include "imr/util/log.h"
+
+#include <bit>
+#include <cstring>
+#include <format>
+#include <new>
+#include <source_location>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace imr::mold::downstream
+{
+    namespace
+    {
+        constexpr auto huge_page_size{2UZ << 20U};
+
+        util::FileDescriptor create(const ShmWriter::Config& cfg)
+        {
+            if (cfg.path.empty())
+            {
+                return util::FileDescriptor([&cfg] {
+                    return memfd_create("imr-shm", MFD_CLOEXEC | (cfg.huge_pages ? MFD_HUGETLB : 0U));
+                });
+            }
+
+            return util::FileDescriptor([&cfg] { return open(cfg.path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644); });
+        }
+    }
+
+    ShmWriter::ShmWriter(const Config& cfg, std::size_t max_packet_size)
+        : fd_{create(cfg)},
+          path_{cfg.path.empty() ? std::filesystem::path(std::format("/proc/{}/fd/{}", getpid(), fd_.get())) : cfg.path},
+          mask_{cfg.slot_count - 1},
+          slot_size_{shm::slot_size(max_packet_size)},
+          content_{cfg.content}
+    {
+        if (!std::has_single_bit(cfg.slot_count))
+        {
+            throw std::invalid_argument(std::format("{}: slot_count must be a power of two",
+                                                    std::source_location::current().function_name()));
+        }
+
+        length_ = sizeof(shm::Header) + (cfg.slot_count * slot_size_);
+        if (cfg.huge_pages)
+        {
+            length_ = (length_ + huge_page_size - 1) / huge_page_size * huge_page_size;
+        }
+
+        if (ftruncate(fd_.get(), static_cast<off_t>(length_)) < 0)
+        {
+            throw std::system_error(errno, std::system_category(), std::source_location::current().function_name());
+        }
+
+        mapping_ = mmap(nullptr, length_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_.get(), 0);
+        if (mapping_ == MAP_FAILED)
+        {
+            mapping_ = nullptr;
+            throw std::system_error(errno, std::system_category(), std::source_location::current().function_name());
+        }
+
+        // fresh (zeroed) file, the header is the only object needing construction
+        header_ = new (mapping_) shm::Header{};
+        header_->content = content_;
+        header_->slot_size = static_cast<std::uint32_t>(slot_size_);
+        header_->slot_count = cfg.slot_count;
+        slots_ = static_cast<std::byte*>(mapping_) + sizeof(shm::Header);
+
+        // magic last, readers check it before trusting the rest
+        std::atomic_thread_fence(std::memory_order_release);
+        header_->magic = shm::magic;
+
+        util::log::info("Downstream feed: shared memory ring at {}", path_.c_str());
+    }
+
+    ShmWriter::~ShmWriter()
+    {
+        if (mapping_ != nullptr)
+        {
+            munmap(mapping_, length_);
+        }
+    }
+
+    void ShmWriter::publish(std::span<const iovec> packet) noexcept
+    {
+        const std::span header{static_cast<const char*>(packet[0].iov_base), packet[0].iov_len};
+        const auto sequence_number{util::binary_io::read_at_be<types::header::SequenceNumber>(header, types::header::sequence_number_offset)};
+        const auto message_count{util::binary_io::read_at_be<types::header::MessageCount>(header, types::header::message_count_offset)};
+
+        if (content_ == shm::Content::packets || message_count == types::header::end_of_session_msg_count)
+        {
+            publish_entry(sequence_number, message_count, content_ == shm::Content::packets ? packet : packet.first(0));
+            return;
+        }
+
+        for (auto i{1UZ}; i < packet.size(); ++i)
+        {
+            // without the length prefix, the slot has the length
+            const iovec message{.iov_base = static_cast<char*>(packet[i].iov_base) + sizeof(types::LengthPrefix),
+                                .iov_len = packet[i].iov_len - sizeof(types::LengthPrefix)};
+            publish_entry(sequence_number + i - 1, 1, std::span(&message, 1));
+        }
+    }
+
+    void ShmWriter::publish_entry(types::header::SequenceNumber sequence_number,
+                                  types::header::MessageCount message_count,
+                                  std::span<const iovec> data) noexcept
+    {
+        auto& slot{*reinterpret_cast<shm::Slot*>(slots_ + ((write_index_ & mask_) * slot_size_))};
+        auto* out{reinterpret_cast<std::byte*>(&slot) + shm::slot_data_offset};
+        const auto capacity{slot_size_ - shm::slot_data_offset};
+
+        slot.version.store((2 * write_index_) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        auto length{0UZ};
+        for (const auto& part : data)
+        {
+            const auto size{std::min(part.iov_len, capacity - length)};
+            std::memcpy(out + length, part.iov_base, size);
+            length += size;
+        }
+
+        slot.sequence_number = sequence_number;
+        slot.message_count = message_count;
+        slot.length = static_cast<std::uint32_t>(length);
+
+        slot.version.store((2 * write_index_) + 2, std::memory_order_release);
+        header_->write_index.store(++write_index_, std::memory_order_release);
+    }
+
+    const std::filesystem::path& ShmWriter::path() const noexcept
+    {
+        return path_;
+    }
+
+    std::vector<ShmWriter::ReaderLag> ShmWriter::readers() const
+    {
+        std::vector<ReaderLag> readers;
+
+        for (const auto& reader : header_->readers)
+        {
+            if (const auto pid{reader.pid.load(std::memory_order_acquire)}; pid != 0)
+            {
+                readers.push_back({.pid = pid, .lag = write_index_ - reader.position.load(std::memory_order_relaxed)});
+            }
+        }
+
+        return readers;
+    }
+}
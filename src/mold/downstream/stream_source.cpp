@@ -0,0 +1,212 @@
+#include "imr/mold/downstream/stream_source.h"
+
+#include "../../itch/timestamp.h"
+#include "../../util/binary_io.h"
+#include "imr/mold/types.h"
+#include "imr/util/log.h"
+
+#include <algorithm>
+#include <format>
+#include <source_location>
+#include <stdexcept>
+#include <system_error>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace
+{
+    // upper bound on a single read(), keeps one slow refill from eating the whole ring
+    constexpr auto max_read_size{1UZ << 20U};
+
+    imr::util::FileDescriptor open_stream(const std::filesystem::path& path)
+    {
+        using namespace imr;
+
+        if (path == "-")
+        {
+            return util::FileDescriptor{[] { return dup(STDIN_FILENO); }};
+        }
+
+        if (!std::filesystem::is_socket(path))
+        {
+            return util::FileDescriptor{path};
+        }
+
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+
+        if (path.native().size() >= sizeof(addr.sun_path))
+        {
+            throw std::invalid_argument(std::format("{}: socket path too long {}",
+                                                    std::source_location::current().function_name(),
+                                                    path.c_str()));
+        }
+
+        std::ranges::copy(path.native(), std::begin(addr.sun_path));
+
+        util::FileDescriptor fd{[] { return socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0); }};
+
+        if (connect(fd.get(), reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) < 0)
+        {
+            throw std::system_error(errno, std::system_category(), std::source_location::current().function_name());
+        }
+
+        return fd;
+    }
+}
+
+namespace imr::mold::downstream
+{
+    StreamSource::StreamSource(const Config& cfg)
+        : fd_{open_stream(cfg.path)},
+          ring_{cfg.ring_size},
+          poll_interval_{cfg.poll_interval}
+    {
+        util::log::debug();
+    }
+
+    void StreamSource::start(std::stop_token st)
+    {
+        stop_token_ = std::move(st);
+    }
+
+    std::optional<std::chrono::nanoseconds> StreamSource::peek_timestamp()
+    {
+        const std::optional length{next_message_length()};
+
+        if (!length.has_value() ||
+            *length < sizeof(types::LengthPrefix) + itch::timestamp_offset + itch::timestamp_size) [[unlikely]]
+        {
+            return std::nullopt;
+        }
+
+        return itch::extract_timestamp(ring_.view(read_pos_ + sizeof(types::LengthPrefix), *length - sizeof(types::LengthPrefix)));
+    }
+
+    bool StreamSource::skip()
+    {
+        const std::optional length{next_message_length()};
+
+        if (!length.has_value())
+        {
+            return false;
+        }
+
+        read_pos_ += *length;
+        return true;
+    }
+
+    types::header::SequenceNumber StreamSource::fill(PacketBuilder& packet_builder,
+                                                     RetransmissionBuffer& retransmission_buffer,
+                                                     types::header::SequenceNumber next_seq)
+    {
+        pinned_pos_ = read_pos_;
+
+        while (const std::optional length{next_message_length()})
+        {
+            if (!packet_builder.try_add(ring_.view(read_pos_, *length)))
+            {
+                break;
+            }
+
+            retransmission_buffer.push({
+                .sequence_number = next_seq++,
+                .file_position = read_pos_,
+            });
+
+            read_pos_ += *length;
+        }
+
+        return next_seq;
+    }
+
+    MessageStore StreamSource::message_store() const noexcept
+    {
+        return MessageStore{ring_};
+    }
+
+    const util::ByteRing& StreamSource::ring() const noexcept
+    {
+        return ring_;
+    }
+
+    bool StreamSource::ensure(std::size_t length)
+    {
+        while (ring_.head() - read_pos_ < length)
+        {
+            if (eof_ || stop_token_.stop_requested())
+            {
+                return false;
+            }
+
+            const auto free{ring_.capacity() - (ring_.head() - pinned_pos_)};
+
+            if (free == 0) [[unlikely]]
+            {
+                util::log::error("{}: message of {} bytes does not fit in ring of {} bytes",
+                                 std::source_location::current().function_name(),
+                                 length,
+                                 ring_.capacity());
+                return false;
+            }
+
+            pollfd pfd{.fd = fd_.get(), .events = POLLIN, .revents = 0};
+
+            if (const auto ready{poll(&pfd, 1, static_cast<int>(poll_interval_.count()))}; ready <= 0)
+            {
+                if (ready < 0 && errno != EINTR)
+                {
+                    util::log::perror();
+                    eof_ = true;
+                }
+                continue;
+            }
+
+            const std::span buffer{ring_.prepare(std::min(free, max_read_size))};
+
+            const auto bytes_read{read(fd_.get(), buffer.data(), buffer.size())};
+
+            if (bytes_read < 0)
+            {
+                if (errno != EINTR && errno != EAGAIN)
+                {
+                    util::log::perror();
+                    eof_ = true;
+                }
+                continue;
+            }
+
+            if (bytes_read == 0)
+            {
+                util::log::info("Stream source: EOF after {} bytes", ring_.head());
+                eof_ = true;
+                continue;
+            }
+
+            ring_.commit(static_cast<std::size_t>(bytes_read));
+        }
+
+        return true;
+    }
+
+    std::optional<std::size_t> StreamSource::next_message_length()
+    {
+        if (!ensure(sizeof(types::LengthPrefix)))
+        {
+            return std::nullopt;
+        }
+
+        const auto length{sizeof(types::LengthPrefix) +
+                          util::binary_io::read_at_be<types::LengthPrefix>(ring_.view(read_pos_, sizeof(types::LengthPrefix)), 0)};
+
+        if (!ensure(length))
+        {
+            return std::nullopt;
+        }
+
+        return length;
+    }
+}
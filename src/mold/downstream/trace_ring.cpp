@@ -0,0 +1,292 @@
+#include "imr/mold/downstream/trace_ring.h"
+
+#include "imr/util/log.h"
+#include "util/write_all.h"
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <csignal>
+#include <cstddef>
+#include <format>
+#include <mutex>
+#include <new>
+#include <source_location>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace imr::mold::downstream
+{
+    namespace
+    {
+        util::FileDescriptor create(const TraceRing::Config& cfg)
+        {
+            if (cfg.path.empty())
+            {
+                return util::FileDescriptor([] { return memfd_create("imr-trace", MFD_CLOEXEC); });
+            }
+
+            return util::FileDescriptor([&cfg] { return open(cfg.path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644); });
+        }
+
+        /* calibrate, open, write, close only: from the signal handler too. One dump of a ring at a time, another one
+         * (the signal landing during the end of session's) is skipped. The calibration goes in the dumped file only, the
+         * live ring keeps latest == origin for readers to calibrate it themselves.
+         */
+        bool write_dump(const char* path, const trace::Header* header, std::size_t length, std::atomic_flag& dumping) noexcept
+        {
+            if (dumping.test_and_set(std::memory_order_acquire))
+            {
+                return true;
+            }
+
+            const auto latest{trace::calibrate()};
+
+            const int fd{open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)};
+            if (fd < 0)
+            {
+                dumping.clear(std::memory_order_release);
+                return false;
+            }
+
+            const auto written{util::write_all(fd, {reinterpret_cast<const char*>(header), length}) &&
+                               pwrite(fd, &latest, sizeof(latest), static_cast<off_t>(offsetof(trace::Header, latest))) ==
+                                   static_cast<ssize_t>(sizeof(latest))};
+            const auto closed{close(fd) == 0};
+
+            dumping.clear(std::memory_order_release);
+            return closed && written;
+        }
+
+        // rings the signal handler dumps, what it needs copied out so it never touches a TraceRing
+        constexpr auto max_signalled{16UZ};
+
+        struct Signalled
+        {
+            std::atomic<const TraceRing*> owner;
+            // set last, 0 while the rest is being written
+            std::atomic<int> signal;
+            const char* path;
+            const trace::Header* header;
+            std::size_t length;
+            std::atomic_flag* dumping;
+        };
+
+        std::array<Signalled, max_signalled> signalled{};
+        // handlers running, unwatch() waits for none before its ring can be unmapped
+        std::atomic<int> in_handler{0};
+
+        // per signal, the rings watching it and the action before the first, put back once the last is gone
+        struct Installed
+        {
+            std::size_t watchers;
+            struct sigaction previous;
+        };
+
+        std::mutex installed_mutex;
+        std::array<Installed, NSIG> installed{};
+
+        // the handler returns and the process carries on, which only suits signals with no other meaning
+        bool dumpable(int signal) noexcept
+        {
+            return signal == SIGUSR1 || signal == SIGUSR2 || (signal >= SIGRTMIN && signal <= SIGRTMAX);
+        }
+
+        void on_signal(int signal)
+        {
+            const auto saved_errno{errno};
+            // seq_cst with unwatch(): either it sees this handler running, or this handler sees the entry gone
+            in_handler.fetch_add(1);
+
+            for (auto& entry : signalled)
+            {
+                if (entry.signal.load() == signal)
+                {
+                    write_dump(entry.path, entry.header, entry.length, *entry.dumping);
+                }
+            }
+
+            in_handler.fetch_sub(1);
+            errno = saved_errno;
+        }
+
+        void watch(const TraceRing* owner,
+                   int signal,
+                   const char* path,
+                   const trace::Header* header,
+                   std::size_t length,
+                   std::atomic_flag& dumping)
+        {
+            const std::scoped_lock lock(installed_mutex);
+            auto& install{installed[static_cast<std::size_t>(signal)]};
+
+            for (auto& entry : signalled)
+            {
+                const TraceRing* expected{nullptr};
+                if (!entry.owner.compare_exchange_strong(expected, owner, std::memory_order_acq_rel))
+                {
+                    continue;
+                }
+
+                entry.path = path;
+                entry.header = header;
+                entry.length = length;
+                entry.dumping = &dumping;
+                entry.signal.store(signal, std::memory_order_release);
+
+                if (install.watchers == 0)
+                {
+                    struct sigaction action{};
+                    action.sa_handler = on_signal;
+                    action.sa_flags = SA_RESTART;
+                    sigemptyset(&action.sa_mask);
+
+                    if (sigaction(signal, &action, &install.previous) < 0)
+                    {
+                        const auto error{errno};
+                        entry.signal.store(0, std::memory_order_release);
+                        entry.owner.store(nullptr, std::memory_order_release);
+                        throw std::system_error(error, std::system_category(), std::source_location::current().function_name());
+                    }
+                }
+
+                ++install.watchers;
+                return;
+            }
+
+            throw std::invalid_argument(std::format("{}: more than {} trace rings dumped on signal",
+                                                    std::source_location::current().function_name(),
+                                                    max_signalled));
+        }
+
+        void unwatch(const TraceRing* owner) noexcept
+        {
+            const std::scoped_lock lock(installed_mutex);
+
+            for (auto& entry : signalled)
+            {
+                if (entry.owner.load(std::memory_order_acquire) != owner)
+                {
+                    continue;
+                }
+
+                const auto signal{entry.signal.exchange(0)};
+
+                if (auto& install{installed[static_cast<std::size_t>(signal)]}; --install.watchers == 0)
+                {
+                    sigaction(signal, &install.previous, nullptr);
+                }
+
+                // a handler that saw the entry before it went may still be dumping the ring
+                while (in_handler.load() != 0)
+                {
+                    std::this_thread::yield();
+                }
+
+                entry.owner.store(nullptr, std::memory_order_release);
+            }
+        }
+    }
+
+    TraceRing::TraceRing(const Config& cfg)
+        : fd_{create(cfg)},
+          path_{cfg.path.empty() ? std::filesystem::path(std::format("/proc/{}/fd/{}", getpid(), fd_.get())) : cfg.path},
+          dump_path_{cfg.dump.string()},
+          dump_signal_{cfg.dump_signal},
+          length_{sizeof(trace::Header) + (cfg.capacity * sizeof(trace::Entry))},
+          mask_{cfg.capacity - 1}
+    {
+        if (!std::has_single_bit(cfg.capacity))
+        {
+            throw std::invalid_argument(std::format("{}: capacity must be a power of two",
+                                                    std::source_location::current().function_name()));
+        }
+
+        if (dump_signal_ != 0 && dump_path_.empty())
+        {
+            throw std::invalid_argument(std::format("{}: dump_signal without dump", std::source_location::current().function_name()));
+        }
+
+        if (dump_signal_ != 0 && !dumpable(dump_signal_))
+        {
+            throw std::invalid_argument(std::format("{}: dump_signal {} is not SIGUSR1, SIGUSR2 or a real time signal",
+                                                    std::source_location::current().function_name(),
+                                                    dump_signal_));
+        }
+
+        if (ftruncate(fd_.get(), static_cast<off_t>(length_)) < 0)
+        {
+            throw std::system_error(errno, std::system_category(), std::source_location::current().function_name());
+        }
+
+        mapping_ = mmap(nullptr, length_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_.get(), 0);
+        if (mapping_ == MAP_FAILED)
+        {
+            mapping_ = nullptr;
+            throw std::system_error(errno, std::system_category(), std::source_location::current().function_name());
+        }
+
+        // fresh (zeroed) file, the header is the only object needing construction
+        header_ = new (mapping_) trace::Header{};
+        header_->capacity = cfg.capacity;
+        header_->origin = trace::calibrate();
+        header_->latest = header_->origin;
+        entries_ = reinterpret_cast<trace::Entry*>(static_cast<std::byte*>(mapping_) + sizeof(trace::Header));
+
+        // magic last, readers check it before trusting the rest
+        std::atomic_thread_fence(std::memory_order_release);
+        header_->magic = trace::magic;
+
+        if (dump_signal_ != 0)
+        {
+            try
+            {
+                watch(this, dump_signal_, dump_path_.c_str(), header_, length_, dumping_);
+            }
+            catch (...)
+            {
+                munmap(mapping_, length_);
+                throw;
+            }
+        }
+
+        util::log::info("Downstream feed: trace ring at {}", path_.c_str());
+    }
+
+    TraceRing::~TraceRing()
+    {
+        if (dump_signal_ != 0)
+        {
+            unwatch(this);
+        }
+
+        if (mapping_ != nullptr)
+        {
+            munmap(mapping_, length_);
+        }
+    }
+
+    void TraceRing::dump() noexcept
+    {
+        if (dump_path_.empty())
+        {
+            return;
+        }
+
+        if (!write_dump(dump_path_.c_str(), header_, length_, dumping_))
+        {
+            util::log::perror();
+        }
+    }
+
+    const std::filesystem::path& TraceRing::path() const noexcept
+    {
+        return path_;
+    }
+}
@@ -0,0 +1,409 @@
+#include "imr/mold/downstream/tx_timestamper.h"
+
+#include "imr/util/log.h"
+#include "util/binary_io.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <source_location>
+#include <stdexcept>
+#include <system_error>
+
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+
+namespace
+{
+    std::chrono::nanoseconds realtime() noexcept
+    {
+        timespec ts{};
+        clock_gettime(CLOCK_REALTIME, &ts);
+        return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+    }
+
+    std::chrono::nanoseconds to_duration(const timespec& ts) noexcept
+    {
+        return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+    }
+
+    // the first bytes of a datagram, however it's split across iovecs
+    std::array<char, imr::mold::types::header::length> header_of(const msghdr& msg) noexcept
+    {
+        std::array<char, imr::mold::types::header::length> header{};
+
+        auto copied{0UZ};
+        for (const auto& iov : std::span(msg.msg_iov, msg.msg_iovlen))
+        {
+            const auto length{std::min(iov.iov_len, header.size() - copied)};
+            std::memcpy(header.data() + copied, iov.iov_base, length);
+            copied += length;
+
+            if (copied == header.size())
+            {
+                break;
+            }
+        }
+
+        return header;
+    }
+
+    // ids are 32 bit, the ring indexes by their low bits
+    std::size_t pending_size(std::size_t capacity)
+    {
+        if (capacity == 0 || capacity > (1UZ << 31U))
+        {
+            throw std::invalid_argument(std::format("{}: capacity must be in [1, 2^31]", std::source_location::current().function_name()));
+        }
+
+        return std::bit_ceil(capacity);
+    }
+
+    bool same_destination(const msghdr& msg, const sockaddr_in* destination) noexcept
+    {
+        if (destination == nullptr || msg.msg_name == nullptr)
+        {
+            return false;
+        }
+
+        const auto* to{static_cast<const sockaddr_in*>(msg.msg_name)};
+        return to->sin_addr.s_addr == destination->sin_addr.s_addr && to->sin_port == destination->sin_port;
+    }
+}
+
+namespace imr::mold::downstream
+{
+    TxTimestamper::TxTimestamper(int socket, const Config& cfg, const sockaddr_in* parity_destination)
+        : socket_{socket},
+          parity_destination_{parity_destination},
+          pending_(pending_size(cfg.capacity)),
+          mask_{static_cast<std::uint32_t>(pending_.size() - 1)}
+    {
+        // numbered from 0 (OPT_ID), the timestamp alone without the datagram looped back (OPT_TSONLY)
+        unsigned flags{SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_TX_SCHED | SOF_TIMESTAMPING_SOFTWARE |
+                       SOF_TIMESTAMPING_OPT_ID | SOF_TIMESTAMPING_OPT_TSONLY};
+        if (cfg.hardware)
+        {
+            flags |= SOF_TIMESTAMPING_TX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE;
+        }
+
+        if (setsockopt(socket_, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) < 0)
+        {
+            throw std::system_error(errno, std::system_category(), std::source_location::current().function_name());
+        }
+
+        if (!cfg.report.empty())
+        {
+            report_.open(cfg.report);
+            if (!report_)
+            {
+                throw std::system_error(errno, std::system_category(), std::format("{}: {}", std::source_location::current().function_name(), cfg.report.c_str()));
+            }
+
+            report_ << "kind,sequence_number,message_count,scheduled_ns,sendmsg_ns,qdisc_ns,departure_ns,hardware\n";
+        }
+
+        reader_ = std::jthread([this](std::stop_token st) { read(st); });
+
+        util::log::debug();
+    }
+
+    TxTimestamper::~TxTimestamper()
+    {
+        reader_.request_stop();
+        reader_.join();
+
+        // what's left never got its timestamp
+        for (const auto& pending : pending_)
+        {
+            if (pending.waiting)
+            {
+                missed_.increment();
+            }
+        }
+
+        util::Histogram::Snapshot pacing;
+        pacing.add(pacing_);
+        util::Histogram::Snapshot kernel;
+        kernel.add(kernel_);
+        util::Histogram::Snapshot departure;
+        departure.add(departure_);
+
+        util::log::info("TX timestamps: {} datagrams, {} missed; pacing p50 {}ns p99 {}ns max {}ns; kernel p50 {}ns p99 {}ns max {}ns; "
+                        "departure p50 {}ns p99 {}ns max {}ns",
+                        timestamped_.value(),
+                        missed_.value(),
+                        pacing.percentile(50.0),
+                        pacing.percentile(99.0),
+                        pacing.max(),
+                        kernel.percentile(50.0),
+                        kernel.percentile(99.0),
+                        kernel.max(),
+                        departure.percentile(50.0),
+                        departure.percentile(99.0),
+                        departure.max());
+    }
+
+    bool TxTimestamper::send(std::span<mmsghdr> batch) noexcept
+    {
+        const std::scoped_lock lock(mutex_);
+
+        for (auto sent{0UZ}; sent < batch.size();)
+        {
+            const auto sent_at{Clock::now()};
+            const auto sent_realtime{realtime()};
+            const auto ret{sendmmsg(socket_, batch.data() + sent, static_cast<unsigned>(batch.size() - sent), 0)};
+
+            if (ret < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+
+                util::log::perror();
+                errors_.increment_shared();
+                return false;
+            }
+
+            // the kernel numbered exactly these
+            for (const auto& message : batch.subspan(sent, static_cast<std::size_t>(ret)))
+            {
+                track(message.msg_hdr, sent_at, sent_realtime);
+            }
+
+            sent += static_cast<std::size_t>(ret);
+        }
+
+        return true;
+    }
+
+    void TxTimestamper::set_schedule(types::header::SequenceNumber sequence_number, Clock::time_point due) noexcept
+    {
+        const std::scoped_lock lock(mutex_);
+
+        schedule_sequence_number_ = sequence_number;
+        schedule_due_ = due;
+    }
+
+    const util::Histogram& TxTimestamper::pacing() const noexcept
+    {
+        return pacing_;
+    }
+
+    const util::Histogram& TxTimestamper::kernel() const noexcept
+    {
+        return kernel_;
+    }
+
+    const util::Histogram& TxTimestamper::departure() const noexcept
+    {
+        return departure_;
+    }
+
+    util::metrics::Counter& TxTimestamper::timestamped() noexcept
+    {
+        return timestamped_;
+    }
+
+    util::metrics::Counter& TxTimestamper::missed() noexcept
+    {
+        return missed_;
+    }
+
+    util::metrics::Counter& TxTimestamper::errors() noexcept
+    {
+        return errors_;
+    }
+
+    void TxTimestamper::track(const msghdr& msg, Clock::time_point sent_at, std::chrono::nanoseconds sent) noexcept
+    {
+        using namespace types::header;
+
+        auto& pending{pending_[next_id_ & mask_]};
+        if (pending.waiting)
+        {
+            missed_.increment();
+        }
+
+        pending = {.waiting = true, .id = next_id_, .sent = sent};
+        ++next_id_;
+
+        if (same_destination(msg, parity_destination_))
+        {
+            pending.kind = Kind::parity;
+            return;
+        }
+
+        const auto header{header_of(msg)};
+        pending.sequence_number = util::binary_io::read_at_be<SequenceNumber>(header, sequence_number_offset);
+        pending.message_count = util::binary_io::read_at_be<MessageCount>(header, message_count_offset);
+
+        if (pending.message_count == heartbeat_msg_count)
+        {
+            pending.kind = Kind::heartbeat;
+        }
+        else if (pending.message_count == end_of_session_msg_count)
+        {
+            pending.kind = Kind::end_of_session;
+        }
+        else if (pending.sequence_number == schedule_sequence_number_)
+        {
+            pending.scheduled = true;
+            pending.pacing = sent_at - schedule_due_;
+        }
+    }
+
+    void TxTimestamper::read(std::stop_token st) noexcept
+    {
+        // wakes the blocked poll()
+        const std::stop_callback wake(st, [this] {
+            constexpr std::uint64_t one{1};
+            if (write(wake_.get(), &one, sizeof(one)) < 0)
+            {
+                util::log::perror();
+            }
+        });
+
+        // the error queue reports as POLLERR, whatever events are asked for
+        std::array<pollfd, 2> fds{{{.fd = socket_, .events = 0, .revents = 0}, {.fd = wake_.get(), .events = POLLIN, .revents = 0}}};
+
+        while (!st.stop_requested())
+        {
+            if (poll(fds.data(), fds.size(), -1) < 0)
+            {
+                if (errno != EINTR)
+                {
+                    util::log::perror();
+                    return;
+                }
+                continue;
+            }
+
+            if ((fds[0].revents & POLLERR) != 0)
+            {
+                drain();
+            }
+        }
+
+        drain();
+    }
+
+    void TxTimestamper::drain() noexcept
+    {
+        while (true)
+        {
+            alignas(cmsghdr) std::array<char, CMSG_SPACE(sizeof(scm_timestamping)) + CMSG_SPACE(sizeof(sock_extended_err) + sizeof(sockaddr_in))> control{};
+
+            msghdr msg{};
+            msg.msg_control = control.data();
+            msg.msg_controllen = control.size();
+
+            if (recvmsg(socket_, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+
+                if (errno != EAGAIN)
+                {
+                    util::log::perror();
+                }
+                return;
+            }
+
+            std::optional<scm_timestamping> timestamps;
+            std::optional<sock_extended_err> error;
+
+            for (auto* cmsg{CMSG_FIRSTHDR(&msg)}; cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg))
+            {
+                if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPING)
+                {
+                    timestamps.emplace();
+                    std::memcpy(&*timestamps, CMSG_DATA(cmsg), sizeof(scm_timestamping));
+                }
+                else if (cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR)
+                {
+                    error.emplace();
+                    std::memcpy(&*error, CMSG_DATA(cmsg), sizeof(sock_extended_err));
+                }
+            }
+
+            if (!timestamps.has_value() || !error.has_value() || error->ee_errno != ENOMSG ||
+                error->ee_origin != SO_EE_ORIGIN_TIMESTAMPING)
+            {
+                continue;
+            }
+
+            // software in ts[0], hardware (raw) in ts[2] with ts[0] zero
+            const auto software{to_duration(timestamps->ts[0])};
+            const auto hardware{software == std::chrono::nanoseconds{0}};
+
+            complete(error->ee_data, error->ee_info, hardware ? to_duration(timestamps->ts[2]) : software, hardware);
+        }
+    }
+
+    void TxTimestamper::complete(std::uint32_t id, std::uint32_t type, std::chrono::nanoseconds time, bool hardware) noexcept
+    {
+        Pending done;
+
+        {
+            const std::scoped_lock lock(mutex_);
+
+            auto& pending{pending_[id & mask_]};
+            // overwritten by a later datagram, already counted as missed
+            if (!pending.waiting || pending.id != id)
+            {
+                return;
+            }
+
+            if (type == SCM_TSTAMP_SCHED)
+            {
+                pending.qdisc = time;
+                return;
+            }
+
+            if (type != SCM_TSTAMP_SND)
+            {
+                return;
+            }
+
+            pending.waiting = false;
+            done = pending;
+        }
+
+        timestamped_.increment();
+
+        const auto kernel{time - done.sent};
+        kernel_.record(static_cast<std::uint64_t>(std::max(kernel.count(), std::int64_t{0})));
+
+        if (done.scheduled)
+        {
+            pacing_.record(static_cast<std::uint64_t>(std::max(done.pacing.count(), std::int64_t{0})));
+            departure_.record(static_cast<std::uint64_t>(std::max((done.pacing + kernel).count(), std::int64_t{0})));
+        }
+
+        if (report_.is_open())
+        {
+            constexpr std::array kinds{"data", "heartbeat", "end_of_session", "parity"};
+
+            report_ << std::format("{},{},{},{},{},{},{},{}\n",
+                                   kinds[static_cast<std::size_t>(done.kind)],
+                                   done.sequence_number,
+                                   done.message_count,
+                                   done.scheduled ? std::to_string((done.sent - done.pacing).count()) : std::string{},
+                                   done.sent.count(),
+                                   done.qdisc.count(),
+                                   time.count(),
+                                   hardware ? 1 : 0);
+        }
+    }
+}
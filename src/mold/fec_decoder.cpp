@@ -0,0 +1,123 @@
+#include "imr/mold/fec_decoder.h"
+
+#include "../util/binary_io.h"
+#include "../util/xor.h"
+
+#include <algorithm>
+#include <optional>
+
+namespace imr::mold
+{
+    FecDecoder::FecDecoder(std::size_t window)
+        : window_{std::max(window, 1UZ)}
+    {
+    }
+
+    void FecDecoder::on_packet(std::span<const char> packet)
+    {
+        if (packet.size() < types::header::length)
+        {
+            return;
+        }
+
+        const auto count{util::binary_io::read_at_be<types::header::MessageCount>(packet, types::header::message_count_offset)};
+        if (count == types::header::heartbeat_msg_count || count == types::header::end_of_session_msg_count)
+        {
+            return;
+        }
+
+        const auto seq{util::binary_io::read_at_be<types::header::SequenceNumber>(packet, types::header::sequence_number_offset)};
+
+        if (!packets_.try_emplace(seq, packet.begin(), packet.end()).second)
+        {
+            return;
+        }
+
+        received_.push_back(seq);
+
+        if (received_.size() > window_)
+        {
+            packets_.erase(received_.front());
+            received_.pop_front();
+        }
+    }
+
+    std::vector<char> FecDecoder::on_parity(std::span<const char> parity)
+    {
+        if (parity.size() < types::fec::sequence_numbers_offset)
+        {
+            return {};
+        }
+
+        const auto count{static_cast<std::uint8_t>(parity[types::fec::count_offset])};
+        const auto payload_offset{types::fec::payload_offset(count)};
+
+        if (parity.size() < payload_offset)
+        {
+            return {};
+        }
+
+        std::optional<types::header::SequenceNumber> missing;
+
+        for (auto i{0UZ}; i < count; ++i)
+        {
+            const auto seq{util::binary_io::read_at_be<types::header::SequenceNumber>(
+                parity, types::fec::sequence_numbers_offset + (i * sizeof(types::header::SequenceNumber)))};
+
+            if (!has(seq))
+            {
+                if (missing.has_value())
+                {
+                    return {};
+                }
+                missing = seq;
+            }
+        }
+
+        if (!missing.has_value())
+        {
+            return {};
+        }
+
+        // XOR of everything but the missing packet's protected bytes
+        std::vector<char> protected_bytes(parity.begin() + static_cast<std::ptrdiff_t>(payload_offset), parity.end());
+        auto length{util::binary_io::read_at_be<std::uint16_t>(parity, types::fec::length_offset)};
+
+        for (auto i{0UZ}; i < count; ++i)
+        {
+            const auto seq{util::binary_io::read_at_be<types::header::SequenceNumber>(
+                parity, types::fec::sequence_numbers_offset + (i * sizeof(types::header::SequenceNumber)))};
+
+            if (seq == *missing)
+            {
+                continue;
+            }
+
+            const auto packet{std::span<const char>(packets_.at(seq)).subspan(sizeof(types::header::Session))};
+            if (packet.size() > protected_bytes.size())
+            {
+                return {};
+            }
+
+            util::xor_into(protected_bytes, packet);
+            length ^= static_cast<std::uint16_t>(packet.size());
+        }
+
+        if (length > protected_bytes.size())
+        {
+            return {};
+        }
+
+        std::vector<char> packet(parity.begin(), parity.begin() + sizeof(types::header::Session));
+        packet.insert(packet.end(), protected_bytes.begin(), protected_bytes.begin() + length);
+
+        on_packet(packet);
+
+        return packet;
+    }
+
+    bool FecDecoder::has(types::header::SequenceNumber sequence_number) const noexcept
+    {
+        return packets_.contains(sequence_number);
+    }
+}
@@ -0,0 +1,59 @@
+#include "imr/mold/message_store.h"
+
+#include "io.h"
+#include "../util/binary_io.h"
+#include "imr/mold/types.h"
+
+namespace imr::mold
+{
+    MessageStore::MessageStore(std::span<const char> file) noexcept
+        : file_{file}
+    {
+    }
+
+    MessageStore::MessageStore(std::span<const std::span<const char>> files) noexcept
+        : files_{files}
+    {
+    }
+
+    MessageStore::MessageStore(const util::ByteRing& ring) noexcept
+        : ring_{&ring}
+    {
+    }
+
+    std::span<const char> MessageStore::read(std::size_t position, std::span<char> scratch) const noexcept
+    {
+        if (ring_ == nullptr)
+        {
+            const auto file_id{position >> offset_bits};
+            auto offset{position & ((1UZ << offset_bits) - 1)};
+
+            if (files_.empty())
+            {
+                return file_id == 0 ? io::read_message(file_, offset) : std::span<const char>{};
+            }
+
+            return file_id < files_.size() ? io::read_message(files_[file_id], offset) : std::span<const char>{};
+        }
+
+        if (scratch.size() < sizeof(types::LengthPrefix) ||
+            !ring_->copy_to(position, scratch.first(sizeof(types::LengthPrefix)))) [[unlikely]]
+        {
+            return {};
+        }
+
+        const auto length{sizeof(types::LengthPrefix) + util::binary_io::read_at_be<types::LengthPrefix>(scratch, 0)};
+
+        if (length > scratch.size() || !ring_->copy_to(position, scratch.first(length))) [[unlikely]]
+        {
+            return {};
+        }
+
+        return scratch.first(length);
+    }
+
+    bool MessageStore::copies() const noexcept
+    {
+        return ring_ != nullptr;
+    }
+}
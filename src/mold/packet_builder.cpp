@@ -68,8 +68,20 @@ namespace imr::mold
         return static_cast<types::header::MessageCount>(iovecs_.size() - 1);
     }
 
+    std::size_t PacketBuilder::size() const noexcept
+    {
+        return MTU_ - bytes_remaining_;
+    }
+
     std::string_view PacketBuilder::session() const noexcept
     {
         return std::string_view(header_buffer_.data(), sizeof(types::header::Session));
     }
+
+    void PacketBuilder::set_session(const types::header::Session& session) noexcept
+    {
+        util::binary_io::write_at(std::span(header_buffer_),
+                                  types::header::session_offset,
+                                  std::string_view(session.data(), session.size()));
+    }
 }
@@ -3,10 +3,13 @@
 #include "imr/mold/types.h"
 
 #include "../../util/binary_io.h"
-#include "../io.h"
+#include "../../util/probe.h"
+#include "imr/util/hot_path.h"
 #include "imr/util/log.h"
 
+#include <algorithm>
 #include <arpa/inet.h>
+#include <chrono>
 #include <source_location>
 #include <stdexcept>
 #include <format>
@@ -15,16 +18,61 @@
 
 namespace imr::mold::retransmission
 {
+    namespace
+    {
+        std::vector<Feed::Channel> single_channel(const PacketBuilder::Config& packet_builder_cfg,
+                                                  MessageStore message_store,
+                                                  const RetransmissionBuffer& retransmission_buffer)
+        {
+            Feed::Channel channel{.session = {},
+                                  .message_store = message_store,
+                                  .retransmission_buffer = &retransmission_buffer};
+
+            // PacketBuilder's constructor rejects sessions of the wrong size
+            std::ranges::copy(packet_builder_cfg.session.substr(0, channel.session.size()), channel.session.begin());
+
+            return {channel};
+        }
+    }
+
     Feed::Feed(const Config& cfg,
                const PacketBuilder::Config& packet_builder_cfg,
-               std::span<const char> file,
+               MessageStore message_store,
                const RetransmissionBuffer& retransmission_buffer,
                int shutdown_fd)
+        : Feed(cfg, packet_builder_cfg, single_channel(packet_builder_cfg, message_store, retransmission_buffer), shutdown_fd)
+    {
+    }
+
+    Feed::Feed(const Config& cfg,
+               const PacketBuilder::Config& packet_builder_cfg,
+               std::vector<Channel> channels,
+               int shutdown_fd)
         : shutdown_fd_{shutdown_fd},
-          packet_builder_(packet_builder_cfg),
-          file_{file},
-          retransmission_buffer_{&retransmission_buffer}
+          transport_{cfg.transport},
+          packet_builder_(packet_builder_cfg)
     {
+        if (transport_ == transport::Kind::shm)
+        {
+            throw std::invalid_argument(std::format("{}: no shm transport for retransmission", std::source_location::current().function_name()));
+        }
+
+        if (channels.empty())
+        {
+            throw std::invalid_argument(std::format("{}: no channels", std::source_location::current().function_name()));
+        }
+
+        routes_.reserve(channels.size());
+        for (const auto& channel : channels)
+        {
+            routes_.push_back({.channel = channel});
+
+            if (channel.message_store.copies())
+            {
+                scratch_.resize(packet_builder_cfg.MTU);
+            }
+        }
+
         // 0 is stdin so will EPERM w/ epoll
         if (shutdown_fd_ <= 0)
         {
@@ -38,8 +86,59 @@ namespace imr::mold::retransmission
     }
 
     void Feed::start()
+    {
+        switch (transport_)
+        {
+        case transport::Kind::udp:
+            run(udp_);
+            break;
+        case transport::Kind::memory:
+            run(memory_);
+            break;
+        case transport::Kind::shm:
+        case transport::Kind::null:
+            run(null_);
+            break;
+        }
+    }
+
+    void Feed::attach_metrics(util::metrics::Registry& registry, std::string_view labels)
+    {
+        registry.attach(metrics_.requests, "imr_retransmission_requests_total", labels);
+        registry.attach(metrics_.served, "imr_retransmission_served_total", labels);
+        registry.attach(metrics_.out_of_range, "imr_retransmission_out_of_range_total", labels);
+        registry.attach(metrics_.bad_session, "imr_retransmission_bad_session_total", labels);
+        registry.attach(metrics_.bytes, "imr_retransmission_bytes_total", labels);
+        registry.attach(udp_.errors(), "imr_retransmission_send_errors_total", labels);
+    }
+
+    void Feed::record_service_time(util::Histogram& histogram) noexcept
+    {
+        metrics_.service_time = &histogram;
+    }
+
+    void Feed::count_hot_path(std::atomic<std::size_t>& threads) noexcept
+    {
+        hot_path_threads_ = &threads;
+    }
+
+    const transport::Memory& Feed::memory_sink() const noexcept
+    {
+        return memory_;
+    }
+
+    const transport::Null& Feed::null_sink() const noexcept
+    {
+        return null_;
+    }
+
+    template <transport::Transport T>
+    void Feed::run(T& transport)
     {
         util::log::info("Retransmission feed: started");
+        util::log::register_thread();
+
+        const util::hot_path::Scope hot_path(util::hot_path::Kind::retransmission, hot_path_threads_);
 
         auto should_stop{false};
         while (!should_stop)
@@ -70,25 +169,27 @@ namespace imr::mold::retransmission
 
                 if ((event.events & EPOLLIN) != 0)
                 {
-                    handle_request(event.data.fd);
+                    handle_request(event.data.fd, transport);
                 }
             }
         }
     }
 
-    void Feed::handle_request(int client_fd)
+    template <transport::Transport T>
+    void Feed::handle_request(int client_fd, T& transport)
     {
         static socklen_t client_addr_len{sizeof(RequestContext::client_address)};
 
         sockaddr_in client_addr{};
 
-        if (const auto bytes_recv{recvfrom(client_fd,
-                                           recv_buffer_.data(),
-                                           sizeof(recv_buffer_),
-                                           0,
-                                           reinterpret_cast<sockaddr*>(&client_addr),
-                                           &client_addr_len)};
-            bytes_recv < 0)
+        const auto bytes_recv{recvfrom(client_fd,
+                                       recv_buffer_.data(),
+                                       sizeof(recv_buffer_),
+                                       0,
+                                       reinterpret_cast<sockaddr*>(&client_addr),
+                                       &client_addr_len)};
+
+        if (bytes_recv < 0)
         {
             if (errno != EWOULDBLOCK)
             {
@@ -97,17 +198,41 @@ namespace imr::mold::retransmission
             }
             return;
         }
-        else if (bytes_recv != mold::types::header::length)
+
+        const auto received_at{std::chrono::steady_clock::now()};
+
+        // malformed requests count too, as requests neither served nor out of range
+        metrics_.requests.increment();
+
+        if (bytes_recv != mold::types::header::length)
         {
             return;
         }
 
+        IMR_PROBE(retransmission_request,
+                  util::binary_io::read_at_be<types::header::SequenceNumber>(recv_buffer_, types::header::sequence_number_offset),
+                  util::binary_io::read_at_be<types::header::MessageCount>(recv_buffer_, types::header::message_count_offset));
+
         const std::optional<RequestContext> req_ctx{parse_request(std::move(client_addr))};
 
         if (req_ctx)
         {
             build_packet(*req_ctx);
-            send_packet(req_ctx->client_address);
+
+            // downstream rolled the session while we were building, the messages may be from the new one
+            if (req_ctx->route->channel.retransmission_buffer->session_index() != req_ctx->route->session_index) [[unlikely]]
+            {
+                return;
+            }
+
+            send_packet(req_ctx->client_address, transport);
+            IMR_PROBE(retransmission_response, req_ctx->starting_sequence, packet_builder_.message_count(), packet_builder_.size());
+
+            if (metrics_.service_time != nullptr)
+            {
+                metrics_.service_time->record(
+                    static_cast<std::uint64_t>(std::chrono::nanoseconds(std::chrono::steady_clock::now() - received_at).count()));
+            }
         }
     }
 
@@ -115,21 +240,31 @@ namespace imr::mold::retransmission
     {
         using namespace types::header;
 
-        std::string_view recv_session(recv_buffer_.data(), sizeof(types::header::Session));
-        if (recv_session != packet_builder_.session())
+        const std::string_view recv_session(recv_buffer_.data(), sizeof(types::header::Session));
+
+        // a handful of channels at most, linear scan beats hashing
+        const auto route{std::ranges::find_if(routes_, [&recv_session](Route& r) {
+            follow_session(r);
+            return recv_session == std::string_view(r.channel.session.data(), r.channel.session.size());
+        })};
+
+        if (route == routes_.end())
         {
             util::log::debug("Retransmission feed: bad request");
+            metrics_.bad_session.increment();
             return std::nullopt;
         }
 
         RequestContext req_ctx{};
 
+        req_ctx.route = &*route;
         req_ctx.starting_sequence = util::binary_io::read_at_be<SequenceNumber>(recv_buffer_, sequence_number_offset);
 
-        const std::optional file_pos{retransmission_buffer_->file_position_for(req_ctx.starting_sequence)};
+        const std::optional file_pos{route->channel.retransmission_buffer->file_position_for(req_ctx.starting_sequence)};
         if (!file_pos)
         {
             util::log::debug("Retransmission feed: requested sequence_number out of range");
+            metrics_.out_of_range.increment();
             return std::nullopt;
         }
 
@@ -142,14 +277,30 @@ namespace imr::mold::retransmission
 
     void Feed::build_packet(const RequestContext& req_ctx)
     {
-        std::size_t file_pos{req_ctx.file_position_for_retransmission};
+        const auto& [session, message_store, retransmission_buffer]{req_ctx.route->channel};
 
+        packet_builder_.set_session(session);
         packet_builder_.reset(req_ctx.starting_sequence);
 
+        std::span<char> scratch{scratch_};
+        std::optional<std::size_t> file_pos{req_ctx.file_position_for_retransmission};
+
         for (auto i{0UZ}; i < req_ctx.msg_count; ++i)
         {
-            const std::span msg{io::read_message(file_, file_pos)};
-            // eof / bad file
+            // consecutive sequence numbers aren't necessarily adjacent in the input, so look each one up
+            if (i > 0)
+            {
+                file_pos = retransmission_buffer->file_position_for(req_ctx.starting_sequence + i);
+            }
+
+            // evicted / not yet sent
+            if (!file_pos.has_value())
+            {
+                break;
+            }
+
+            const std::span msg{message_store.read(*file_pos, scratch)};
+            // eof / bad file / overwritten
             if (msg.empty()) [[unlikely]]
             {
                 break;
@@ -160,31 +311,45 @@ namespace imr::mold::retransmission
             {
                 break;
             }
+
+            if (message_store.copies())
+            {
+                scratch = scratch.subspan(msg.size());
+            }
+        }
+    }
+
+    void Feed::follow_session(Route& route) noexcept
+    {
+        const auto session_index{route.channel.retransmission_buffer->session_index()};
+
+        while (route.session_index != session_index)
+        {
+            route.channel.session = types::header::roll_session(route.channel.session);
+            ++route.session_index;
         }
     }
 
-    void Feed::send_packet([[maybe_unused]] const sockaddr_in& client_addr)
+    template <transport::Transport T>
+    void Feed::send_packet(const sockaddr_in& client_addr, T& transport) noexcept
     {
-#ifndef DEBUG_NO_NETWORK
         auto msg{packet_builder_.finalize()};
 
-        msghdr send_hdr{};
+        mmsghdr send_hdr{};
 
-        send_hdr.msg_name = const_cast<sockaddr_in*>(&client_addr);
-        send_hdr.msg_namelen = sizeof(client_addr);
-        send_hdr.msg_iov = msg.data();
-        send_hdr.msg_iovlen = msg.size();
+        send_hdr.msg_hdr.msg_name = const_cast<sockaddr_in*>(&client_addr);
+        send_hdr.msg_hdr.msg_namelen = sizeof(client_addr);
+        send_hdr.msg_hdr.msg_iov = msg.data();
+        send_hdr.msg_hdr.msg_iovlen = msg.size();
 
-        if (const auto bytes_sent{sendmsg(socket_.get(), &send_hdr, 0)}; bytes_sent < 0)
-        {
-            util::log::perror();
-        }
-#endif
+        transport.send({&send_hdr, 1});
+
+        metrics_.served.increment();
+        metrics_.bytes.increment(packet_builder_.size());
     }
 
-    void Feed::configure_socket([[maybe_unused]] const Config& cfg)
+    void Feed::configure_socket(const Config& cfg)
     {
-#ifndef DEBUG_NO_NETWORK
         constexpr auto sockopt_on{1};
         if (setsockopt(socket_.get(), SOL_SOCKET, SO_REUSEADDR, &sockopt_on, sizeof(sockopt_on)) < 0 ||
             setsockopt(socket_.get(), SOL_SOCKET, SO_REUSEPORT, &sockopt_on, sizeof(sockopt_on)) < 0)
@@ -232,6 +397,5 @@ namespace imr::mold::retransmission
         }
 
         util::log::debug();
-#endif
     }
 }
@@ -2,6 +2,8 @@
 #include "imr/util/file_descriptor.h"
 #include "imr/util/log.h"
 
+#include <format>
+#include <memory>
 #include <source_location>
 #include <unistd.h>
 
@@ -10,16 +12,26 @@ namespace imr::mold::retransmission
     FeedPool::FeedPool(std::size_t num_feeds,
                        const Feed::Config& feed_cfg,
                        const PacketBuilder::Config& packet_builder_cfg,
-                       std::span<const char> file,
-                       const RetransmissionBuffer& retransmission_buffer)
+                       MessageStore message_store,
+                       const RetransmissionBuffer& retransmission_buffer,
+                       util::metrics::Registry* metrics)
         : feed_cfg_{&feed_cfg},
           packet_builder_cfg_{&packet_builder_cfg}
     {
+        service_times_.reserve(num_feeds);
         feeds_.reserve(num_feeds);
         for (auto i{0UZ}; i < num_feeds; ++i)
         {
-            feeds_.emplace_back([this, &retransmission_buffer, file] {
-                Feed feed(*feed_cfg_, *packet_builder_cfg_, file, retransmission_buffer, shutdown_fd_.get());
+            auto& service_time{*service_times_.emplace_back(std::make_unique<util::Histogram>())};
+
+            feeds_.emplace_back([this, &retransmission_buffer, &service_time, message_store, metrics, i] {
+                Feed feed(*feed_cfg_, *packet_builder_cfg_, message_store, retransmission_buffer, shutdown_fd_.get());
+                if (metrics != nullptr)
+                {
+                    feed.attach_metrics(*metrics, std::format("thread=\"{}\"", i));
+                }
+                feed.record_service_time(service_time);
+                feed.count_hot_path(hot_path_threads_);
                 feed.start();
             });
 
@@ -29,6 +41,37 @@ namespace imr::mold::retransmission
         util::log::debug();
     }
 
+    FeedPool::FeedPool(std::size_t num_feeds,
+                       const Feed::Config& feed_cfg,
+                       const PacketBuilder::Config& packet_builder_cfg,
+                       std::vector<Feed::Channel> channels,
+                       util::metrics::Registry* metrics)
+        : feed_cfg_{&feed_cfg},
+          packet_builder_cfg_{&packet_builder_cfg}
+    {
+        service_times_.reserve(num_feeds);
+        feeds_.reserve(num_feeds);
+        for (auto i{0UZ}; i < num_feeds; ++i)
+        {
+            auto& service_time{*service_times_.emplace_back(std::make_unique<util::Histogram>())};
+
+            feeds_.emplace_back([this, &service_time, channels, metrics, i] {
+                Feed feed(*feed_cfg_, *packet_builder_cfg_, channels, shutdown_fd_.get());
+                if (metrics != nullptr)
+                {
+                    feed.attach_metrics(*metrics, std::format("thread=\"{}\"", i));
+                }
+                feed.record_service_time(service_time);
+                feed.count_hot_path(hot_path_threads_);
+                feed.start();
+            });
+
+            util::log::info("Started retransmission thread {} of {} ({} channels)", i + 1, num_feeds, channels.size());
+        }
+
+        util::log::debug();
+    }
+
     void FeedPool::stop() const
     {
         constexpr std::uint64_t val{1};
@@ -39,4 +82,19 @@ namespace imr::mold::retransmission
 
         util::log::debug();
     }
+
+    util::Histogram::Snapshot FeedPool::service_time() const
+    {
+        util::Histogram::Snapshot snapshot;
+        for (const auto& histogram : service_times_)
+        {
+            snapshot.add(*histogram);
+        }
+        return snapshot;
+    }
+
+    std::size_t FeedPool::hot_path_threads() const noexcept
+    {
+        return hot_path_threads_.load(std::memory_order_acquire);
+    }
 };
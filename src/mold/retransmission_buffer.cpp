@@ -1,5 +1,7 @@
 #include "imr/mold/retransmission_buffer.h"
 
+#include "util/probe.h"
+
 #include <print>
 #include <source_location>
 #include <stdexcept>
@@ -30,7 +32,9 @@ namespace imr::mold
 
     void RetransmissionBuffer::push(const RetransmissionBuffer::MessageRecord& message_record) noexcept
     {
+        IMR_PROBE(retransmission_buffer_push, message_record.sequence_number, message_record.file_position);
         buffer_[index_for(message_record.sequence_number)] = message_record;
+        last_file_position_ = message_record.file_position;
 
         write_seq_.store(message_record.sequence_number, std::memory_order_release);
     }
@@ -46,6 +50,7 @@ namespace imr::mold
 
         if (overwritten || not_yet_sent || buffer_empty)
         {
+            IMR_PROBE(retransmission_buffer_lookup, seq_num, false);
             return std::nullopt;
         }
 
@@ -54,12 +59,35 @@ namespace imr::mold
         // check if writer lapped us between checking overwritten above and this read
         if (entry.sequence_number != seq_num)
         {
+            IMR_PROBE(retransmission_buffer_lookup, seq_num, false);
             return std::nullopt;
         }
 
+        IMR_PROBE(retransmission_buffer_lookup, seq_num, true);
         return entry.file_position;
     }
 
+    std::size_t RetransmissionBuffer::last_file_position() const noexcept
+    {
+        return last_file_position_;
+    }
+
+    void RetransmissionBuffer::roll_session() noexcept
+    {
+        write_seq_.store(0, std::memory_order_release);
+        session_index_.fetch_add(1, std::memory_order_acq_rel);
+    }
+
+    std::uint32_t RetransmissionBuffer::session_index() const noexcept
+    {
+        return session_index_.load(std::memory_order_acquire);
+    }
+
+    types::header::SequenceNumber RetransmissionBuffer::written() const noexcept
+    {
+        return write_seq_.load(std::memory_order_acquire);
+    }
+
     std::size_t RetransmissionBuffer::index_for(types::header::SequenceNumber seq_num) const noexcept
     {
         return use_mask_ ? seq_num & mask_
@@ -0,0 +1,158 @@
+#include "imr/mold/shm.h"
+
+#include "imr/util/file_descriptor.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <format>
+#include <source_location>
+#include <stdexcept>
+#include <system_error>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace imr::mold::shm
+{
+    Reader::Reader(const std::filesystem::path& path, Start start)
+    {
+        // read write to register in the ring's reader slots
+        const util::FileDescriptor fd(path, O_RDWR | O_CLOEXEC);
+
+        struct stat info{};
+        if (fstat(fd.get(), &info) < 0)
+        {
+            throw std::system_error(errno, std::system_category(), std::source_location::current().function_name());
+        }
+
+        length_ = static_cast<std::size_t>(info.st_size);
+        if (length_ < sizeof(Header))
+        {
+            throw std::invalid_argument(std::format("{}: {} is not a ring", std::source_location::current().function_name(), path.c_str()));
+        }
+
+        mapping_ = mmap(nullptr, length_, PROT_READ | PROT_WRITE, MAP_SHARED, fd.get(), 0);
+        if (mapping_ == MAP_FAILED)
+        {
+            mapping_ = nullptr;
+            throw std::system_error(errno, std::system_category(), std::source_location::current().function_name());
+        }
+
+        header_ = static_cast<Header*>(mapping_);
+        slots_ = static_cast<std::byte*>(mapping_) + sizeof(Header);
+        slot_size_ = header_->slot_size;
+        mask_ = header_->slot_count - 1;
+
+        if (header_->magic != magic || header_->slot_count == 0 || (header_->slot_count & mask_) != 0 ||
+            slot_size_ <= slot_data_offset || sizeof(Header) + (header_->slot_count * slot_size_) > length_)
+        {
+            munmap(mapping_, length_);
+            mapping_ = nullptr;
+            throw std::invalid_argument(std::format("{}: {} is not a ring", std::source_location::current().function_name(), path.c_str()));
+        }
+
+        entry_.resize(slot_size_ - slot_data_offset);
+
+        const auto written{header_->write_index.load(std::memory_order_acquire)};
+        if (start == Start::latest)
+        {
+            position_ = written;
+        }
+        else
+        {
+            position_ = written > mask_ + 1 ? written - mask_ : 0;
+        }
+
+        for (auto& slot : header_->readers)
+        {
+            // free, or left behind by a reader that died without detaching
+            auto owner{slot.pid.load(std::memory_order_acquire)};
+            if (owner != 0 && (kill(owner, 0) == 0 || errno != ESRCH))
+            {
+                continue;
+            }
+
+            if (slot.pid.compare_exchange_strong(owner, getpid(), std::memory_order_acq_rel))
+            {
+                slot.position.store(position_, std::memory_order_relaxed);
+                registration_ = &slot;
+                break;
+            }
+        }
+    }
+
+    Reader::~Reader()
+    {
+        if (registration_ != nullptr)
+        {
+            registration_->pid.store(0, std::memory_order_release);
+        }
+
+        if (mapping_ != nullptr)
+        {
+            munmap(mapping_, length_);
+        }
+    }
+
+    std::optional<Reader::Entry> Reader::try_read() noexcept
+    {
+        while (true)
+        {
+            auto& slot{*reinterpret_cast<Slot*>(slots_ + ((position_ & mask_) * slot_size_))};
+            const auto expected{(2 * position_) + 2};
+
+            const auto before{slot.version.load(std::memory_order_acquire)};
+            if (before < expected)
+            {
+                // not published yet (or being written)
+                return std::nullopt;
+            }
+
+            if (before == expected)
+            {
+                const Entry entry{.sequence_number = slot.sequence_number,
+                                  .message_count = slot.message_count,
+                                  .data = std::span(entry_).first(std::min<std::size_t>(slot.length, entry_.size()))};
+                std::memcpy(entry_.data(), reinterpret_cast<const std::byte*>(&slot) + slot_data_offset, entry.data.size());
+
+                // seqlock: the copy is only good if the writer didn't start on the slot meanwhile
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot.version.load(std::memory_order_relaxed) == expected)
+                {
+                    ++position_;
+                    if (registration_ != nullptr)
+                    {
+                        registration_->position.store(position_, std::memory_order_relaxed);
+                    }
+                    return entry;
+                }
+            }
+
+            // lapped, skip to the oldest entry still in the ring
+            const auto written{header_->write_index.load(std::memory_order_acquire)};
+            const auto oldest{written > mask_ + 1 ? written - mask_ : 0};
+            const auto resume{std::max(oldest, position_ + 1)};
+
+            dropped_ += resume - position_;
+            position_ = resume;
+        }
+    }
+
+    std::uint64_t Reader::lag() const noexcept
+    {
+        return header_->write_index.load(std::memory_order_acquire) - position_;
+    }
+
+    std::uint64_t Reader::dropped() const noexcept
+    {
+        return dropped_;
+    }
+
+    Content Reader::content() const noexcept
+    {
+        return header_->content;
+    }
+}
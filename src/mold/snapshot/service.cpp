@@ -0,0 +1,229 @@
+#include "imr/mold/snapshot/service.h"
+
+#include "../../itch/order_book.h"
+#include "imr/util/log.h"
+#include "../../util/write_all.h"
+
+#include <algorithm>
+#include <format>
+#include <source_location>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+namespace imr::mold::snapshot
+{
+    Service::Service(const Config& cfg, MessageStore message_store, const RetransmissionBuffer& retransmission_buffer)
+        : message_store_{message_store},
+          retransmission_buffer_{&retransmission_buffer},
+          poll_interval_{cfg.poll_interval},
+          batch_size_{std::max(cfg.batch_size, 1UZ)},
+          send_timeout_{cfg.send_timeout},
+          book_{std::make_unique<itch::OrderBook>()}
+    {
+        constexpr auto sockopt_on{1};
+        if (setsockopt(socket_.get(), SOL_SOCKET, SO_REUSEADDR, &sockopt_on, sizeof(sockopt_on)) < 0)
+        {
+            throw std::system_error(errno, std::system_category(), std::source_location::current().function_name());
+        }
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(cfg.port);
+
+        if (inet_pton(AF_INET, cfg.address.c_str(), &addr.sin_addr) != 1)
+        {
+            throw std::invalid_argument(std::format("{}: invalid ip format for snapshot address {}",
+                                                    std::source_location::current().function_name(),
+                                                    cfg.address.c_str()));
+        }
+
+        if (bind(socket_.get(), reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) < 0 || listen(socket_.get(), SOMAXCONN) < 0)
+        {
+            throw std::system_error(errno, std::system_category(), std::source_location::current().function_name());
+        }
+
+        util::log::debug();
+    }
+
+    Service::~Service() = default;
+
+    void Service::start(std::stop_token st)
+    {
+        util::log::info("Snapshot service: started on port {}", port());
+
+        {
+            std::jthread server([this](std::stop_token server_st) { serve(server_st); });
+
+            // wakes the blocked accept(), or send to a client
+            std::stop_callback wake(server.get_stop_token(), [this] {
+                shutdown(socket_.get(), SHUT_RDWR);
+
+                const std::scoped_lock lock(client_mutex_);
+                if (client_ >= 0)
+                {
+                    shutdown(client_, SHUT_RDWR);
+                }
+            });
+
+            run_book(st);
+
+            server.request_stop();
+        }
+
+        util::log::info("Snapshot service: finished");
+    }
+
+    std::uint16_t Service::port() const
+    {
+        sockaddr_in addr{};
+        socklen_t length{sizeof(addr)};
+
+        if (getsockname(socket_.get(), reinterpret_cast<sockaddr*>(&addr), &length) < 0)
+        {
+            throw std::system_error(errno, std::system_category(), std::source_location::current().function_name());
+        }
+
+        return ntohs(addr.sin_port);
+    }
+
+    void Service::run_book(std::stop_token st)
+    {
+        // ring backed stores copy messages out, largest message + length prefix
+        std::vector<char> scratch(sizeof(types::LengthPrefix) + 0xFFFFUZ);
+
+        auto session_index{retransmission_buffer_->session_index()};
+        types::header::SequenceNumber next{1};
+
+        while (!st.stop_requested())
+        {
+            if (const auto current{retransmission_buffer_->session_index()}; current != session_index)
+            {
+                const std::scoped_lock lock(mutex_);
+                book_->clear();
+                applied_ = 0;
+
+                session_index = current;
+                next = 1;
+            }
+
+            const auto written{retransmission_buffer_->written()};
+
+            if (next > written)
+            {
+                std::this_thread::sleep_for(poll_interval_);
+                continue;
+            }
+
+            if (next + retransmission_buffer_->size() <= written) [[unlikely]]
+            {
+                util::log::error("{}: book fell behind the retransmission buffer at sequence {}, snapshots are incomplete",
+                                 std::source_location::current().function_name(),
+                                 next);
+
+                next = written - retransmission_buffer_->size() + 1;
+            }
+
+            const std::scoped_lock lock(mutex_);
+
+            for (const auto last{std::min(written, next + batch_size_ - 1)}; next <= last; ++next)
+            {
+                const auto position{retransmission_buffer_->file_position_for(next)};
+                if (!position.has_value())
+                {
+                    // lapped or rolled since written() was read, caught on the next pass
+                    break;
+                }
+
+                const auto message{message_store_.read(*position, scratch)};
+                if (message.size() <= sizeof(types::LengthPrefix)) [[unlikely]]
+                {
+                    break;
+                }
+
+                book_->apply(message.subspan(sizeof(types::LengthPrefix)));
+            }
+
+            applied_ = next - 1;
+        }
+    }
+
+    void Service::serve(std::stop_token st)
+    {
+        while (!st.stop_requested())
+        {
+            const auto fd{accept4(socket_.get(), nullptr, nullptr, SOCK_CLOEXEC)};
+
+            if (fd < 0)
+            {
+                if (errno != EINTR && errno != ECONNABORTED && !st.stop_requested())
+                {
+                    util::log::perror();
+                }
+                continue;
+            }
+
+            const util::FileDescriptor client{fd};
+
+            const auto seconds{std::chrono::duration_cast<std::chrono::seconds>(send_timeout_)};
+            const timeval timeout{
+                .tv_sec = seconds.count(),
+                .tv_usec = std::chrono::duration_cast<std::chrono::microseconds>(send_timeout_ - seconds).count(),
+            };
+
+            if (setsockopt(client.get(), SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout)) < 0)
+            {
+                util::log::perror();
+                continue;
+            }
+
+            {
+                const std::scoped_lock lock(client_mutex_);
+
+                // stop came between accept() and here, nothing would shut the client down
+                if (st.stop_requested())
+                {
+                    return;
+                }
+                client_ = client.get();
+            }
+
+            send_snapshot(client.get());
+
+            const std::scoped_lock lock(client_mutex_);
+            client_ = -1;
+        }
+    }
+
+    void Service::send_snapshot(int client)
+    {
+        std::vector<char> snapshot;
+        types::header::SequenceNumber resume{};
+
+        {
+            const std::scoped_lock lock(mutex_);
+            book_->write_snapshot(snapshot);
+            resume = applied_ + 1;
+        }
+
+        std::string end_of_snapshot(end_of_snapshot_size, ' ');
+        end_of_snapshot[0] = end_of_snapshot_type;
+        const auto sequence_number{std::to_string(resume)};
+        std::ranges::copy(sequence_number, end_of_snapshot.begin() + 1);
+
+        snapshot.push_back(0);
+        snapshot.push_back(static_cast<char>(end_of_snapshot_size));
+        snapshot.insert(snapshot.end(), end_of_snapshot.begin(), end_of_snapshot.end());
+
+        if (!util::send_all(client, snapshot))
+        {
+            util::log::perror();
+        }
+
+        util::log::debug("Snapshot service: sent {} bytes, resume from {}", snapshot.size(), resume);
+    }
+}
@@ -0,0 +1,719 @@
+#include "imr/mold/soup/feed.h"
+
+#include "../../util/binary_io.h"
+#include "imr/util/log.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <format>
+#include <memory>
+#include <optional>
+#include <source_location>
+#include <stdexcept>
+#include <system_error>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+namespace imr::mold::soup
+{
+    namespace
+    {
+        // left justified, space padded
+        template <std::size_t N>
+        std::array<char, N> alpha_field(std::string_view value, std::string_view name)
+        {
+            if (value.size() > N)
+            {
+                throw std::invalid_argument(std::format("{}: {} longer than {} characters",
+                                                        std::source_location::current().function_name(),
+                                                        name,
+                                                        N));
+            }
+
+            std::array<char, N> field{};
+            std::ranges::fill(field, ' ');
+            std::ranges::copy(value, field.begin());
+            return field;
+        }
+
+        // right justified, space padded
+        std::array<char, types::soup::sequence_number_size> numeric_field(types::header::SequenceNumber value) noexcept
+        {
+            std::array<char, types::soup::sequence_number_size> digits{};
+            const auto [end, ec]{std::to_chars(digits.begin(), digits.end(), value)};
+
+            std::array<char, types::soup::sequence_number_size> field{};
+            std::ranges::fill(field, ' ');
+            std::ranges::copy(digits.begin(), end, field.end() - (end - digits.begin()));
+            return field;
+        }
+
+        std::optional<types::header::SequenceNumber> parse_numeric(std::span<const char> field) noexcept
+        {
+            const auto first{std::ranges::find_if(field, [](char c) { return c != ' '; })};
+            const auto last{std::ranges::find(first, field.end(), ' ')};
+
+            if (first == field.end())
+            {
+                return types::header::SequenceNumber{0};
+            }
+
+            types::header::SequenceNumber value{};
+            const auto [end, ec]{std::from_chars(std::to_address(first), std::to_address(last), value)};
+
+            if (ec != std::errc{} || end != std::to_address(last) || std::ranges::any_of(last, field.end(), [](char c) { return c != ' '; }))
+            {
+                return std::nullopt;
+            }
+
+            return value;
+        }
+    }
+
+    struct Feed::Client
+    {
+        enum class State : std::uint8_t
+        {
+            login,
+            streaming,
+            disconnected,
+        };
+
+        Client(int client_fd, Clock::time_point now)
+            : fd{client_fd},
+              last_received{now},
+              last_sent{now}
+        {
+        }
+
+        util::FileDescriptor fd;
+        State state{State::login};
+
+        // next sequence number to send, and how much of its frame already went out
+        types::header::SequenceNumber next{1};
+        std::size_t partial{0};
+
+        // login accepted / rejected, heartbeats, end of session
+        std::string control;
+
+        // client packets are small (a login is the largest), anything longer is a protocol error
+        std::array<char, 64> input{};
+        std::size_t input_size{0};
+
+        Clock::time_point last_received;
+        Clock::time_point last_sent;
+        // when the socket last filled up, while it's unwritable
+        std::optional<Clock::time_point> blocked_since;
+    };
+
+    Feed::Feed(const Config& cfg,
+               std::string_view session,
+               MessageStore message_store,
+               const RetransmissionBuffer& retransmission_buffer)
+        : username_{alpha_field<types::soup::username_size>(cfg.username, "username")},
+          password_{alpha_field<types::soup::password_size>(cfg.password, "password")},
+          authenticate_{!cfg.username.empty() || !cfg.password.empty()},
+          session_index_{retransmission_buffer.session_index()},
+          message_store_{message_store},
+          retransmission_buffer_{&retransmission_buffer},
+          max_clients_{cfg.max_clients},
+          poll_interval_{cfg.poll_interval},
+          heartbeat_period_{cfg.heartbeat_period},
+          client_timeout_{cfg.client_timeout},
+          slow_consumer_timeout_{cfg.slow_consumer_timeout},
+          drain_timeout_{cfg.drain_timeout}
+    {
+        if (session.size() != session_.size())
+        {
+            throw std::invalid_argument(std::format("{}: session must be {} characters",
+                                                    std::source_location::current().function_name(),
+                                                    session_.size()));
+        }
+        std::ranges::copy(session, session_.begin());
+
+        if (message_store_.copies())
+        {
+            // a batch always has room for the largest message
+            staging_.resize(16 * (sizeof(types::LengthPrefix) + 0xFFFFUZ));
+        }
+
+        configure_socket(cfg);
+
+        util::log::debug();
+    }
+
+    Feed::~Feed() = default;
+
+    void Feed::start(std::stop_token st)
+    {
+        util::log::info("SoupBinTCP feed: started on port {}", port());
+
+        std::optional<Clock::time_point> drain_deadline;
+        auto busy{false};
+
+        while (true)
+        {
+            if (st.stop_requested() && !drain_deadline.has_value())
+            {
+                drain_deadline = Clock::now() + drain_timeout_;
+
+                // no new logins while draining
+                if (epoll_ctl(epoll_fd_.get(), EPOLL_CTL_DEL, socket_.get(), nullptr) < 0)
+                {
+                    util::log::perror();
+                }
+            }
+
+            // clients with a backlog are written again straight away
+            const auto timeout{busy ? std::chrono::nanoseconds{0} : poll_interval_};
+            const timespec wait{.tv_sec = std::chrono::duration_cast<std::chrono::seconds>(timeout).count(),
+                                .tv_nsec = (timeout % std::chrono::seconds{1}).count()};
+
+            const auto nfds{epoll_pwait2(epoll_fd_.get(), epoll_events_.data(), static_cast<int>(epoll_events_.size()), &wait, nullptr)};
+
+            if (nfds < 0 && errno != EINTR)
+            {
+                util::log::perror();
+            }
+
+            const auto now{Clock::now()};
+
+            for (auto i{0}; i < nfds; ++i)
+            {
+                const epoll_event& event{epoll_events_[static_cast<std::size_t>(i)]};
+
+                if (event.data.ptr == nullptr)
+                {
+                    accept_clients();
+                    continue;
+                }
+
+                auto& client{*static_cast<Client*>(event.data.ptr)};
+
+                if ((event.events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) != 0)
+                {
+                    read_client(client, now);
+                }
+
+                if ((event.events & EPOLLOUT) != 0 && client.state != Client::State::disconnected)
+                {
+                    client.blocked_since.reset();
+                    want_writable(client, false);
+                }
+            }
+
+            if (const auto session_index{retransmission_buffer_->session_index()}; session_index != session_index_)
+            {
+                end_session();
+
+                for (; session_index_ != session_index; ++session_index_)
+                {
+                    session_ = types::header::roll_session(session_);
+                }
+            }
+
+            const auto written{retransmission_buffer_->written()};
+
+            busy = false;
+            for (auto& client : clients_)
+            {
+                if (client->state != Client::State::disconnected)
+                {
+                    busy = service_client(*client, written, now) || busy;
+                }
+            }
+
+            remove_disconnected();
+
+            if (drain_deadline.has_value() && (drained(written) || now >= *drain_deadline))
+            {
+                end_session();
+                break;
+            }
+        }
+
+        util::log::info("SoupBinTCP feed: finished");
+    }
+
+    std::uint16_t Feed::port() const
+    {
+        sockaddr_in addr{};
+        socklen_t length{sizeof(addr)};
+
+        if (getsockname(socket_.get(), reinterpret_cast<sockaddr*>(&addr), &length) < 0)
+        {
+            throw std::system_error(errno, std::system_category(), std::source_location::current().function_name());
+        }
+
+        return ntohs(addr.sin_port);
+    }
+
+    void Feed::accept_clients()
+    {
+        while (true)
+        {
+            const auto fd{accept4(socket_.get(), nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)};
+
+            if (fd < 0)
+            {
+                if (errno != EAGAIN && errno != EINTR && errno != ECONNABORTED)
+                {
+                    util::log::perror();
+                }
+
+                if (errno == EINTR || errno == ECONNABORTED)
+                {
+                    continue;
+                }
+                return;
+            }
+
+            if (clients_.size() >= max_clients_)
+            {
+                util::log::error("{}: {} clients connected, refusing another",
+                                 std::source_location::current().function_name(),
+                                 clients_.size());
+
+                const util::FileDescriptor refused{fd};
+                continue;
+            }
+
+            auto client{std::make_unique<Client>(fd, Clock::now())};
+
+            constexpr auto sockopt_on{1};
+            if (setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &sockopt_on, sizeof(sockopt_on)) < 0)
+            {
+                util::log::perror();
+            }
+
+            epoll_event event{.events = EPOLLIN | EPOLLRDHUP, .data = {.ptr = client.get()}};
+            if (epoll_ctl(epoll_fd_.get(), EPOLL_CTL_ADD, fd, &event) < 0)
+            {
+                util::log::perror();
+                continue;
+            }
+
+            clients_.push_back(std::move(client));
+        }
+    }
+
+    void Feed::read_client(Client& client, Clock::time_point now)
+    {
+        while (client.state != Client::State::disconnected)
+        {
+            const auto received{recv(client.fd.get(),
+                                     client.input.data() + client.input_size,
+                                     client.input.size() - client.input_size,
+                                     0)};
+
+            if (received < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+
+                if (errno != EAGAIN)
+                {
+                    disconnect(client, std::strerror(errno));
+                }
+                return;
+            }
+
+            if (received == 0)
+            {
+                disconnect(client, "connection closed");
+                return;
+            }
+
+            client.last_received = now;
+            client.input_size += static_cast<std::size_t>(received);
+
+            auto consumed{0UZ};
+            while (client.state != Client::State::disconnected && client.input_size - consumed >= sizeof(types::soup::Length))
+            {
+                const std::span input{std::span(client.input).subspan(consumed, client.input_size - consumed)};
+                const auto length{util::binary_io::read_at_be<types::soup::Length>(input, 0)};
+
+                if (length == 0 || sizeof(types::soup::Length) + length > client.input.size())
+                {
+                    disconnect(client, "malformed packet");
+                    return;
+                }
+
+                if (input.size() < sizeof(types::soup::Length) + length)
+                {
+                    break;
+                }
+
+                handle_packet(client, input[types::soup::type_offset], input.subspan(types::soup::payload_offset, length - 1UZ));
+                consumed += sizeof(types::soup::Length) + length;
+            }
+
+            std::memmove(client.input.data(), client.input.data() + consumed, client.input_size - consumed);
+            client.input_size -= consumed;
+        }
+    }
+
+    void Feed::handle_packet(Client& client, char type, std::span<const char> payload)
+    {
+        if (client.state == Client::State::login)
+        {
+            if (type != types::soup::login_request_type)
+            {
+                disconnect(client, "expected a login request");
+                return;
+            }
+
+            login(client, payload);
+            return;
+        }
+
+        switch (type)
+        {
+        case types::soup::logout_request_type:
+            disconnect(client, "logged out");
+            break;
+        case types::soup::login_request_type:
+            disconnect(client, "login request while logged in");
+            break;
+        default:
+            // heartbeats only refresh last_received, unsequenced data isn't used by a replay
+            break;
+        }
+    }
+
+    void Feed::login(Client& client, std::span<const char> payload)
+    {
+        using namespace types::soup;
+
+        if (payload.size() != login_request_size)
+        {
+            disconnect(client, "malformed login request");
+            return;
+        }
+
+        const auto username{payload.first(username_size)};
+        const auto password{payload.subspan(username_size, password_size)};
+        const auto session{payload.subspan(username_size + password_size, session_.size())};
+        const auto requested{parse_numeric(payload.last(sequence_number_size))};
+
+        const auto reject{[&](char reason, std::string_view why) {
+            queue(client, login_rejected_type, std::span(&reason, 1));
+            write_control(client);
+            disconnect(client, why);
+        }};
+
+        if (authenticate_ && (!std::ranges::equal(username, username_) || !std::ranges::equal(password, password_)))
+        {
+            reject(reject_not_authorized, "not authorized");
+            return;
+        }
+
+        if (!std::ranges::all_of(session, [](char c) { return c == ' '; }) && !std::ranges::equal(session, session_))
+        {
+            reject(reject_session_not_available, "session not available");
+            return;
+        }
+
+        if (!requested.has_value())
+        {
+            disconnect(client, "malformed requested sequence number");
+            return;
+        }
+
+        const auto written{retransmission_buffer_->written()};
+        const auto size{retransmission_buffer_->size()};
+        // oldest message still in the retransmission buffer
+        const auto earliest{written > size ? written - size + 1 : 1};
+
+        client.next = *requested == 0 ? written + 1 : std::max(*requested, earliest);
+        client.state = Client::State::streaming;
+
+        if (*requested != 0 && *requested < earliest)
+        {
+            util::log::info("SoupBinTCP feed: requested sequence {} no longer buffered, starting from {}", *requested, earliest);
+        }
+
+        std::array<char, login_accepted_size> accepted{};
+        std::ranges::copy(session_, accepted.begin());
+        std::ranges::copy(numeric_field(client.next), accepted.begin() + session_.size());
+        queue(client, login_accepted_type, accepted);
+    }
+
+    bool Feed::service_client(Client& client, types::header::SequenceNumber written, Clock::time_point now)
+    {
+        if (now - client.last_received > client_timeout_)
+        {
+            disconnect(client, "timed out");
+            return false;
+        }
+
+        const auto streaming{client.state == Client::State::streaming};
+
+        if (streaming && client.control.empty() && client.partial == 0 && now - client.last_sent >= heartbeat_period_)
+        {
+            queue(client, types::soup::server_heartbeat_type, {});
+        }
+
+        if (client.blocked_since.has_value())
+        {
+            if (streaming && client.next <= written && now - *client.blocked_since > slow_consumer_timeout_)
+            {
+                disconnect(client, "slow consumer");
+            }
+            return false;
+        }
+
+        if (!write_control(client))
+        {
+            block(client, now);
+            return false;
+        }
+
+        if (!streaming || client.next > written)
+        {
+            return false;
+        }
+
+        if (!write_data(client, written, now))
+        {
+            block(client, now);
+            return false;
+        }
+
+        return client.state != Client::State::disconnected && client.next <= written;
+    }
+
+    bool Feed::write_data(Client& client, types::header::SequenceNumber written, Clock::time_point now)
+    {
+        auto frames{0UZ};
+        auto total{0UZ};
+        auto staged{0UZ};
+
+        for (auto seq{client.next}; seq <= written && frames < batch_size; ++seq, ++frames)
+        {
+            if (message_store_.copies() && staging_.size() - staged < sizeof(types::LengthPrefix) + 0xFFFFUZ)
+            {
+                break;
+            }
+
+            const auto position{retransmission_buffer_->file_position_for(seq)};
+            const auto message{position.has_value() ? message_store_.read(*position, std::span(staging_).subspan(staged))
+                                                    : std::span<const char>{}};
+
+            if (message.size() <= sizeof(types::LengthPrefix)) [[unlikely]]
+            {
+                if (frames == 0)
+                {
+                    disconnect(client, "fell behind the retransmission buffer");
+                    return true;
+                }
+                break;
+            }
+
+            if (message_store_.copies())
+            {
+                staged += message.size();
+            }
+
+            const auto body{message.subspan(sizeof(types::LengthPrefix))};
+            auto& header{frame_headers_[frames]};
+            util::binary_io::write_at_be(std::span(header), 0, static_cast<types::soup::Length>(1 + body.size()));
+            header[types::soup::type_offset] = types::soup::sequenced_data_type;
+
+            // resume a frame the socket only took part of
+            const auto skip{frames == 0 ? client.partial : 0UZ};
+            const auto header_skip{std::min(skip, header.size())};
+
+            iov_[2 * frames] = {.iov_base = header.data() + header_skip, .iov_len = header.size() - header_skip};
+            iov_[(2 * frames) + 1] = {.iov_base = const_cast<char*>(body.data()) + (skip - header_skip),
+                                      .iov_len = body.size() - (skip - header_skip)};
+
+            total += iov_[2 * frames].iov_len + iov_[(2 * frames) + 1].iov_len;
+        }
+
+        // positions read above belong to the session if it hasn't rolled since
+        if (frames == 0 || retransmission_buffer_->session_index() != session_index_)
+        {
+            return true;
+        }
+
+        msghdr msg{};
+        msg.msg_iov = iov_.data();
+        msg.msg_iovlen = 2 * frames;
+
+        const auto sent{sendmsg(client.fd.get(), &msg, MSG_NOSIGNAL)};
+
+        if (sent < 0)
+        {
+            if (errno == EAGAIN)
+            {
+                return false;
+            }
+
+            if (errno != EINTR)
+            {
+                disconnect(client, std::strerror(errno));
+            }
+            return true;
+        }
+
+        client.last_sent = now;
+
+        auto remaining{static_cast<std::size_t>(sent)};
+        for (auto i{0UZ}; i < frames; ++i)
+        {
+            const auto frame{iov_[2 * i].iov_len + iov_[(2 * i) + 1].iov_len};
+
+            if (remaining < frame)
+            {
+                client.partial += remaining;
+                break;
+            }
+
+            remaining -= frame;
+            client.partial = 0;
+            ++client.next;
+        }
+
+        return static_cast<std::size_t>(sent) == total;
+    }
+
+    bool Feed::write_control(Client& client)
+    {
+        while (!client.control.empty())
+        {
+            const auto sent{send(client.fd.get(), client.control.data(), client.control.size(), MSG_NOSIGNAL)};
+
+            if (sent < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+
+                if (errno != EAGAIN)
+                {
+                    disconnect(client, std::strerror(errno));
+                    return true;
+                }
+                return false;
+            }
+
+            client.control.erase(0, static_cast<std::size_t>(sent));
+            client.last_sent = Clock::now();
+        }
+
+        return true;
+    }
+
+    void Feed::queue(Client& client, char type, std::span<const char> payload) const
+    {
+        std::array<char, sizeof(types::soup::Length)> length{};
+        util::binary_io::write_at_be(std::span(length), 0, static_cast<types::soup::Length>(1 + payload.size()));
+
+        client.control.append(length.data(), length.size());
+        client.control.push_back(type);
+        client.control.append(payload.data(), payload.size());
+    }
+
+    void Feed::block(Client& client, Clock::time_point now)
+    {
+        if (client.state == Client::State::disconnected)
+        {
+            return;
+        }
+
+        client.blocked_since = now;
+        want_writable(client, true);
+    }
+
+    void Feed::want_writable(Client& client, bool writable)
+    {
+        epoll_event event{.events = EPOLLIN | EPOLLRDHUP | (writable ? EPOLLOUT : 0U), .data = {.ptr = &client}};
+
+        if (epoll_ctl(epoll_fd_.get(), EPOLL_CTL_MOD, client.fd.get(), &event) < 0)
+        {
+            disconnect(client, std::strerror(errno));
+        }
+    }
+
+    void Feed::disconnect(Client& client, std::string_view reason)
+    {
+        if (client.state == Client::State::disconnected)
+        {
+            return;
+        }
+
+        util::log::info("SoupBinTCP feed: client {} disconnected: {}", client.fd.get(), reason);
+
+        // closing removes it from the epoll set
+        client.fd = util::FileDescriptor{};
+        client.state = Client::State::disconnected;
+    }
+
+    void Feed::end_session()
+    {
+        for (auto& client : clients_)
+        {
+            // a half sent frame can't be followed by another packet
+            if (client->state == Client::State::streaming && client->partial == 0)
+            {
+                queue(*client, types::soup::end_of_session_type, {});
+                write_control(*client);
+            }
+
+            disconnect(*client, "end of session");
+        }
+
+        remove_disconnected();
+    }
+
+    void Feed::remove_disconnected()
+    {
+        std::erase_if(clients_, [](const auto& client) { return client->state == Client::State::disconnected; });
+    }
+
+    bool Feed::drained(types::header::SequenceNumber written) const noexcept
+    {
+        return std::ranges::all_of(clients_, [written](const auto& client) {
+            return client->state != Client::State::streaming || (client->next > written && client->control.empty());
+        });
+    }
+
+    void Feed::configure_socket(const Config& cfg)
+    {
+        constexpr auto sockopt_on{1};
+        if (setsockopt(socket_.get(), SOL_SOCKET, SO_REUSEADDR, &sockopt_on, sizeof(sockopt_on)) < 0)
+        {
+            throw std::system_error(errno, std::system_category(), std::source_location::current().function_name());
+        }
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(cfg.port);
+
+        if (inet_pton(AF_INET, cfg.address.c_str(), &addr.sin_addr) != 1)
+        {
+            throw std::invalid_argument(std::format("{}: invalid ip format for SoupBinTCP address {}",
+                                                    std::source_location::current().function_name(),
+                                                    cfg.address.c_str()));
+        }
+
+        if (bind(socket_.get(), reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) < 0 || listen(socket_.get(), SOMAXCONN) < 0)
+        {
+            throw std::system_error(errno, std::system_category(), std::source_location::current().function_name());
+        }
+
+        // listening socket is the only entry without a client
+        epoll_event event{.events = EPOLLIN, .data = {.ptr = nullptr}};
+        if (epoll_ctl(epoll_fd_.get(), EPOLL_CTL_ADD, socket_.get(), &event) < 0)
+        {
+            throw std::system_error(errno, std::system_category(), std::source_location::current().function_name());
+        }
+    }
+}
@@ -0,0 +1,230 @@
+#include "imr/mold/trace.h"
+
+#include "imr/util/file_descriptor.h"
+#include "util/write_all.h"
+
+#include <format>
+#include <optional>
+#include <source_location>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace imr::mold::trace
+{
+    namespace
+    {
+        std::int64_t nanoseconds(clockid_t clock) noexcept
+        {
+            timespec ts{};
+            clock_gettime(clock, &ts);
+            return (std::int64_t{ts.tv_sec} * 1'000'000'000) + ts.tv_nsec;
+        }
+
+        // a private (copy on write) mapping of a ring / dump, checked
+        class Mapping
+        {
+          public:
+            explicit Mapping(const std::filesystem::path& path)
+            {
+                const util::FileDescriptor fd(path, O_RDONLY | O_CLOEXEC);
+
+                struct stat info{};
+                if (fstat(fd.get(), &info) < 0)
+                {
+                    throw std::system_error(errno, std::system_category(), std::source_location::current().function_name());
+                }
+
+                length_ = static_cast<std::size_t>(info.st_size);
+                if (length_ < sizeof(Header))
+                {
+                    throw std::invalid_argument(std::format("{}: {} is not a trace ring",
+                                                            std::source_location::current().function_name(),
+                                                            path.c_str()));
+                }
+
+                mapping_ = mmap(nullptr, length_, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd.get(), 0);
+                if (mapping_ == MAP_FAILED)
+                {
+                    mapping_ = nullptr;
+                    throw std::system_error(errno, std::system_category(), std::source_location::current().function_name());
+                }
+
+                if (header().magic != magic || header().capacity == 0 ||
+                    (header().capacity & (header().capacity - 1)) != 0 ||
+                    sizeof(Header) + (header().capacity * sizeof(Entry)) > length_)
+                {
+                    munmap(mapping_, length_);
+                    throw std::invalid_argument(std::format("{}: {} is not a trace ring",
+                                                            std::source_location::current().function_name(),
+                                                            path.c_str()));
+                }
+            }
+
+            ~Mapping()
+            {
+                munmap(mapping_, length_);
+            }
+
+            Mapping(const Mapping&) = delete;
+            Mapping& operator=(const Mapping&) = delete;
+
+            Mapping(Mapping&&) = delete;
+            Mapping& operator=(Mapping&&) = delete;
+
+            [[nodiscard]]
+            Header& header() const noexcept
+            {
+                return *static_cast<Header*>(mapping_);
+            }
+
+            [[nodiscard]]
+            std::span<const Entry> entries() const noexcept
+            {
+                return {reinterpret_cast<const Entry*>(static_cast<const std::byte*>(mapping_) + sizeof(Header)), header().capacity};
+            }
+
+            [[nodiscard]]
+            std::span<const char> bytes() const noexcept
+            {
+                return {static_cast<const char*>(mapping_), sizeof(Header) + (header().capacity * sizeof(Entry))};
+            }
+
+          private:
+            std::size_t length_{0};
+            void* mapping_{nullptr};
+        };
+
+        // no dump since the ring was created: it's read live, on the host it's written on
+        void calibrate_if_live(Header& header) noexcept
+        {
+            if (header.latest.tsc == header.origin.tsc)
+            {
+                header.latest = calibrate();
+            }
+        }
+
+        // TSC to CLOCK_REALTIME nanoseconds per the header's calibration
+        std::optional<std::int64_t> realtime(const Trace& trace, std::uint64_t tsc) noexcept
+        {
+            const auto ticks{static_cast<double>(trace.latest.tsc - trace.origin.tsc)};
+            if (ticks <= 0.0)
+            {
+                return std::nullopt;
+            }
+
+            const auto ns_per_tick{static_cast<double>(trace.latest.steady_ns - trace.origin.steady_ns) / ticks};
+            const auto since_origin{static_cast<double>(static_cast<std::int64_t>(tsc - trace.origin.tsc)) * ns_per_tick};
+
+            return trace.origin.realtime_ns + static_cast<std::int64_t>(since_origin);
+        }
+
+        constexpr std::string_view result_name(Result result) noexcept
+        {
+            switch (result)
+            {
+            case Result::sent:
+                return "sent";
+            case Result::send_error:
+                return "send_error";
+            case Result::captured:
+                return "captured";
+            }
+            return "unknown";
+        }
+    }
+
+    Calibration calibrate() noexcept
+    {
+        return {.tsc = tsc(), .steady_ns = nanoseconds(CLOCK_MONOTONIC), .realtime_ns = nanoseconds(CLOCK_REALTIME)};
+    }
+
+    Trace read(const std::filesystem::path& path)
+    {
+        const Mapping mapping(path);
+        auto& header{mapping.header()};
+        calibrate_if_live(header);
+
+        Trace trace{.origin = header.origin, .latest = header.latest, .records = {}};
+
+        const auto capacity{header.capacity};
+        const auto written{header.write_index.load(std::memory_order_acquire)};
+        const auto oldest{written > capacity ? written - capacity : 0};
+        const auto entries{mapping.entries()};
+
+        trace.records.reserve(written - oldest);
+        for (auto n{oldest}; n < written; ++n)
+        {
+            const auto& entry{entries[n & (capacity - 1)]};
+
+            const auto version{entry.version.load(std::memory_order_acquire)};
+            if (version != (2 * n) + 2)
+            {
+                continue;
+            }
+
+            const Record record{.sequence_number = entry.sequence_number,
+                                .message_count = entry.message_count,
+                                .file_position = entry.file_position,
+                                .itch_timestamp = std::chrono::nanoseconds(entry.itch_timestamp),
+                                .due = entry.due,
+                                .send_tsc = entry.send_tsc,
+                                .batch = entry.batch,
+                                .result = entry.result};
+
+            // overwritten while copied
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (entry.version.load(std::memory_order_relaxed) != version)
+            {
+                continue;
+            }
+
+            trace.records.push_back(record);
+        }
+
+        return trace;
+    }
+
+    void dump(const std::filesystem::path& from, const std::filesystem::path& to)
+    {
+        const Mapping mapping(from);
+        calibrate_if_live(mapping.header());
+
+        const util::FileDescriptor fd([&to] { return open(to.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644); });
+        if (!util::write_all(fd.get(), mapping.bytes()))
+        {
+            throw std::system_error(errno, std::system_category(), std::format("{}: {}", std::source_location::current().function_name(), to.c_str()));
+        }
+    }
+
+    void write_csv(const Trace& trace, std::ostream& out)
+    {
+        const auto steady_to_realtime{trace.origin.realtime_ns - trace.origin.steady_ns};
+
+        out << "sequence_number,message_count,file_position,itch_timestamp_ns,due_ns,sent_ns,late_ns,send_tsc,batch,result\n";
+
+        for (const auto& record : trace.records)
+        {
+            const auto sent{realtime(trace, record.send_tsc)};
+            const auto due{record.due != 0 ? std::optional(record.due + steady_to_realtime) : std::nullopt};
+
+            out << std::format("{},{},{},{},{},{},{},{},{},{}\n",
+                               record.sequence_number,
+                               record.message_count,
+                               record.file_position,
+                               record.itch_timestamp.count(),
+                               due.has_value() ? std::to_string(*due) : std::string{},
+                               sent.has_value() ? std::to_string(*sent) : std::string{},
+                               due.has_value() && sent.has_value() ? std::to_string(*sent - *due) : std::string{},
+                               record.send_tsc,
+                               record.batch,
+                               result_name(record.result));
+        }
+    }
+}
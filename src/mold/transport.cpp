@@ -0,0 +1,99 @@
+#include "imr/mold/transport.h"
+
+#include "imr/util/log.h"
+
+#include <cerrno>
+
+namespace imr::mold::transport
+{
+    bool Udp::send(std::span<mmsghdr> batch) noexcept
+    {
+        for (auto sent{0UZ}; sent < batch.size();)
+        {
+            const auto ret{sendmmsg(socket_, batch.data() + sent, static_cast<unsigned>(batch.size() - sent), 0)};
+
+            if (ret < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+
+                util::log::perror();
+                errors_.increment_shared();
+                return false;
+            }
+
+            sent += static_cast<std::size_t>(ret);
+        }
+
+        return true;
+    }
+
+    util::metrics::Counter& Udp::errors() noexcept
+    {
+        return errors_;
+    }
+
+    bool Memory::send(std::span<mmsghdr> batch) noexcept
+    {
+        const auto time{now_.load(std::memory_order_relaxed)()};
+        const std::scoped_lock lock(mutex_);
+
+        for (const auto& message : batch)
+        {
+            Packet packet{.time = time, .destination = {}, .bytes = {}};
+            if (message.msg_hdr.msg_name != nullptr)
+            {
+                packet.destination = *static_cast<const sockaddr_in*>(message.msg_hdr.msg_name);
+            }
+
+            for (const auto& iov : std::span(message.msg_hdr.msg_iov, message.msg_hdr.msg_iovlen))
+            {
+                const auto* data{static_cast<const char*>(iov.iov_base)};
+                packet.bytes.insert(packet.bytes.end(), data, data + iov.iov_len);
+            }
+
+            packets_.push_back(std::move(packet));
+        }
+
+        return true;
+    }
+
+    void Memory::set_clock(Now now) noexcept
+    {
+        now_.store(now, std::memory_order_relaxed);
+    }
+
+    std::vector<Memory::Packet> Memory::packets() const
+    {
+        const std::scoped_lock lock(mutex_);
+        return packets_;
+    }
+
+    bool Null::send(std::span<mmsghdr> batch) noexcept
+    {
+        auto bytes{0UZ};
+        for (const auto& message : batch)
+        {
+            for (const auto& iov : std::span(message.msg_hdr.msg_iov, message.msg_hdr.msg_iovlen))
+            {
+                bytes += iov.iov_len;
+            }
+        }
+
+        packets_.fetch_add(batch.size(), std::memory_order_relaxed);
+        bytes_.fetch_add(bytes, std::memory_order_relaxed);
+        return true;
+    }
+
+    std::uint64_t Null::packets() const noexcept
+    {
+        return packets_.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t Null::bytes() const noexcept
+    {
+        return bytes_.load(std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// https://www.ietf.org/archive/id/draft-ietf-opsawg-pcap-04.html
+// https://www.ietf.org/archive/id/draft-ietf-opsawg-pcapng-01.html
+namespace pcap
+{
+    inline constexpr std::uint32_t magic_microseconds{0xA1B2C3D4};
+    inline constexpr std::uint32_t magic_nanoseconds{0xA1B23C4D};
+
+    inline constexpr std::size_t file_header_length{24};
+    inline constexpr std::size_t file_header_link_type_offset{20};
+
+    inline constexpr std::size_t record_header_length{16};
+    inline constexpr std::size_t record_ts_sec_offset{0};
+    inline constexpr std::size_t record_ts_frac_offset{4};
+    inline constexpr std::size_t record_captured_length_offset{8};
+    inline constexpr std::size_t record_original_length_offset{12};
+
+    namespace ng
+    {
+        inline constexpr std::uint32_t section_header_block{0x0A0D0D0A};
+        inline constexpr std::uint32_t interface_description_block{1};
+        inline constexpr std::uint32_t simple_packet_block{3};
+        inline constexpr std::uint32_t enhanced_packet_block{6};
+        inline constexpr std::uint32_t byte_order_magic{0x1A2B3C4D};
+
+        // type + total length ... total length
+        inline constexpr std::size_t block_overhead{12};
+        inline constexpr std::size_t block_body_offset{8};
+
+        inline constexpr std::uint16_t option_end{0};
+        inline constexpr std::uint16_t option_if_tsresol{9};
+    }
+
+    inline constexpr std::uint16_t link_type_ethernet{1};
+    inline constexpr std::uint16_t link_type_raw{101};
+    inline constexpr std::uint16_t link_type_linux_sll{113};
+    inline constexpr std::uint16_t link_type_ipv4{228};
+
+    inline constexpr std::size_t ethernet_header_length{14};
+    inline constexpr std::size_t ethernet_type_offset{12};
+    inline constexpr std::size_t vlan_tag_length{4};
+    inline constexpr std::size_t linux_sll_header_length{16};
+    inline constexpr std::size_t linux_sll_protocol_offset{14};
+
+    inline constexpr std::uint16_t ether_type_ipv4{0x0800};
+    inline constexpr std::uint16_t ether_type_vlan{0x8100};
+    inline constexpr std::uint16_t ether_type_qinq{0x88A8};
+
+    inline constexpr std::size_t ipv4_min_header_length{20};
+    inline constexpr std::size_t ipv4_total_length_offset{2};
+    inline constexpr std::size_t ipv4_fragment_offset{6};
+    inline constexpr std::size_t ipv4_ttl_offset{8};
+    inline constexpr std::size_t ipv4_protocol_offset{9};
+    inline constexpr std::size_t ipv4_checksum_offset{10};
+    inline constexpr std::size_t ipv4_source_offset{12};
+    inline constexpr std::size_t ipv4_destination_offset{16};
+    inline constexpr std::uint8_t ipv4_protocol_udp{17};
+    // more fragments flag | fragment offset
+    inline constexpr std::uint16_t ipv4_fragment_mask{0x3FFF};
+
+    inline constexpr std::size_t udp_header_length{8};
+    inline constexpr std::size_t udp_source_port_offset{0};
+    inline constexpr std::size_t udp_destination_port_offset{2};
+    inline constexpr std::size_t udp_length_offset{4};
+}
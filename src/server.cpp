@@ -1,51 +1,447 @@
 #include "imr/server.h"
 #include "imr/mold/retransmission_buffer.h"
+#include "imr/mold/downstream/file_source.h"
+#include "imr/util/log.h"
+
+#include <algorithm>
+#include <cstring>
+#include <format>
+#include <source_location>
+#include <stdexcept>
+#include <utility>
+
+#include <pthread.h>
+#include <sched.h>
+
+namespace
+{
+    std::vector<imr::util::MemoryMappedFile> map_itch_files(const imr::Server::Config& cfg)
+    {
+        if (cfg.stream_input_cfg.has_value() && cfg.pcap_input_cfg.has_value())
+        {
+            throw std::invalid_argument(std::format("{}: stream_input_cfg and pcap_input_cfg are mutually exclusive",
+                                                    std::source_location::current().function_name()));
+        }
+
+        if (!cfg.merge_itch_file_cfgs.empty() && (cfg.stream_input_cfg.has_value() || cfg.pcap_input_cfg.has_value()))
+        {
+            throw std::invalid_argument(std::format("{}: merge_itch_file_cfgs requires plain ITCH file input",
+                                                    std::source_location::current().function_name()));
+        }
+
+        if (cfg.playlist_cfg.has_value() &&
+            (cfg.stream_input_cfg.has_value() || cfg.pcap_input_cfg.has_value() || !cfg.merge_itch_file_cfgs.empty()))
+        {
+            throw std::invalid_argument(std::format("{}: playlist_cfg requires plain ITCH file input without merge_itch_file_cfgs",
+                                                    std::source_location::current().function_name()));
+        }
+
+        if (!cfg.channel_cfgs.empty() &&
+            (cfg.stream_input_cfg.has_value() || cfg.pcap_input_cfg.has_value() || !cfg.merge_itch_file_cfgs.empty() ||
+             cfg.playlist_cfg.has_value() || cfg.filter_cfg.has_value()))
+        {
+            throw std::invalid_argument(std::format("{}: channel_cfgs requires a single plain ITCH file input",
+                                                    std::source_location::current().function_name()));
+        }
+
+        if (cfg.filter_cfg.has_value() &&
+            (cfg.stream_input_cfg.has_value() || cfg.pcap_input_cfg.has_value() || !cfg.merge_itch_file_cfgs.empty() ||
+             cfg.playlist_cfg.has_value()))
+        {
+            throw std::invalid_argument(std::format("{}: filter_cfg requires a single plain ITCH file input",
+                                                    std::source_location::current().function_name()));
+        }
+
+        // the retransmission feeds route a request by session, the first channel would answer for the others
+        for (auto i{0UZ}; i < cfg.channel_cfgs.size(); ++i)
+        {
+            for (auto j{0UZ}; j < i; ++j)
+            {
+                const auto& channel{cfg.channel_cfgs[i]};
+                const auto& other{cfg.channel_cfgs[j]};
+
+                if (channel.session == other.session)
+                {
+                    throw std::invalid_argument(std::format("{}: channels {} and {} have the same session {}",
+                                                            std::source_location::current().function_name(),
+                                                            j,
+                                                            i,
+                                                            channel.session));
+                }
+
+                const auto& downstream{channel.downstream_feed_config};
+                const auto& other_downstream{other.downstream_feed_config};
+
+                if (downstream.mcast_group.sv() == other_downstream.mcast_group.sv() && downstream.port == other_downstream.port)
+                {
+                    throw std::invalid_argument(std::format("{}: channels {} and {} both send to {}:{}",
+                                                            std::source_location::current().function_name(),
+                                                            j,
+                                                            i,
+                                                            downstream.mcast_group.c_str(),
+                                                            downstream.port));
+                }
+            }
+        }
+
+        if (cfg.snapshot_cfg.has_value() && !cfg.channel_cfgs.empty())
+        {
+            throw std::invalid_argument(std::format("{}: snapshot_cfg is not supported with channel_cfgs",
+                                                    std::source_location::current().function_name()));
+        }
+
+        if (cfg.soup_cfg.has_value() && !cfg.channel_cfgs.empty())
+        {
+            throw std::invalid_argument(std::format("{}: soup_cfg is not supported with channel_cfgs",
+                                                    std::source_location::current().function_name()));
+        }
+
+        std::vector<imr::util::MemoryMappedFile> mapped_itch_files;
+
+        if (cfg.stream_input_cfg.has_value())
+        {
+            return mapped_itch_files;
+        }
+
+        const auto& more_file_cfgs{cfg.playlist_cfg.has_value() ? cfg.playlist_itch_file_cfgs : cfg.merge_itch_file_cfgs};
+
+        mapped_itch_files.reserve(1 + more_file_cfgs.size());
+        mapped_itch_files.emplace_back(cfg.mapped_itch_file_cfg);
+
+        for (const auto& file_cfg : more_file_cfgs)
+        {
+            mapped_itch_files.emplace_back(file_cfg);
+        }
+
+        return mapped_itch_files;
+    }
+
+    void log_distribution(std::string_view name, const imr::util::Histogram::Snapshot& snapshot)
+    {
+        imr::util::log::info("{}: {} samples, min {}ns p50 {}ns p90 {}ns p99 {}ns p99.9 {}ns p99.99 {}ns max {}ns",
+                             name,
+                             snapshot.count(),
+                             snapshot.min(),
+                             snapshot.percentile(50.0),
+                             snapshot.percentile(90.0),
+                             snapshot.percentile(99.0),
+                             snapshot.percentile(99.9),
+                             snapshot.percentile(99.99),
+                             snapshot.max());
+    }
+
+    std::unique_ptr<imr::mold::downstream::Source> make_source(const imr::Server::Config& cfg,
+                                                               const std::vector<imr::util::MemoryMappedFile>& mapped_itch_files)
+    {
+        using namespace imr::mold::downstream;
+
+        if (mapped_itch_files.empty())
+        {
+            return std::make_unique<StreamSource>(*cfg.stream_input_cfg);
+        }
+
+        if (cfg.pcap_input_cfg.has_value())
+        {
+            return std::make_unique<PcapSource>(mapped_itch_files.front().as_span(), *cfg.pcap_input_cfg);
+        }
+
+        if (cfg.filter_cfg.has_value())
+        {
+            return std::make_unique<FilterSource>(mapped_itch_files.front().as_span(), *cfg.filter_cfg);
+        }
+
+        if (mapped_itch_files.size() > 1 || cfg.playlist_cfg.has_value())
+        {
+            std::vector<std::span<const char>> files;
+            files.reserve(mapped_itch_files.size());
+
+            for (const auto& mapped_itch_file : mapped_itch_files)
+            {
+                files.push_back(mapped_itch_file.as_span());
+            }
+
+            if (cfg.playlist_cfg.has_value())
+            {
+                return std::make_unique<PlaylistSource>(std::move(files), *cfg.playlist_cfg);
+            }
+
+            return std::make_unique<MergeSource>(std::move(files));
+        }
+
+        return std::make_unique<FileSource>(mapped_itch_files.front().as_span());
+    }
+}
 
 namespace imr
 {
+    struct Server::Channel
+    {
+        Channel(const mold::downstream::Feed::Config& feed_cfg,
+                const mold::PacketBuilder::Config& packet_builder_cfg,
+                std::unique_ptr<mold::downstream::Source> channel_source,
+                std::size_t retransmission_buffer_size,
+                std::optional<unsigned> channel_cpu)
+            : source{std::move(channel_source)},
+              retransmission_buffer(retransmission_buffer_size),
+              downstream_feed(feed_cfg, packet_builder_cfg, *source, retransmission_buffer),
+              session{packet_builder_cfg.session},
+              cpu{channel_cpu}
+        {
+        }
+
+        std::unique_ptr<mold::downstream::Source> source;
+        mold::RetransmissionBuffer retransmission_buffer;
+        mold::downstream::Feed downstream_feed;
+        // validated by downstream_feed's PacketBuilder
+        std::string_view session;
+        std::optional<unsigned> cpu;
+        std::jthread thread;
+    };
+
     Server::Server(const Config& cfg)
-        : mapped_itch_file_(cfg.mapped_itch_file_cfg),
-          retransmission_buffer_(cfg.retransmission_buffer_size),
-          downstream_feed_(cfg.downstream_feed_config,
-                           cfg.packet_builder_cfg,
-                           mapped_itch_file_.as_span(),
-                           retransmission_buffer_),
+        : metrics_{make_metrics(cfg)},
+          mapped_itch_files_(map_itch_files(cfg)),
+          channels_(make_channels(cfg, mapped_itch_files_)),
           retransmission_feeds_(cfg.num_retransmission_feeds,
                                 cfg.retransmission_feed_config,
                                 cfg.packet_builder_cfg,
-                                mapped_itch_file_.as_span(),
-                                retransmission_buffer_)
-    {}
+                                retransmission_channels(),
+                                metrics_.get()),
+          snapshot_service_{make_snapshot_service(cfg)},
+          soup_feed_{make_soup_feed(cfg)}
+    {
+        if (metrics_ == nullptr)
+        {
+            return;
+        }
+
+        for (auto i{0UZ}; i < channels_.size(); ++i)
+        {
+            channels_[i]->downstream_feed.attach_metrics(*metrics_, std::format("channel=\"{}\"", i));
+        }
+
+        if (cfg.metrics_endpoint_cfg.has_value())
+        {
+            metrics_endpoint_ = std::make_unique<util::metrics::Endpoint>(*cfg.metrics_endpoint_cfg, *metrics_);
+        }
+    }
+
+    std::unique_ptr<util::metrics::Registry> Server::make_metrics(const Config& cfg)
+    {
+        if (cfg.metrics_endpoint_cfg.has_value() && !cfg.metrics_cfg.has_value())
+        {
+            throw std::invalid_argument(std::format("{}: metrics_endpoint_cfg requires metrics_cfg",
+                                                    std::source_location::current().function_name()));
+        }
+
+        if (!cfg.metrics_cfg.has_value())
+        {
+            return nullptr;
+        }
+
+        return std::make_unique<util::metrics::Registry>(*cfg.metrics_cfg);
+    }
+
+    std::unique_ptr<mold::snapshot::Service> Server::make_snapshot_service(const Config& cfg) const
+    {
+        if (!cfg.snapshot_cfg.has_value())
+        {
+            return nullptr;
+        }
+
+        const auto& channel{*channels_.front()};
+        return std::make_unique<mold::snapshot::Service>(*cfg.snapshot_cfg,
+                                                         channel.source->message_store(),
+                                                         channel.retransmission_buffer);
+    }
+
+    std::unique_ptr<mold::soup::Feed> Server::make_soup_feed(const Config& cfg) const
+    {
+        if (!cfg.soup_cfg.has_value())
+        {
+            return nullptr;
+        }
+
+        const auto& channel{*channels_.front()};
+        return std::make_unique<mold::soup::Feed>(*cfg.soup_cfg,
+                                                  channel.session,
+                                                  channel.source->message_store(),
+                                                  channel.retransmission_buffer);
+    }
+
+    std::vector<std::unique_ptr<Server::Channel>> Server::make_channels(const Config& cfg,
+                                                                        const std::vector<util::MemoryMappedFile>& mapped_itch_files)
+    {
+        std::vector<std::unique_ptr<Channel>> channels;
+
+        if (cfg.channel_cfgs.empty())
+        {
+            channels.push_back(std::make_unique<Channel>(cfg.downstream_feed_config,
+                                                         cfg.packet_builder_cfg,
+                                                         make_source(cfg, mapped_itch_files),
+                                                         cfg.retransmission_buffer_size,
+                                                         std::nullopt));
+            return channels;
+        }
+
+        const auto file{mapped_itch_files.front().as_span()};
+        const mold::downstream::ShardMap shard_map(cfg.shard_map_cfg, cfg.channel_cfgs.size(), file);
+
+        channels.reserve(cfg.channel_cfgs.size());
+        for (auto i{0UZ}; i < cfg.channel_cfgs.size(); ++i)
+        {
+            const auto& channel_cfg{cfg.channel_cfgs[i]};
+
+            auto packet_builder_cfg{cfg.packet_builder_cfg};
+            packet_builder_cfg.session = channel_cfg.session;
+
+            mold::downstream::FilterSource::Config filter_cfg{};
+            filter_cfg.locates = shard_map.locates_for(i);
+
+            // a channel left without stocks (table mapping) still gets the market wide messages, and only those
+            if (filter_cfg.locates.empty())
+            {
+                filter_cfg.locates.push_back(0);
+            }
+
+            channels.push_back(std::make_unique<Channel>(channel_cfg.downstream_feed_config,
+                                                         packet_builder_cfg,
+                                                         std::make_unique<mold::downstream::FilterSource>(file, filter_cfg),
+                                                         cfg.retransmission_buffer_size,
+                                                         channel_cfg.cpu));
+        }
+
+        return channels;
+    }
+
+    std::vector<mold::retransmission::Feed::Channel> Server::retransmission_channels() const
+    {
+        std::vector<mold::retransmission::Feed::Channel> channels;
+        channels.reserve(channels_.size());
+
+        for (const auto& channel : channels_)
+        {
+            mold::retransmission::Feed::Channel retransmission_channel{
+                .session = {},
+                .message_store = channel->source->message_store(),
+                .retransmission_buffer = &channel->retransmission_buffer,
+            };
+            std::ranges::copy(channel->session, retransmission_channel.session.begin());
+
+            channels.push_back(retransmission_channel);
+        }
+
+        return channels;
+    }
 
     void Server::start()
     {
-        downstream_thread_ = std::jthread([this](std::stop_token st) {
-            // downstream blocks till finished
-            downstream_feed_.start(st);
-            retransmission_feeds_.stop();
-        });
+        running_channels_.store(channels_.size(), std::memory_order_relaxed);
+
+        if (metrics_endpoint_ != nullptr)
+        {
+            metrics_thread_ = std::jthread([this](std::stop_token st) { metrics_endpoint_->start(st); });
+        }
+
+        if (snapshot_service_ != nullptr)
+        {
+            snapshot_thread_ = std::jthread([this](std::stop_token st) { snapshot_service_->start(st); });
+        }
+
+        if (soup_feed_ != nullptr)
+        {
+            soup_thread_ = std::jthread([this](std::stop_token st) { soup_feed_->start(st); });
+        }
+
+        for (auto& channel : channels_)
+        {
+            channel->downstream_feed.count_hot_path(downstream_hot_path_threads_);
+
+            channel->thread = std::jthread([this, &channel = *channel](std::stop_token st) {
+                if (channel.cpu.has_value())
+                {
+                    cpu_set_t cpus;
+                    CPU_ZERO(&cpus);
+                    CPU_SET(*channel.cpu, &cpus);
+
+                    if (const auto err{pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus)}; err != 0)
+                    {
+                        util::log::error("{}: pinning to cpu {} failed: {}",
+                                         std::source_location::current().function_name(),
+                                         *channel.cpu,
+                                         std::strerror(err));
+                    }
+                }
+
+                // downstream blocks till finished
+                channel.downstream_feed.start(st);
+
+                if (running_channels_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                {
+                    log_distribution("Downstream lateness", downstream_lateness());
+                    log_distribution("Retransmission service time", retransmission_service_time());
+
+                    retransmission_feeds_.stop();
+                    snapshot_thread_.request_stop();
+                    // drains clients then ends their session
+                    soup_thread_.request_stop();
+                }
+            });
+        }
     }
 
     void Server::wait_for_downstream()
     {
-        if (downstream_thread_.joinable())
+        for (auto& channel : channels_)
         {
-            downstream_thread_.join();
+            if (channel->thread.joinable())
+            {
+                channel->thread.join();
+            }
         }
     }
 
     void Server::stop()
     {
-        downstream_thread_.request_stop();
+        for (auto& channel : channels_)
+        {
+            channel->thread.request_stop();
+        }
+
+        snapshot_thread_.request_stop();
+        soup_thread_.request_stop();
+        metrics_thread_.request_stop();
+    }
+
+    const util::metrics::Registry* Server::metrics() const noexcept
+    {
+        return metrics_.get();
     }
 
-    Server::~Server()
+    util::Histogram::Snapshot Server::downstream_lateness() const
     {
-        downstream_thread_.request_stop();
-        if (downstream_thread_.joinable())
+        util::Histogram::Snapshot snapshot;
+        for (const auto& channel : channels_)
         {
-            downstream_thread_.join();
+            snapshot.add(channel->downstream_feed.lateness());
         }
+        return snapshot;
+    }
+
+    util::Histogram::Snapshot Server::retransmission_service_time() const
+    {
+        return retransmission_feeds_.service_time();
+    }
+
+    std::size_t Server::hot_path_threads() const noexcept
+    {
+        return downstream_hot_path_threads_.load(std::memory_order_acquire) + retransmission_feeds_.hot_path_threads();
+    }
+
+    Server::~Server()
+    {
+        stop();
+        wait_for_downstream();
         retransmission_feeds_.stop();
     }
 
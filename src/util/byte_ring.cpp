@@ -0,0 +1,124 @@
+#include "imr/util/byte_ring.h"
+#include "imr/util/file_descriptor.h"
+#include "imr/util/log.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstring>
+#include <format>
+#include <source_location>
+#include <stdexcept>
+#include <system_error>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace imr::util
+{
+    ByteRing::ByteRing(std::size_t capacity)
+        : capacity_{std::bit_ceil(std::max(capacity, static_cast<std::size_t>(sysconf(_SC_PAGESIZE))))},
+          mask_{capacity_ - 1}
+    {
+        if (capacity == 0)
+        {
+            throw std::invalid_argument(std::format("{}: capacity must be > 0",
+                                                    std::source_location::current().function_name()));
+        }
+
+        const FileDescriptor memfd{[] { return memfd_create("imr-byte-ring", MFD_CLOEXEC); }};
+
+        if (ftruncate(memfd.get(), static_cast<off_t>(capacity_)) < 0)
+        {
+            throw std::system_error(errno, std::system_category(), std::source_location::current().function_name());
+        }
+
+        // reserve 2x capacity of address space then map the same pages into both halves
+        void* reserved{mmap(nullptr, 2 * capacity_, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)};
+        if (reserved == MAP_FAILED)
+        {
+            throw std::system_error(errno, std::system_category(), std::source_location::current().function_name());
+        }
+
+        data_ = static_cast<char*>(reserved);
+
+        for (auto* half : {data_, data_ + capacity_})
+        {
+            if (mmap(half, capacity_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, memfd.get(), 0) == MAP_FAILED)
+            {
+                const auto err{errno};
+                munmap(data_, 2 * capacity_);
+                throw std::system_error(err, std::system_category(), std::source_location::current().function_name());
+            }
+        }
+
+        util::log::debug();
+    }
+
+    ByteRing::~ByteRing()
+    {
+        if (data_ != nullptr)
+        {
+            munmap(data_, 2 * capacity_);
+        }
+    }
+
+    std::size_t ByteRing::capacity() const noexcept
+    {
+        return capacity_;
+    }
+
+    std::size_t ByteRing::head() const noexcept
+    {
+        return head_.load(std::memory_order_acquire);
+    }
+
+    std::size_t ByteRing::tail() const noexcept
+    {
+        return tail_.load(std::memory_order_acquire);
+    }
+
+    std::span<const char> ByteRing::view(std::size_t offset, std::size_t length) const noexcept
+    {
+        assert(length <= capacity_);
+        return {data_ + (offset & mask_), length};
+    }
+
+    std::span<char> ByteRing::prepare(std::size_t length) noexcept
+    {
+        assert(length <= capacity_);
+
+        const auto head{head_.load(std::memory_order_relaxed)};
+
+        if (const auto end{head + length}; end > capacity_ && end - capacity_ > tail_.load(std::memory_order_relaxed))
+        {
+            // publish the invalidation before any byte of the old range is touched
+            tail_.store(end - capacity_, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+        }
+
+        return {data_ + (head & mask_), length};
+    }
+
+    void ByteRing::commit(std::size_t length) noexcept
+    {
+        head_.store(head_.load(std::memory_order_relaxed) + length, std::memory_order_release);
+    }
+
+    bool ByteRing::copy_to(std::size_t offset, std::span<char> dst) const noexcept
+    {
+        if (dst.size() > capacity_ ||
+            offset + dst.size() > head_.load(std::memory_order_acquire) ||
+            offset < tail_.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+
+        std::memcpy(dst.data(), data_ + (offset & mask_), dst.size());
+
+        // if the writer started overwriting this range while we copied, its tail_ store is now visible
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        return offset >= tail_.load(std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,71 @@
+#include "imr/util/histogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace imr::util
+{
+    Histogram::Snapshot::Snapshot()
+        : counts_(bucket_count)
+    {}
+
+    void Histogram::Snapshot::add(const Histogram& histogram)
+    {
+        for (auto i{0UZ}; i < bucket_count; ++i)
+        {
+            const auto count{histogram.counts_[i].load(std::memory_order_relaxed)};
+            counts_[i] += count;
+            count_ += count;
+        }
+
+        sum_ += histogram.sum_.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t Histogram::Snapshot::count() const noexcept
+    {
+        return count_;
+    }
+
+    std::uint64_t Histogram::Snapshot::min() const noexcept
+    {
+        const auto first{std::ranges::find_if(counts_, [](auto count) { return count != 0; })};
+        return first == counts_.end() ? 0 : lowest_equivalent(static_cast<std::size_t>(first - counts_.begin()));
+    }
+
+    std::uint64_t Histogram::Snapshot::max() const noexcept
+    {
+        const auto last{std::ranges::find_if(counts_.rbegin(), counts_.rend(), [](auto count) { return count != 0; })};
+        return last == counts_.rend() ? 0 : highest_equivalent(static_cast<std::size_t>(counts_.rend() - last) - 1);
+    }
+
+    double Histogram::Snapshot::mean() const noexcept
+    {
+        return count_ == 0 ? 0.0 : static_cast<double>(sum_) / static_cast<double>(count_);
+    }
+
+    std::uint64_t Histogram::Snapshot::percentile(double percentile) const noexcept
+    {
+        if (count_ == 0)
+        {
+            return 0;
+        }
+
+        // rank of the value wanted, 1 based
+        const auto rank{std::max<std::uint64_t>(
+            1,
+            static_cast<std::uint64_t>(std::ceil(std::clamp(percentile, 0.0, 100.0) / 100.0 * static_cast<double>(count_))))};
+
+        auto seen{0ULL};
+        for (auto i{0UZ}; i < bucket_count; ++i)
+        {
+            seen += counts_[i];
+            if (seen >= rank)
+            {
+                return highest_equivalent(i);
+            }
+        }
+
+        // counts added while summing, can't happen on a snapshot
+        return max();
+    }
+}
@@ -0,0 +1,77 @@
+#include "imr/util/hot_path.h"
+
+namespace imr::util::hot_path
+{
+    namespace
+    {
+        // function pointers, set before any feed thread starts and read without allocating
+        std::atomic<void (*)(Kind) noexcept> entered_hook{nullptr};
+        std::atomic<void (*)(Kind) noexcept> exited_hook{nullptr};
+
+        thread_local Kind current_kind{Kind::none};
+    }
+
+    void set_hooks(Hooks hooks) noexcept
+    {
+        entered_hook.store(hooks.entered, std::memory_order_release);
+        exited_hook.store(hooks.exited, std::memory_order_release);
+    }
+
+    Kind current() noexcept
+    {
+        return current_kind;
+    }
+
+    Scope::Scope(Kind kind, std::atomic<std::size_t>* threads) noexcept
+        : kind_{kind},
+          threads_{threads}
+    {
+        enter();
+    }
+
+    Scope::~Scope()
+    {
+        exit();
+    }
+
+    void Scope::enter() noexcept
+    {
+        current_kind = kind_;
+
+        if (threads_ != nullptr)
+        {
+            threads_->fetch_add(1, std::memory_order_release);
+        }
+
+        if (const auto hook{entered_hook.load(std::memory_order_acquire)}; hook != nullptr)
+        {
+            hook(kind_);
+        }
+    }
+
+    void Scope::exit() noexcept
+    {
+        if (const auto hook{exited_hook.load(std::memory_order_acquire)}; hook != nullptr)
+        {
+            hook(kind_);
+        }
+
+        if (threads_ != nullptr)
+        {
+            threads_->fetch_sub(1, std::memory_order_release);
+        }
+
+        current_kind = Kind::none;
+    }
+
+    Pause::Pause(Scope& scope) noexcept
+        : scope_{&scope}
+    {
+        scope_->exit();
+    }
+
+    Pause::~Pause()
+    {
+        scope_->enter();
+    }
+}
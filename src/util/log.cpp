@@ -0,0 +1,276 @@
+#include "imr/util/log.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+namespace imr::util::log
+{
+    namespace
+    {
+        using namespace detail;
+
+        struct Stream
+        {
+            std::FILE* file;
+            std::string_view tag;
+            std::string_view color;
+        };
+
+        // formats and writes what the threads' rings hold, ordered by timestamp
+        class Backend
+        {
+          public:
+            Backend()
+                : thread_([this](std::stop_token st) { run(st); })
+            {
+            }
+
+            ~Backend()
+            {
+                thread_.request_stop();
+                wake_.notify_all();
+                thread_.join();
+            }
+
+            Backend(const Backend&) = delete;
+            Backend& operator=(const Backend&) = delete;
+
+            Backend(Backend&&) = delete;
+            Backend& operator=(Backend&&) = delete;
+
+            Ring* acquire()
+            {
+                const std::scoped_lock lock(mutex_);
+
+                // a ring of a thread gone, once the background thread emptied it
+                for (auto& slot : rings_)
+                {
+                    if (!slot.in_use && slot.ring->front() == nullptr)
+                    {
+                        slot.in_use = true;
+                        return slot.ring.get();
+                    }
+                }
+
+                rings_.push_back({.ring = std::make_unique<Ring>(), .in_use = true, .dropped = 0});
+                return rings_.back().ring.get();
+            }
+
+            void release(Ring* ring) noexcept
+            {
+                const std::scoped_lock lock(mutex_);
+
+                const auto slot{std::ranges::find(rings_, ring, [](const Slot& s) { return s.ring.get(); })};
+                if (slot != rings_.end())
+                {
+                    slot->in_use = false;
+                }
+            }
+
+            void flush()
+            {
+                std::unique_lock lock(mutex_);
+
+                const auto requested{++flush_requested_};
+                wake_.notify_all();
+                flushed_.wait(lock, [this, requested] { return flush_done_ >= requested; });
+            }
+
+          private:
+            struct Slot
+            {
+                std::unique_ptr<Ring> ring;
+                bool in_use;
+                // drops reported so far
+                std::uint64_t dropped;
+            };
+
+            std::mutex mutex_;
+            std::vector<Slot> rings_;
+            std::condition_variable wake_;
+            std::condition_variable flushed_;
+            std::uint64_t flush_requested_{0};
+            std::uint64_t flush_done_{0};
+
+            std::array<Stream, 4> streams_{{{.file = stderr, .tag = "error", .color = color_error},
+                                            {.file = stdout, .tag = "warn", .color = color_warn},
+                                            {.file = stdout, .tag = "info", .color = color_info},
+                                            {.file = stdout, .tag = "debug", .color = color_debug}}};
+            // isatty() once, not per message
+            bool stdout_tty_{static_cast<bool>(isatty(fileno(stdout)))};
+            bool stderr_tty_{static_cast<bool>(isatty(fileno(stderr)))};
+
+            std::vector<Record> batch_;
+            std::string line_;
+
+            // last so everything above exists before it runs
+            std::jthread thread_;
+
+            void run(std::stop_token st)
+            {
+                while (true)
+                {
+                    std::uint64_t requested{0};
+                    {
+                        std::unique_lock lock(mutex_);
+                        // producers never signal, a quiet millisecond between passes keeps their path free of syscalls
+                        wake_.wait_for(lock, std::chrono::milliseconds(1), [this, &st] {
+                            return st.stop_requested() || flush_requested_ > flush_done_;
+                        });
+                        requested = flush_requested_;
+                    }
+
+                    drain();
+
+                    {
+                        const std::scoped_lock lock(mutex_);
+                        flush_done_ = requested;
+                    }
+                    flushed_.notify_all();
+
+                    if (st.stop_requested())
+                    {
+                        return;
+                    }
+                }
+            }
+
+            void drain()
+            {
+                std::vector<std::uint64_t> drops;
+
+                {
+                    const std::scoped_lock lock(mutex_);
+
+                    for (auto& slot : rings_)
+                    {
+                        for (auto* record{slot.ring->front()}; record != nullptr; record = slot.ring->front())
+                        {
+                            batch_.push_back(*record);
+                            slot.ring->pop();
+                        }
+
+                        if (const auto dropped{slot.ring->dropped()}; dropped != slot.dropped)
+                        {
+                            drops.push_back(dropped - slot.dropped);
+                            slot.dropped = dropped;
+                        }
+                    }
+                }
+
+                std::ranges::stable_sort(batch_, {}, &Record::tsc);
+
+                auto wrote_stdout{false};
+                auto wrote_stderr{false};
+                for (auto& record : batch_)
+                {
+                    const auto& stream{streams_[static_cast<std::size_t>(record.level)]};
+                    const auto tty{stream.file == stderr ? stderr_tty_ : stdout_tty_};
+
+                    line_.clear();
+                    if (tty)
+                    {
+                        line_ += stream.color;
+                        line_ += "[imr:";
+                        line_ += stream.tag;
+                        line_ += "]\033[0m ";
+                    }
+                    else
+                    {
+                        line_ += "[imr:";
+                        line_ += stream.tag;
+                        line_ += "] ";
+                    }
+
+                    try
+                    {
+                        line_ += record.format(record);
+                    }
+                    catch (const std::exception& ex)
+                    {
+                        line_ += ex.what();
+                    }
+                    line_ += '\n';
+
+                    std::fwrite(line_.data(), 1, line_.size(), stream.file);
+                    (stream.file == stderr ? wrote_stderr : wrote_stdout) = true;
+                }
+                batch_.clear();
+
+                for (const auto count : drops)
+                {
+                    std::fprintf(stderr, "[imr:warn] %llu log records dropped, ring full\n", static_cast<unsigned long long>(count));
+                    wrote_stderr = true;
+                }
+
+                if (wrote_stdout)
+                {
+                    std::fflush(stdout);
+                }
+                if (wrote_stderr)
+                {
+                    std::fflush(stderr);
+                }
+            }
+        };
+
+        Backend& backend()
+        {
+            static Backend instance;
+            return instance;
+        }
+
+        // hands the ring back when the thread exits
+        struct Registration
+        {
+            Ring* ring{nullptr};
+
+            Registration()
+            {
+                try
+                {
+                    ring = backend().acquire();
+                }
+                catch (const std::bad_alloc&)
+                {
+                    ring = nullptr;
+                }
+            }
+
+            ~Registration()
+            {
+                if (ring != nullptr)
+                {
+                    backend().release(ring);
+                }
+            }
+
+            Registration(const Registration&) = delete;
+            Registration& operator=(const Registration&) = delete;
+
+            Registration(Registration&&) = delete;
+            Registration& operator=(Registration&&) = delete;
+        };
+    }
+
+    namespace detail
+    {
+        Ring* ring() noexcept
+        {
+            thread_local const Registration registration;
+            return registration.ring;
+        }
+    }
+
+    void flush()
+    {
+        backend().flush();
+    }
+}
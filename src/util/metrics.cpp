@@ -0,0 +1,384 @@
+#include "imr/util/metrics.h"
+
+#include "imr/util/log.h"
+#include "write_all.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <format>
+#include <map>
+#include <new>
+#include <source_location>
+#include <stdexcept>
+#include <system_error>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace imr::util::metrics
+{
+    namespace
+    {
+        FileDescriptor create(const Registry::Config& cfg)
+        {
+            if (cfg.path.empty())
+            {
+                return FileDescriptor([] { return memfd_create("imr-metrics", MFD_CLOEXEC); });
+            }
+
+            return FileDescriptor([&cfg] { return open(cfg.path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644); });
+        }
+
+        std::string_view text(std::span<const char> padded) noexcept
+        {
+            return {padded.data(), static_cast<std::size_t>(std::ranges::find(padded, '\0') - padded.begin())};
+        }
+
+        std::vector<Sample> read_slots(const Header& header, const Slot* slots)
+        {
+            // slots below count are complete and never change again, only their values do
+            const auto count{std::min(header.count.load(std::memory_order_acquire), header.capacity)};
+
+            std::vector<Sample> samples;
+            samples.reserve(count);
+
+            for (const auto& slot : std::span(slots, count))
+            {
+                samples.push_back({.name = std::string(text(slot.name)),
+                                   .labels = std::string(text(slot.labels)),
+                                   .kind = slot.kind,
+                                   .value = static_cast<std::int64_t>(slot.value.load(std::memory_order_relaxed))});
+            }
+
+            return samples;
+        }
+    }
+
+    std::string prometheus(std::span<const Sample> samples)
+    {
+        // name -> (kind, labels -> value), names in first registered order
+        std::vector<std::string_view> names;
+        std::map<std::string_view, std::pair<Kind, std::map<std::string_view, std::int64_t>>> series;
+
+        for (const auto& sample : samples)
+        {
+            auto [it, inserted]{series.try_emplace(sample.name, sample.kind, std::map<std::string_view, std::int64_t>{})};
+            if (inserted)
+            {
+                names.push_back(sample.name);
+            }
+
+            it->second.second[sample.labels] += sample.value;
+        }
+
+        std::string out;
+        for (const auto name : names)
+        {
+            const auto& [kind, values]{series.at(name)};
+            out += std::format("# TYPE {} {}\n", name, kind == Kind::counter ? "counter" : "gauge");
+
+            for (const auto& [labels, value] : values)
+            {
+                if (labels.empty())
+                {
+                    out += std::format("{} {}\n", name, value);
+                }
+                else
+                {
+                    out += std::format("{}{}{}{} {}\n", name, '{', labels, '}', value);
+                }
+            }
+        }
+
+        return out;
+    }
+
+    Registry::Registry(const Config& cfg)
+        : fd_{create(cfg)},
+          path_{cfg.path.empty() ? std::filesystem::path(std::format("/proc/{}/fd/{}", getpid(), fd_.get())) : cfg.path},
+          length_{sizeof(Header) + (cfg.capacity * sizeof(Slot))}
+    {
+        if (ftruncate(fd_.get(), static_cast<off_t>(length_)) < 0)
+        {
+            throw std::system_error(errno, std::system_category(), std::source_location::current().function_name());
+        }
+
+        mapping_ = mmap(nullptr, length_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_.get(), 0);
+        if (mapping_ == MAP_FAILED)
+        {
+            mapping_ = nullptr;
+            throw std::system_error(errno, std::system_category(), std::source_location::current().function_name());
+        }
+
+        // fresh (zeroed) file, the header is the only object needing construction
+        header_ = new (mapping_) Header{};
+        header_->capacity = static_cast<std::uint32_t>(cfg.capacity);
+        slots_ = reinterpret_cast<Slot*>(static_cast<std::byte*>(mapping_) + sizeof(Header));
+
+        // magic last, readers check it before trusting the rest
+        std::atomic_thread_fence(std::memory_order_release);
+        header_->magic = magic;
+
+        util::log::info("Metrics: shared memory segment at {}", path_.c_str());
+    }
+
+    Registry::~Registry()
+    {
+        if (mapping_ != nullptr)
+        {
+            munmap(mapping_, length_);
+        }
+    }
+
+    void Registry::attach(Counter& counter, std::string_view name, std::string_view labels)
+    {
+        counter.value_ = &add(Kind::counter, name, labels, counter.value());
+    }
+
+    void Registry::attach(Gauge& gauge, std::string_view name, std::string_view labels)
+    {
+        gauge.value_ = &add(Kind::gauge, name, labels, static_cast<std::uint64_t>(gauge.value()));
+    }
+
+    std::atomic<std::uint64_t>& Registry::add(Kind kind, std::string_view name, std::string_view labels, std::uint64_t value)
+    {
+        if (name.empty() || name.size() > name_size || labels.size() > labels_size)
+        {
+            throw std::invalid_argument(std::format("{}: {} with labels {} doesn't fit a metric slot",
+                                                    std::source_location::current().function_name(),
+                                                    name,
+                                                    labels));
+        }
+
+        const std::scoped_lock lock(mutex_);
+
+        const auto index{header_->count.load(std::memory_order_relaxed)};
+        if (index >= header_->capacity)
+        {
+            throw std::invalid_argument(std::format("{}: no room for {}, capacity {}",
+                                                    std::source_location::current().function_name(),
+                                                    name,
+                                                    header_->capacity));
+        }
+
+        auto* slot{new (slots_ + index) Slot{}};
+        slot->value.store(value, std::memory_order_relaxed);
+        slot->kind = kind;
+        std::ranges::copy(name, slot->name.begin());
+        std::ranges::copy(labels, slot->labels.begin());
+
+        header_->count.store(index + 1, std::memory_order_release);
+
+        return slot->value;
+    }
+
+    const std::filesystem::path& Registry::path() const noexcept
+    {
+        return path_;
+    }
+
+    std::vector<Sample> Registry::read() const
+    {
+        return read_slots(*header_, slots_);
+    }
+
+    Reader::Reader(const std::filesystem::path& path)
+    {
+        const FileDescriptor fd(path, O_RDONLY | O_CLOEXEC);
+
+        struct stat info{};
+        if (fstat(fd.get(), &info) < 0)
+        {
+            throw std::system_error(errno, std::system_category(), std::source_location::current().function_name());
+        }
+
+        length_ = static_cast<std::size_t>(info.st_size);
+        if (length_ < sizeof(Header))
+        {
+            throw std::invalid_argument(std::format("{}: {} is not a metrics segment",
+                                                    std::source_location::current().function_name(),
+                                                    path.c_str()));
+        }
+
+        auto* mapping{mmap(nullptr, length_, PROT_READ, MAP_SHARED, fd.get(), 0)};
+        if (mapping == MAP_FAILED)
+        {
+            throw std::system_error(errno, std::system_category(), std::source_location::current().function_name());
+        }
+
+        mapping_ = mapping;
+        header_ = static_cast<const Header*>(mapping_);
+        slots_ = reinterpret_cast<const Slot*>(static_cast<const std::byte*>(mapping_) + sizeof(Header));
+
+        if (header_->magic != magic || sizeof(Header) + (header_->capacity * sizeof(Slot)) > length_)
+        {
+            munmap(mapping, length_);
+            mapping_ = nullptr;
+            throw std::invalid_argument(std::format("{}: {} is not a metrics segment",
+                                                    std::source_location::current().function_name(),
+                                                    path.c_str()));
+        }
+    }
+
+    Reader::~Reader()
+    {
+        if (mapping_ != nullptr)
+        {
+            munmap(const_cast<void*>(mapping_), length_);
+        }
+    }
+
+    std::vector<Sample> Reader::read() const
+    {
+        return read_slots(*header_, slots_);
+    }
+
+    Endpoint::Endpoint(const Config& cfg, const Registry& registry)
+        : registry_{&registry},
+          timeout_{cfg.timeout}
+    {
+        constexpr auto sockopt_on{1};
+        if (setsockopt(socket_.get(), SOL_SOCKET, SO_REUSEADDR, &sockopt_on, sizeof(sockopt_on)) < 0)
+        {
+            throw std::system_error(errno, std::system_category(), std::source_location::current().function_name());
+        }
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(cfg.port);
+
+        if (inet_pton(AF_INET, cfg.address.c_str(), &addr.sin_addr) != 1)
+        {
+            throw std::invalid_argument(std::format("{}: invalid ip format for metrics address {}",
+                                                    std::source_location::current().function_name(),
+                                                    cfg.address.c_str()));
+        }
+
+        if (bind(socket_.get(), reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) < 0 || listen(socket_.get(), SOMAXCONN) < 0)
+        {
+            throw std::system_error(errno, std::system_category(), std::source_location::current().function_name());
+        }
+
+        util::log::debug();
+    }
+
+    void Endpoint::start(std::stop_token st)
+    {
+        util::log::info("Metrics: serving /metrics on port {}", port());
+
+        // wakes the blocked accept(), or recv / send on a connection
+        const std::stop_callback wake(st, [this] {
+            shutdown(socket_.get(), SHUT_RDWR);
+
+            const std::scoped_lock lock(client_mutex_);
+            if (client_ >= 0)
+            {
+                shutdown(client_, SHUT_RDWR);
+            }
+        });
+
+        const auto seconds{std::chrono::duration_cast<std::chrono::seconds>(timeout_)};
+        const timeval timeout{
+            .tv_sec = seconds.count(),
+            .tv_usec = std::chrono::duration_cast<std::chrono::microseconds>(timeout_ - seconds).count(),
+        };
+
+        while (!st.stop_requested())
+        {
+            const auto fd{accept4(socket_.get(), nullptr, nullptr, SOCK_CLOEXEC)};
+
+            if (fd < 0)
+            {
+                if (errno != EINTR && errno != ECONNABORTED && !st.stop_requested())
+                {
+                    util::log::perror();
+                }
+                continue;
+            }
+
+            const FileDescriptor client{fd};
+
+            if (setsockopt(client.get(), SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) < 0 ||
+                setsockopt(client.get(), SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout)) < 0)
+            {
+                util::log::perror();
+                continue;
+            }
+
+            {
+                const std::scoped_lock lock(client_mutex_);
+
+                // stop came between accept() and here, nothing would shut the connection down
+                if (st.stop_requested())
+                {
+                    return;
+                }
+                client_ = client.get();
+            }
+
+            serve(client.get());
+
+            const std::scoped_lock lock(client_mutex_);
+            client_ = -1;
+        }
+    }
+
+    std::uint16_t Endpoint::port() const
+    {
+        sockaddr_in addr{};
+        socklen_t length{sizeof(addr)};
+
+        if (getsockname(socket_.get(), reinterpret_cast<sockaddr*>(&addr), &length) < 0)
+        {
+            throw std::system_error(errno, std::system_category(), std::source_location::current().function_name());
+        }
+
+        return ntohs(addr.sin_port);
+    }
+
+    void Endpoint::serve(int client) const noexcept
+    {
+        // the request line is all we look at
+        std::array<char, 1024> request{};
+        const auto received{recv(client, request.data(), request.size(), 0)};
+        if (received <= 0)
+        {
+            return;
+        }
+
+        const std::string_view request_line(request.data(), static_cast<std::size_t>(received));
+
+        try
+        {
+            std::string response;
+            if (request_line.starts_with("GET /metrics ") || request_line.starts_with("GET /metrics?"))
+            {
+                const auto body{prometheus(registry_->read())};
+                response = std::format("HTTP/1.0 200 OK\r\n"
+                                       "Content-Type: text/plain; version=0.0.4\r\n"
+                                       "Content-Length: {}\r\n"
+                                       "\r\n"
+                                       "{}",
+                                       body.size(),
+                                       body);
+            }
+            else
+            {
+                response = "HTTP/1.0 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+            }
+
+            if (!send_all(client, response))
+            {
+                util::log::perror();
+            }
+        }
+        catch (const std::exception& ex)
+        {
+            util::log::error("{}: {}", std::source_location::current().function_name(), ex.what());
+        }
+    }
+}
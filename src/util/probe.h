@@ -0,0 +1,96 @@
+#pragma once
+
+#include <type_traits>
+
+/** USDT (user statically defined tracing) probes, provider `imr`: `IMR_PROBE(name, args...)`, 1 to 4 integer args.
+ *
+ *  A probe is a single nop in the code plus an ELF note (.note.stapsdt) telling tracers where it is and where each
+ *  argument lives at that point (register, stack slot or constant). perf / bpftrace / systemtap attach by patching the
+ *  nop, so a probe not attached costs the nop and whatever its arguments take to compute:
+ *
+ *      bpftrace -e 'usdt:./replay:imr:heartbeat { @ = count(); }'
+ *
+ *  Uses <sys/sdt.h> (systemtap-sdt-dev) when installed, else writes the same note itself on x86-64. Compiles to
+ *  nothing on other targets or with IMR_NO_PROBES.
+ */
+
+// arguments still count as used
+#define IMR_PROBE_NONE(...) [](const auto&...) {}(__VA_ARGS__)
+
+#if defined(IMR_NO_PROBES)
+
+#define IMR_PROBE(name, ...) IMR_PROBE_NONE(__VA_ARGS__)
+
+#elif __has_include(<sys/sdt.h>)
+
+#include <sys/sdt.h>
+#define IMR_PROBE(name, ...) STAP_PROBEV(imr, name, __VA_ARGS__)
+
+#elif defined(__x86_64__)
+
+namespace imr::util::probe
+{
+    /// Argument size as the note spells it: bytes, negative if signed.
+    template <typename T>
+    inline constexpr int arg_size{std::is_signed_v<std::remove_cvref_t<T>> ? -static_cast<int>(sizeof(T))
+                                                                            : static_cast<int>(sizeof(T))};
+}
+
+// "size@operand", the operand as the assembler prints it (%rdi, 8(%rsp), $1)
+#define IMR_PROBE_ARG(i) "%c[s" #i "]@%[a" #i "]"
+#define IMR_PROBE_OPERAND(i, value) [s##i] "n"(::imr::util::probe::arg_size<decltype(value)>), [a##i] "nor"(value)
+
+// the nop, its note (version 3: address, base, semaphore, provider, name, args) and the .stapsdt.base tracers
+// relocate the address by, once per object
+#define IMR_PROBE_NOTE(name, args, ...)                                                 \
+    __asm__ __volatile__("990: nop\n"                                                   \
+                         ".pushsection .note.stapsdt,\"?\",\"note\"\n"                  \
+                         ".balign 4\n"                                                  \
+                         ".4byte 992f-991f, 994f-993f, 3\n"                             \
+                         "991: .asciz \"stapsdt\"\n"                                    \
+                         "992: .balign 4\n"                                             \
+                         "993: .8byte 990b\n"                                           \
+                         ".8byte _.stapsdt.base\n"                                      \
+                         ".8byte 0\n"                                                   \
+                         ".asciz \"imr\"\n"                                             \
+                         ".asciz \"" #name "\"\n"                                       \
+                         ".asciz \"" args "\"\n"                                        \
+                         "994: .balign 4\n"                                             \
+                         ".popsection\n"                                                \
+                         ".ifndef _.stapsdt.base\n"                                     \
+                         ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n" \
+                         ".weak _.stapsdt.base\n"                                       \
+                         ".hidden _.stapsdt.base\n"                                     \
+                         "_.stapsdt.base: .space 1\n"                                   \
+                         ".size _.stapsdt.base, 1\n"                                    \
+                         ".popsection\n"                                                \
+                         ".endif\n"                                                     \
+                         :                                                              \
+                         : __VA_ARGS__)
+
+#define IMR_PROBE1(name, a0) IMR_PROBE_NOTE(name, IMR_PROBE_ARG(0), IMR_PROBE_OPERAND(0, a0))
+#define IMR_PROBE2(name, a0, a1) \
+    IMR_PROBE_NOTE(name, IMR_PROBE_ARG(0) " " IMR_PROBE_ARG(1), IMR_PROBE_OPERAND(0, a0), IMR_PROBE_OPERAND(1, a1))
+#define IMR_PROBE3(name, a0, a1, a2)                                                   \
+    IMR_PROBE_NOTE(name,                                                               \
+                   IMR_PROBE_ARG(0) " " IMR_PROBE_ARG(1) " " IMR_PROBE_ARG(2),         \
+                   IMR_PROBE_OPERAND(0, a0),                                           \
+                   IMR_PROBE_OPERAND(1, a1),                                           \
+                   IMR_PROBE_OPERAND(2, a2))
+#define IMR_PROBE4(name, a0, a1, a2, a3)                                                          \
+    IMR_PROBE_NOTE(name,                                                                          \
+                   IMR_PROBE_ARG(0) " " IMR_PROBE_ARG(1) " " IMR_PROBE_ARG(2) " " IMR_PROBE_ARG(3), \
+                   IMR_PROBE_OPERAND(0, a0),                                                      \
+                   IMR_PROBE_OPERAND(1, a1),                                                      \
+                   IMR_PROBE_OPERAND(2, a2),                                                      \
+                   IMR_PROBE_OPERAND(3, a3))
+
+#define IMR_PROBE_SELECT(_1, _2, _3, _4, probe, ...) probe
+#define IMR_PROBE(name, ...) \
+    IMR_PROBE_SELECT(__VA_ARGS__, IMR_PROBE4, IMR_PROBE3, IMR_PROBE2, IMR_PROBE1, )(name, __VA_ARGS__)
+
+#else
+
+#define IMR_PROBE(name, ...) IMR_PROBE_NONE(__VA_ARGS__)
+
+#endif
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cerrno>
+#include <span>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace imr::util
+{
+    // all or nothing write, retrying on partial writes / EINTR
+    inline bool write_all(int fd, std::span<const char> bytes) noexcept
+    {
+        while (!bytes.empty())
+        {
+            const auto written{::write(fd, bytes.data(), bytes.size())};
+
+            if (written < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                return false;
+            }
+
+            bytes = bytes.subspan(static_cast<std::size_t>(written));
+        }
+
+        return true;
+    }
+
+    // all or nothing send, a client hanging up mustn't raise SIGPIPE
+    inline bool send_all(int fd, std::span<const char> bytes) noexcept
+    {
+        while (!bytes.empty())
+        {
+            const auto sent{::send(fd, bytes.data(), bytes.size(), MSG_NOSIGNAL)};
+
+            if (sent < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                return false;
+            }
+
+            bytes = bytes.subspan(static_cast<std::size_t>(sent));
+        }
+
+        return true;
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cassert>
+#include <cstring>
+#include <span>
+
+namespace imr::util
+{
+    // dst ^= src over src.size() bytes, 32 bytes per step (vectorised by the compiler for the target's widest registers)
+    inline void xor_into(std::span<char> dst, std::span<const char> src) noexcept
+    {
+        assert(dst.size() >= src.size());
+
+        using Block = char __attribute__((vector_size(32)));
+
+        auto i{0UZ};
+        for (; i + sizeof(Block) <= src.size(); i += sizeof(Block))
+        {
+            Block a;
+            Block b;
+            std::memcpy(&a, dst.data() + i, sizeof(Block));
+            std::memcpy(&b, src.data() + i, sizeof(Block));
+            a ^= b;
+            std::memcpy(dst.data() + i, &a, sizeof(Block));
+        }
+
+        for (; i < src.size(); ++i)
+        {
+            dst[i] ^= src[i];
+        }
+    }
+}
@@ -1,18 +1,41 @@
 #include <gtest/gtest.h>
 #include "imr/mold/downstream/feed.h"
+#include "imr/mold/downstream/file_source.h"
 #include "imr/mold/packet_builder.h"
 #include "imr/mold/retransmission_buffer.h"
+#include "imr/util/metrics.h"
+#include "itch_file_fixture.h"
+#include "util/binary_io.h"
+
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
 
 using namespace imr::mold;
 
 namespace
 {
     constexpr std::array file{'a', 'b', 'c'};
+
+    constexpr auto messages{16UZ};
+    constexpr auto itch_file{test_common::ItchFileFixture<messages>::get_test_content()};
+
+    types::header::MessageCount message_count(std::span<const char> packet)
+    {
+        return imr::util::binary_io::read_at_be<types::header::MessageCount>(packet, types::header::message_count_offset);
+    }
 }
 
 class DownstreamFeedTest : public ::testing::Test
 {
   protected:
+    downstream::FileSource source{file};
     RetransmissionBuffer retransmission_buffer{1};
     PacketBuilder::Config packet_builder_cfg{
         .session = "SESSION001",
@@ -20,7 +43,7 @@ class DownstreamFeedTest : public ::testing::Test
 
     downstream::Feed make_feed(const downstream::Feed::Config& cfg)
     {
-        return downstream::Feed(cfg, packet_builder_cfg, file, retransmission_buffer);
+        return downstream::Feed(cfg, packet_builder_cfg, source, retransmission_buffer);
     }
 };
 
@@ -37,3 +60,270 @@ TEST_F(DownstreamFeedTest, Ctor_InvalidMcastGroup_ThrowsInvalidArgument)
     EXPECT_THROW(make_feed({.mcast_group = ""}), std::invalid_argument);
     EXPECT_THROW(make_feed({.mcast_group = "badip"}), std::invalid_argument);
 }
+
+TEST_F(DownstreamFeedTest, Ctor_ShmTransportWithoutShmOutput_ThrowsInvalidArgument)
+{
+    EXPECT_THROW(make_feed({.mcast_group = "239.0.0.1", .port = 3400, .transport = imr::mold::transport::Kind::shm}),
+                 std::invalid_argument);
+}
+
+TEST_F(DownstreamFeedTest, Start_MemoryTransport_CapturesPacketsThenOneEndOfSession)
+{
+    downstream::FileSource itch_source{itch_file};
+    RetransmissionBuffer buffer{messages};
+
+    downstream::Feed feed({.mcast_group = "239.0.0.1",
+                           .port = 3400,
+                           .heartbeat_period = std::chrono::hours(1),
+                           .transport = imr::mold::transport::Kind::memory,
+                           .wait = imr::util::wait::Kind::none},
+                          packet_builder_cfg,
+                          itch_source,
+                          buffer);
+    feed.start({});
+
+    const auto packets{feed.memory_sink().packets()};
+    ASSERT_FALSE(packets.empty());
+
+    // the heartbeat thread's first heartbeat races the replay, so only count data packets
+    const auto sent{std::accumulate(packets.begin(), packets.end(), 0UZ, [](std::size_t total, const auto& packet) {
+        const auto count{message_count(packet.bytes)};
+        return count == types::header::end_of_session_msg_count ? total : total + count;
+    })};
+    EXPECT_EQ(sent, messages);
+
+    EXPECT_EQ(message_count(packets.back().bytes), types::header::end_of_session_msg_count);
+    EXPECT_EQ(std::ranges::count_if(packets,
+                                    [](const auto& packet) {
+                                        return message_count(packet.bytes) == types::header::end_of_session_msg_count;
+                                    }),
+              1);
+    EXPECT_EQ(packets.back().destination.sin_port, htons(3400));
+}
+
+TEST_F(DownstreamFeedTest, Start_NullTransport_CountsEveryPacket)
+{
+    downstream::FileSource itch_source{itch_file};
+    RetransmissionBuffer buffer{messages};
+
+    downstream::Feed feed({.mcast_group = "239.0.0.1",
+                           .port = 3400,
+                           .heartbeat_period = std::chrono::hours(1),
+                           .transport = imr::mold::transport::Kind::null,
+                           .wait = imr::util::wait::Kind::none},
+                          packet_builder_cfg,
+                          itch_source,
+                          buffer);
+    feed.start({});
+
+    // at least one data packet and the end of session
+    EXPECT_GE(feed.null_sink().packets(), 2U);
+    EXPECT_GE(feed.null_sink().bytes(), (messages * PacketBuilder::min_message_size) + (2 * types::header::length));
+}
+
+TEST_F(DownstreamFeedTest, Start_AttachedMetrics_CountsWhatWasSent)
+{
+    downstream::FileSource itch_source{itch_file};
+    RetransmissionBuffer buffer{messages};
+    imr::util::metrics::Registry registry({});
+
+    downstream::Feed feed({.mcast_group = "239.0.0.1",
+                           .port = 3400,
+                           .heartbeat_period = std::chrono::hours(1),
+                           .transport = imr::mold::transport::Kind::null,
+                           .wait = imr::util::wait::Kind::none},
+                          packet_builder_cfg,
+                          itch_source,
+                          buffer);
+    feed.attach_metrics(registry, "channel=\"0\"");
+    feed.start({});
+
+    std::map<std::string, std::int64_t> values;
+    for (const auto& sample : registry.read())
+    {
+        EXPECT_EQ(sample.labels, "channel=\"0\"");
+        values[sample.name] = sample.value;
+    }
+
+    // data packets only, heartbeats and the end of session (header only packets) are counted apart
+    const auto header_only{values["imr_downstream_heartbeats_total"] + 1};
+    EXPECT_EQ(values["imr_downstream_packets_total"], static_cast<std::int64_t>(feed.null_sink().packets()) - header_only);
+    EXPECT_EQ(values["imr_downstream_messages_total"], static_cast<std::int64_t>(messages));
+    EXPECT_EQ(values["imr_downstream_bytes_total"],
+              static_cast<std::int64_t>(feed.null_sink().bytes()) - (header_only * static_cast<std::int64_t>(types::header::length)));
+    EXPECT_EQ(values["imr_downstream_file_position"], static_cast<std::int64_t>((messages - 1) * PacketBuilder::min_message_size));
+    EXPECT_EQ(values["imr_downstream_send_errors_total"], 0);
+}
+
+TEST_F(DownstreamFeedTest, Ctor_TxTimestampsWithoutUdp_ThrowsInvalidArgument)
+{
+    EXPECT_THROW(downstream::Feed({.mcast_group = "239.0.0.1",
+                                   .port = 3400,
+                                   .transport = imr::mold::transport::Kind::null,
+                                   .tx_timestamps = downstream::TxTimestamper::Config{}},
+                                  packet_builder_cfg,
+                                  source,
+                                  retransmission_buffer),
+                 std::invalid_argument);
+}
+
+TEST_F(DownstreamFeedTest, Start_TxTimestamps_ReportsEveryPacket)
+{
+    const auto report{std::filesystem::path(TEST_DATA_DIR) / ("DownstreamFeedTest_tx_" + std::to_string(getpid()) + ".csv")};
+
+    {
+        downstream::FileSource itch_source{itch_file};
+        RetransmissionBuffer buffer{messages};
+
+        // unicast to ourselves, timestamped on loopback
+        downstream::Feed feed({.mcast_group = "127.0.0.1",
+                               .port = 3401,
+                               .heartbeat_period = std::chrono::hours(1),
+                               .end_of_session_duration = std::chrono::nanoseconds{0},
+                               .tx_timestamps = downstream::TxTimestamper::Config{.hardware = false, .report = report}},
+                              {.session = "SESSION001", .MTU = types::header::length + (4 * PacketBuilder::min_message_size)},
+                              itch_source,
+                              buffer);
+        feed.start({});
+
+        ASSERT_NE(feed.tx_timestamper(), nullptr);
+    }
+
+    // kind,sequence_number,message_count,scheduled_ns,sendmsg_ns,qdisc_ns,departure_ns,hardware
+    std::ifstream csv(report);
+    std::string line;
+    std::getline(csv, line);
+    EXPECT_TRUE(line.starts_with("kind,sequence_number"));
+
+    auto next_sequence{1ULL};
+    while (std::getline(csv, line))
+    {
+        std::vector<std::string> fields;
+        for (std::stringstream row(line); std::getline(row, fields.emplace_back(), ',');)
+        {
+        }
+        fields.pop_back();
+        ASSERT_EQ(fields.size(), 8U) << line;
+
+        if (fields[0] != "data")
+        {
+            continue;
+        }
+
+        EXPECT_EQ(std::stoull(fields[1]), next_sequence);
+        next_sequence += std::stoull(fields[2]);
+
+        EXPECT_FALSE(fields[3].empty());
+        EXPECT_LE(std::stoll(fields[4]), std::stoll(fields[6]));
+        EXPECT_EQ(fields[7], "0");
+    }
+    EXPECT_EQ(next_sequence, messages + 1);
+
+    std::filesystem::remove(report);
+}
+
+TEST_F(DownstreamFeedTest, Start_VirtualTime_KeepsTimingWithoutWaiting)
+{
+    using namespace std::chrono_literals;
+
+    // 4 messages 10s apart, one per packet
+    constexpr auto timed_file{test_common::ItchFileFixture<4, std::chrono::nanoseconds(10s).count()>::get_test_content()};
+    downstream::FileSource itch_source{timed_file};
+    RetransmissionBuffer buffer{4};
+
+    downstream::Feed feed({.mcast_group = "239.0.0.1",
+                           .port = 3400,
+                           .heartbeat_period = 1s,
+                           .end_of_session_duration = 5s,
+                           .transport = imr::mold::transport::Kind::memory,
+                           .wait = imr::util::wait::Kind::virtual_time},
+                          {.session = "SESSION001", .MTU = types::header::length + PacketBuilder::min_message_size},
+                          itch_source,
+                          buffer);
+
+    const auto wall_start{std::chrono::steady_clock::now()};
+    feed.start({});
+    EXPECT_LT(std::chrono::steady_clock::now() - wall_start, 5s);
+
+    std::vector<std::chrono::steady_clock::time_point> data;
+    std::vector<std::chrono::steady_clock::time_point> heartbeats;
+    std::vector<std::chrono::steady_clock::time_point> end_of_session;
+    for (const auto& packet : feed.memory_sink().packets())
+    {
+        const auto count{message_count(packet.bytes)};
+        if (count == types::header::end_of_session_msg_count)
+        {
+            end_of_session.push_back(packet.time);
+        }
+        else if (count == types::header::heartbeat_msg_count)
+        {
+            heartbeats.push_back(packet.time);
+        }
+        else
+        {
+            data.push_back(packet.time);
+        }
+    }
+
+    ASSERT_EQ(data.size(), 4U);
+    for (auto i{1UZ}; i < data.size(); ++i)
+    {
+        EXPECT_EQ(data[i] - data[i - 1], 10s);
+    }
+
+    // a heartbeat every second from the first packet on, the last one due with the last packet
+    ASSERT_EQ(heartbeats.size(), 31U);
+    EXPECT_EQ(heartbeats.front(), data.front());
+    EXPECT_EQ(heartbeats.back(), data.back());
+
+    ASSERT_EQ(end_of_session.size(), 5U);
+    EXPECT_EQ(end_of_session.front(), data.back());
+    EXPECT_EQ(end_of_session.back() - end_of_session.front(), 4s);
+
+    // virtual time never overshoots a packet's schedule
+    imr::util::Histogram::Snapshot lateness;
+    lateness.add(feed.lateness());
+    EXPECT_EQ(lateness.count(), 4U);
+    EXPECT_EQ(lateness.max(), 0U);
+}
+
+TEST_F(DownstreamFeedTest, Start_Trace_RecordsEveryPacketAndDumpsAtEndOfSession)
+{
+    const auto dump{std::filesystem::path(TEST_DATA_DIR) / ("DownstreamFeedTest_trace_" + std::to_string(getpid()) + ".bin")};
+
+    downstream::FileSource itch_source{itch_file};
+    RetransmissionBuffer buffer{messages};
+
+    downstream::Feed feed({.mcast_group = "239.0.0.1",
+                           .port = 3400,
+                           .heartbeat_period = std::chrono::hours(1),
+                           .end_of_session_duration = std::chrono::nanoseconds{0},
+                           .transport = imr::mold::transport::Kind::memory,
+                           .wait = imr::util::wait::Kind::spin,
+                           .trace = downstream::TraceRing::Config{.path = {}, .capacity = 64, .dump = dump, .dump_signal = 0}},
+                          {.session = "SESSION001", .MTU = types::header::length + (4 * PacketBuilder::min_message_size)},
+                          itch_source,
+                          buffer);
+    feed.start({});
+
+    ASSERT_NE(feed.trace_ring(), nullptr);
+    const auto records{trace::read(dump).records};
+    ASSERT_FALSE(records.empty());
+
+    auto next_sequence{1ULL};
+    auto batch{0ULL};
+    for (const auto& record : records)
+    {
+        EXPECT_EQ(record.sequence_number, next_sequence);
+        EXPECT_EQ(record.batch, batch++);
+        EXPECT_EQ(record.result, trace::Result::sent);
+        EXPECT_NE(record.due, 0);
+        EXPECT_EQ(*buffer.file_position_for(record.sequence_number + record.message_count - 1), record.file_position);
+        next_sequence += record.message_count;
+    }
+    EXPECT_EQ(next_sequence, messages + 1);
+
+    EXPECT_EQ(trace::read(feed.trace_ring()->path()).records.size(), records.size());
+
+    std::filesystem::remove(dump);
+}
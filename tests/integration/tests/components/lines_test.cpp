@@ -0,0 +1,317 @@
+#include <gtest/gtest.h>
+
+#include "imr/mold/downstream/lines.h"
+#include "imr/mold/types.h"
+#include "imr/util/file_descriptor.h"
+#include "imr/util/memory_mapped_file.h"
+#include "util/binary_io.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace imr::mold;
+using namespace imr::mold::downstream;
+
+namespace
+{
+    constexpr auto max_packet_size{64UZ};
+
+    // unicast loopback receiver standing in for a line's multicast subscriber
+    struct Receiver
+    {
+        imr::util::FileDescriptor socket{::socket(AF_INET, SOCK_DGRAM, 0)};
+        sockaddr_in address{};
+
+        Receiver()
+        {
+            address.sin_family = AF_INET;
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+            EXPECT_EQ(bind(socket.get(), reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+
+            socklen_t length{sizeof(address)};
+            EXPECT_EQ(getsockname(socket.get(), reinterpret_cast<sockaddr*>(&address), &length), 0);
+
+            timeval timeout{.tv_sec = 0, .tv_usec = 50'000};
+            EXPECT_EQ(setsockopt(socket.get(), SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)), 0);
+        }
+
+        [[nodiscard]]
+        std::uint16_t port() const
+        {
+            return ntohs(address.sin_port);
+        }
+
+        // sequence number of every packet received until the timeout
+        std::vector<types::header::SequenceNumber> drain() const
+        {
+            std::vector<types::header::SequenceNumber> sequence_numbers;
+            std::array<char, max_packet_size> packet{};
+
+            while (recv(socket.get(), packet.data(), packet.size(), 0) > 0)
+            {
+                sequence_numbers.push_back(
+                    imr::util::binary_io::read_at_be<types::header::SequenceNumber>(packet, types::header::sequence_number_offset));
+            }
+
+            return sequence_numbers;
+        }
+    };
+
+    // single message packet, ITCH timestamp = sequence number, returns whether it all went out
+    bool send_packet(Lines& lines, types::header::SequenceNumber seq, Lines::Clock::time_point now = Lines::Clock::now())
+    {
+        std::array<char, types::header::length> header{};
+        imr::util::binary_io::write_at_be(std::span(header), types::header::sequence_number_offset, seq);
+        imr::util::binary_io::write_at_be(std::span(header), types::header::message_count_offset, types::header::MessageCount{1});
+
+        std::array message{'\0', '\1', 'x'};
+        const std::array iov{iovec{.iov_base = header.data(), .iov_len = header.size()},
+                             iovec{.iov_base = message.data(), .iov_len = message.size()}};
+
+        return lines.send(iov, std::chrono::nanoseconds(seq), now);
+    }
+
+    // one packet per sequence number 1..count
+    void send_packets(Lines& lines, types::header::SequenceNumber count, Lines::Clock::time_point now = Lines::Clock::now())
+    {
+        for (types::header::SequenceNumber seq{1}; seq <= count; ++seq)
+        {
+            send_packet(lines, seq, now);
+        }
+    }
+
+    std::vector<types::header::SequenceNumber> sequence_numbers(types::header::SequenceNumber first,
+                                                                types::header::SequenceNumber last)
+    {
+        std::vector<types::header::SequenceNumber> numbers;
+        for (auto seq{first}; seq <= last; ++seq)
+        {
+            numbers.push_back(seq);
+        }
+        return numbers;
+    }
+}
+
+class LinesTest : public ::testing::Test
+{
+  protected:
+    imr::util::FileDescriptor socket_{socket(AF_INET, SOCK_DGRAM, 0)};
+    Receiver a_;
+    Receiver b_;
+
+    Lines make_lines(const Lines::Impairment& a_impairment,
+                     const Lines::Impairment& b_impairment,
+                     FaultJournal* journal = nullptr)
+    {
+        const std::array redundant{Lines::Line{.mcast_group = "127.0.0.1", .port = b_.port(), .impairment = b_impairment}};
+        return Lines(socket_.get(), a_.address, a_impairment, redundant, max_packet_size, journal);
+    }
+};
+
+TEST_F(LinesTest, Ctor_InvalidLineGroup_ThrowsInvalidArgument)
+{
+    const std::array redundant{Lines::Line{.mcast_group = "badip", .port = 1}};
+    EXPECT_THROW(Lines(socket_.get(), a_.address, {}, redundant, max_packet_size), std::invalid_argument);
+}
+
+TEST_F(LinesTest, Send_NoImpairment_EveryLineGetsEveryPacketInOrder)
+{
+    auto lines{make_lines({}, {})};
+    EXPECT_EQ(lines.size(), 2);
+
+    send_packets(lines, 10);
+
+    EXPECT_EQ(a_.drain(), sequence_numbers(1, 10));
+    EXPECT_EQ(b_.drain(), sequence_numbers(1, 10));
+}
+
+TEST_F(LinesTest, Send_ReturnsWhetherTheTransportSentIt)
+{
+    auto lines{make_lines({}, {})};
+    EXPECT_TRUE(send_packet(lines, 1));
+
+    // nothing to send isn't a failure
+    auto dropping{make_lines({.drop = 1.0}, {.drop = 1.0})};
+    EXPECT_TRUE(send_packet(dropping, 1));
+
+    // port 0, sendmmsg() fails with EINVAL
+    auto unsendable{a_.address};
+    unsendable.sin_port = 0;
+    Lines failing(socket_.get(), unsendable, {}, {}, max_packet_size);
+    EXPECT_FALSE(send_packet(failing, 1));
+}
+
+TEST_F(LinesTest, Send_ControlPacket_GoesOutOnEveryLine)
+{
+    const auto lines{make_lines({.drop = 1.0}, {.drop = 1.0})};
+
+    constexpr std::array<char, types::header::length> heartbeat{};
+    lines.send(heartbeat);
+
+    EXPECT_EQ(a_.drain().size(), 1);
+    EXPECT_EQ(b_.drain().size(), 1);
+}
+
+TEST_F(LinesTest, Send_DropOnOneLine_OtherLineUnaffected)
+{
+    auto lines{make_lines({}, {.drop = 1.0})};
+
+    send_packets(lines, 10);
+
+    EXPECT_EQ(a_.drain(), sequence_numbers(1, 10));
+    EXPECT_TRUE(b_.drain().empty());
+}
+
+TEST_F(LinesTest, Send_SameSeed_SameDrops)
+{
+    const Lines::Impairment impairment{.drop = 0.5, .seed = 42};
+    auto lines{make_lines(impairment, impairment)};
+
+    send_packets(lines, 100);
+
+    const auto a{a_.drain()};
+    EXPECT_GT(a.size(), 0);
+    EXPECT_LT(a.size(), 100);
+    EXPECT_EQ(a, b_.drain());
+}
+
+TEST_F(LinesTest, Send_Reorder_AllPacketsArriveOutOfOrder)
+{
+    auto lines{make_lines({.reorder = 0.3, .reorder_depth = 2, .seed = 7}, {})};
+
+    send_packets(lines, 100);
+    lines.flush();
+
+    auto a{a_.drain()};
+    EXPECT_NE(a, sequence_numbers(1, 100));
+
+    std::ranges::sort(a);
+    EXPECT_EQ(a, sequence_numbers(1, 100));
+    EXPECT_EQ(b_.drain(), sequence_numbers(1, 100));
+}
+
+TEST_F(LinesTest, Send_Delay_HeldUntilDue)
+{
+    const auto now{Lines::Clock::now()};
+    auto lines{make_lines({}, {.delay = std::chrono::seconds(1)})};
+
+    EXPECT_FALSE(lines.next_release().has_value());
+
+    send_packets(lines, 3, now);
+
+    EXPECT_EQ(a_.drain(), sequence_numbers(1, 3));
+    EXPECT_TRUE(b_.drain().empty());
+    EXPECT_EQ(lines.next_release(), now + std::chrono::seconds(1));
+
+    lines.release(now + std::chrono::milliseconds(999));
+    EXPECT_TRUE(b_.drain().empty());
+
+    lines.release(now + std::chrono::seconds(1));
+    EXPECT_EQ(b_.drain(), sequence_numbers(1, 3));
+    EXPECT_FALSE(lines.next_release().has_value());
+}
+
+TEST_F(LinesTest, Send_Duplicate_EveryPacketTwice)
+{
+    auto lines{make_lines({}, {.duplicate = 1.0})};
+
+    send_packets(lines, 3);
+
+    EXPECT_EQ(a_.drain(), sequence_numbers(1, 3));
+    EXPECT_EQ(b_.drain(), (std::vector<types::header::SequenceNumber>{1, 1, 2, 2, 3, 3}));
+}
+
+TEST_F(LinesTest, Send_ScriptedDrop_DropsRangeFromItsTime)
+{
+    // 2..3 before the event's time go out, 7..8 after don't
+    auto lines{make_lines({.scripted_drops = {{.at = std::chrono::nanoseconds(5), .first = 2, .last = 8}}}, {})};
+
+    send_packets(lines, 10);
+
+    EXPECT_EQ(a_.drain(), (std::vector<types::header::SequenceNumber>{1, 2, 3, 4, 9, 10}));
+    EXPECT_EQ(b_.drain(), sequence_numbers(1, 10));
+}
+
+TEST_F(LinesTest, Send_DelayJitter_AllPacketsArriveOutOfOrder)
+{
+    const auto now{Lines::Clock::now()};
+    auto lines{make_lines({.delay_jitter = std::chrono::milliseconds(10), .seed = 3}, {})};
+
+    send_packets(lines, 100, now);
+    EXPECT_TRUE(a_.drain().empty());
+
+    lines.release(now + std::chrono::milliseconds(10));
+
+    auto a{a_.drain()};
+    EXPECT_NE(a, sequence_numbers(1, 100));
+
+    std::ranges::sort(a);
+    EXPECT_EQ(a, sequence_numbers(1, 100));
+}
+
+class LinesJournalTest : public LinesTest
+{
+  protected:
+    const std::filesystem::path path_{std::filesystem::path(TEST_DATA_DIR) /
+                                      ("LinesJournalTest_" + std::to_string(getpid()) + ".journal")};
+
+    void TearDown() override
+    {
+        std::filesystem::remove(path_);
+    }
+};
+
+TEST_F(LinesJournalTest, Send_Faults_JournaledPerLine)
+{
+    {
+        FaultJournal journal({.path = path_});
+        auto lines{make_lines({.scripted_drops = {{.first = 2, .last = 2}}},
+                              {.drop = 0.5, .duplicate = 0.5, .reorder = 0.5, .delay = std::chrono::microseconds(7), .seed = 11},
+                              &journal)};
+
+        send_packets(lines, 50);
+        lines.flush();
+    }
+
+    const imr::util::MemoryMappedFile journal({.path = path_});
+    const auto records{FaultJournal::parse(journal.as_span())};
+
+    const auto a{std::ranges::find(records, std::uint8_t{0}, &FaultJournal::Record::line)};
+    ASSERT_NE(a, records.end());
+    EXPECT_EQ(*a,
+              (FaultJournal::Record{.timestamp = std::chrono::nanoseconds(2),
+                                    .sequence_number = 2,
+                                    .message_count = 1,
+                                    .line = 0,
+                                    .fault = FaultJournal::Fault::scripted_drop,
+                                    .detail = 0}));
+
+    const auto count{[&records](FaultJournal::Fault fault) {
+        return std::ranges::count_if(records, [fault](const auto& record) { return record.line == 1 && record.fault == fault; });
+    }};
+
+    EXPECT_GT(count(FaultJournal::Fault::drop), 0);
+    EXPECT_GT(count(FaultJournal::Fault::duplicate), 0);
+    EXPECT_GT(count(FaultJournal::Fault::reorder), 0);
+    EXPECT_GT(count(FaultJournal::Fault::delay), 0);
+
+    // B line got every packet journaled as neither dropped nor duplicated once, duplicates twice
+    const auto b{b_.drain()};
+    EXPECT_EQ(std::ssize(b), 50 - count(FaultJournal::Fault::drop) + count(FaultJournal::Fault::duplicate));
+}
+
+TEST(FaultJournalTest, Parse_NotAJournal_ThrowsInvalidArgument)
+{
+    constexpr std::array bad{'n', 'o', 'p', 'e'};
+    EXPECT_THROW(static_cast<void>(FaultJournal::parse(bad)), std::invalid_argument);
+}
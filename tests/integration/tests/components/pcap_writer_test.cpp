@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+
+#include "itch_file_fixture.h"
+
+#include "imr/mold/downstream/feed.h"
+#include "imr/mold/downstream/file_source.h"
+#include "imr/mold/downstream/pcap_source.h"
+#include "imr/mold/packet_builder.h"
+#include "imr/mold/retransmission_buffer.h"
+#include "imr/util/memory_mapped_file.h"
+
+#include <filesystem>
+#include <stop_token>
+
+#include <unistd.h>
+
+using namespace imr::mold;
+using namespace std::chrono_literals;
+
+namespace
+{
+    constexpr auto num_messages{256UZ};
+    constexpr auto content{test_common::ItchFileFixture<num_messages, 1'000'000>::get_test_content()};
+    constexpr auto MTU{200UZ};
+}
+
+class PcapWriterTest : public ::testing::Test
+{
+  protected:
+    const std::filesystem::path path_{std::filesystem::path(TEST_DATA_DIR) /
+                                      ("PcapWriterTest_" + std::to_string(getpid()) + ".pcap")};
+
+    PacketBuilder::Config packet_builder_cfg{.session = "SESSION001", .MTU = MTU};
+
+    void TearDown() override
+    {
+        std::filesystem::remove(path_);
+    }
+
+    void write_capture()
+    {
+        downstream::FileSource source{content};
+        RetransmissionBuffer retransmission_buffer{num_messages};
+
+        downstream::Feed feed({.mcast_group = "239.0.0.1",
+                               .port = 3400,
+                               .heartbeat_period = 10ms,
+                               .end_of_session_duration = 50ms,
+                               .pacer_cfg = {.skip_before = 0ns},
+                               .pcap_output = downstream::PcapWriter::Config{.path = path_}},
+                              packet_builder_cfg,
+                              source,
+                              retransmission_buffer);
+
+        feed.start(std::stop_token{});
+    }
+};
+
+TEST_F(PcapWriterTest, Start_WritesEveryMessageInMtuSizedPackets)
+{
+    write_capture();
+
+    const imr::util::MemoryMappedFile capture({.path = path_});
+    downstream::PcapSource source(capture.as_span(), {.port = 3400});
+
+    RetransmissionBuffer retransmission_buffer{num_messages};
+    PacketBuilder packet_builder{packet_builder_cfg};
+
+    constexpr auto per_packet{(MTU - types::header::length) / PacketBuilder::min_message_size};
+
+    types::header::SequenceNumber seq{1};
+    while (source.peek_timestamp().has_value())
+    {
+        packet_builder.reset(seq);
+        seq = source.fill(packet_builder, retransmission_buffer, seq);
+        EXPECT_LE(packet_builder.message_count(), per_packet);
+    }
+
+    EXPECT_EQ(seq, num_messages + 1);
+}
+
+TEST_F(PcapWriterTest, Start_ItchTimestamps_WritesPacketsAtItchTime)
+{
+    write_capture();
+
+    const imr::util::MemoryMappedFile capture({.path = path_});
+    downstream::PcapSource source(capture.as_span(), {.timing = downstream::PcapSource::Config::Timing::capture});
+
+    // session_date defaults to the epoch so capture time == ITCH time
+    EXPECT_EQ(source.peek_timestamp(), 0ns);
+}
+
+TEST_F(PcapWriterTest, Ctor_DirectoryPath_ThrowsInvalidArgument)
+{
+    EXPECT_THROW(downstream::PcapWriter({.path = TEST_DATA_DIR}, {}), std::invalid_argument);
+}
@@ -0,0 +1,161 @@
+#include <gtest/gtest.h>
+
+#include "itch_file_fixture.h"
+
+#include "imr/mold/downstream/feed.h"
+#include "imr/mold/downstream/playlist_source.h"
+#include "imr/mold/packet_builder.h"
+#include "imr/mold/retransmission_buffer.h"
+#include "imr/util/memory_mapped_file.h"
+#include "util/binary_io.h"
+
+#include <filesystem>
+#include <stop_token>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace imr::mold;
+using namespace std::chrono_literals;
+
+namespace
+{
+    constexpr auto num_messages{64UZ};
+    constexpr auto content{test_common::ItchFileFixture<num_messages, 1'000'000>::get_test_content()};
+
+    // pcap global header, record header, ethernet / IPv4 / UDP headers
+    constexpr auto pcap_header_length{24UZ};
+    constexpr auto record_header_length{16UZ};
+    constexpr auto frame_header_length{14UZ + 20 + 8};
+
+    struct Packet
+    {
+        std::string session;
+        types::header::SequenceNumber sequence_number;
+        types::header::MessageCount message_count;
+    };
+
+    std::vector<Packet> read_packets(std::span<const char> capture)
+    {
+        std::vector<Packet> packets;
+
+        for (auto pos{pcap_header_length}; pos + record_header_length <= capture.size();)
+        {
+            const auto length{imr::util::binary_io::read_at<std::uint32_t>(capture, pos + 8)};
+            const auto mold_header{capture.subspan(pos + record_header_length + frame_header_length, types::header::length)};
+
+            packets.push_back({
+                .session = std::string(mold_header.data(), sizeof(types::header::Session)),
+                .sequence_number = imr::util::binary_io::read_at_be<types::header::SequenceNumber>(mold_header, types::header::sequence_number_offset),
+                .message_count = imr::util::binary_io::read_at_be<types::header::MessageCount>(mold_header, types::header::message_count_offset),
+            });
+
+            pos += record_header_length + length;
+        }
+
+        return packets;
+    }
+}
+
+class PlaylistSourceTest : public ::testing::Test
+{
+  protected:
+    const std::filesystem::path path_{std::filesystem::path(TEST_DATA_DIR) /
+                                      ("PlaylistSourceTest_" + std::to_string(getpid()) + ".pcap")};
+
+    RetransmissionBuffer retransmission_buffer{2 * num_messages};
+
+    void TearDown() override
+    {
+        std::filesystem::remove(path_);
+    }
+
+    // plays `file` twice, returning the MoldUDP64 headers written
+    std::vector<Packet> play_twice(downstream::Feed::Config::Rollover rollover, std::span<const char> file = content)
+    {
+        downstream::PlaylistSource source({file}, {.loops = 2});
+
+        downstream::Feed feed({.mcast_group = "239.0.0.1",
+                               .port = 3400,
+                               .heartbeat_period = 10ms,
+                               .end_of_session_duration = 30ms,
+                               .pacer_cfg = {.skip_before = 0ns},
+                               .pcap_output = downstream::PcapWriter::Config{.path = path_},
+                               .rollover = rollover},
+                              {.session = "SESSION001", .MTU = 200},
+                              source,
+                              retransmission_buffer);
+
+        feed.start(std::stop_token{});
+
+        const imr::util::MemoryMappedFile capture({.path = path_});
+        return read_packets(capture.as_span());
+    }
+
+    static types::header::SequenceNumber count_messages(const std::vector<Packet>& packets, std::string_view session)
+    {
+        types::header::SequenceNumber count{0};
+        for (const auto& packet : packets)
+        {
+            if (packet.session == session && packet.message_count != types::header::end_of_session_msg_count)
+            {
+                count += packet.message_count;
+            }
+        }
+        return count;
+    }
+};
+
+TEST_F(PlaylistSourceTest, Ctor_NoFiles_ThrowsInvalidArgument)
+{
+    EXPECT_THROW(downstream::PlaylistSource({}, {}), std::invalid_argument);
+}
+
+TEST_F(PlaylistSourceTest, Start_SessionRollover_EndsSessionThenRestartsSequence)
+{
+    const auto packets{play_twice(downstream::Feed::Config::Rollover::session)};
+
+    ASSERT_FALSE(packets.empty());
+    EXPECT_EQ(count_messages(packets, "SESSION001"), num_messages);
+    EXPECT_EQ(count_messages(packets, "SESSION002"), num_messages);
+
+    const auto first_new{std::ranges::find(packets, std::string{"SESSION002"}, &Packet::session)};
+    ASSERT_NE(first_new, packets.end());
+    EXPECT_EQ(first_new->sequence_number, 1u);
+
+    // end of session handshake for the first session before the second starts
+    const auto previous{std::prev(first_new)};
+    EXPECT_EQ(previous->session, "SESSION001");
+    EXPECT_EQ(previous->message_count, types::header::end_of_session_msg_count);
+    EXPECT_EQ(previous->sequence_number, num_messages + 1);
+
+    EXPECT_EQ(retransmission_buffer.session_index(), 1u);
+}
+
+TEST_F(PlaylistSourceTest, Start_SequenceRollover_ContinuesSequence)
+{
+    const auto packets{play_twice(downstream::Feed::Config::Rollover::sequence)};
+
+    EXPECT_EQ(count_messages(packets, "SESSION001"), 2 * num_messages);
+    EXPECT_EQ(packets.back().message_count, types::header::end_of_session_msg_count);
+    EXPECT_EQ(packets.back().sequence_number, (2 * num_messages) + 1);
+
+    // second pass still retransmittable, from the same file
+    const auto position{retransmission_buffer.file_position_for((2 * num_messages) - 1)};
+    ASSERT_TRUE(position.has_value());
+    EXPECT_EQ(*position, (num_messages - 2) * PacketBuilder::min_message_size);
+}
+
+TEST_F(PlaylistSourceTest, Start_MalformedTail_MovesOnToNextPass)
+{
+    // 60 messages (5 full packets at this MTU), then a message cut short starting the next packet
+    constexpr auto full_messages{60UZ};
+    const std::span file{std::span{content}.first(((full_messages + 1) * PacketBuilder::min_message_size) - 1)};
+
+    const auto packets{play_twice(downstream::Feed::Config::Rollover::sequence, file)};
+
+    EXPECT_EQ(count_messages(packets, "SESSION001"), 2 * full_messages);
+    EXPECT_EQ(packets.back().message_count, types::header::end_of_session_msg_count);
+    EXPECT_EQ(packets.back().sequence_number, (2 * full_messages) + 1);
+}
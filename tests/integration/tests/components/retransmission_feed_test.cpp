@@ -3,13 +3,22 @@
 
 #include "imr/mold/retransmission_buffer.h"
 #include "imr/mold/retransmission/feed.h"
+#include "imr/util/file_descriptor.h"
+#include "itch_file_fixture.h"
+#include "util/binary_io.h"
+
+#include <algorithm>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <unistd.h>
 
 using namespace imr::mold;
 
 namespace
 {
     constexpr std::array file{'c', 'd', 'e'};
-    constexpr std::span file_span{file};
+    constexpr std::span<const char> file_span{file};
 }
 class RetransmissionFeedTest : public ::testing::Test
 {
@@ -58,3 +67,126 @@ TEST_F(RetransmissionFeedTest, Ctor_InvalidShutdownFd_ThrowsInvalidArugment)
                                       0),
                  std::invalid_argument);
 }
+
+TEST_F(RetransmissionFeedTest, Start_TwoChannels_RoutesRequestBySession)
+{
+    constexpr auto first_content{test_common::ItchFileFixture<2, 1>::get_test_content()};
+    constexpr auto second_content{test_common::ItchFileFixture<2, 1000>::get_test_content()};
+    constexpr auto msg_size{PacketBuilder::min_message_size};
+    constexpr types::header::Session second_session{'C', 'H', 'A', 'N', 'N', 'E', 'L', '0', '0', '2'};
+
+    RetransmissionBuffer first_buffer{2};
+    RetransmissionBuffer second_buffer{2};
+    first_buffer.push({.sequence_number = 1, .file_position = 0});
+    second_buffer.push({.sequence_number = 1, .file_position = msg_size});
+
+    // let the kernel pick a port, then hand it to the feed
+    imr::util::FileDescriptor client{socket(AF_INET, SOCK_DGRAM, 0)};
+    sockaddr_in addr{.sin_family = AF_INET, .sin_port = 0, .sin_addr = {.s_addr = htonl(INADDR_LOOPBACK)}};
+    socklen_t len{sizeof(addr)};
+    ASSERT_EQ(bind(client.get(), reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+    ASSERT_EQ(getsockname(client.get(), reinterpret_cast<sockaddr*>(&addr), &len), 0);
+    const auto port{ntohs(addr.sin_port)};
+    client = imr::util::FileDescriptor{socket(AF_INET, SOCK_DGRAM, 0)};
+
+    constexpr timeval timeout{.tv_sec = 1, .tv_usec = 0};
+    ASSERT_EQ(setsockopt(client.get(), SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)), 0);
+
+    const imr::util::FileDescriptor shutdown_fd{eventfd(0, EFD_CLOEXEC)};
+    retransmission::Feed feed({.address = "127.0.0.1", .port = port},
+                              packet_builder_cfg,
+                              {{.session = {'C', 'H', 'A', 'N', 'N', 'E', 'L', '0', '0', '1'},
+                                .message_store = std::span<const char>{first_content},
+                                .retransmission_buffer = &first_buffer},
+                               {.session = second_session,
+                                .message_store = std::span<const char>{second_content},
+                                .retransmission_buffer = &second_buffer}},
+                              shutdown_fd.get());
+
+    std::jthread feed_thread([&feed] { feed.start(); });
+
+    std::array<char, types::header::length> request{};
+    imr::util::binary_io::write_at(std::span(request), types::header::session_offset, second_session);
+    imr::util::binary_io::write_at_be<types::header::SequenceNumber>(std::span(request), types::header::sequence_number_offset, 1);
+    imr::util::binary_io::write_at_be<types::header::MessageCount>(std::span(request), types::header::message_count_offset, 1);
+
+    addr.sin_port = htons(port);
+    ASSERT_EQ(sendto(client.get(), request.data(), request.size(), 0, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)),
+              static_cast<ssize_t>(request.size()));
+
+    std::array<char, types::header::length + msg_size> response{};
+    const auto bytes_recv{recv(client.get(), response.data(), response.size(), 0)};
+
+    constexpr std::uint64_t stop{1};
+    ASSERT_EQ(write(shutdown_fd.get(), &stop, sizeof(stop)), static_cast<ssize_t>(sizeof(stop)));
+
+    ASSERT_EQ(bytes_recv, static_cast<ssize_t>(response.size()));
+    EXPECT_TRUE(std::ranges::equal(std::span(response).first(sizeof(types::header::Session)), second_session));
+    EXPECT_TRUE(std::ranges::equal(std::span(response).subspan(types::header::length),
+                                   std::span(second_content).subspan(msg_size, msg_size)));
+}
+
+TEST_F(RetransmissionFeedTest, Ctor_ShmTransport_ThrowsInvalidArgument)
+{
+    EXPECT_THROW(make_feed({.address = "127.0.0.1", .port = 0, .transport = imr::mold::transport::Kind::shm}),
+                 std::invalid_argument);
+}
+
+TEST_F(RetransmissionFeedTest, Start_MemoryTransport_CapturesResponse)
+{
+    constexpr auto content{test_common::ItchFileFixture<2, 1>::get_test_content()};
+    constexpr auto msg_size{PacketBuilder::min_message_size};
+
+    RetransmissionBuffer buffer{2};
+    buffer.push({.sequence_number = 1, .file_position = 0});
+    buffer.push({.sequence_number = 2, .file_position = msg_size});
+
+    // let the kernel pick a port, then hand it to the feed
+    imr::util::FileDescriptor client{socket(AF_INET, SOCK_DGRAM, 0)};
+    sockaddr_in addr{.sin_family = AF_INET, .sin_port = 0, .sin_addr = {.s_addr = htonl(INADDR_LOOPBACK)}};
+    socklen_t len{sizeof(addr)};
+    ASSERT_EQ(bind(client.get(), reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+    ASSERT_EQ(getsockname(client.get(), reinterpret_cast<sockaddr*>(&addr), &len), 0);
+    const auto port{ntohs(addr.sin_port)};
+    client = imr::util::FileDescriptor{socket(AF_INET, SOCK_DGRAM, 0)};
+
+    const imr::util::FileDescriptor shutdown_fd{eventfd(0, EFD_CLOEXEC)};
+    retransmission::Feed feed({.address = "127.0.0.1", .port = port, .transport = imr::mold::transport::Kind::memory},
+                              packet_builder_cfg,
+                              std::span<const char>{content},
+                              buffer,
+                              shutdown_fd.get());
+
+    imr::util::Histogram service_time;
+    feed.record_service_time(service_time);
+
+    std::jthread feed_thread([&feed] { feed.start(); });
+
+    // requests still arrive on the socket
+    std::array<char, types::header::length> request{};
+    imr::util::binary_io::write_at(std::span(request), types::header::session_offset, std::string_view{"SESSION001"});
+    imr::util::binary_io::write_at_be<types::header::SequenceNumber>(std::span(request), types::header::sequence_number_offset, 1);
+    imr::util::binary_io::write_at_be<types::header::MessageCount>(std::span(request), types::header::message_count_offset, 2);
+
+    ASSERT_EQ(sendto(client.get(), request.data(), request.size(), 0, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)),
+              static_cast<ssize_t>(request.size()));
+
+    for (auto i{0}; i < 1000 && feed.memory_sink().packets().empty(); ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    constexpr std::uint64_t stop{1};
+    ASSERT_EQ(write(shutdown_fd.get(), &stop, sizeof(stop)), static_cast<ssize_t>(sizeof(stop)));
+    feed_thread.join();
+
+    const auto packets{feed.memory_sink().packets()};
+    ASSERT_EQ(packets.size(), 1U);
+    EXPECT_EQ(packets.front().destination.sin_addr.s_addr, htonl(INADDR_LOOPBACK));
+    ASSERT_EQ(packets.front().bytes.size(), types::header::length + (2 * msg_size));
+    EXPECT_TRUE(std::ranges::equal(std::span(packets.front().bytes).subspan(types::header::length), content));
+
+    imr::util::Histogram::Snapshot snapshot;
+    snapshot.add(service_time);
+    EXPECT_EQ(snapshot.count(), 1U);
+}
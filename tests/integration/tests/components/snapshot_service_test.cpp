@@ -0,0 +1,286 @@
+#include <gtest/gtest.h>
+
+#include "imr/mold/snapshot/service.h"
+#include "imr/mold/message_store.h"
+#include "imr/mold/retransmission_buffer.h"
+#include "imr/mold/types.h"
+#include "imr/util/file_descriptor.h"
+#include "itch/order_book.h"
+#include "util/binary_io.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+using namespace imr::mold;
+
+namespace
+{
+    // appends a length prefixed add order and returns its file position
+    std::size_t append_add_order(std::vector<char>& file, std::uint64_t reference, std::uint16_t locate)
+    {
+        const auto position{file.size()};
+
+        std::vector<char> message(itch::add_order_size, ' ');
+        message[0] = itch::add_order_type;
+        imr::util::binary_io::write_at_be(std::span(message), 1, locate);
+        imr::util::binary_io::write_at_be(std::span(message), itch::order_reference_offset, reference);
+        message[itch::side_offset] = 'B';
+        imr::util::binary_io::write_at_be(std::span(message), itch::add_shares_offset, std::uint32_t{100});
+        imr::util::binary_io::write_at_be(std::span(message), itch::add_price_offset, std::uint32_t{5000});
+
+        file.push_back(0);
+        file.push_back(static_cast<char>(message.size()));
+        file.insert(file.end(), message.begin(), message.end());
+
+        return position;
+    }
+
+    // whole stream the service sends before closing the connection
+    std::vector<char> fetch_snapshot(std::uint16_t port)
+    {
+        const imr::util::FileDescriptor client{socket(AF_INET, SOCK_STREAM, 0)};
+
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        EXPECT_EQ(connect(client.get(), reinterpret_cast<const sockaddr*>(&address), sizeof(address)), 0);
+
+        std::vector<char> snapshot;
+        std::array<char, 4096> buffer{};
+
+        for (auto received{recv(client.get(), buffer.data(), buffer.size(), 0)}; received > 0;
+             received = recv(client.get(), buffer.data(), buffer.size(), 0))
+        {
+            snapshot.insert(snapshot.end(), buffer.begin(), buffer.begin() + received);
+        }
+
+        return snapshot;
+    }
+
+    struct Parsed
+    {
+        std::vector<std::uint64_t> references;
+        std::string end_of_snapshot;
+    };
+
+    Parsed parse(const std::vector<char>& snapshot)
+    {
+        Parsed parsed;
+
+        for (auto offset{0UZ}; offset < snapshot.size();)
+        {
+            const auto length{imr::util::binary_io::read_at_be<types::LengthPrefix>(snapshot, offset)};
+            const std::span message{std::span(snapshot).subspan(offset + sizeof(types::LengthPrefix), length)};
+            offset += sizeof(types::LengthPrefix) + length;
+
+            if (message[0] == itch::add_order_type)
+            {
+                parsed.references.push_back(imr::util::binary_io::read_at_be<std::uint64_t>(message, itch::order_reference_offset));
+            }
+            else if (message[0] == snapshot::Service::end_of_snapshot_type)
+            {
+                parsed.end_of_snapshot.assign(message.begin(), message.end());
+            }
+        }
+
+        return parsed;
+    }
+}
+
+class SnapshotServiceTest : public ::testing::Test
+{
+  protected:
+    static constexpr std::size_t message_count{32};
+
+    // add orders with references 101..132, all mapped before the service reads them
+    std::vector<char> file_;
+    std::vector<std::size_t> positions_;
+    RetransmissionBuffer retransmission_buffer_{1024};
+
+    void SetUp() override
+    {
+        for (auto i{0UZ}; i < message_count; ++i)
+        {
+            positions_.push_back(append_add_order(file_, 101 + i, 1));
+        }
+    }
+
+    // records sequence numbers first..last as the downstream would, seq N being the Nth message of the file
+    void publish(types::header::SequenceNumber first, types::header::SequenceNumber last)
+    {
+        for (auto seq{first}; seq <= last; ++seq)
+        {
+            retransmission_buffer_.push({.sequence_number = seq, .file_position = positions_[seq - 1]});
+        }
+    }
+
+    // snapshot once the book has caught up to `seq`
+    Parsed snapshot_at(const snapshot::Service& service, types::header::SequenceNumber seq)
+    {
+        const auto expected{std::to_string(seq + 1)};
+
+        for (auto deadline{std::chrono::steady_clock::now() + std::chrono::seconds(5)}; std::chrono::steady_clock::now() < deadline;)
+        {
+            auto parsed{parse(fetch_snapshot(service.port()))};
+            if (parsed.end_of_snapshot.substr(1, expected.size() + 1) == expected + ' ')
+            {
+                return parsed;
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        ADD_FAILURE() << "book never reached " << seq;
+        return {};
+    }
+};
+
+TEST_F(SnapshotServiceTest, Connect_SendsBookThenResumeSequence)
+{
+    publish(1, 10);
+
+    snapshot::Service service({.address = "127.0.0.1", .port = 0}, MessageStore(file_), retransmission_buffer_);
+    std::jthread thread([&service](std::stop_token st) { service.start(st); });
+
+    const auto parsed{snapshot_at(service, 10)};
+
+    ASSERT_EQ(parsed.end_of_snapshot.size(), snapshot::Service::end_of_snapshot_size);
+    EXPECT_EQ(parsed.end_of_snapshot, "G11                  ");
+    ASSERT_EQ(parsed.references.size(), 10u);
+    EXPECT_EQ(parsed.references.front(), 101u);
+    EXPECT_EQ(parsed.references.back(), 110u);
+}
+
+TEST_F(SnapshotServiceTest, Connect_AfterMorePublished_FollowsTheFeed)
+{
+    publish(1, 5);
+
+    snapshot::Service service({.address = "127.0.0.1", .port = 0}, MessageStore(file_), retransmission_buffer_);
+    std::jthread thread([&service](std::stop_token st) { service.start(st); });
+
+    EXPECT_EQ(snapshot_at(service, 5).references.size(), 5u);
+
+    publish(6, 20);
+    EXPECT_EQ(snapshot_at(service, 20).references.size(), 20u);
+}
+
+TEST_F(SnapshotServiceTest, RollSession_RestartsEmpty)
+{
+    publish(1, 5);
+
+    snapshot::Service service({.address = "127.0.0.1", .port = 0}, MessageStore(file_), retransmission_buffer_);
+    std::jthread thread([&service](std::stop_token st) { service.start(st); });
+
+    EXPECT_EQ(snapshot_at(service, 5).references.size(), 5u);
+
+    retransmission_buffer_.roll_session();
+    retransmission_buffer_.push({.sequence_number = 1, .file_position = positions_.back()});
+
+    const auto parsed{snapshot_at(service, 1)};
+    ASSERT_EQ(parsed.references.size(), 1u);
+    EXPECT_EQ(parsed.references.front(), 132u);
+}
+
+TEST(SnapshotServiceCtorTest, InvalidAddress_ThrowsInvalidArgument)
+{
+    const std::vector<char> file;
+    const RetransmissionBuffer retransmission_buffer(16);
+
+    EXPECT_THROW(snapshot::Service({.address = "not an address", .port = 0}, MessageStore(file), retransmission_buffer),
+                 std::invalid_argument);
+}
+
+class SnapshotServiceStalledClientTest : public ::testing::Test
+{
+  protected:
+    // enough resting orders that a snapshot outgrows the socket buffers
+    static constexpr std::size_t message_count{200'000};
+
+    std::vector<char> file_;
+    RetransmissionBuffer retransmission_buffer_{1U << 18U};
+
+    void SetUp() override
+    {
+        for (auto i{0UZ}; i < message_count; ++i)
+        {
+            const auto position{append_add_order(file_, 1 + i, 1)};
+            retransmission_buffer_.push({.sequence_number = i + 1, .file_position = position});
+        }
+    }
+
+    static void wait_for_book(const snapshot::Service& service)
+    {
+        for (auto deadline{std::chrono::steady_clock::now() + std::chrono::seconds(10)}; std::chrono::steady_clock::now() < deadline;)
+        {
+            if (parse(fetch_snapshot(service.port())).references.size() == message_count)
+            {
+                return;
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+
+        ADD_FAILURE() << "book never caught up";
+    }
+
+    // connected, with a small receive window, and never read
+    static imr::util::FileDescriptor connect_stalled(std::uint16_t port)
+    {
+        imr::util::FileDescriptor client{socket(AF_INET, SOCK_STREAM, 0)};
+
+        constexpr auto receive_buffer{4096};
+        EXPECT_EQ(setsockopt(client.get(), SOL_SOCKET, SO_RCVBUF, &receive_buffer, sizeof(receive_buffer)), 0);
+
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        EXPECT_EQ(connect(client.get(), reinterpret_cast<const sockaddr*>(&address), sizeof(address)), 0);
+        return client;
+    }
+};
+
+TEST_F(SnapshotServiceStalledClientTest, Stop_WhileSendingToStalledClient_Returns)
+{
+    snapshot::Service service({.address = "127.0.0.1", .port = 0, .send_timeout = std::chrono::seconds(60)},
+                              MessageStore(file_),
+                              retransmission_buffer_);
+    std::jthread thread([&service](std::stop_token st) { service.start(st); });
+
+    wait_for_book(service);
+
+    const auto stalled{connect_stalled(service.port())};
+    // the service fills the socket buffers and blocks
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    const auto before{std::chrono::steady_clock::now()};
+    thread.request_stop();
+    thread.join();
+
+    EXPECT_LT(std::chrono::steady_clock::now() - before, std::chrono::seconds(5));
+}
+
+TEST_F(SnapshotServiceStalledClientTest, Connect_AfterStalledClient_ServedOnceItTimesOut)
+{
+    snapshot::Service service({.address = "127.0.0.1", .port = 0, .send_timeout = std::chrono::milliseconds(100)},
+                              MessageStore(file_),
+                              retransmission_buffer_);
+    std::jthread thread([&service](std::stop_token st) { service.start(st); });
+
+    wait_for_book(service);
+
+    const auto stalled{connect_stalled(service.port())};
+
+    EXPECT_EQ(parse(fetch_snapshot(service.port())).references.size(), message_count);
+}
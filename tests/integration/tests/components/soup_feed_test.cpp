@@ -0,0 +1,400 @@
+#include <gtest/gtest.h>
+
+#include "imr/mold/soup/feed.h"
+#include "imr/mold/message_store.h"
+#include "imr/mold/retransmission_buffer.h"
+#include "imr/mold/types.h"
+#include "imr/util/file_descriptor.h"
+#include "util/binary_io.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+using namespace imr::mold;
+
+namespace
+{
+    constexpr std::string_view session{"SESSION001"};
+
+    struct Packet
+    {
+        char type;
+        std::string payload;
+    };
+
+    // blocking SoupBinTCP client
+    struct Client
+    {
+        imr::util::FileDescriptor socket{::socket(AF_INET, SOCK_STREAM, 0)};
+
+        explicit Client(std::uint16_t port, std::optional<int> receive_buffer = std::nullopt)
+        {
+            if (receive_buffer.has_value())
+            {
+                EXPECT_EQ(setsockopt(socket.get(), SOL_SOCKET, SO_RCVBUF, &*receive_buffer, sizeof(*receive_buffer)), 0);
+            }
+
+            timeval timeout{.tv_sec = 5, .tv_usec = 0};
+            EXPECT_EQ(setsockopt(socket.get(), SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)), 0);
+
+            sockaddr_in address{};
+            address.sin_family = AF_INET;
+            address.sin_port = htons(port);
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+            EXPECT_EQ(connect(socket.get(), reinterpret_cast<const sockaddr*>(&address), sizeof(address)), 0);
+        }
+
+        void login(std::uint64_t sequence_number,
+                   std::string_view requested_session = "",
+                   std::string_view username = "",
+                   std::string_view password = "") const
+        {
+            std::string packet{"\0\0L", 3};
+            const auto field{[&packet](std::string_view value, std::size_t size, bool right) {
+                const std::string padding(size - value.size(), ' ');
+                packet += right ? padding + std::string(value) : std::string(value) + padding;
+            }};
+
+            field(username, types::soup::username_size, false);
+            field(password, types::soup::password_size, false);
+            field(requested_session, session.size(), false);
+            field(std::to_string(sequence_number), types::soup::sequence_number_size, true);
+
+            packet[1] = static_cast<char>(packet.size() - sizeof(types::soup::Length));
+            ASSERT_EQ(send(socket.get(), packet.data(), packet.size(), 0), static_cast<ssize_t>(packet.size()));
+        }
+
+        // nullopt once the server closes the connection
+        std::optional<Packet> receive() const
+        {
+            std::array<char, sizeof(types::soup::Length)> length{};
+            if (!receive_exactly(length))
+            {
+                return std::nullopt;
+            }
+
+            std::string body(imr::util::binary_io::read_at_be<types::soup::Length>(length, 0), '\0');
+            if (!receive_exactly(body))
+            {
+                return std::nullopt;
+            }
+
+            return Packet{.type = body[0], .payload = body.substr(1)};
+        }
+
+        // next packet that isn't a heartbeat
+        std::optional<Packet> receive_data() const
+        {
+            auto packet{receive()};
+            while (packet.has_value() && packet->type == types::soup::server_heartbeat_type)
+            {
+                packet = receive();
+            }
+            return packet;
+        }
+
+        bool receive_exactly(std::span<char> out) const
+        {
+            while (!out.empty())
+            {
+                const auto received{recv(socket.get(), out.data(), out.size(), 0)};
+                if (received <= 0)
+                {
+                    return false;
+                }
+                out = out.subspan(static_cast<std::size_t>(received));
+            }
+            return true;
+        }
+    };
+
+    std::string login_accepted(std::uint64_t next)
+    {
+        const auto sequence_number{std::to_string(next)};
+        return std::string(session) + std::string(types::soup::sequence_number_size - sequence_number.size(), ' ') + sequence_number;
+    }
+}
+
+class SoupFeedTest : public ::testing::Test
+{
+  protected:
+    static constexpr std::size_t message_count{64};
+
+    // message N (1 based) is "N" padded to 8 + N % 16 characters, length prefixed
+    std::vector<char> file_;
+    std::vector<std::size_t> positions_;
+    RetransmissionBuffer retransmission_buffer_{1 << 18U};
+
+    soup::Feed::Config cfg_{.address = "127.0.0.1",
+                            .port = 0,
+                            .username = {},
+                            .password = {},
+                            .max_clients = 1024,
+                            .poll_interval = std::chrono::microseconds(100),
+                            .heartbeat_period = std::chrono::seconds(1),
+                            .client_timeout = std::chrono::seconds(15),
+                            .slow_consumer_timeout = std::chrono::seconds(5),
+                            .drain_timeout = std::chrono::seconds(5)};
+
+    void SetUp() override
+    {
+        make_file(message_count);
+    }
+
+    void make_file(std::size_t count)
+    {
+        file_.clear();
+        positions_.clear();
+
+        for (auto seq{1UZ}; seq <= count; ++seq)
+        {
+            positions_.push_back(file_.size());
+            const auto body{message(seq)};
+            file_.push_back(0);
+            file_.push_back(static_cast<char>(body.size()));
+            file_.insert(file_.end(), body.begin(), body.end());
+        }
+    }
+
+    static std::string message(std::uint64_t seq)
+    {
+        auto body{std::to_string(seq)};
+        body.resize(8 + (seq % 16), '.');
+        return body;
+    }
+
+    void publish(types::header::SequenceNumber first, types::header::SequenceNumber last)
+    {
+        for (auto seq{first}; seq <= last; ++seq)
+        {
+            retransmission_buffer_.push({.sequence_number = seq, .file_position = positions_[seq - 1]});
+        }
+    }
+};
+
+TEST_F(SoupFeedTest, Login_FromOne_ReplaysThenStreamsLive)
+{
+    publish(1, 40);
+
+    soup::Feed feed(cfg_, session, MessageStore(file_), retransmission_buffer_);
+    std::jthread thread([&feed](std::stop_token st) { feed.start(st); });
+
+    const Client client(feed.port());
+    client.login(1);
+
+    const auto accepted{client.receive_data()};
+    ASSERT_TRUE(accepted.has_value());
+    EXPECT_EQ(accepted->type, types::soup::login_accepted_type);
+    EXPECT_EQ(accepted->payload, login_accepted(1));
+
+    for (std::uint64_t seq{1}; seq <= 40; ++seq)
+    {
+        const auto packet{client.receive_data()};
+        ASSERT_TRUE(packet.has_value());
+        ASSERT_EQ(packet->type, types::soup::sequenced_data_type);
+        ASSERT_EQ(packet->payload, message(seq));
+    }
+
+    publish(41, message_count);
+
+    for (std::uint64_t seq{41}; seq <= message_count; ++seq)
+    {
+        const auto packet{client.receive_data()};
+        ASSERT_TRUE(packet.has_value());
+        ASSERT_EQ(packet->payload, message(seq));
+    }
+}
+
+TEST_F(SoupFeedTest, Login_Zero_StartsWithNextMessage)
+{
+    publish(1, 10);
+
+    soup::Feed feed(cfg_, session, MessageStore(file_), retransmission_buffer_);
+    std::jthread thread([&feed](std::stop_token st) { feed.start(st); });
+
+    const Client client(feed.port());
+    client.login(0, session);
+
+    const auto accepted{client.receive_data()};
+    ASSERT_TRUE(accepted.has_value());
+    EXPECT_EQ(accepted->payload, login_accepted(11));
+
+    publish(11, 12);
+
+    EXPECT_EQ(client.receive_data()->payload, message(11));
+    EXPECT_EQ(client.receive_data()->payload, message(12));
+}
+
+TEST_F(SoupFeedTest, Login_BadCredentialsOrSession_Rejected)
+{
+    cfg_.username = "user";
+    cfg_.password = "secret";
+
+    soup::Feed feed(cfg_, session, MessageStore(file_), retransmission_buffer_);
+    std::jthread thread([&feed](std::stop_token st) { feed.start(st); });
+
+    {
+        const Client client(feed.port());
+        client.login(1, "", "user", "wrong");
+
+        const auto rejected{client.receive()};
+        ASSERT_TRUE(rejected.has_value());
+        EXPECT_EQ(rejected->type, types::soup::login_rejected_type);
+        EXPECT_EQ(rejected->payload, std::string(1, types::soup::reject_not_authorized));
+        EXPECT_FALSE(client.receive().has_value());
+    }
+
+    {
+        const Client client(feed.port());
+        client.login(1, "SESSION999", "user", "secret");
+
+        const auto rejected{client.receive()};
+        ASSERT_TRUE(rejected.has_value());
+        EXPECT_EQ(rejected->payload, std::string(1, types::soup::reject_session_not_available));
+    }
+
+    {
+        const Client client(feed.port());
+        client.login(1, session, "user", "secret");
+
+        EXPECT_EQ(client.receive()->type, types::soup::login_accepted_type);
+    }
+}
+
+TEST_F(SoupFeedTest, Idle_SendsHeartbeats)
+{
+    cfg_.heartbeat_period = std::chrono::milliseconds(10);
+
+    soup::Feed feed(cfg_, session, MessageStore(file_), retransmission_buffer_);
+    std::jthread thread([&feed](std::stop_token st) { feed.start(st); });
+
+    const Client client(feed.port());
+    client.login(1);
+
+    EXPECT_EQ(client.receive()->type, types::soup::login_accepted_type);
+    EXPECT_EQ(client.receive()->type, types::soup::server_heartbeat_type);
+}
+
+TEST_F(SoupFeedTest, Stop_DrainsThenEndsSession)
+{
+    publish(1, message_count);
+
+    soup::Feed feed(cfg_, session, MessageStore(file_), retransmission_buffer_);
+    std::jthread thread([&feed](std::stop_token st) { feed.start(st); });
+
+    const Client client(feed.port());
+    client.login(1);
+    EXPECT_EQ(client.receive_data()->type, types::soup::login_accepted_type);
+
+    thread.request_stop();
+
+    for (std::uint64_t seq{1}; seq <= message_count; ++seq)
+    {
+        const auto packet{client.receive_data()};
+        ASSERT_TRUE(packet.has_value());
+        ASSERT_EQ(packet->payload, message(seq));
+    }
+
+    EXPECT_EQ(client.receive_data()->type, types::soup::end_of_session_type);
+    EXPECT_FALSE(client.receive().has_value());
+}
+
+TEST_F(SoupFeedTest, RollSession_EndsSessionThenAcceptsNewSession)
+{
+    publish(1, 5);
+
+    soup::Feed feed(cfg_, session, MessageStore(file_), retransmission_buffer_);
+    std::jthread thread([&feed](std::stop_token st) { feed.start(st); });
+
+    {
+        const Client client(feed.port());
+        client.login(6);
+        EXPECT_EQ(client.receive_data()->type, types::soup::login_accepted_type);
+
+        retransmission_buffer_.roll_session();
+
+        EXPECT_EQ(client.receive_data()->type, types::soup::end_of_session_type);
+    }
+
+    const Client client(feed.port());
+    client.login(1, "SESSION002");
+    EXPECT_EQ(client.receive_data()->type, types::soup::login_accepted_type);
+}
+
+TEST_F(SoupFeedTest, ManyClients_EachGetsEveryMessage)
+{
+    constexpr auto clients_count{200UZ};
+
+    soup::Feed feed(cfg_, session, MessageStore(file_), retransmission_buffer_);
+    std::jthread thread([&feed](std::stop_token st) { feed.start(st); });
+
+    std::vector<std::unique_ptr<Client>> clients;
+    for (auto i{0UZ}; i < clients_count; ++i)
+    {
+        clients.push_back(std::make_unique<Client>(feed.port()));
+        clients.back()->login(1);
+        ASSERT_EQ(clients.back()->receive_data()->type, types::soup::login_accepted_type);
+    }
+
+    publish(1, message_count);
+
+    for (const auto& client : clients)
+    {
+        for (std::uint64_t seq{1}; seq <= message_count; ++seq)
+        {
+            const auto packet{client->receive_data()};
+            ASSERT_TRUE(packet.has_value());
+            ASSERT_EQ(packet->payload, message(seq));
+        }
+    }
+}
+
+TEST_F(SoupFeedTest, SlowConsumer_Disconnected)
+{
+    // more than loopback socket buffers hold
+    constexpr auto count{300'000UZ};
+    make_file(count);
+    publish(1, count);
+
+    cfg_.slow_consumer_timeout = std::chrono::milliseconds(50);
+
+    soup::Feed feed(cfg_, session, MessageStore(file_), retransmission_buffer_);
+    std::jthread thread([&feed](std::stop_token st) { feed.start(st); });
+
+    const Client client(feed.port(), 4096);
+    client.login(1);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+    auto received{0UZ};
+    for (auto packet{client.receive()}; packet.has_value(); packet = client.receive())
+    {
+        received += packet->type == types::soup::sequenced_data_type ? 1 : 0;
+    }
+
+    EXPECT_LT(received, count);
+}
+
+TEST(SoupFeedCtorTest, InvalidConfig_ThrowsInvalidArgument)
+{
+    const std::vector<char> file;
+    const RetransmissionBuffer retransmission_buffer(16);
+
+    EXPECT_THROW(soup::Feed({.address = "not an address", .port = 0}, session, MessageStore(file), retransmission_buffer),
+                 std::invalid_argument);
+    EXPECT_THROW(soup::Feed({.address = "127.0.0.1", .port = 0}, "short", MessageStore(file), retransmission_buffer),
+                 std::invalid_argument);
+    EXPECT_THROW(soup::Feed({.address = "127.0.0.1", .port = 0, .username = "toolonguser"}, session, MessageStore(file), retransmission_buffer),
+                 std::invalid_argument);
+}
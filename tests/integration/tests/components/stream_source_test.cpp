@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+
+#include "itch_file_fixture.h"
+
+#include "imr/mold/downstream/stream_source.h"
+#include "imr/mold/packet_builder.h"
+#include "imr/mold/retransmission_buffer.h"
+#include "imr/util/file_descriptor.h"
+
+#include <algorithm>
+#include <array>
+#include <format>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace imr::mold;
+
+namespace
+{
+    constexpr auto num_messages{64UZ};
+    constexpr auto content{test_common::ItchFileFixture<num_messages>::get_test_content()};
+    constexpr auto msg_size{PacketBuilder::min_message_size};
+}
+
+class StreamSourceTest : public ::testing::Test
+{
+  protected:
+    imr::util::FileDescriptor read_end_;
+    std::unique_ptr<downstream::StreamSource> source_;
+
+    RetransmissionBuffer retransmission_buffer{num_messages};
+    PacketBuilder packet_builder{{.session = "SESSION001"}};
+
+    void SetUp() override
+    {
+        std::array<int, 2> fds{};
+        ASSERT_EQ(pipe(fds.data()), 0);
+        read_end_ = imr::util::FileDescriptor(fds[0]);
+
+        // whole fixture fits in the pipe buffer so no writer thread is needed
+        const imr::util::FileDescriptor write_end{fds[1]};
+        ASSERT_EQ(write(write_end.get(), content.data(), content.size()), static_cast<ssize_t>(content.size()));
+
+        source_ = std::make_unique<downstream::StreamSource>(downstream::StreamSource::Config{
+            .path = std::format("/dev/fd/{}", read_end_.get()),
+            .ring_size = 1,
+        });
+    }
+};
+
+TEST_F(StreamSourceTest, Fill_WholeStream_RecordsStreamOffsets)
+{
+    types::header::SequenceNumber seq{1};
+
+    while (source_->peek_timestamp().has_value())
+    {
+        packet_builder.reset(seq);
+        seq = source_->fill(packet_builder, retransmission_buffer, seq);
+        ASSERT_GT(packet_builder.message_count(), 0);
+    }
+
+    ASSERT_EQ(seq, num_messages + 1);
+
+    for (auto i{0UZ}; i < num_messages; ++i)
+    {
+        EXPECT_EQ(retransmission_buffer.file_position_for(i + 1), i * msg_size);
+    }
+}
+
+TEST_F(StreamSourceTest, MessageStore_Read_ReturnsCopyOfStreamedMessage)
+{
+    const auto seq{source_->fill(packet_builder, retransmission_buffer, 1)};
+    ASSERT_GT(seq, 1u);
+
+    const MessageStore store{source_->message_store()};
+    ASSERT_TRUE(store.copies());
+
+    std::array<char, msg_size> scratch{};
+    const auto msg{store.read(msg_size, scratch)};
+
+    ASSERT_EQ(msg.size(), msg_size);
+    EXPECT_TRUE(std::ranges::equal(msg, std::span(content).subspan(msg_size, msg_size)));
+}
+
+TEST_F(StreamSourceTest, Skip_PastEnd_ReturnsFalse)
+{
+    for (auto i{0UZ}; i < num_messages; ++i)
+    {
+        ASSERT_TRUE(source_->skip());
+    }
+
+    EXPECT_FALSE(source_->skip());
+    EXPECT_FALSE(source_->peek_timestamp().has_value());
+}
+
+TEST_F(StreamSourceTest, Ctor_BadPath_ThrowsInvalidArgument)
+{
+    EXPECT_THROW(downstream::StreamSource({.path = "asdf"}), std::invalid_argument);
+}
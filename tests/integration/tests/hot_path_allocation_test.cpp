@@ -0,0 +1,375 @@
+#include <gtest/gtest.h>
+
+#include "server_test_fixture.h"
+#include "itch_file_fixture.h"
+
+#include <imr/mold/types.h>
+#include <imr/server.h>
+#include <imr/util/file_descriptor.h>
+#include <imr/util/hot_path.h>
+#include <imr/util/wait.h>
+#include <util/binary_io.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <print>
+#include <thread>
+#include <utility>
+
+#include <arpa/inet.h>
+#include <execinfo.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/** Allocation tracking: this binary interposes glibc's malloc family (which operator new allocates through), counting
+ *  each thread's allocations outside its hot path (startup, budgeted and reported) and inside it (must be none).
+ *
+ *  Its own executable so the interposition doesn't reach the other tests.
+ */
+namespace
+{
+    using imr::util::hot_path::Kind;
+
+    struct Counts
+    {
+        // before each thread's first hot path entry
+        std::atomic<std::uint64_t> startup{0};
+        // between a thread's hot path exits and entries (playlist items, session rollovers)
+        std::atomic<std::uint64_t> paused{0};
+        std::atomic<std::uint64_t> hot{0};
+        // size of the last hot path allocation, for the failure message
+        std::atomic<std::size_t> hot_size{0};
+        std::atomic<std::uint64_t> threads{0};
+
+        void reset() noexcept
+        {
+            startup.store(0);
+            paused.store(0);
+            hot.store(0);
+            hot_size.store(0);
+            threads.store(0);
+        }
+    };
+
+    std::array<Counts, 3> counts;
+
+    // IMR_HOT_PATH_BACKTRACE set: print where each hot path allocation came from
+    bool print_backtraces{false};
+
+    // plain thread locals in the executable, no allocation to reach them
+    thread_local Kind thread_kind{Kind::none};
+    thread_local std::uint64_t thread_allocations{0};
+    thread_local bool thread_entered{false};
+
+    Counts& counts_of(Kind kind) noexcept
+    {
+        return counts[static_cast<std::size_t>(kind)];
+    }
+
+    void record(std::size_t size) noexcept
+    {
+        if (thread_kind == Kind::none)
+        {
+            ++thread_allocations;
+            return;
+        }
+
+        auto& kind_counts{counts_of(thread_kind)};
+        kind_counts.hot.fetch_add(1, std::memory_order_relaxed);
+        kind_counts.hot_size.store(size, std::memory_order_relaxed);
+
+        if (print_backtraces)
+        {
+            // backtrace() may allocate loading the unwinder
+            const auto kind{std::exchange(thread_kind, Kind::none)};
+
+            std::array<void*, 64> frames{};
+            const auto depth{backtrace(frames.data(), static_cast<int>(frames.size()))};
+            backtrace_symbols_fd(frames.data(), depth, STDERR_FILENO);
+
+            thread_kind = kind;
+        }
+    }
+
+    void entered(Kind kind) noexcept
+    {
+        auto& kind_counts{counts_of(kind)};
+
+        if (!thread_entered)
+        {
+            kind_counts.startup.fetch_add(thread_allocations, std::memory_order_relaxed);
+            kind_counts.threads.fetch_add(1, std::memory_order_release);
+            thread_entered = true;
+        }
+        else
+        {
+            kind_counts.paused.fetch_add(thread_allocations, std::memory_order_relaxed);
+        }
+
+        thread_allocations = 0;
+        thread_kind = kind;
+    }
+
+    void exited(Kind) noexcept
+    {
+        thread_kind = Kind::none;
+    }
+}
+
+extern "C"
+{
+    void* __libc_malloc(std::size_t size);
+    void* __libc_calloc(std::size_t count, std::size_t size);
+    void* __libc_realloc(void* ptr, std::size_t size);
+    void* __libc_memalign(std::size_t alignment, std::size_t size);
+
+    void* malloc(std::size_t size) noexcept
+    {
+        record(size);
+        return __libc_malloc(size);
+    }
+
+    void* calloc(std::size_t count, std::size_t size) noexcept
+    {
+        record(count * size);
+        return __libc_calloc(count, size);
+    }
+
+    void* realloc(void* ptr, std::size_t size) noexcept
+    {
+        record(size);
+        return __libc_realloc(ptr, size);
+    }
+
+    void* aligned_alloc(std::size_t alignment, std::size_t size) noexcept
+    {
+        record(size);
+        return __libc_memalign(alignment, size);
+    }
+
+    int posix_memalign(void** ptr, std::size_t alignment, std::size_t size) noexcept
+    {
+        record(size);
+        *ptr = __libc_memalign(alignment, size);
+        return *ptr != nullptr ? 0 : ENOMEM;
+    }
+}
+
+namespace
+{
+    constexpr auto num_messages{1024};
+    // a second of messages at 1x
+    constexpr std::int64_t message_interval_ns{1'000'000};
+    constexpr auto num_retransmission_feeds{2UZ};
+    constexpr auto num_requests{64};
+
+    imr::Server::Config base_config{
+        .packet_builder_cfg = {.session = "SESSION001"},
+        .downstream_feed_config =
+            {
+                .mcast_group = "239.0.0.1",
+                .loopback = true,
+                .egress_interface = {.s_addr = htonl(INADDR_LOOPBACK)},
+                .heartbeat_period = std::chrono::milliseconds(10),
+                // keeps the retransmission feeds up for the requests once a fast replay is done
+                .end_of_session_duration = std::chrono::milliseconds(500),
+                .pacer_cfg = {.skip_before = std::chrono::nanoseconds(0)},
+            },
+        .retransmission_feed_config = {.address = "127.0.0.1"},
+        .num_retransmission_feeds = num_retransmission_feeds,
+        .metrics_cfg = imr::util::metrics::Registry::Config{},
+    };
+}
+
+class HotPathAllocationTest : public test_common::ServerTestFixture<test_common::ItchFileFixture<num_messages, message_interval_ns>>
+{
+  protected:
+    void SetUp() override
+    {
+        for (auto& kind_counts : counts)
+        {
+            kind_counts.reset();
+        }
+
+        print_backtraces = std::getenv("IMR_HOT_PATH_BACKTRACE") != nullptr;
+        imr::util::hot_path::set_hooks({.entered = entered, .exited = exited});
+    }
+
+    void TearDown() override
+    {
+        imr::util::hot_path::set_hooks({});
+    }
+
+    static void wait_for_threads(Kind kind, std::uint64_t threads)
+    {
+        const auto deadline{std::chrono::steady_clock::now() + std::chrono::seconds(5)};
+
+        while (counts_of(kind).threads.load(std::memory_order_acquire) < threads && std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        ASSERT_EQ(counts_of(kind).threads.load(std::memory_order_acquire), threads);
+    }
+
+    // served, out of range and bad session requests, returns the responses received
+    static int send_requests(std::uint16_t port)
+    {
+        const imr::util::FileDescriptor socket_fd{socket(AF_INET, SOCK_DGRAM, 0)};
+
+        constexpr timeval recv_timeout{.tv_sec = 0, .tv_usec = 100'000};
+        EXPECT_EQ(setsockopt(socket_fd.get(), SOL_SOCKET, SO_RCVTIMEO, &recv_timeout, sizeof(recv_timeout)), 0);
+
+        sockaddr_in dest{};
+        dest.sin_family = AF_INET;
+        dest.sin_port = htons(port);
+        dest.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        auto responses{0};
+
+        for (auto i{0}; i < num_requests; ++i)
+        {
+            std::array<char, imr::mold::types::header::length> request{};
+            std::span request_span(request);
+
+            const bool bad_session{i % 16 == 15};
+            const bool out_of_range{i % 16 == 14};
+
+            imr::util::binary_io::write_at(request_span,
+                                           imr::mold::types::header::session_offset,
+                                           std::string_view(bad_session ? "SESSION999" : "SESSION001"));
+            imr::util::binary_io::write_at_be(request_span,
+                                              imr::mold::types::header::sequence_number_offset,
+                                              imr::mold::types::header::SequenceNumber{out_of_range ? 1'000'000U : 1U});
+            imr::util::binary_io::write_at_be(request_span,
+                                              imr::mold::types::header::message_count_offset,
+                                              static_cast<imr::mold::types::header::MessageCount>(1 + (i % 8)));
+
+            EXPECT_EQ(sendto(socket_fd.get(), request.data(), request.size(), 0, reinterpret_cast<sockaddr*>(&dest), sizeof(dest)),
+                      static_cast<ssize_t>(request.size()));
+
+            if (bad_session || out_of_range)
+            {
+                continue;
+            }
+
+            std::array<char, 1500> response{};
+            if (recv(socket_fd.get(), response.data(), response.size(), 0) > 0)
+            {
+                ++responses;
+            }
+        }
+
+        return responses;
+    }
+
+    static imr::Server::Config make_config(imr::util::wait::Kind wait)
+    {
+        auto config{base_config};
+        config.downstream_feed_config.port = find_free_udp_port();
+        config.downstream_feed_config.wait = wait;
+        return config;
+    }
+
+    // requests retransmissions if the replay is paced on wall time (the others finish, and stop the retransmission
+    // feeds, before the requests get there)
+    void replay(imr::Server::Config config)
+    {
+        const auto wait{config.downstream_feed_config.wait};
+
+        const auto construction_before{thread_allocations};
+        const std::unique_ptr<imr::Server> server{make_test_server(config)};
+        const auto construction{thread_allocations - construction_before};
+
+        server->start();
+
+        wait_for_threads(Kind::downstream, 1);
+        wait_for_threads(Kind::retransmission, num_retransmission_feeds);
+
+        if (wait == imr::util::wait::Kind::sleep || wait == imr::util::wait::Kind::spin)
+        {
+            // seq 1 is out once the replay loop is
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            EXPECT_GT(send_requests(config.retransmission_feed_config.port), 0);
+        }
+
+        server->wait_for_downstream();
+
+        const auto& downstream{counts_of(Kind::downstream)};
+        const auto& retransmission{counts_of(Kind::retransmission)};
+
+        std::println("Allocations at startup: server construction {}, downstream thread {}, retransmission threads {}",
+                     construction,
+                     downstream.startup.load(),
+                     retransmission.startup.load());
+
+        RecordProperty("construction_allocations", std::to_string(construction));
+        RecordProperty("downstream_startup_allocations", std::to_string(downstream.startup.load()));
+        RecordProperty("retransmission_startup_allocations", std::to_string(retransmission.startup.load()));
+
+        EXPECT_EQ(downstream.hot.load(), 0U) << "downstream replay loop allocated, last " << downstream.hot_size.load() << " bytes";
+        EXPECT_EQ(retransmission.hot.load(), 0U)
+            << "retransmission event loop allocated, last " << retransmission.hot_size.load() << " bytes";
+    }
+};
+
+TEST_F(HotPathAllocationTest, SleepReplay_NoAllocationsAfterStartup)
+{
+    replay(make_config(imr::util::wait::Kind::sleep));
+}
+
+TEST_F(HotPathAllocationTest, UnpacedReplay_NoAllocationsAfterStartup)
+{
+    replay(make_config(imr::util::wait::Kind::none));
+}
+
+TEST_F(HotPathAllocationTest, VirtualTimeReplay_NoAllocationsAfterStartup)
+{
+    replay(make_config(imr::util::wait::Kind::virtual_time));
+}
+
+// every send fails (EINVAL), each logging an error from the replay loop
+TEST_F(HotPathAllocationTest, SendErrors_NoAllocationsAfterStartup)
+{
+    auto config{make_config(imr::util::wait::Kind::none)};
+    config.downstream_feed_config.port = 0;
+
+    replay(config);
+}
+
+// every packet sent twice on the B line, which holds nothing back: the batch is only sized by the duplicates
+TEST_F(HotPathAllocationTest, ImpairedRedundantLine_NoAllocationsAfterStartup)
+{
+    auto config{make_config(imr::util::wait::Kind::none)};
+    config.downstream_feed_config.redundant_lines = {{
+        .mcast_group = "239.0.0.2",
+        .port = find_free_udp_port(),
+        .egress_interface = {.s_addr = htonl(INADDR_LOOPBACK)},
+        .impairment = {.duplicate = 1.0},
+    }};
+
+    replay(config);
+}
+
+TEST_F(HotPathAllocationTest, Server_CountsHotPathThreads)
+{
+    auto config{make_config(imr::util::wait::Kind::sleep)};
+    const std::unique_ptr<imr::Server> server{make_test_server(config)};
+
+    // retransmission feeds start with the server
+    wait_for_threads(Kind::retransmission, num_retransmission_feeds);
+    EXPECT_EQ(server->hot_path_threads(), num_retransmission_feeds);
+
+    server->start();
+
+    wait_for_threads(Kind::downstream, 1);
+    EXPECT_EQ(server->hot_path_threads(), 1 + num_retransmission_feeds);
+
+    server->stop();
+    server->wait_for_downstream();
+    EXPECT_LE(server->hot_path_threads(), num_retransmission_feeds);
+}
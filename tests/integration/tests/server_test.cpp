@@ -75,3 +75,64 @@ TEST_F(ServerIntegrationTest, Stop_AfterEOF)
     server->wait_for_downstream();
     server->stop();
 }
+
+TEST_F(ServerIntegrationTest, Start_ShardedChannels_RunToEOF)
+{
+    auto sharded_config{config};
+
+    for (const auto* session : {"CHANNEL001", "CHANNEL002"})
+    {
+        sharded_config.channel_cfgs.push_back({
+            .downstream_feed_config = config.downstream_feed_config,
+            .session = session,
+            .cpu = 0,
+        });
+        sharded_config.channel_cfgs.back().downstream_feed_config.port = find_free_udp_port();
+    }
+
+    sharded_config.shard_map_cfg = {.mapping = imr::mold::downstream::ShardMap::Config::Mapping::hash};
+
+    const std::unique_ptr<imr::Server> server{make_test_server(sharded_config)};
+
+    server->start();
+    server->wait_for_downstream();
+}
+
+TEST_F(ServerIntegrationTest, Ctor_ChannelsWithSameSession_ReturnsError)
+{
+    auto sharded_config{config};
+    for (auto i{0}; i < 2; ++i)
+    {
+        sharded_config.channel_cfgs.push_back({.downstream_feed_config = config.downstream_feed_config, .session = "CHANNEL001"});
+        sharded_config.channel_cfgs.back().downstream_feed_config.port = find_free_udp_port();
+    }
+    sharded_config.mapped_itch_file_cfg.path = test_path();
+
+    const auto server{imr::make_server(sharded_config)};
+    ASSERT_FALSE(server.has_value());
+    EXPECT_TRUE(server.error().contains("same session")) << server.error();
+}
+
+TEST_F(ServerIntegrationTest, Ctor_ChannelsWithSameGroupAndPort_ReturnsError)
+{
+    auto sharded_config{config};
+    for (const auto* session : {"CHANNEL001", "CHANNEL002"})
+    {
+        sharded_config.channel_cfgs.push_back({.downstream_feed_config = config.downstream_feed_config, .session = session});
+    }
+    sharded_config.mapped_itch_file_cfg.path = test_path();
+
+    const auto server{imr::make_server(sharded_config)};
+    ASSERT_FALSE(server.has_value());
+    EXPECT_TRUE(server.error().contains("both send to")) << server.error();
+}
+
+TEST_F(ServerIntegrationTest, Ctor_ShardedWithFilter_ReturnsError)
+{
+    auto sharded_config{config};
+    sharded_config.channel_cfgs.push_back({.downstream_feed_config = config.downstream_feed_config, .session = "CHANNEL001"});
+    sharded_config.filter_cfg = imr::mold::downstream::FilterSource::Config{};
+    sharded_config.mapped_itch_file_cfg.path = test_path();
+
+    EXPECT_FALSE(imr::make_server(sharded_config).has_value());
+}
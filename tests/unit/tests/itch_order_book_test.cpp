@@ -0,0 +1,232 @@
+#include <gtest/gtest.h>
+
+#include "itch/order_book.h"
+#include "imr/mold/types.h"
+#include "util/binary_io.h"
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace
+{
+    template <typename T>
+    void put(std::span<char> message, std::size_t offset, T value)
+    {
+        imr::util::binary_io::write_at_be(message, offset, value);
+    }
+
+    std::vector<char> add_order(std::uint64_t reference, std::uint16_t locate, char side, std::uint32_t shares,
+                                std::uint32_t price, std::string stock = "AAPL")
+    {
+        std::vector<char> message(itch::add_order_size);
+        message[0] = itch::add_order_type;
+        put(message, 1, locate);
+        put(message, itch::order_reference_offset, reference);
+        message[itch::side_offset] = side;
+        put(message, itch::add_shares_offset, shares);
+        stock.resize(8, ' ');
+        std::ranges::copy(stock, message.begin() + itch::add_stock_offset);
+        put(message, itch::add_price_offset, price);
+        return message;
+    }
+
+    std::vector<char> reduce_order(char type, std::uint64_t reference, std::uint32_t shares)
+    {
+        std::vector<char> message(type == itch::order_cancel_type ? 23 : 31);
+        message[0] = type;
+        put(message, itch::order_reference_offset, reference);
+        put(message, itch::shares_offset, shares);
+        return message;
+    }
+
+    std::vector<char> delete_order(std::uint64_t reference)
+    {
+        std::vector<char> message(19);
+        message[0] = itch::order_delete_type;
+        put(message, itch::order_reference_offset, reference);
+        return message;
+    }
+
+    std::vector<char> replace_order(std::uint64_t reference, std::uint64_t new_reference, std::uint32_t shares, std::uint32_t price)
+    {
+        std::vector<char> message(35);
+        message[0] = itch::order_replace_type;
+        put(message, itch::order_reference_offset, reference);
+        put(message, itch::new_order_reference_offset, new_reference);
+        put(message, itch::replace_shares_offset, shares);
+        put(message, itch::replace_price_offset, price);
+        return message;
+    }
+
+    // messages of a length prefixed snapshot
+    std::vector<std::vector<char>> split(const std::vector<char>& snapshot)
+    {
+        std::vector<std::vector<char>> messages;
+
+        for (auto offset{0UZ}; offset < snapshot.size();)
+        {
+            const auto length{imr::util::binary_io::read_at_be<imr::mold::types::LengthPrefix>(snapshot, offset)};
+            offset += sizeof(imr::mold::types::LengthPrefix);
+            messages.emplace_back(snapshot.begin() + static_cast<std::ptrdiff_t>(offset),
+                                  snapshot.begin() + static_cast<std::ptrdiff_t>(offset + length));
+            offset += length;
+        }
+
+        return messages;
+    }
+}
+
+TEST(ItchOrderBookTest, Apply_AddOrder_IsFound)
+{
+    itch::OrderBook book;
+    book.apply(add_order(7, 1, 'B', 100, 12345));
+
+    const auto order{book.find(7)};
+    ASSERT_TRUE(order.has_value());
+    EXPECT_EQ(order->shares, 100u);
+    EXPECT_EQ(order->price, 12345u);
+    EXPECT_EQ(order->locate, 1u);
+    EXPECT_EQ(order->side, 'B');
+    EXPECT_EQ(book.order_count(), 1u);
+}
+
+TEST(ItchOrderBookTest, Apply_ExecuteAndCancel_ReduceShares)
+{
+    itch::OrderBook book;
+    book.apply(add_order(7, 1, 'S', 100, 1));
+
+    book.apply(reduce_order(itch::order_executed_type, 7, 30));
+    EXPECT_EQ(book.find(7)->shares, 70u);
+
+    book.apply(reduce_order(itch::order_cancel_type, 7, 20));
+    EXPECT_EQ(book.find(7)->shares, 50u);
+
+    book.apply(reduce_order(itch::order_executed_price_type, 7, 50));
+    EXPECT_FALSE(book.find(7).has_value());
+    EXPECT_EQ(book.order_count(), 0u);
+}
+
+TEST(ItchOrderBookTest, Apply_Delete_RemovesOrder)
+{
+    itch::OrderBook book;
+    book.apply(add_order(7, 1, 'B', 100, 1));
+    book.apply(add_order(8, 1, 'B', 100, 1));
+
+    book.apply(delete_order(7));
+
+    EXPECT_FALSE(book.find(7).has_value());
+    EXPECT_TRUE(book.find(8).has_value());
+    EXPECT_EQ(book.order_count(), 1u);
+}
+
+TEST(ItchOrderBookTest, Apply_UnknownReference_IsIgnored)
+{
+    itch::OrderBook book;
+
+    book.apply(delete_order(7));
+    book.apply(reduce_order(itch::order_executed_type, 7, 1));
+    book.apply(replace_order(7, 8, 1, 1));
+
+    EXPECT_EQ(book.order_count(), 0u);
+}
+
+TEST(ItchOrderBookTest, Apply_Replace_KeepsSideAndLocateLosesPriority)
+{
+    itch::OrderBook book;
+    book.apply(add_order(1, 3, 'S', 100, 10));
+    book.apply(add_order(2, 3, 'S', 200, 20));
+
+    book.apply(replace_order(1, 9, 150, 15));
+
+    EXPECT_FALSE(book.find(1).has_value());
+    const auto replaced{book.find(9)};
+    ASSERT_TRUE(replaced.has_value());
+    EXPECT_EQ(replaced->side, 'S');
+    EXPECT_EQ(replaced->locate, 3u);
+    EXPECT_EQ(replaced->shares, 150u);
+    EXPECT_EQ(replaced->price, 15u);
+
+    std::vector<char> snapshot;
+    book.write_snapshot(snapshot);
+    const auto messages{split(snapshot)};
+
+    ASSERT_EQ(messages.size(), 2u);
+    EXPECT_EQ(imr::util::binary_io::read_at_be<std::uint64_t>(messages[0], itch::order_reference_offset), 2u);
+    EXPECT_EQ(imr::util::binary_io::read_at_be<std::uint64_t>(messages[1], itch::order_reference_offset), 9u);
+}
+
+TEST(ItchOrderBookTest, WriteSnapshot_EmitsStateThenOrdersPerLocate)
+{
+    itch::OrderBook book;
+
+    std::vector<char> system_event(itch::system_event_size);
+    system_event[0] = itch::system_event_type;
+    system_event[11] = 'Q';
+    book.apply(system_event);
+
+    std::vector<char> directory(itch::stock_directory_size, 'N');
+    directory[0] = 'R';
+    put<std::uint16_t>(directory, 1, 2);
+    std::ranges::copy(std::string("MSFT    "), directory.begin() + 11);
+    book.apply(directory);
+
+    std::vector<char> trading_action(itch::stock_trading_action_size);
+    trading_action[0] = itch::stock_trading_action_type;
+    put<std::uint16_t>(trading_action, 1, 2);
+    trading_action[19] = 'T';
+    book.apply(trading_action);
+
+    book.apply(add_order(5, 2, 'B', 10, 100, "MSFT"));
+    book.apply(add_order(4, 1, 'S', 20, 200));
+
+    std::vector<char> snapshot;
+    book.write_snapshot(snapshot);
+    const auto messages{split(snapshot)};
+
+    ASSERT_EQ(messages.size(), 5u);
+    EXPECT_EQ(messages[0], system_event);
+    // locate 1 before locate 2
+    EXPECT_EQ(messages[1], add_order(4, 1, 'S', 20, 200));
+    EXPECT_EQ(messages[2], directory);
+    EXPECT_EQ(messages[3], trading_action);
+    EXPECT_EQ(messages[4], add_order(5, 2, 'B', 10, 100, "MSFT"));
+}
+
+TEST(ItchOrderBookTest, Clear_ForgetsEverything)
+{
+    itch::OrderBook book;
+    book.apply(add_order(1, 1, 'B', 1, 1));
+    book.clear();
+
+    std::vector<char> snapshot;
+    book.write_snapshot(snapshot);
+
+    EXPECT_TRUE(snapshot.empty());
+    EXPECT_EQ(book.order_count(), 0u);
+    EXPECT_FALSE(book.find(1).has_value());
+}
+
+TEST(ItchOrderBookTest, Apply_ManyOrders_IndexGrowsAndDeletesKeepLookupsIntact)
+{
+    itch::OrderBook book;
+    constexpr std::uint64_t count{100'000};
+
+    for (std::uint64_t reference{1}; reference <= count; ++reference)
+    {
+        book.apply(add_order(reference, static_cast<std::uint16_t>(reference % 50), 'B', 1, 1));
+    }
+
+    for (std::uint64_t reference{1}; reference <= count; reference += 2)
+    {
+        book.apply(delete_order(reference));
+    }
+
+    EXPECT_EQ(book.order_count(), count / 2);
+    for (std::uint64_t reference{1}; reference <= count; ++reference)
+    {
+        ASSERT_EQ(book.find(reference).has_value(), reference % 2 == 0) << reference;
+    }
+}
@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+
+#include "imr/mold/downstream/filter_source.h"
+#include "imr/mold/packet_builder.h"
+#include "imr/mold/retransmission_buffer.h"
+#include "imr/mold/types.h"
+#include "util/binary_io.h"
+
+#include <array>
+#include <string_view>
+#include <vector>
+
+using namespace imr;
+
+namespace
+{
+    template <typename T>
+    void append_be(std::vector<char>& out, T value)
+    {
+        const auto bytes{std::bit_cast<std::array<char, sizeof(T)>>(util::binary_io::to_be(value))};
+        out.insert(out.end(), bytes.begin(), bytes.end());
+    }
+
+    // type, locate, tracking number, timestamp, then `rest`
+    void append_message(std::vector<char>& out, char type, std::uint16_t locate, std::string_view rest = "x")
+    {
+        append_be(out, static_cast<mold::types::LengthPrefix>(11 + rest.size()));
+        out.push_back(type);
+        append_be(out, locate);
+        out.insert(out.end(), 8, '\0');
+        out.insert(out.end(), rest.begin(), rest.end());
+    }
+
+    // stock directory message, stock padded to 8 + remaining 20 bytes of the 39 byte message
+    void append_directory(std::vector<char>& out, std::uint16_t locate, std::string_view stock)
+    {
+        std::string rest{stock};
+        rest.resize(8, ' ');
+        rest.resize(28, 'N');
+        append_message(out, 'R', locate, rest);
+    }
+}
+
+class MoldDownstreamFilterSourceTest : public ::testing::Test
+{
+  protected:
+    mold::RetransmissionBuffer retransmission_buffer{64};
+    mold::PacketBuilder packet_builder{{.session = "SESSION001"}};
+
+    std::vector<char> file;
+    // file offset of each message, in file order
+    std::vector<std::size_t> offsets;
+
+    void SetUp() override
+    {
+        add([&] { append_message(file, 'S', 0); });
+        add([&] { append_directory(file, 1, "AAPL"); });
+        add([&] { append_directory(file, 2, "MSFT"); });
+        add([&] { append_message(file, 'A', 1); });
+        add([&] { append_message(file, 'A', 2); });
+        add([&] { append_message(file, 'E', 1); });
+        add([&] { append_message(file, 'D', 2); });
+        add([&] { append_message(file, 'S', 0); });
+    }
+
+    void add(auto&& append)
+    {
+        offsets.push_back(file.size());
+        append();
+    }
+
+    // file indexes of the replayed messages, checking sequence numbers are contiguous from 1
+    std::vector<std::size_t> replay_all(mold::downstream::FilterSource& source)
+    {
+        mold::types::header::SequenceNumber seq{1};
+        while (source.peek_timestamp().has_value())
+        {
+            packet_builder.reset(seq);
+            seq = source.fill(packet_builder, retransmission_buffer, seq);
+        }
+
+        std::vector<std::size_t> replayed;
+        for (mold::types::header::SequenceNumber i{1}; i < seq; ++i)
+        {
+            const auto position{retransmission_buffer.file_position_for(i)};
+            EXPECT_TRUE(position.has_value());
+            replayed.push_back(static_cast<std::size_t>(std::ranges::find(offsets, *position) - offsets.begin()));
+        }
+        return replayed;
+    }
+};
+
+TEST_F(MoldDownstreamFilterSourceTest, Ctor_UnknownSymbol_ThrowsInvalidArgument)
+{
+    EXPECT_THROW(mold::downstream::FilterSource(file, {.symbols = {"GOOG"}}), std::invalid_argument);
+}
+
+TEST_F(MoldDownstreamFilterSourceTest, Fill_Symbol_ReplaysSymbolAndMarketWideRenumbered)
+{
+    mold::downstream::FilterSource source(file, {.symbols = {"MSFT"}});
+
+    EXPECT_EQ(replay_all(source), (std::vector<std::size_t>{0, 2, 4, 6, 7}));
+}
+
+TEST_F(MoldDownstreamFilterSourceTest, Fill_LocateAndTypes_ReplaysMatchingOnly)
+{
+    mold::downstream::FilterSource source(file, {.locates = {1}, .message_types = "AE", .market_wide = false});
+
+    EXPECT_EQ(replay_all(source), (std::vector<std::size_t>{3, 5}));
+}
+
+TEST_F(MoldDownstreamFilterSourceTest, Fill_TypesOnly_ReplaysThoseTypesOfEveryStock)
+{
+    mold::downstream::FilterSource source(file, {.message_types = "AE", .market_wide = false});
+
+    EXPECT_EQ(replay_all(source), (std::vector<std::size_t>{3, 4, 5}));
+}
+
+TEST_F(MoldDownstreamFilterSourceTest, Fill_Empty_ReplaysEverything)
+{
+    mold::downstream::FilterSource source(file, {});
+
+    EXPECT_EQ(replay_all(source), (std::vector<std::size_t>{0, 1, 2, 3, 4, 5, 6, 7}));
+}
+
+TEST_F(MoldDownstreamFilterSourceTest, Fill_LocateZero_ReplaysMarketWide)
+{
+    mold::downstream::FilterSource source(file, {.locates = {0}, .market_wide = false});
+
+    EXPECT_EQ(replay_all(source), (std::vector<std::size_t>{0, 7}));
+}
+
+TEST_F(MoldDownstreamFilterSourceTest, Ctor_DirectoryMessagePastDirectorySection_NotFound)
+{
+    append_directory(file, 3, "GOOG");
+
+    EXPECT_THROW(mold::downstream::FilterSource(file, {.symbols = {"GOOG"}}), std::invalid_argument);
+}
+
+TEST_F(MoldDownstreamFilterSourceTest, Fill_NothingMatches_ReplaysNothing)
+{
+    mold::downstream::FilterSource source(file, {.locates = {3}, .market_wide = false});
+
+    EXPECT_FALSE(source.peek_timestamp().has_value());
+}
+
+TEST_F(MoldDownstreamFilterSourceTest, Skip_SkipsToNextMatch)
+{
+    mold::downstream::FilterSource source(file, {.locates = {2}, .market_wide = false});
+
+    EXPECT_TRUE(source.skip());
+
+    packet_builder.reset(1);
+    const auto next{source.fill(packet_builder, retransmission_buffer, 1)};
+
+    EXPECT_EQ(next, 3u);
+    EXPECT_EQ(retransmission_buffer.file_position_for(1), offsets[4]);
+    EXPECT_EQ(retransmission_buffer.file_position_for(2), offsets[6]);
+}
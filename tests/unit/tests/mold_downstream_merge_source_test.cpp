@@ -0,0 +1,140 @@
+#include <gtest/gtest.h>
+
+#include "imr/mold/downstream/merge_source.h"
+#include "imr/mold/packet_builder.h"
+#include "imr/mold/retransmission_buffer.h"
+#include "imr/mold/types.h"
+#include "util/binary_io.h"
+
+#include <array>
+#include <vector>
+
+using namespace imr;
+using namespace std::chrono_literals;
+
+namespace
+{
+    constexpr auto msg_size{mold::PacketBuilder::min_message_size};
+
+    // min size ITCH messages tagged with `tag`, one per timestamp
+    std::vector<char> make_file(std::span<const std::chrono::nanoseconds> timestamps, char tag)
+    {
+        std::vector<char> out;
+        for (const auto timestamp : timestamps)
+        {
+            const auto prefix{util::binary_io::to_be<mold::types::LengthPrefix>(msg_size - sizeof(mold::types::LengthPrefix))};
+            const auto prefix_bytes{std::bit_cast<std::array<char, sizeof(prefix)>>(prefix)};
+            out.insert(out.end(), prefix_bytes.begin(), prefix_bytes.end());
+            out.push_back(tag);
+            out.insert(out.end(), 4, '\0');
+            const auto ts{util::binary_io::to_be(static_cast<std::uint64_t>(timestamp.count()))};
+            const auto ts_bytes{std::bit_cast<std::array<char, sizeof(ts)>>(ts)};
+            out.insert(out.end(), ts_bytes.begin() + 2, ts_bytes.end());
+            out.push_back('\0');
+        }
+        return out;
+    }
+}
+
+class MoldDownstreamMergeSourceTest : public ::testing::Test
+{
+  protected:
+    mold::RetransmissionBuffer retransmission_buffer{64};
+    mold::PacketBuilder packet_builder{{.session = "SESSION001"}};
+
+    static constexpr std::array a_timestamps{1ns, 4ns, 4ns, 9ns};
+    static constexpr std::array b_timestamps{2ns, 3ns, 10ns};
+    static constexpr std::array c_timestamps{4ns, 5ns};
+
+    std::vector<char> a{make_file(a_timestamps, 'a')};
+    std::vector<char> b{make_file(b_timestamps, 'b')};
+    std::vector<char> c{make_file(c_timestamps, 'c')};
+
+    // tags of every message in replay order, read back through the source's message store
+    std::string replay_all(mold::downstream::MergeSource& source)
+    {
+        mold::types::header::SequenceNumber seq{1};
+        while (source.peek_timestamp().has_value())
+        {
+            packet_builder.reset(seq);
+            seq = source.fill(packet_builder, retransmission_buffer, seq);
+        }
+
+        const auto store{source.message_store()};
+        std::string tags;
+        for (mold::types::header::SequenceNumber i{1}; i < seq; ++i)
+        {
+            const auto position{retransmission_buffer.file_position_for(i)};
+            EXPECT_TRUE(position.has_value());
+            const auto msg{store.read(*position, {})};
+            EXPECT_EQ(msg.size(), msg_size);
+            tags.push_back(msg[sizeof(mold::types::LengthPrefix)]);
+        }
+        return tags;
+    }
+};
+
+TEST_F(MoldDownstreamMergeSourceTest, Ctor_NoFiles_ThrowsInvalidArgument)
+{
+    EXPECT_THROW(mold::downstream::MergeSource({}), std::invalid_argument);
+}
+
+TEST_F(MoldDownstreamMergeSourceTest, Fill_ThreeFiles_OrderedByTimestampThenFileId)
+{
+    mold::downstream::MergeSource source({a, b, c});
+
+    EXPECT_EQ(replay_all(source), "abbaaccab");
+}
+
+TEST_F(MoldDownstreamMergeSourceTest, Fill_SingleFile_ReplaysInFileOrder)
+{
+    mold::downstream::MergeSource source({b});
+
+    EXPECT_EQ(replay_all(source), "bbb");
+}
+
+TEST_F(MoldDownstreamMergeSourceTest, Fill_EmptyFile_Ignored)
+{
+    mold::downstream::MergeSource source({{}, c, a});
+
+    EXPECT_EQ(replay_all(source), "acaaca");
+}
+
+TEST_F(MoldDownstreamMergeSourceTest, Skip_AdvancesMergedStream)
+{
+    mold::downstream::MergeSource source({a, b});
+
+    EXPECT_EQ(source.peek_timestamp(), 1ns);
+    EXPECT_TRUE(source.skip());
+    EXPECT_EQ(source.peek_timestamp(), 2ns);
+    EXPECT_TRUE(source.skip());
+    EXPECT_TRUE(source.skip());
+    EXPECT_EQ(source.peek_timestamp(), 4ns);
+}
+
+TEST_F(MoldDownstreamMergeSourceTest, Skip_TruncatedTail_DropsOnlyThatFile)
+{
+    // c's second message is missing its last byte, its timestamp still readable
+    c.pop_back();
+    mold::downstream::MergeSource source({c, b});
+
+    EXPECT_TRUE(source.skip());
+    EXPECT_TRUE(source.skip());
+    EXPECT_TRUE(source.skip());
+    EXPECT_EQ(source.peek_timestamp(), 5ns);
+
+    // c's truncated message, b remains
+    EXPECT_TRUE(source.skip());
+    EXPECT_EQ(source.peek_timestamp(), 10ns);
+
+    EXPECT_FALSE(source.skip());
+    EXPECT_FALSE(source.peek_timestamp().has_value());
+}
+
+TEST_F(MoldDownstreamMergeSourceTest, MessageStore_UnknownFileId_ReturnsEmpty)
+{
+    mold::downstream::MergeSource source({a, b});
+
+    EXPECT_TRUE(source.message_store().read(mold::MessageStore::position(2, 0), {}).empty());
+    EXPECT_EQ(source.message_store().read(mold::MessageStore::position(1, msg_size), {}).data(), b.data() + msg_size);
+}
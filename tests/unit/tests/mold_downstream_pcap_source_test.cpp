@@ -0,0 +1,320 @@
+#include <gtest/gtest.h>
+
+#include "imr/mold/downstream/pcap_source.h"
+#include "imr/mold/packet_builder.h"
+#include "imr/mold/retransmission_buffer.h"
+#include "imr/mold/types.h"
+#include "util/binary_io.h"
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+using namespace imr;
+using namespace std::chrono_literals;
+
+namespace
+{
+    constexpr std::uint16_t port{3400};
+    constexpr auto msg_size{mold::PacketBuilder::min_message_size};
+
+    template <typename T>
+    void append(std::vector<char>& out, T value)
+    {
+        const auto bytes{std::bit_cast<std::array<char, sizeof(T)>>(value)};
+        out.insert(out.end(), bytes.begin(), bytes.end());
+    }
+
+    template <typename T>
+    void append_be(std::vector<char>& out, T value)
+    {
+        append(out, util::binary_io::to_be(value));
+    }
+
+    // min size ITCH message: length prefix, type, locate, tracking number, timestamp
+    void append_message(std::vector<char>& out, std::chrono::nanoseconds timestamp, char tag)
+    {
+        append_be<mold::types::LengthPrefix>(out, msg_size - sizeof(mold::types::LengthPrefix));
+        out.push_back(tag);
+        out.insert(out.end(), 4, '\0');
+        const auto ts{util::binary_io::to_be(static_cast<std::uint64_t>(timestamp.count()))};
+        const auto ts_bytes{std::bit_cast<std::array<char, sizeof(ts)>>(ts)};
+        out.insert(out.end(), ts_bytes.begin() + 2, ts_bytes.end());
+        out.push_back('\0');
+    }
+
+    // ethernet / IPv4 / UDP / MoldUDP64 frame
+    std::vector<char> make_frame(mold::types::header::SequenceNumber seq,
+                                 std::span<const std::chrono::nanoseconds> timestamps,
+                                 std::uint16_t dst_port = port,
+                                 std::uint8_t protocol = 17,
+                                 std::string_view session = "SESSION001")
+    {
+        std::vector<char> payload;
+        payload.insert(payload.end(), session.begin(), session.end());
+        append_be(payload, seq);
+        append_be(payload, static_cast<mold::types::header::MessageCount>(timestamps.size()));
+        for (auto i{0UZ}; i < timestamps.size(); ++i)
+        {
+            append_message(payload, timestamps[i], static_cast<char>('A' + seq + i));
+        }
+
+        std::vector<char> frame(12, '\0');
+        append_be<std::uint16_t>(frame, 0x0800);
+
+        frame.push_back(0x45);
+        frame.push_back(0);
+        append_be(frame, static_cast<std::uint16_t>(20 + 8 + payload.size()));
+        append_be<std::uint32_t>(frame, 0);
+        frame.push_back(1);
+        frame.push_back(static_cast<char>(protocol));
+        frame.insert(frame.end(), 10, '\0');
+
+        append_be<std::uint16_t>(frame, 1234);
+        append_be(frame, dst_port);
+        append_be(frame, static_cast<std::uint16_t>(8 + payload.size()));
+        append_be<std::uint16_t>(frame, 0);
+
+        frame.insert(frame.end(), payload.begin(), payload.end());
+        return frame;
+    }
+
+    std::vector<char> make_pcap(std::span<const std::vector<char>> frames)
+    {
+        std::vector<char> out;
+        append<std::uint32_t>(out, 0xA1B23C4D);
+        append<std::uint16_t>(out, 2);
+        append<std::uint16_t>(out, 4);
+        append<std::uint32_t>(out, 0);
+        append<std::uint32_t>(out, 0);
+        append<std::uint32_t>(out, 65535);
+        append<std::uint32_t>(out, 1);
+
+        for (auto i{0U}; i < frames.size(); ++i)
+        {
+            append<std::uint32_t>(out, 100 + i);
+            append<std::uint32_t>(out, 5);
+            append(out, static_cast<std::uint32_t>(frames[i].size()));
+            append(out, static_cast<std::uint32_t>(frames[i].size()));
+            out.insert(out.end(), frames[i].begin(), frames[i].end());
+        }
+        return out;
+    }
+
+    // packet i captured at 100 + i seconds and `fraction_ticks` of the interface's resolution
+    std::vector<char> make_pcapng(std::span<const std::vector<char>> frames,
+                                  std::uint8_t tsresol = 9,
+                                  std::uint64_t ticks_per_second = 1'000'000'000,
+                                  std::uint64_t fraction_ticks = 7)
+    {
+        std::vector<char> out;
+
+        append<std::uint32_t>(out, 0x0A0D0D0A);
+        append<std::uint32_t>(out, 28);
+        append<std::uint32_t>(out, 0x1A2B3C4D);
+        append<std::uint16_t>(out, 1);
+        append<std::uint16_t>(out, 0);
+        append<std::int64_t>(out, -1);
+        append<std::uint32_t>(out, 28);
+
+        // interface with if_tsresol
+        append<std::uint32_t>(out, 1);
+        append<std::uint32_t>(out, 32);
+        append<std::uint16_t>(out, 1);
+        append<std::uint16_t>(out, 0);
+        append<std::uint32_t>(out, 0);
+        append<std::uint16_t>(out, 9);
+        append<std::uint16_t>(out, 1);
+        append<std::uint32_t>(out, tsresol);
+        append<std::uint32_t>(out, 0);
+        append<std::uint32_t>(out, 32);
+
+        for (auto i{0U}; i < frames.size(); ++i)
+        {
+            const auto padded{(frames[i].size() + 3) & ~3UZ};
+            const auto length{static_cast<std::uint32_t>(32 + padded)};
+            const std::uint64_t ts{((100 + i) * ticks_per_second) + fraction_ticks};
+
+            append<std::uint32_t>(out, 6);
+            append(out, length);
+            append<std::uint32_t>(out, 0);
+            append(out, static_cast<std::uint32_t>(ts >> 32U));
+            append(out, static_cast<std::uint32_t>(ts));
+            append(out, static_cast<std::uint32_t>(frames[i].size()));
+            append(out, static_cast<std::uint32_t>(frames[i].size()));
+            out.insert(out.end(), frames[i].begin(), frames[i].end());
+            out.insert(out.end(), padded - frames[i].size(), '\0');
+            append(out, length);
+        }
+        return out;
+    }
+
+    // an enhanced packet block whose length covers 4 of its 20 byte fixed fields
+    void append_short_enhanced_packet_block(std::vector<char>& out)
+    {
+        append<std::uint32_t>(out, 6);
+        append<std::uint32_t>(out, 16);
+        append<std::uint32_t>(out, 0);
+        append<std::uint32_t>(out, 16);
+    }
+}
+
+class MoldDownstreamPcapSourceTest : public ::testing::Test
+{
+  protected:
+    mold::RetransmissionBuffer retransmission_buffer{64};
+    mold::PacketBuilder packet_builder{{.session = "SESSION001"}};
+
+    std::vector<mold::types::header::MessageCount> fill_all(mold::downstream::Source& source)
+    {
+        std::vector<mold::types::header::MessageCount> counts;
+        mold::types::header::SequenceNumber seq{1};
+        while (source.peek_timestamp().has_value())
+        {
+            packet_builder.reset(seq);
+            seq = source.fill(packet_builder, retransmission_buffer, seq);
+            counts.push_back(packet_builder.message_count());
+        }
+        return counts;
+    }
+
+    static constexpr std::array first_timestamps{1ns, 2ns, 3ns};
+    static constexpr std::array second_timestamps{4ns, 5ns};
+};
+
+TEST_F(MoldDownstreamPcapSourceTest, Ctor_NotACapture_ThrowsInvalidArgument)
+{
+    const std::array<char, 32> bytes{};
+    EXPECT_THROW(mold::downstream::PcapSource(bytes, {}), std::invalid_argument);
+}
+
+TEST_F(MoldDownstreamPcapSourceTest, Fill_Pcap_PreservesOriginalGrouping)
+{
+    const std::array frames{make_frame(1, first_timestamps), make_frame(4, second_timestamps)};
+    const auto capture{make_pcap(frames)};
+
+    mold::downstream::PcapSource source(capture, {});
+
+    EXPECT_EQ(fill_all(source), (std::vector<mold::types::header::MessageCount>{3, 2}));
+}
+
+TEST_F(MoldDownstreamPcapSourceTest, MessageStore_Read_ReturnsMessageInPlace)
+{
+    const std::array frames{make_frame(1, first_timestamps), make_frame(4, second_timestamps)};
+    const auto capture{make_pcap(frames)};
+
+    mold::downstream::PcapSource source(capture, {});
+    fill_all(source);
+
+    const auto store{source.message_store()};
+    const auto position{retransmission_buffer.file_position_for(4)};
+    ASSERT_TRUE(position.has_value());
+
+    const auto msg{store.read(*position, {})};
+    ASSERT_EQ(msg.size(), msg_size);
+    EXPECT_EQ(msg[sizeof(mold::types::LengthPrefix)], 'A' + 4);
+    EXPECT_EQ(msg.data(), capture.data() + *position);
+}
+
+TEST_F(MoldDownstreamPcapSourceTest, PeekTimestamp_ItchTiming_ReturnsFirstMessageTimestamp)
+{
+    const std::array frames{make_frame(1, second_timestamps)};
+    const auto capture{make_pcap(frames)};
+
+    mold::downstream::PcapSource source(capture, {});
+
+    EXPECT_EQ(source.peek_timestamp(), 4ns);
+}
+
+TEST_F(MoldDownstreamPcapSourceTest, PeekTimestamp_CaptureTimingPcapng_ReturnsCaptureTimestamp)
+{
+    const std::array frames{make_frame(1, first_timestamps)};
+    const auto capture{make_pcapng(frames)};
+
+    mold::downstream::PcapSource source(capture, {.timing = mold::downstream::PcapSource::Config::Timing::capture});
+
+    EXPECT_EQ(source.peek_timestamp(), 100s + 7ns);
+}
+
+TEST_F(MoldDownstreamPcapSourceTest, PeekTimestamp_CaptureTimingFinerThanNanoseconds_ReturnsCaptureTimestamp)
+{
+    const std::array frames{make_frame(1, first_timestamps)};
+    // 2^-40 s ticks, half a second past 100s
+    constexpr std::uint64_t ticks_per_second{1ULL << 40U};
+    const auto capture{make_pcapng(frames, 0x80U | 40U, ticks_per_second, ticks_per_second / 2)};
+
+    mold::downstream::PcapSource source(capture, {.timing = mold::downstream::PcapSource::Config::Timing::capture});
+
+    EXPECT_EQ(source.peek_timestamp(), 100s + 500ms);
+}
+
+TEST_F(MoldDownstreamPcapSourceTest, Fill_Pcapng_PreservesOriginalGrouping)
+{
+    const std::array frames{make_frame(1, first_timestamps), make_frame(4, second_timestamps)};
+    const auto capture{make_pcapng(frames)};
+
+    mold::downstream::PcapSource source(capture, {});
+
+    EXPECT_EQ(fill_all(source), (std::vector<mold::types::header::MessageCount>{3, 2}));
+}
+
+TEST_F(MoldDownstreamPcapSourceTest, Fill_DuplicatePackets_ReplayedOnce)
+{
+    // B line copy of the first packet, then a packet overlapping by one message
+    const std::array frames{make_frame(1, first_timestamps),
+                            make_frame(1, first_timestamps),
+                            make_frame(3, first_timestamps)};
+    const auto capture{make_pcap(frames)};
+
+    mold::downstream::PcapSource source(capture, {});
+
+    EXPECT_EQ(fill_all(source), (std::vector<mold::types::header::MessageCount>{3, 2}));
+}
+
+TEST_F(MoldDownstreamPcapSourceTest, Fill_SessionRollover_ReplaysNewSessionFromOne)
+{
+    const std::array frames{make_frame(1, first_timestamps),
+                            make_frame(4, second_timestamps),
+                            make_frame(1, first_timestamps, port, 17, "SESSION002"),
+                            // B line copies, the first session's lagging behind the rollover
+                            make_frame(4, second_timestamps),
+                            make_frame(1, first_timestamps, port, 17, "SESSION002"),
+                            make_frame(4, second_timestamps, port, 17, "SESSION002")};
+    const auto capture{make_pcap(frames)};
+
+    mold::downstream::PcapSource source(capture, {});
+
+    EXPECT_EQ(fill_all(source), (std::vector<mold::types::header::MessageCount>{3, 2, 3, 2}));
+}
+
+TEST_F(MoldDownstreamPcapSourceTest, Fill_OtherPortsAndProtocols_Skipped)
+{
+    const std::array frames{make_frame(1, first_timestamps, port + 1),
+                            make_frame(1, first_timestamps, port, 6),
+                            make_frame(1, second_timestamps)};
+    const auto capture{make_pcap(frames)};
+
+    mold::downstream::PcapSource source(capture, {.port = port});
+
+    EXPECT_EQ(fill_all(source), (std::vector<mold::types::header::MessageCount>{2}));
+}
+
+TEST_F(MoldDownstreamPcapSourceTest, Fill_PcapngShortEnhancedPacketBlock_Skipped)
+{
+    const std::array first{make_frame(1, first_timestamps)};
+    const std::array second{make_frame(4, second_timestamps)};
+
+    auto capture{make_pcapng(first)};
+    append_short_enhanced_packet_block(capture);
+
+    // second's section / interface headers, then its packet
+    const auto rest{make_pcapng(second)};
+    capture.insert(capture.end(), rest.begin(), rest.end());
+
+    // and one cut short at the end of the capture
+    append_short_enhanced_packet_block(capture);
+
+    mold::downstream::PcapSource source(capture, {});
+
+    EXPECT_EQ(fill_all(source), (std::vector<mold::types::header::MessageCount>{3, 2}));
+}
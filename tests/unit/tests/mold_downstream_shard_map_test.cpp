@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+
+#include "imr/mold/downstream/shard_map.h"
+#include "imr/mold/types.h"
+#include "util/binary_io.h"
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace imr;
+
+namespace
+{
+    template <typename T>
+    void append_be(std::vector<char>& out, T value)
+    {
+        const auto bytes{std::bit_cast<std::array<char, sizeof(T)>>(util::binary_io::to_be(value))};
+        out.insert(out.end(), bytes.begin(), bytes.end());
+    }
+
+    // stock directory messages for locates 1..count
+    std::vector<char> make_directory(std::uint16_t count)
+    {
+        std::vector<char> out;
+        for (std::uint16_t locate{1}; locate <= count; ++locate)
+        {
+            append_be<mold::types::LengthPrefix>(out, 39);
+            out.push_back('R');
+            append_be(out, locate);
+            out.insert(out.end(), 8, '\0');
+            auto stock{"S" + std::to_string(locate)};
+            stock.resize(8, ' ');
+            out.insert(out.end(), stock.begin(), stock.end());
+            out.insert(out.end(), 20, 'N');
+        }
+        return out;
+    }
+
+    using Mapping = mold::downstream::ShardMap::Config::Mapping;
+}
+
+TEST(MoldDownstreamShardMapTest, Ctor_ZeroChannels_ThrowsInvalidArgument)
+{
+    EXPECT_THROW(mold::downstream::ShardMap({}, 0, {}), std::invalid_argument);
+}
+
+TEST(MoldDownstreamShardMapTest, Ctor_TableEntryOutOfRange_ThrowsInvalidArgument)
+{
+    EXPECT_THROW(mold::downstream::ShardMap({.mapping = Mapping::table, .table = {0, 1, 2}}, 2, {}),
+                 std::invalid_argument);
+}
+
+TEST(MoldDownstreamShardMapTest, ChannelFor_Range_SplitsDirectoryIntoContiguousRanges)
+{
+    const auto file{make_directory(100)};
+    const mold::downstream::ShardMap map({.mapping = Mapping::range}, 4, file);
+
+    EXPECT_EQ(map.channel_for(1), 0u);
+    EXPECT_EQ(map.channel_for(25), 0u);
+    EXPECT_EQ(map.channel_for(26), 1u);
+    EXPECT_EQ(map.channel_for(100), 3u);
+    // not in the directory
+    EXPECT_EQ(map.channel_for(5000), 3u);
+}
+
+TEST(MoldDownstreamShardMapTest, LocatesFor_Hash_PartitionsEveryLocate)
+{
+    constexpr auto channels{3UZ};
+    const mold::downstream::ShardMap map({.mapping = Mapping::hash}, channels, {});
+
+    auto total{0UZ};
+    for (auto channel{0UZ}; channel < channels; ++channel)
+    {
+        const auto locates{map.locates_for(channel)};
+        EXPECT_NEAR(static_cast<double>(locates.size()), 65535.0 / channels, 65535.0 / channels / 10);
+        total += locates.size();
+    }
+
+    EXPECT_EQ(total, 65535u);
+}
+
+TEST(MoldDownstreamShardMapTest, ChannelFor_Hash_SpreadsContiguousLocates)
+{
+    constexpr auto channels{8UZ};
+    constexpr auto run{1024UZ};
+    const mold::downstream::ShardMap map({.mapping = Mapping::hash}, channels, {});
+
+    std::array<std::size_t, channels> per_channel{};
+    // locates of the run sharing their low bits, all on one channel if only those picked it
+    std::array<std::size_t, channels> same_low_bits_per_channel{};
+    for (std::uint16_t locate{1}; locate <= run; ++locate)
+    {
+        ++per_channel[map.channel_for(locate)];
+
+        if (locate % channels == 0)
+        {
+            ++same_low_bits_per_channel[map.channel_for(locate)];
+        }
+    }
+
+    for (auto channel{0UZ}; channel < channels; ++channel)
+    {
+        EXPECT_NEAR(static_cast<double>(per_channel[channel]), run / channels, run / channels / 4.0);
+        EXPECT_NEAR(static_cast<double>(same_low_bits_per_channel[channel]), run / channels / channels, run / channels / channels / 2.0);
+    }
+}
+
+TEST(MoldDownstreamShardMapTest, ChannelFor_Table_UsesTableThenChannelZero)
+{
+    const mold::downstream::ShardMap map({.mapping = Mapping::table, .table = {0, 1, 0, 1}}, 2, {});
+
+    EXPECT_EQ(map.channel_for(1), 1u);
+    EXPECT_EQ(map.channel_for(2), 0u);
+    EXPECT_EQ(map.channel_for(3), 1u);
+    EXPECT_EQ(map.channel_for(4), 0u);
+    EXPECT_EQ(map.locates_for(1).size(), 2u);
+}
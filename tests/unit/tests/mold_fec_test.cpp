@@ -0,0 +1,169 @@
+#include <gtest/gtest.h>
+
+#include "imr/mold/downstream/fec_encoder.h"
+#include "imr/mold/fec_decoder.h"
+#include "imr/mold/types.h"
+#include "util/binary_io.h"
+
+#include <algorithm>
+#include <set>
+#include <vector>
+
+using namespace imr;
+
+namespace
+{
+    using Packet = std::vector<char>;
+
+    // MoldUDP64 packet with first sequence number `seq` and `seq % 3 + 1` messages of varying length
+    Packet make_packet(mold::types::header::SequenceNumber seq)
+    {
+        Packet packet(mold::types::header::length);
+        std::ranges::copy(std::string_view("SESSION001"), packet.begin());
+        util::binary_io::write_at_be(std::span(packet), mold::types::header::sequence_number_offset, seq);
+
+        const auto count{static_cast<mold::types::header::MessageCount>((seq % 3) + 1)};
+        util::binary_io::write_at_be(std::span(packet), mold::types::header::message_count_offset, count);
+
+        for (auto i{0U}; i < count; ++i)
+        {
+            const auto length{static_cast<mold::types::LengthPrefix>(10 + ((seq * 7 + i) % 40))};
+            packet.push_back(static_cast<char>(length >> 8U));
+            packet.push_back(static_cast<char>(length & 0xFFU));
+            for (auto j{0U}; j < length; ++j)
+            {
+                packet.push_back(static_cast<char>(seq + i + j));
+            }
+        }
+
+        return packet;
+    }
+}
+
+class MoldFecTest : public ::testing::Test
+{
+  protected:
+    std::vector<Packet> packets_;
+    std::vector<Packet> parity_;
+
+    // encode packets 1..count (header and messages in separate iovecs like PacketBuilder), flushing at the end
+    void encode(const mold::downstream::FecEncoder::Config& cfg, mold::types::header::SequenceNumber count)
+    {
+        mold::downstream::FecEncoder encoder(cfg, 1472);
+
+        const auto keep{[this](std::span<const std::span<const char>> parity) {
+            for (const auto& packet : parity)
+            {
+                parity_.emplace_back(packet.begin(), packet.end());
+            }
+        }};
+
+        for (mold::types::header::SequenceNumber seq{1}; seq <= count; ++seq)
+        {
+            auto& packet{packets_.emplace_back(make_packet(seq))};
+            const std::array iov{iovec{.iov_base = packet.data(), .iov_len = mold::types::header::length},
+                                 iovec{.iov_base = packet.data() + mold::types::header::length,
+                                       .iov_len = packet.size() - mold::types::header::length}};
+            keep(encoder.add(iov));
+        }
+
+        keep(encoder.flush());
+    }
+
+    // receive everything but `lost` then apply every parity packet, returns the packets rebuilt
+    std::vector<Packet> decode(const std::set<std::size_t>& lost)
+    {
+        mold::FecDecoder decoder;
+
+        for (auto i{0UZ}; i < packets_.size(); ++i)
+        {
+            if (!lost.contains(i))
+            {
+                decoder.on_packet(packets_[i]);
+            }
+        }
+
+        std::vector<Packet> rebuilt;
+        for (const auto& parity : parity_)
+        {
+            if (auto packet{decoder.on_parity(parity)}; !packet.empty())
+            {
+                rebuilt.push_back(std::move(packet));
+            }
+        }
+
+        return rebuilt;
+    }
+};
+
+TEST_F(MoldFecTest, Ctor_InvalidConfig_ThrowsInvalidArgument)
+{
+    EXPECT_THROW(mold::downstream::FecEncoder({.mcast_group = "239.0.0.2", .port = 1, .k = 0}, 1472), std::invalid_argument);
+    EXPECT_THROW(mold::downstream::FecEncoder({.mcast_group = "239.0.0.2", .port = 1, .interleave = 256}, 1472),
+                 std::invalid_argument);
+    EXPECT_THROW(mold::downstream::FecEncoder({.mcast_group = "badip", .port = 1}, 1472), std::invalid_argument);
+}
+
+TEST_F(MoldFecTest, Add_ParityEveryKPackets)
+{
+    encode({.mcast_group = "239.0.0.2", .port = 1, .k = 4}, 8);
+
+    EXPECT_EQ(parity_.size(), 2);
+    EXPECT_EQ(parity_[0][mold::types::fec::count_offset], 4);
+}
+
+TEST_F(MoldFecTest, Decode_SingleLoss_Rebuilt)
+{
+    encode({.mcast_group = "239.0.0.2", .port = 1, .k = 4}, 8);
+
+    const auto rebuilt{decode({2, 5})};
+
+    ASSERT_EQ(rebuilt.size(), 2);
+    EXPECT_EQ(rebuilt[0], packets_[2]);
+    EXPECT_EQ(rebuilt[1], packets_[5]);
+}
+
+TEST_F(MoldFecTest, Decode_TwoLossesInGroup_NotRebuilt)
+{
+    encode({.mcast_group = "239.0.0.2", .port = 1, .k = 4}, 4);
+
+    EXPECT_TRUE(decode({1, 2}).empty());
+}
+
+TEST_F(MoldFecTest, Decode_BurstWithinInterleave_Rebuilt)
+{
+    encode({.mcast_group = "239.0.0.2", .port = 1, .k = 4, .interleave = 3}, 12);
+
+    const auto rebuilt{decode({4, 5, 6})};
+
+    ASSERT_EQ(rebuilt.size(), 3);
+    for (const auto& packet : rebuilt)
+    {
+        EXPECT_NE(std::ranges::find(packets_, packet), packets_.end());
+    }
+}
+
+TEST_F(MoldFecTest, Decode_TwoLossesInColumn_RebuiltByRows)
+{
+    // columns {0, 2} / {1, 3}, rows {0, 1} / {2, 3}
+    encode({.mcast_group = "239.0.0.2", .port = 1, .k = 2, .interleave = 2, .row_parity = true}, 4);
+
+    const auto rebuilt{decode({0, 2})};
+
+    ASSERT_EQ(rebuilt.size(), 2);
+    EXPECT_EQ(rebuilt[0], packets_[0]);
+    EXPECT_EQ(rebuilt[1], packets_[2]);
+}
+
+TEST_F(MoldFecTest, Flush_PartialGroup_Rebuilt)
+{
+    encode({.mcast_group = "239.0.0.2", .port = 1, .k = 8}, 11);
+
+    ASSERT_EQ(parity_.size(), 2);
+    EXPECT_EQ(parity_[1][mold::types::fec::count_offset], 3);
+
+    const auto rebuilt{decode({9})};
+
+    ASSERT_EQ(rebuilt.size(), 1);
+    EXPECT_EQ(rebuilt[0], packets_[9]);
+}
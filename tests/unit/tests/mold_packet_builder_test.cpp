@@ -4,6 +4,7 @@
 #include "imr/mold/types.h"
 #include "util/binary_io.h"
 
+#include <algorithm>
 #include <array>
 
 using namespace imr;
@@ -154,3 +155,27 @@ TEST_F(MoldPacketBuilderTest, Reset_GivenSequenceNumber_WritesSequenceNumberToHe
 
     EXPECT_EQ(builder_seq, new_seq);
 }
+
+TEST_F(MoldPacketBuilderTest, SetSession_RolledSession_WritesSessionToHeader)
+{
+    mold::types::header::Session session{};
+    std::ranges::copy(builder.session(), session.begin());
+
+    builder.set_session(mold::types::header::roll_session(session));
+
+    EXPECT_EQ(builder.session(), "SESSION002");
+}
+
+TEST(MoldRollSessionTest, RollSession_TrailingDigits_IncrementsWithCarry)
+{
+    using mold::types::header::roll_session;
+    using mold::types::header::Session;
+
+    constexpr Session nines{'S', 'E', 'S', 'S', 'I', 'O', 'N', '0', '9', '9'};
+    constexpr Session all_nines{'9', '9', '9', '9', '9', '9', '9', '9', '9', '9'};
+    constexpr Session no_digits{'S', 'E', 'S', 'S', 'I', 'O', 'N', 'A', 'B', 'C'};
+
+    EXPECT_EQ(std::string_view(roll_session(nines).data(), 10), "SESSION100");
+    EXPECT_EQ(std::string_view(roll_session(all_nines).data(), 10), "0000000000");
+    EXPECT_EQ(std::string_view(roll_session(no_digits).data(), 10), "SESSIONAB1");
+}
@@ -46,6 +46,16 @@ TEST_F(RetransmissionBufferTest, Push_BeyondCapacity_OldestEvictedNewestRetrieva
     EXPECT_EQ(*result, 500u);
 }
 
+TEST_F(RetransmissionBufferTest, LastFilePosition_ReturnsLastPushed)
+{
+    EXPECT_EQ(buf.last_file_position(), 0u);
+
+    push(1, 100);
+    push(2, 200);
+
+    EXPECT_EQ(buf.last_file_position(), 200u);
+}
+
 TEST_F(RetransmissionBufferTest, FilePositionFor_EmptyBuffer_ReturnsNullopt)
 {
     EXPECT_EQ(buf.file_position_for(1), std::nullopt);
@@ -74,3 +84,18 @@ TEST_F(RetransmissionBufferTest, FilePositionFor_LiveWindowAfterWrap_ReturnsCorr
         EXPECT_EQ(*result, seq * 10);
     }
 }
+
+TEST_F(RetransmissionBufferTest, RollSession_DropsPreviousSessionRecords)
+{
+    push(1, 100);
+    push(2, 200);
+
+    buf.roll_session();
+
+    EXPECT_EQ(buf.session_index(), 1u);
+    EXPECT_EQ(buf.file_position_for(1), std::nullopt);
+
+    push(1, 300);
+    EXPECT_EQ(buf.file_position_for(1), 300u);
+    EXPECT_EQ(buf.file_position_for(2), std::nullopt);
+}
@@ -0,0 +1,252 @@
+#include <gtest/gtest.h>
+
+#include "imr/mold/downstream/shm_writer.h"
+#include "imr/mold/shm.h"
+#include "imr/mold/types.h"
+#include "util/binary_io.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace imr::mold;
+
+namespace
+{
+    constexpr auto mtu{256UZ};
+
+    // a downstream packet as PacketBuilder lays it out, messages "m<seq>" length prefixed
+    struct Packet
+    {
+        std::array<char, types::header::length> header{};
+        std::vector<std::string> messages;
+        std::vector<iovec> iov;
+
+        Packet(types::header::SequenceNumber first, types::header::MessageCount count)
+        {
+            imr::util::binary_io::write_at_be(std::span(header), types::header::sequence_number_offset, first);
+            imr::util::binary_io::write_at_be(std::span(header), types::header::message_count_offset, count);
+
+            messages.reserve(count);
+            iov.push_back({.iov_base = header.data(), .iov_len = header.size()});
+
+            if (count == types::header::end_of_session_msg_count)
+            {
+                return;
+            }
+
+            for (auto i{0U}; i < count; ++i)
+            {
+                const auto body{"m" + std::to_string(first + i)};
+                messages.push_back(std::string{'\0', static_cast<char>(body.size())} + body);
+                iov.push_back({.iov_base = messages.back().data(), .iov_len = messages.back().size()});
+            }
+        }
+
+        [[nodiscard]]
+        std::string bytes() const
+        {
+            std::string out(header.begin(), header.end());
+            for (const auto& message : messages)
+            {
+                out += message;
+            }
+            return out;
+        }
+    };
+
+    std::string as_string(std::span<const char> data)
+    {
+        return {data.begin(), data.end()};
+    }
+}
+
+TEST(MoldShmTest, Packets_ReaderSeesEachPacketAsSent)
+{
+    downstream::ShmWriter writer({.path = {}, .slot_count = 8}, mtu);
+    shm::Reader reader(writer.path());
+
+    EXPECT_EQ(reader.content(), shm::Content::packets);
+    EXPECT_FALSE(reader.try_read().has_value());
+
+    const Packet first(1, 3);
+    const Packet second(4, 1);
+    writer.publish(first.iov);
+    writer.publish(second.iov);
+
+    EXPECT_EQ(reader.lag(), 2u);
+
+    const auto entry{reader.try_read()};
+    ASSERT_TRUE(entry.has_value());
+    EXPECT_EQ(entry->sequence_number, 1u);
+    EXPECT_EQ(entry->message_count, 3u);
+    EXPECT_EQ(as_string(entry->data), first.bytes());
+
+    EXPECT_EQ(reader.try_read()->sequence_number, 4u);
+    EXPECT_FALSE(reader.try_read().has_value());
+    EXPECT_EQ(reader.lag(), 0u);
+}
+
+TEST(MoldShmTest, Messages_EntryPerMessageWithoutLengthPrefix)
+{
+    downstream::ShmWriter writer({.path = {}, .slot_count = 8, .content = shm::Content::messages}, mtu);
+    shm::Reader reader(writer.path());
+
+    writer.publish(Packet(10, 2).iov);
+    writer.publish(Packet(12, types::header::end_of_session_msg_count).iov);
+
+    auto entry{reader.try_read()};
+    ASSERT_TRUE(entry.has_value());
+    EXPECT_EQ(entry->sequence_number, 10u);
+    EXPECT_EQ(entry->message_count, 1u);
+    EXPECT_EQ(as_string(entry->data), "m10");
+
+    entry = reader.try_read();
+    EXPECT_EQ(entry->sequence_number, 11u);
+    EXPECT_EQ(as_string(entry->data), "m11");
+
+    entry = reader.try_read();
+    ASSERT_TRUE(entry.has_value());
+    EXPECT_EQ(entry->message_count, types::header::end_of_session_msg_count);
+    EXPECT_TRUE(entry->data.empty());
+}
+
+TEST(MoldShmTest, Lapped_SkipsToOldestAndCountsDropped)
+{
+    downstream::ShmWriter writer({.path = {}, .slot_count = 4}, mtu);
+    shm::Reader reader(writer.path());
+
+    for (types::header::SequenceNumber seq{1}; seq <= 10; ++seq)
+    {
+        writer.publish(Packet(seq, 1).iov);
+    }
+
+    // the oldest slot is the one the next publish overwrites, so 3 of the 4 remain readable
+    const auto entry{reader.try_read()};
+    ASSERT_TRUE(entry.has_value());
+    EXPECT_EQ(entry->sequence_number, 8u);
+    EXPECT_EQ(reader.dropped(), 7u);
+}
+
+TEST(MoldShmTest, StartOldest_ReadsWhatIsStillInTheRing)
+{
+    downstream::ShmWriter writer({.path = {}, .slot_count = 4}, mtu);
+    writer.publish(Packet(1, 1).iov);
+    writer.publish(Packet(2, 1).iov);
+
+    shm::Reader oldest(writer.path(), shm::Reader::Start::oldest);
+    shm::Reader latest(writer.path());
+
+    EXPECT_EQ(oldest.try_read()->sequence_number, 1u);
+    EXPECT_FALSE(latest.try_read().has_value());
+}
+
+TEST(MoldShmTest, Readers_RegisteredWithTheirLag)
+{
+    downstream::ShmWriter writer({.path = {}, .slot_count = 8}, mtu);
+
+    {
+        shm::Reader reader(writer.path());
+        writer.publish(Packet(1, 1).iov);
+        writer.publish(Packet(2, 1).iov);
+        ASSERT_TRUE(reader.try_read().has_value());
+
+        const auto readers{writer.readers()};
+        ASSERT_EQ(readers.size(), 1u);
+        EXPECT_EQ(readers[0].pid, getpid());
+        EXPECT_EQ(readers[0].lag, 1u);
+    }
+
+    EXPECT_TRUE(writer.readers().empty());
+}
+
+TEST(MoldShmTest, Readers_DeadReaderSlotReclaimed)
+{
+    downstream::ShmWriter writer({.path = {}, .slot_count = 8}, mtu);
+
+    const auto child{fork()};
+    ASSERT_GE(child, 0);
+
+    if (child == 0)
+    {
+        // every slot taken, then gone without detaching
+        std::array<std::optional<shm::Reader>, shm::max_readers> readers;
+        for (auto& reader : readers)
+        {
+            reader.emplace(writer.path());
+        }
+        _exit(0);
+    }
+
+    int status{};
+    ASSERT_EQ(waitpid(child, &status, 0), child);
+    ASSERT_EQ(writer.readers().size(), shm::max_readers);
+
+    const shm::Reader reader(writer.path());
+
+    const auto readers{writer.readers()};
+    EXPECT_EQ(readers.size(), shm::max_readers);
+    EXPECT_TRUE(std::ranges::any_of(readers, [](const auto& registered) { return registered.pid == getpid(); }));
+}
+
+TEST(MoldShmTest, NamedFile_ReaderAttachesByPath)
+{
+    const auto path{std::filesystem::path(TEST_DATA_DIR) / ("MoldShmTest_" + std::to_string(getpid()) + ".ring")};
+
+    {
+        downstream::ShmWriter writer({.path = path, .slot_count = 8}, mtu);
+        shm::Reader reader(path);
+
+        writer.publish(Packet(1, 1).iov);
+        EXPECT_EQ(reader.try_read()->sequence_number, 1u);
+    }
+
+    std::filesystem::remove(path);
+}
+
+TEST(MoldShmTest, OtherProcess_AttachesToMemfd)
+{
+    downstream::ShmWriter writer({.path = {}, .slot_count = 8}, mtu);
+    for (types::header::SequenceNumber seq{1}; seq <= 3; ++seq)
+    {
+        writer.publish(Packet(seq, 1).iov);
+    }
+
+    const auto child{fork()};
+    ASSERT_GE(child, 0);
+
+    if (child == 0)
+    {
+        // exit status = sequence numbers summed
+        shm::Reader reader(writer.path(), shm::Reader::Start::oldest);
+        auto sum{0};
+        for (auto entry{reader.try_read()}; entry.has_value(); entry = reader.try_read())
+        {
+            sum += static_cast<int>(entry->sequence_number);
+        }
+        _exit(sum);
+    }
+
+    int status{};
+    ASSERT_EQ(waitpid(child, &status, 0), child);
+    ASSERT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 6);
+}
+
+TEST(MoldShmTest, Ctor_Invalid_Throws)
+{
+    EXPECT_THROW(downstream::ShmWriter({.path = {}, .slot_count = 6}, mtu), std::invalid_argument);
+
+    const auto path{std::filesystem::path(TEST_DATA_DIR) / ("MoldShmTest_bad_" + std::to_string(getpid()) + ".ring")};
+    std::ofstream(path) << std::string(4096, 'x');
+    EXPECT_THROW(shm::Reader{path}, std::invalid_argument);
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,183 @@
+#include <gtest/gtest.h>
+
+#include "imr/mold/downstream/trace_ring.h"
+#include "imr/mold/trace.h"
+
+#include <chrono>
+#include <csignal>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+using namespace imr::mold;
+
+namespace
+{
+    const std::filesystem::path dump_path{std::filesystem::path(TEST_DATA_DIR) / "trace.bin"};
+
+    void previous_handler(int)
+    {
+    }
+
+    // handler currently installed for `signal`
+    void (*handler(int signal))(int)
+    {
+        struct sigaction action{};
+        EXPECT_EQ(sigaction(signal, nullptr, &action), 0);
+        return action.sa_handler;
+    }
+
+    void record(downstream::TraceRing& ring, types::header::SequenceNumber seq, trace::Result result = trace::Result::sent)
+    {
+        ring.record(seq,
+                    2,
+                    seq * 100,
+                    std::chrono::nanoseconds(seq * 1'000),
+                    std::chrono::steady_clock::time_point(std::chrono::nanoseconds(seq)),
+                    trace::tsc(),
+                    seq - 1,
+                    result);
+    }
+}
+
+TEST(MoldTraceTest, Ctor_CapacityNotPowerOfTwo_ThrowsInvalidArgument)
+{
+    EXPECT_THROW(downstream::TraceRing({.path = {}, .capacity = 3, .dump = {}, .dump_signal = 0}), std::invalid_argument);
+}
+
+TEST(MoldTraceTest, Ctor_DumpSignalWithoutDump_ThrowsInvalidArgument)
+{
+    EXPECT_THROW(downstream::TraceRing({.path = {}, .capacity = 4, .dump = {}, .dump_signal = SIGUSR1}), std::invalid_argument);
+}
+
+TEST(MoldTraceTest, Ctor_TerminatingDumpSignal_ThrowsInvalidArgument)
+{
+    EXPECT_THROW(downstream::TraceRing({.path = {}, .capacity = 4, .dump = dump_path, .dump_signal = SIGTERM}), std::invalid_argument);
+    EXPECT_THROW(downstream::TraceRing({.path = {}, .capacity = 4, .dump = dump_path, .dump_signal = SIGINT}), std::invalid_argument);
+}
+
+TEST(MoldTraceTest, Dtor_LastRingWatchingSignal_RestoresPreviousHandler)
+{
+    struct sigaction action{};
+    action.sa_handler = previous_handler;
+    sigemptyset(&action.sa_mask);
+    struct sigaction original{};
+    ASSERT_EQ(sigaction(SIGUSR1, &action, &original), 0);
+
+    {
+        const downstream::TraceRing first({.path = {}, .capacity = 4, .dump = dump_path, .dump_signal = SIGUSR1});
+        EXPECT_NE(handler(SIGUSR1), previous_handler);
+
+        {
+            const downstream::TraceRing second({.path = {}, .capacity = 4, .dump = dump_path, .dump_signal = SIGUSR1});
+        }
+
+        // still watched by the first
+        EXPECT_NE(handler(SIGUSR1), previous_handler);
+    }
+
+    EXPECT_EQ(handler(SIGUSR1), previous_handler);
+
+    sigaction(SIGUSR1, &original, nullptr);
+}
+
+TEST(MoldTraceTest, Read_LiveRing_RecordsInOrder)
+{
+    downstream::TraceRing ring({.path = {}, .capacity = 4, .dump = {}, .dump_signal = 0});
+    record(ring, 1);
+    record(ring, 3, trace::Result::send_error);
+
+    const auto read{trace::read(ring.path())};
+
+    ASSERT_EQ(read.records.size(), 2U);
+    EXPECT_EQ(read.records[0].sequence_number, 1U);
+    EXPECT_EQ(read.records[0].message_count, 2U);
+    EXPECT_EQ(read.records[0].file_position, 100U);
+    EXPECT_EQ(read.records[0].itch_timestamp, std::chrono::nanoseconds(1'000));
+    EXPECT_EQ(read.records[0].due, 1);
+    EXPECT_EQ(read.records[0].batch, 0U);
+    EXPECT_EQ(read.records[0].result, trace::Result::sent);
+    EXPECT_EQ(read.records[1].sequence_number, 3U);
+    EXPECT_EQ(read.records[1].result, trace::Result::send_error);
+    EXPECT_LE(read.records[0].send_tsc, read.records[1].send_tsc);
+}
+
+TEST(MoldTraceTest, Read_Wrapped_KeepsLatestCapacity)
+{
+    downstream::TraceRing ring({.path = {}, .capacity = 4, .dump = {}, .dump_signal = 0});
+    for (auto seq{1U}; seq <= 10; ++seq)
+    {
+        record(ring, seq);
+    }
+
+    const auto read{trace::read(ring.path())};
+
+    ASSERT_EQ(read.records.size(), 4U);
+    EXPECT_EQ(read.records.front().sequence_number, 7U);
+    EXPECT_EQ(read.records.back().sequence_number, 10U);
+}
+
+TEST(MoldTraceTest, Dump_ReadsBackAsCsv)
+{
+    std::filesystem::remove(dump_path);
+
+    downstream::TraceRing ring({.path = {}, .capacity = 4, .dump = dump_path, .dump_signal = 0});
+    record(ring, 1);
+    ring.dump();
+    // after the dump, not in it
+    record(ring, 3);
+
+    const auto read{trace::read(dump_path)};
+    ASSERT_EQ(read.records.size(), 1U);
+    EXPECT_GT(read.latest.tsc, read.origin.tsc);
+
+    std::ostringstream csv;
+    trace::write_csv(read, csv);
+
+    std::istringstream lines(csv.str());
+    std::string header;
+    std::string row;
+    std::getline(lines, header);
+    std::getline(lines, row);
+
+    EXPECT_EQ(header, "sequence_number,message_count,file_position,itch_timestamp_ns,due_ns,sent_ns,late_ns,send_tsc,batch,result");
+    EXPECT_TRUE(row.starts_with("1,2,100,1000,"));
+    EXPECT_TRUE(row.ends_with(",0,sent"));
+    EXPECT_FALSE(std::getline(lines, row));
+}
+
+TEST(MoldTraceTest, Dump_LiveRingStillCalibratedOnRead)
+{
+    std::filesystem::remove(dump_path);
+
+    downstream::TraceRing ring({.path = {}, .capacity = 4, .dump = dump_path, .dump_signal = 0});
+    record(ring, 1);
+    ring.dump();
+
+    // the dump's calibration stays in the dump, the live ring is calibrated as it's read
+    EXPECT_GT(trace::read(ring.path()).latest.tsc, trace::read(dump_path).latest.tsc);
+}
+
+TEST(MoldTraceTest, DumpSignal_WritesDump)
+{
+    std::filesystem::remove(dump_path);
+
+    downstream::TraceRing ring({.path = {}, .capacity = 4, .dump = dump_path, .dump_signal = SIGUSR2});
+    record(ring, 1);
+    record(ring, 3);
+
+    ASSERT_EQ(std::raise(SIGUSR2), 0);
+
+    EXPECT_EQ(trace::read(dump_path).records.size(), 2U);
+}
+
+TEST(MoldTraceTest, Read_NotATrace_ThrowsInvalidArgument)
+{
+    const auto path{std::filesystem::path(TEST_DATA_DIR) / "not_a_trace.bin"};
+    {
+        std::ofstream(path) << std::string(256, 'x');
+    }
+
+    EXPECT_THROW(static_cast<void>(trace::read(path)), std::invalid_argument);
+}
@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+
+#include "imr/util/byte_ring.h"
+
+#include <algorithm>
+#include <array>
+#include <numeric>
+
+using namespace imr;
+
+class UtilByteRingTest : public ::testing::Test
+{
+  protected:
+    util::ByteRing ring{1};
+
+    void write(std::span<const char> bytes)
+    {
+        std::ranges::copy(bytes, ring.prepare(bytes.size()).begin());
+        ring.commit(bytes.size());
+    }
+};
+
+TEST_F(UtilByteRingTest, Ctor_Zero_ThrowsInvalidArgument)
+{
+    EXPECT_THROW(util::ByteRing(0), std::invalid_argument);
+}
+
+TEST_F(UtilByteRingTest, Capacity_RoundedUpToPowerOfTwoPageMultiple)
+{
+    EXPECT_GE(ring.capacity(), 1u);
+    EXPECT_EQ(ring.capacity() & (ring.capacity() - 1), 0u);
+}
+
+TEST_F(UtilByteRingTest, Commit_AdvancesHead)
+{
+    write(std::to_array({'a', 'b', 'c'}));
+
+    EXPECT_EQ(ring.head(), 3u);
+    EXPECT_EQ(ring.tail(), 0u);
+}
+
+TEST_F(UtilByteRingTest, View_AcrossWrap_IsContiguous)
+{
+    // leave 2 bytes before the end so the next write straddles the wrap
+    std::vector<char> filler(ring.capacity() - 2);
+    write(filler);
+
+    const auto bytes{std::to_array({'w', 'r', 'a', 'p'})};
+    write(bytes);
+
+    EXPECT_TRUE(std::ranges::equal(ring.view(ring.capacity() - 2, bytes.size()), bytes));
+}
+
+TEST_F(UtilByteRingTest, CopyTo_CommittedRange_CopiesBytes)
+{
+    const auto bytes{std::to_array({'a', 'b', 'c'})};
+    write(bytes);
+
+    std::array<char, 3> dst{};
+    ASSERT_TRUE(ring.copy_to(0, dst));
+    EXPECT_EQ(dst, bytes);
+}
+
+TEST_F(UtilByteRingTest, CopyTo_UncommittedRange_ReturnsFalse)
+{
+    write(std::to_array({'a'}));
+
+    std::array<char, 2> dst{};
+    EXPECT_FALSE(ring.copy_to(0, dst));
+}
+
+TEST_F(UtilByteRingTest, CopyTo_OverwrittenRange_ReturnsFalse)
+{
+    std::vector<char> bytes(ring.capacity());
+    std::iota(bytes.begin(), bytes.end(), 0);
+    write(bytes);
+    write(std::to_array({'x'}));
+
+    std::array<char, 1> dst{};
+    EXPECT_EQ(ring.tail(), 1u);
+    EXPECT_FALSE(ring.copy_to(0, dst));
+    EXPECT_TRUE(ring.copy_to(1, dst));
+    EXPECT_EQ(dst[0], bytes[1]);
+}
@@ -0,0 +1,110 @@
+#include <gtest/gtest.h>
+
+#include "imr/util/histogram.h"
+
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+using imr::util::Histogram;
+
+TEST(UtilHistogramTest, SmallValues_Exact)
+{
+    const auto histogram{std::make_unique<Histogram>()};
+    for (auto value{0ULL}; value < Histogram::sub_bucket_count; ++value)
+    {
+        histogram->record(value);
+    }
+
+    Histogram::Snapshot snapshot;
+    snapshot.add(*histogram);
+
+    EXPECT_EQ(snapshot.count(), Histogram::sub_bucket_count);
+    EXPECT_EQ(snapshot.min(), 0u);
+    EXPECT_EQ(snapshot.max(), Histogram::sub_bucket_count - 1);
+    EXPECT_EQ(snapshot.percentile(50.0), (Histogram::sub_bucket_count / 2) - 1);
+    EXPECT_EQ(snapshot.percentile(100.0), Histogram::sub_bucket_count - 1);
+}
+
+TEST(UtilHistogramTest, LargeValues_WithinPrecision)
+{
+    for (const auto value : {256ULL, 257ULL, 1'000ULL, 123'456'789ULL, 1ULL << 40U, (1ULL << 63U) + 12345})
+    {
+        const auto index{Histogram::index_of(value)};
+        ASSERT_LT(index, Histogram::bucket_count);
+
+        const auto low{Histogram::lowest_equivalent(index)};
+        const auto high{Histogram::highest_equivalent(index)};
+        EXPECT_LE(low, value);
+        EXPECT_GE(high, value);
+        EXPECT_LE(static_cast<double>(high - low), static_cast<double>(value) / Histogram::sub_bucket_half);
+    }
+}
+
+TEST(UtilHistogramTest, Buckets_Contiguous)
+{
+    for (auto index{1UZ}; index < Histogram::bucket_count; ++index)
+    {
+        ASSERT_EQ(Histogram::lowest_equivalent(index), Histogram::highest_equivalent(index - 1) + 1);
+        ASSERT_EQ(Histogram::index_of(Histogram::lowest_equivalent(index)), index);
+    }
+}
+
+TEST(UtilHistogramTest, Percentiles_OfUniformValues)
+{
+    const auto histogram{std::make_unique<Histogram>()};
+    for (auto value{1ULL}; value <= 100'000; ++value)
+    {
+        histogram->record(value);
+    }
+
+    Histogram::Snapshot snapshot;
+    snapshot.add(*histogram);
+
+    EXPECT_DOUBLE_EQ(snapshot.mean(), 50'000.5);
+    EXPECT_EQ(snapshot.min(), 1u);
+    EXPECT_NEAR(static_cast<double>(snapshot.percentile(50.0)), 50'000.0, 50'000.0 / Histogram::sub_bucket_half);
+    EXPECT_NEAR(static_cast<double>(snapshot.percentile(99.0)), 99'000.0, 99'000.0 / Histogram::sub_bucket_half);
+    EXPECT_EQ(snapshot.percentile(100.0), snapshot.max());
+    EXPECT_GE(snapshot.max(), 100'000u);
+}
+
+TEST(UtilHistogramTest, Snapshot_MergesThreads)
+{
+    const auto fast{std::make_unique<Histogram>()};
+    const auto slow{std::make_unique<Histogram>()};
+
+    {
+        std::jthread fast_thread([&fast] {
+            for (auto i{0}; i < 900; ++i)
+            {
+                fast->record(10);
+            }
+        });
+        std::jthread slow_thread([&slow] {
+            for (auto i{0}; i < 100; ++i)
+            {
+                slow->record(1'000'000);
+            }
+        });
+    }
+
+    Histogram::Snapshot snapshot;
+    snapshot.add(*fast);
+    snapshot.add(*slow);
+
+    EXPECT_EQ(snapshot.count(), 1000u);
+    EXPECT_EQ(snapshot.percentile(90.0), 10u);
+    EXPECT_GE(snapshot.percentile(90.1), 1'000'000u);
+}
+
+TEST(UtilHistogramTest, Snapshot_Empty_Zero)
+{
+    const Histogram::Snapshot snapshot;
+
+    EXPECT_EQ(snapshot.count(), 0u);
+    EXPECT_EQ(snapshot.min(), 0u);
+    EXPECT_EQ(snapshot.max(), 0u);
+    EXPECT_EQ(snapshot.mean(), 0.0);
+    EXPECT_EQ(snapshot.percentile(99.0), 0u);
+}
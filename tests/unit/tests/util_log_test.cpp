@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+
+#include "imr/util/log.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <tuple>
+
+namespace detail = imr::util::log::detail;
+
+namespace
+{
+    // what log() writes to a claimed record, formatted back as the background thread would
+    template <typename... Args>
+    std::string round_trip(std::format_string<Args...> fmt, Args&&... args)
+    {
+        detail::Record record{};
+        record.format = &detail::format<Args...>;
+
+        detail::Writer writer(record.payload);
+        writer.value(fmt);
+        detail::put<0>(writer, std::tie(args...));
+
+        return record.format(record);
+    }
+}
+
+TEST(UtilLogTest, Record_RoundTrips)
+{
+    const std::string owned{"owned"};
+    const char* literal{"pointer"};
+
+    EXPECT_EQ(round_trip("{} {} {} {} {}", 42, -1.5, literal, std::string_view{"view"}, owned),
+              "42 -1.5 pointer view owned");
+}
+
+TEST(UtilLogTest, Record_LongString_Truncated)
+{
+    const std::string long_text(1'000, 'x');
+    const std::uint64_t after{7};
+
+    const auto formatted{round_trip("{}|{}", long_text, after)};
+
+    ASSERT_TRUE(formatted.ends_with("|7"));
+    EXPECT_LT(formatted.size(), sizeof(detail::Record::payload));
+    EXPECT_EQ(formatted.find_first_not_of('x'), formatted.size() - 2);
+}
+
+TEST(UtilLogTest, Ring_Full_Drops)
+{
+    const auto ring{std::make_unique<detail::Ring>()};
+
+    for (auto i{0UZ}; i < detail::Ring::capacity; ++i)
+    {
+        ASSERT_NE(ring->claim(), nullptr);
+        ring->publish();
+    }
+
+    EXPECT_EQ(ring->claim(), nullptr);
+    EXPECT_EQ(ring->dropped(), 1u);
+
+    ASSERT_NE(ring->front(), nullptr);
+    ring->pop();
+    EXPECT_NE(ring->claim(), nullptr);
+}
+
+TEST(UtilLogTest, Flush_WritesInOrder)
+{
+    testing::internal::CaptureStderr();
+
+    imr::util::log::error("first {}", 1);
+    imr::util::log::error("second {}", std::string{"2"});
+    imr::util::log::flush();
+
+    const auto output{testing::internal::GetCapturedStderr()};
+    const auto first{output.find("[imr:error] first 1\n")};
+    const auto second{output.find("[imr:error] second 2\n")};
+
+    ASSERT_NE(first, std::string::npos);
+    ASSERT_NE(second, std::string::npos);
+    EXPECT_LT(first, second);
+}
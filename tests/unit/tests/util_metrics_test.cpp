@@ -0,0 +1,206 @@
+#include <gtest/gtest.h>
+
+#include "imr/util/metrics.h"
+
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace imr::util;
+
+namespace
+{
+    std::string get(std::uint16_t port, std::string_view path)
+    {
+        const FileDescriptor client{socket(AF_INET, SOCK_STREAM, 0)};
+
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (connect(client.get(), reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0)
+        {
+            return {};
+        }
+
+        const auto request{std::string("GET ") + std::string(path) + " HTTP/1.0\r\n\r\n"};
+        send(client.get(), request.data(), request.size(), MSG_NOSIGNAL);
+
+        std::string response;
+        std::array<char, 4096> buffer{};
+        for (auto bytes{recv(client.get(), buffer.data(), buffer.size(), 0)}; bytes > 0;
+             bytes = recv(client.get(), buffer.data(), buffer.size(), 0))
+        {
+            response.append(buffer.data(), static_cast<std::size_t>(bytes));
+        }
+        return response;
+    }
+
+    // connected and sending nothing, like a port scan
+    FileDescriptor connect_silent(std::uint16_t port)
+    {
+        FileDescriptor client{socket(AF_INET, SOCK_STREAM, 0)};
+
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        EXPECT_EQ(connect(client.get(), reinterpret_cast<const sockaddr*>(&address), sizeof(address)), 0);
+
+        return client;
+    }
+}
+
+TEST(UtilMetricsTest, Attach_KeepsValueSoFar)
+{
+    metrics::Registry registry({});
+    metrics::Counter counter;
+    metrics::Gauge gauge;
+
+    counter.increment(3);
+    gauge.set(-5);
+
+    registry.attach(counter, "imr_test_total", "thread=\"0\"");
+    registry.attach(gauge, "imr_test_gauge");
+    counter.increment();
+
+    const auto samples{registry.read()};
+    ASSERT_EQ(samples.size(), 2u);
+    EXPECT_EQ(samples[0].name, "imr_test_total");
+    EXPECT_EQ(samples[0].labels, "thread=\"0\"");
+    EXPECT_EQ(samples[0].kind, metrics::Kind::counter);
+    EXPECT_EQ(samples[0].value, 4);
+    EXPECT_EQ(samples[1].kind, metrics::Kind::gauge);
+    EXPECT_EQ(samples[1].value, -5);
+}
+
+TEST(UtilMetricsTest, IncrementShared_SeveralThreads_CountsEveryIncrement)
+{
+    constexpr auto increments{100'000};
+    metrics::Counter counter;
+
+    {
+        std::vector<std::jthread> threads;
+        for (auto i{0}; i < 4; ++i)
+        {
+            threads.emplace_back([&counter] {
+                for (auto n{0}; n < increments; ++n)
+                {
+                    counter.increment_shared();
+                }
+            });
+        }
+    }
+
+    EXPECT_EQ(counter.value(), 4u * increments);
+}
+
+TEST(UtilMetricsTest, Prometheus_SumsSameSeries)
+{
+    const std::vector<metrics::Sample> samples{
+        {.name = "imr_a_total", .labels = "thread=\"0\"", .kind = metrics::Kind::counter, .value = 1},
+        {.name = "imr_b", .labels = "", .kind = metrics::Kind::gauge, .value = 7},
+        {.name = "imr_a_total", .labels = "thread=\"1\"", .kind = metrics::Kind::counter, .value = 2},
+        {.name = "imr_a_total", .labels = "thread=\"0\"", .kind = metrics::Kind::counter, .value = 3},
+    };
+
+    EXPECT_EQ(metrics::prometheus(samples),
+              "# TYPE imr_a_total counter\n"
+              "imr_a_total{thread=\"0\"} 4\n"
+              "imr_a_total{thread=\"1\"} 2\n"
+              "# TYPE imr_b gauge\n"
+              "imr_b 7\n");
+}
+
+TEST(UtilMetricsTest, Reader_SeesUpdatesReadOnly)
+{
+    metrics::Registry registry({});
+    metrics::Counter counter;
+    registry.attach(counter, "imr_test_total");
+
+    const metrics::Reader reader(registry.path());
+    EXPECT_EQ(reader.read().front().value, 0);
+
+    counter.increment(10);
+    EXPECT_EQ(reader.read().front().value, 10);
+
+    // registered after the reader attached
+    metrics::Counter later;
+    registry.attach(later, "imr_later_total");
+    EXPECT_EQ(reader.read().size(), 2u);
+}
+
+TEST(UtilMetricsTest, Attach_Invalid_Throws)
+{
+    metrics::Registry registry({.path = {}, .capacity = 1});
+    metrics::Counter counter;
+    metrics::Counter other;
+
+    EXPECT_THROW(registry.attach(counter, ""), std::invalid_argument);
+    EXPECT_THROW(registry.attach(counter, std::string(metrics::name_size + 1, 'a')), std::invalid_argument);
+
+    registry.attach(counter, "imr_test_total");
+    EXPECT_THROW(registry.attach(other, "imr_other_total"), std::invalid_argument);
+}
+
+TEST(UtilMetricsTest, Reader_NotASegment_Throws)
+{
+    const auto path{std::filesystem::path(TEST_DATA_DIR) / ("UtilMetricsTest_bad_" + std::to_string(getpid()))};
+    std::ofstream(path) << std::string(4096, 'x');
+    EXPECT_THROW(metrics::Reader{path}, std::invalid_argument);
+    std::filesystem::remove(path);
+}
+
+TEST(UtilMetricsTest, Endpoint_ServesMetrics)
+{
+    metrics::Registry registry({});
+    metrics::Counter counter;
+    registry.attach(counter, "imr_test_total");
+    counter.increment(42);
+
+    metrics::Endpoint endpoint({.address = "127.0.0.1", .port = 0}, registry);
+    std::jthread thread([&endpoint](std::stop_token st) { endpoint.start(st); });
+
+    const auto response{get(endpoint.port(), "/metrics")};
+    EXPECT_TRUE(response.starts_with("HTTP/1.0 200 OK\r\n"));
+    EXPECT_TRUE(response.ends_with("\r\n\r\n# TYPE imr_test_total counter\nimr_test_total 42\n"));
+
+    EXPECT_TRUE(get(endpoint.port(), "/").starts_with("HTTP/1.0 404 Not Found\r\n"));
+}
+
+TEST(UtilMetricsTest, Endpoint_SilentConnection_StopReturns)
+{
+    metrics::Registry registry({});
+    metrics::Endpoint endpoint({.address = "127.0.0.1", .port = 0, .timeout = std::chrono::seconds(60)}, registry);
+    std::jthread thread([&endpoint](std::stop_token st) { endpoint.start(st); });
+
+    const auto silent{connect_silent(endpoint.port())};
+    // the endpoint accepts it and waits for a request
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    const auto before{std::chrono::steady_clock::now()};
+    thread.request_stop();
+    thread.join();
+
+    EXPECT_LT(std::chrono::steady_clock::now() - before, std::chrono::seconds(5));
+}
+
+TEST(UtilMetricsTest, Endpoint_SilentConnection_DroppedAfterTimeout)
+{
+    metrics::Registry registry({});
+    metrics::Endpoint endpoint({.address = "127.0.0.1", .port = 0, .timeout = std::chrono::milliseconds(50)}, registry);
+    std::jthread thread([&endpoint](std::stop_token st) { endpoint.start(st); });
+
+    const auto silent{connect_silent(endpoint.port())};
+
+    EXPECT_TRUE(get(endpoint.port(), "/metrics").starts_with("HTTP/1.0 200 OK\r\n"));
+}
@@ -0,0 +1,41 @@
+// Dumps / converts a downstream trace ring (imr::mold::downstream::TraceRing).
+//
+//   imr-trace <ring or dump>              CSV to stdout
+//   imr-trace <ring or dump> <dump file>  compact binary dump, e.g. of a live ring under /dev/shm
+
+#include "imr/mold/trace.h"
+
+#include <exception>
+#include <iostream>
+#include <print>
+#include <span>
+
+int main(int argc, char** argv)
+{
+    const std::span args(argv, static_cast<std::size_t>(argc));
+
+    if (args.size() != 2 && args.size() != 3)
+    {
+        std::println(stderr, "usage: {} <ring or dump> [dump file]", args[0]);
+        return 2;
+    }
+
+    try
+    {
+        if (args.size() == 3)
+        {
+            imr::mold::trace::dump(args[1], args[2]);
+        }
+        else
+        {
+            imr::mold::trace::write_csv(imr::mold::trace::read(args[1]), std::cout);
+        }
+    }
+    catch (const std::exception& ex)
+    {
+        std::println(stderr, "{}: {}", args[0], ex.what());
+        return 1;
+    }
+
+    return 0;
+}
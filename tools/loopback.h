@@ -0,0 +1,111 @@
+#pragma once
+
+#include "imr/util/file_descriptor.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <format>
+#include <optional>
+#include <print>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <sys/socket.h>
+
+// sockets the tools receive a replay / talk to the server with, all on loopback
+namespace imr::tools
+{
+    inline void check(int result, const char* what)
+    {
+        if (result < 0)
+        {
+            throw std::system_error(errno, std::system_category(), what);
+        }
+    }
+
+    /// Binds the UDP socket to 127.0.0.1 on an ephemeral port, returned.
+    inline std::uint16_t bind_loopback(int fd)
+    {
+        sockaddr_in addr{.sin_family = AF_INET, .sin_port = 0, .sin_addr = {.s_addr = htonl(INADDR_LOOPBACK)}, .sin_zero = {}};
+        check(bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), "bind");
+
+        socklen_t length{sizeof(addr)};
+        check(getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &length), "getsockname");
+        return ntohs(addr.sin_port);
+    }
+
+    /** A UDP port free right now, for servers that can't report the one they were assigned (the retransmission
+     *  feeds share theirs with SO_REUSEPORT).
+     */
+    [[nodiscard]]
+    inline std::uint16_t free_udp_port()
+    {
+        const util::FileDescriptor fd(socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0));
+        return bind_loopback(fd.get());
+    }
+
+    /// Asks for a receive buffer of `bytes`, past rmem_max (SO_RCVBUFFORCE) when privileged.
+    inline void set_receive_buffer(int fd, int bytes)
+    {
+        if (setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, &bytes, sizeof(bytes)) < 0)
+        {
+            check(setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bytes, sizeof(bytes)), "SO_RCVBUF");
+        }
+    }
+
+    struct Subscription
+    {
+        util::FileDescriptor fd;
+        /// Port the downstream should send to.
+        std::uint16_t port;
+    };
+
+    /// A socket joined to multicast `group` on the loopback interface, on an ephemeral port.
+    [[nodiscard]]
+    inline Subscription subscribe(std::string_view group)
+    {
+        util::FileDescriptor fd(socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0));
+
+        constexpr int on{1};
+        check(setsockopt(fd.get(), SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)), "SO_REUSEADDR");
+        set_receive_buffer(fd.get(), 256 << 20);
+
+        sockaddr_in addr{.sin_family = AF_INET, .sin_port = 0, .sin_addr = {.s_addr = htonl(INADDR_ANY)}, .sin_zero = {}};
+        check(bind(fd.get(), reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), "bind");
+
+        socklen_t length{sizeof(addr)};
+        check(getsockname(fd.get(), reinterpret_cast<sockaddr*>(&addr), &length), "getsockname");
+
+        ip_mreq membership{.imr_multiaddr = {}, .imr_interface = {.s_addr = htonl(INADDR_LOOPBACK)}};
+        if (inet_pton(AF_INET, std::string(group).c_str(), &membership.imr_multiaddr) != 1)
+        {
+            throw std::invalid_argument(std::format("not an IPv4 address: {}", group));
+        }
+        check(setsockopt(fd.get(), IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)), "IP_ADD_MEMBERSHIP");
+
+        return {.fd = std::move(fd), .port = ntohs(addr.sin_port)};
+    }
+
+    /// Pins the calling thread, a warning if it can't be.
+    inline void pin(std::optional<unsigned> cpu, std::string_view who) noexcept
+    {
+        if (!cpu.has_value())
+        {
+            return;
+        }
+
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(*cpu, &cpus);
+        if (const auto err{pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus)}; err != 0)
+        {
+            std::println(stderr, "pinning the {} to cpu {} failed: {}", who, *cpu, std::system_category().message(err));
+        }
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <charconv>
+#include <format>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+// command line parsing shared by the tools: `--name value` pairs
+namespace imr::tools
+{
+    template <typename T>
+    T parse_number(std::string_view name, std::string_view value)
+    {
+        T parsed{};
+        const auto [end, ec]{std::from_chars(value.data(), value.data() + value.size(), parsed)};
+        if (ec != std::errc{} || end != value.data() + value.size())
+        {
+            throw std::invalid_argument(std::format("{}: not a number: {}", name, value));
+        }
+        return parsed;
+    }
+
+    /// `a,b,c`
+    template <typename T>
+    std::vector<T> parse_numbers(std::string_view name, std::string_view value)
+    {
+        std::vector<T> parsed;
+        for (auto rest{value}; !rest.empty();)
+        {
+            const auto comma{rest.find(',')};
+            parsed.push_back(parse_number<T>(name, rest.substr(0, comma)));
+            rest = comma == std::string_view::npos ? std::string_view{} : rest.substr(comma + 1);
+        }
+        return parsed;
+    }
+}
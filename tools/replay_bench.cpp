@@ -0,0 +1,467 @@
+// End to end loopback benchmark: replays a file through imr::Server at increasing playback speeds into a recvmmsg()
+// receiver joined to the downstream's group, and reports the highest speed the replay stays faithful at on this host.
+//
+//   imr-replay-bench [options]
+//
+//   --file <path>         ITCH file to replay (default: a synthetic TotalView-like file, see --rate / --seconds)
+//   --rate <msgs/s>       synthetic file's message rate in ITCH time (default 200000)
+//   --seconds <s>         synthetic file's length in ITCH time (default 5)
+//   --skip-before <ns>    pacer's skip_before, packets before it aren't paced nor judged (default 0)
+//   --speeds <a,b,...>    run exactly these playback speeds instead of sweeping
+//   --start <speed>       first speed of the sweep (default 1)
+//   --max <speed>         highest speed swept (default 1024)
+//   --refine <n>          bisection steps between the last faithful and first unfaithful speed (default 3)
+//   --tolerance-us <us>   p99 inter-arrival error / lateness a faithful replay stays within (default 250)
+//   --wait <sleep|spin>   the downstream's wait strategy (default sleep)
+//   --cpu <n>             core to pin the receiver to
+//   --group <ip>          multicast group (default 239.0.0.1)
+//   --mtu <bytes>         downstream MTU (default 1472)
+//
+// A speed is faithful when every message arrives (no sequence gaps) and the p99 of both the inter-arrival error (the
+// gap between consecutive packets' arrivals against their ITCH timestamps' gap / speed) and the lateness (arrival
+// against the first packet's, versus the ITCH timestamps' offset / speed) stay within --tolerance-us.
+
+#include "loopback.h"
+#include "options.h"
+#include "synthetic_itch.h"
+
+#include "imr/server.h"
+#include "imr/mold/types.h"
+#include "imr/util/histogram.h"
+#include "itch/timestamp.h"
+#include "util/binary_io.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <format>
+#include <memory>
+#include <optional>
+#include <print>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <time.h>
+
+using namespace imr;
+
+namespace
+{
+    struct Options
+    {
+        std::optional<std::filesystem::path> file;
+        double rate{200'000};
+        double seconds{5};
+        std::chrono::nanoseconds skip_before{0};
+        std::vector<double> speeds;
+        double start{1};
+        double max{1024};
+        unsigned refine{3};
+        std::chrono::nanoseconds tolerance{std::chrono::microseconds(250)};
+        util::wait::Kind wait{util::wait::Kind::sleep};
+        std::optional<unsigned> cpu;
+        std::string group{"239.0.0.1"};
+        std::size_t mtu{1472};
+    };
+
+    Options parse(std::span<char*> args)
+    {
+        Options options;
+
+        for (auto i{1UZ}; i < args.size(); i += 2)
+        {
+            const std::string_view name{args[i]};
+            if (i + 1 >= args.size())
+            {
+                throw std::invalid_argument(std::format("{}: missing value", name));
+            }
+            const std::string_view value{args[i + 1]};
+
+            if (name == "--file")
+            {
+                options.file = value;
+            }
+            else if (name == "--rate")
+            {
+                options.rate = tools::parse_number<double>(name, value);
+            }
+            else if (name == "--seconds")
+            {
+                options.seconds = tools::parse_number<double>(name, value);
+            }
+            else if (name == "--skip-before")
+            {
+                options.skip_before = std::chrono::nanoseconds(tools::parse_number<std::int64_t>(name, value));
+            }
+            else if (name == "--speeds")
+            {
+                options.speeds = tools::parse_numbers<double>(name, value);
+            }
+            else if (name == "--start")
+            {
+                options.start = tools::parse_number<double>(name, value);
+            }
+            else if (name == "--max")
+            {
+                options.max = tools::parse_number<double>(name, value);
+            }
+            else if (name == "--refine")
+            {
+                options.refine = tools::parse_number<unsigned>(name, value);
+            }
+            else if (name == "--tolerance-us")
+            {
+                options.tolerance = std::chrono::microseconds(tools::parse_number<std::int64_t>(name, value));
+            }
+            else if (name == "--wait")
+            {
+                if (value != "sleep" && value != "spin")
+                {
+                    throw std::invalid_argument(std::format("{}: sleep or spin", name));
+                }
+                options.wait = value == "spin" ? util::wait::Kind::spin : util::wait::Kind::sleep;
+            }
+            else if (name == "--cpu")
+            {
+                options.cpu = tools::parse_number<unsigned>(name, value);
+            }
+            else if (name == "--group")
+            {
+                options.group = value;
+            }
+            else if (name == "--mtu")
+            {
+                options.mtu = tools::parse_number<std::size_t>(name, value);
+            }
+            else
+            {
+                throw std::invalid_argument(std::format("unknown option {}", name));
+            }
+        }
+
+        if (options.start <= 0 || options.max < options.start || options.rate <= 0 || options.seconds <= 0)
+        {
+            throw std::invalid_argument("--start, --rate and --seconds must be positive, --max at least --start");
+        }
+
+        return options;
+    }
+
+    struct Stats
+    {
+        std::uint64_t packets{0};
+        std::uint64_t messages{0};
+        std::uint64_t bytes{0};
+        // messages missing, and the gaps they were missing in
+        std::uint64_t missing{0};
+        std::uint64_t gaps{0};
+        std::int64_t first_ns{0};
+        std::int64_t last_ns{0};
+        util::Histogram inter_arrival_error;
+        util::Histogram lateness;
+    };
+
+    /// Joins the group on an ephemeral port, receives with recvmmsg() and kernel receive timestamps (SO_TIMESTAMPNS).
+    class Receiver
+    {
+      public:
+        Receiver(const std::string& group, std::optional<unsigned> cpu)
+            : subscription_{tools::subscribe(group)},
+              cpu_{cpu}
+        {
+            constexpr int on{1};
+            tools::check(setsockopt(subscription_.fd.get(), SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)), "SO_TIMESTAMPNS");
+
+            constexpr timeval timeout{.tv_sec = 0, .tv_usec = 100'000};
+            tools::check(setsockopt(subscription_.fd.get(), SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)), "SO_RCVTIMEO");
+        }
+
+        [[nodiscard]]
+        std::uint16_t port() const noexcept
+        {
+            return subscription_.port;
+        }
+
+        /// Receives until end of session, or `stop` and nothing left to read.
+        void run(const std::atomic<bool>& stop, double speed, std::chrono::nanoseconds skip_before, Stats& stats)
+        {
+            tools::pin(cpu_, "receiver");
+
+            constexpr auto batch{64UZ};
+            constexpr auto max_packet{9000UZ};
+            std::vector<char> buffers(batch * max_packet);
+            std::array<std::array<char, CMSG_SPACE(sizeof(timespec))>, batch> controls{};
+            std::array<iovec, batch> iovs{};
+            std::array<mmsghdr, batch> messages{};
+
+            mold::types::header::SequenceNumber next{1};
+            std::optional<std::int64_t> origin_rx;
+            std::int64_t origin_itch{0};
+            std::int64_t previous_rx{0};
+            std::int64_t previous_itch{0};
+
+            for (;;)
+            {
+                for (auto i{0UZ}; i < batch; ++i)
+                {
+                    iovs[i] = {.iov_base = buffers.data() + (i * max_packet), .iov_len = max_packet};
+                    messages[i].msg_hdr = {.msg_name = nullptr,
+                                           .msg_namelen = 0,
+                                           .msg_iov = &iovs[i],
+                                           .msg_iovlen = 1,
+                                           .msg_control = controls[i].data(),
+                                           .msg_controllen = controls[i].size(),
+                                           .msg_flags = 0};
+                }
+
+                const auto received{recvmmsg(subscription_.fd.get(), messages.data(), batch, MSG_WAITFORONE, nullptr)};
+                if (received < 0)
+                {
+                    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+                    {
+                        if (stop.load(std::memory_order_acquire))
+                        {
+                            return;
+                        }
+                        continue;
+                    }
+                    throw std::system_error(errno, std::system_category(), "recvmmsg");
+                }
+
+                for (auto i{0UZ}; i < static_cast<std::size_t>(received); ++i)
+                {
+                    const std::span packet(static_cast<const char*>(iovs[i].iov_base), messages[i].msg_len);
+                    if (packet.size() < mold::types::header::length)
+                    {
+                        continue;
+                    }
+
+                    const auto count{util::binary_io::read_at_be<mold::types::header::MessageCount>(packet, mold::types::header::message_count_offset)};
+                    if (count == mold::types::header::end_of_session_msg_count)
+                    {
+                        return;
+                    }
+                    if (count == mold::types::header::heartbeat_msg_count)
+                    {
+                        continue;
+                    }
+
+                    const auto rx{receive_time(messages[i].msg_hdr)};
+                    const auto seq{util::binary_io::read_at_be<mold::types::header::SequenceNumber>(packet, mold::types::header::sequence_number_offset)};
+                    if (seq > next)
+                    {
+                        stats.missing += seq - next;
+                        ++stats.gaps;
+                    }
+                    next = std::max(next, seq + count);
+
+                    stats.first_ns = stats.packets == 0 ? rx : stats.first_ns;
+                    stats.last_ns = rx;
+                    ++stats.packets;
+                    stats.messages += count;
+                    stats.bytes += packet.size();
+
+                    const auto itch{itch::extract_timestamp(packet.subspan(mold::types::header::length + sizeof(mold::types::LengthPrefix))).count()};
+                    if (itch < skip_before.count())
+                    {
+                        continue;
+                    }
+
+                    if (!origin_rx.has_value())
+                    {
+                        origin_rx = rx;
+                        origin_itch = itch;
+                    }
+                    else
+                    {
+                        const auto expected_gap{static_cast<double>(itch - previous_itch) / speed};
+                        stats.inter_arrival_error.record(static_cast<std::uint64_t>(std::abs(static_cast<double>(rx - previous_rx) - expected_gap)));
+
+                        const auto expected_offset{static_cast<double>(itch - origin_itch) / speed};
+                        stats.lateness.record(static_cast<std::uint64_t>(std::max(0.0, static_cast<double>(rx - *origin_rx) - expected_offset)));
+                    }
+
+                    previous_rx = rx;
+                    previous_itch = itch;
+                }
+            }
+        }
+
+      private:
+        tools::Subscription subscription_;
+        std::optional<unsigned> cpu_;
+
+        static std::int64_t receive_time(const msghdr& header) noexcept
+        {
+            for (auto* cmsg{CMSG_FIRSTHDR(&header)}; cmsg != nullptr; cmsg = CMSG_NXTHDR(const_cast<msghdr*>(&header), cmsg))
+            {
+                if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS)
+                {
+                    timespec ts{};
+                    std::memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+                    return (std::int64_t{ts.tv_sec} * 1'000'000'000) + ts.tv_nsec;
+                }
+            }
+
+            timespec ts{};
+            clock_gettime(CLOCK_REALTIME, &ts);
+            return (std::int64_t{ts.tv_sec} * 1'000'000'000) + ts.tv_nsec;
+        }
+    };
+
+    struct Run
+    {
+        double speed;
+        bool faithful;
+    };
+
+    Run run(const Options& options, const std::filesystem::path& file, std::uint64_t file_messages, double speed)
+    {
+        Receiver receiver(options.group, options.cpu);
+
+        Server::Config cfg{
+            .mapped_itch_file_cfg = {.path = file, .mmap_flags = MAP_POPULATE},
+            .packet_builder_cfg = {.session = "BENCH00001", .MTU = options.mtu},
+            .downstream_feed_config = {
+                .mcast_group = options.group,
+                .port = receiver.port(),
+                .loopback = true,
+                .egress_interface = {.s_addr = htonl(INADDR_LOOPBACK)},
+                .heartbeat_period = std::chrono::milliseconds(100),
+                .end_of_session_duration = std::chrono::milliseconds(100),
+                .pacer_cfg = {.playback_speed = speed, .skip_before = options.skip_before},
+                .wait = options.wait,
+            },
+            .retransmission_buffer_size = 1U << 16U,
+            .retransmission_feed_config = {.address = "127.0.0.1", .port = 0},
+            .num_retransmission_feeds = 1,
+        };
+
+        auto stats{std::make_unique<Stats>()};
+        std::atomic<bool> stop{false};
+        std::jthread receiving([&] { receiver.run(stop, speed, options.skip_before, *stats); });
+
+        {
+            Server server(cfg);
+            server.start();
+            server.wait_for_downstream();
+        }
+        stop.store(true, std::memory_order_release);
+        receiving.join();
+
+        util::Histogram::Snapshot error;
+        error.add(stats->inter_arrival_error);
+        util::Histogram::Snapshot lateness;
+        lateness.add(stats->lateness);
+
+        const auto tolerance{static_cast<std::uint64_t>(options.tolerance.count())};
+        const auto missing{stats->missing + (file_messages > stats->messages + stats->missing ? file_messages - stats->messages - stats->missing : 0)};
+        const auto faithful{missing == 0 && error.percentile(99.0) <= tolerance && lateness.percentile(99.0) <= tolerance};
+
+        const auto elapsed{static_cast<double>(std::max<std::int64_t>(stats->last_ns - stats->first_ns, 1))};
+        std::println("{:>9.2f} {:>12.0f} {:>12.0f} {:>7.3f} {:>9} {:>9} {:>10.1f} {:>10.1f} {:>10.1f} {:>10.1f} {:>10.1f}  {}",
+                     speed,
+                     static_cast<double>(stats->packets) * 1e9 / elapsed,
+                     static_cast<double>(stats->messages) * 1e9 / elapsed,
+                     static_cast<double>(stats->bytes) * 8.0 / elapsed,
+                     stats->gaps,
+                     missing,
+                     static_cast<double>(error.percentile(50.0)) / 1e3,
+                     static_cast<double>(error.percentile(99.0)) / 1e3,
+                     static_cast<double>(error.max()) / 1e3,
+                     static_cast<double>(lateness.percentile(99.0)) / 1e3,
+                     static_cast<double>(lateness.max()) / 1e3,
+                     faithful ? "faithful" : "unfaithful");
+
+        return {.speed = speed, .faithful = faithful};
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const std::span args(argv, static_cast<std::size_t>(argc));
+
+    std::optional<std::filesystem::path> synthetic;
+    int status{0};
+    try
+    {
+        const auto options{parse(args)};
+
+        if (!options.file.has_value())
+        {
+            synthetic = tools::make_synthetic_file("imr-replay-bench", options.rate, options.seconds);
+        }
+        const auto file{options.file.value_or(*synthetic)};
+        const auto file_messages{tools::count_messages(file)};
+
+        std::println("{} ({} messages), tolerance p99 {}us, {} wait",
+                     options.file.has_value() ? file.string() : std::format("synthetic {} msgs/s for {}s", options.rate, options.seconds),
+                     file_messages,
+                     options.tolerance.count() / 1'000,
+                     options.wait == util::wait::Kind::spin ? "spin" : "sleep");
+        std::println("{:>9} {:>12} {:>12} {:>7} {:>9} {:>9} {:>10} {:>10} {:>10} {:>10} {:>10}",
+                     "speed", "packets/s", "messages/s", "Gbps", "gaps", "missing", "iae p50us", "iae p99us", "iae maxus", "late p99us", "late maxus");
+
+        std::optional<double> faithful;
+        std::optional<double> unfaithful;
+
+        if (!options.speeds.empty())
+        {
+            for (const auto speed : options.speeds)
+            {
+                if (run(options, file, file_messages, speed).faithful)
+                {
+                    faithful = std::max(faithful.value_or(0.0), speed);
+                }
+            }
+        }
+        else
+        {
+            // double until fidelity breaks, then bisect between the last faithful and first unfaithful speed
+            for (auto speed{options.start}; speed <= options.max && !unfaithful.has_value(); speed *= 2)
+            {
+                (run(options, file, file_messages, speed).faithful ? faithful : unfaithful) = speed;
+            }
+
+            for (auto step{0U}; step < options.refine && faithful.has_value() && unfaithful.has_value(); ++step)
+            {
+                const auto speed{(*faithful + *unfaithful) / 2};
+                (run(options, file, file_messages, speed).faithful ? faithful : unfaithful) = speed;
+            }
+        }
+
+        if (faithful.has_value())
+        {
+            std::println("\nmaximum faithful replay speed: {:.2f}x{}",
+                         *faithful,
+                         options.speeds.empty() && !unfaithful.has_value() ? std::format(" (up to --max {}, not reached)", options.max) : "");
+        }
+        else
+        {
+            std::println("\nno faithful replay speed at or above {:.2f}x", options.speeds.empty() ? options.start : std::ranges::min(options.speeds));
+        }
+    }
+    catch (const std::exception& ex)
+    {
+        std::println(stderr, "{}: {}", args[0], ex.what());
+        status = 1;
+    }
+
+    if (synthetic.has_value())
+    {
+        std::filesystem::remove(*synthetic);
+    }
+    return status;
+}
@@ -0,0 +1,892 @@
+// Retransmission load test: replays a file through imr::Server over loopback multicast to N simulated consumers, each
+// losing downstream packets per a loss model and recovering them from the retransmission feeds like a real client
+// (gap detection, request, timeout, retry with backoff), and reports how the feeds hold up.
+//
+//   imr-retransmission-load [options]
+//
+//   --file <path>          ITCH file to replay (default: a synthetic TotalView-like file, see --rate / --seconds)
+//   --rate <msgs/s>        synthetic file's message rate in ITCH time (default 100000)
+//   --seconds <s>          synthetic file's length in ITCH time (default 2)
+//   --speed <x>            playback speed (default 1)
+//   --clients <n>          simulated consumers (default 1000)
+//   --sockets <per-client|shared>
+//                          a UDP socket per client, or all clients' requests multiplexed on one (default per-client)
+//   --loss <random|burst|same>
+//                          independent losses per client, bursts per client (Gilbert-Elliott, --burst-length long on
+//                          average) or the same packets lost by every client at once (default random)
+//   --loss-rate <p>        fraction of downstream packets lost (default 0.01)
+//   --burst-length <n>     mean packets per burst with --loss burst (default 8)
+//   --timeout-ms <ms>      first request timeout, doubled each retry (default 20)
+//   --retries <n>          retries before a client gives a gap up (default 3)
+//   --threads <n>          retransmission threads (default 2)
+//   --buffer <messages>    retransmission buffer size (default 1048576)
+//   --drain-s <s>          how long clients keep recovering after end of session (default 10)
+//   --mtu <bytes>          MTU (default 1472)
+//   --group <ip>           multicast group (default 239.0.0.1)
+//   --cpu <n>              core to pin the clients to
+//   --seed <n>             loss model seed (default 1)
+//
+// Everything runs on loopback: the server, one multicast receive fanned out to every client, and the clients' requests.
+
+#include "loopback.h"
+#include "options.h"
+#include "synthetic_itch.h"
+
+#include "imr/server.h"
+#include "imr/mold/types.h"
+#include "imr/util/histogram.h"
+#include "imr/util/metrics.h"
+#include "imr/util/random.h"
+#include "util/binary_io.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <format>
+#include <map>
+#include <memory>
+#include <optional>
+#include <print>
+#include <queue>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+using namespace imr;
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+    using mold::types::header::MessageCount;
+    using mold::types::header::SequenceNumber;
+
+    constexpr std::string_view session{"LOADTEST01"};
+
+    enum class Loss
+    {
+        random,
+        burst,
+        same,
+    };
+
+    struct Options
+    {
+        std::optional<std::filesystem::path> file;
+        double rate{100'000};
+        double seconds{2};
+        double speed{1};
+        std::size_t clients{1000};
+        bool shared_socket{false};
+        Loss loss{Loss::random};
+        double loss_rate{0.01};
+        double burst_length{8};
+        std::chrono::milliseconds timeout{20};
+        unsigned retries{3};
+        std::size_t threads{2};
+        std::size_t buffer{1U << 20U};
+        std::chrono::seconds drain{10};
+        std::size_t mtu{1472};
+        std::string group{"239.0.0.1"};
+        std::optional<unsigned> cpu;
+        std::uint64_t seed{1};
+    };
+
+    Options parse(std::span<char*> args)
+    {
+        Options options;
+
+        for (auto i{1UZ}; i < args.size(); i += 2)
+        {
+            const std::string_view name{args[i]};
+            if (i + 1 >= args.size())
+            {
+                throw std::invalid_argument(std::format("{}: missing value", name));
+            }
+            const std::string_view value{args[i + 1]};
+
+            if (name == "--file")
+            {
+                options.file = value;
+            }
+            else if (name == "--rate")
+            {
+                options.rate = tools::parse_number<double>(name, value);
+            }
+            else if (name == "--seconds")
+            {
+                options.seconds = tools::parse_number<double>(name, value);
+            }
+            else if (name == "--speed")
+            {
+                options.speed = tools::parse_number<double>(name, value);
+            }
+            else if (name == "--clients")
+            {
+                options.clients = tools::parse_number<std::size_t>(name, value);
+            }
+            else if (name == "--sockets")
+            {
+                if (value != "per-client" && value != "shared")
+                {
+                    throw std::invalid_argument(std::format("{}: per-client or shared", name));
+                }
+                options.shared_socket = value == "shared";
+            }
+            else if (name == "--loss")
+            {
+                if (value == "random")
+                {
+                    options.loss = Loss::random;
+                }
+                else if (value == "burst")
+                {
+                    options.loss = Loss::burst;
+                }
+                else if (value == "same")
+                {
+                    options.loss = Loss::same;
+                }
+                else
+                {
+                    throw std::invalid_argument(std::format("{}: random, burst or same", name));
+                }
+            }
+            else if (name == "--loss-rate")
+            {
+                options.loss_rate = tools::parse_number<double>(name, value);
+            }
+            else if (name == "--burst-length")
+            {
+                options.burst_length = tools::parse_number<double>(name, value);
+            }
+            else if (name == "--timeout-ms")
+            {
+                options.timeout = std::chrono::milliseconds(tools::parse_number<std::int64_t>(name, value));
+            }
+            else if (name == "--retries")
+            {
+                options.retries = tools::parse_number<unsigned>(name, value);
+            }
+            else if (name == "--threads")
+            {
+                options.threads = tools::parse_number<std::size_t>(name, value);
+            }
+            else if (name == "--buffer")
+            {
+                options.buffer = tools::parse_number<std::size_t>(name, value);
+            }
+            else if (name == "--drain-s")
+            {
+                options.drain = std::chrono::seconds(tools::parse_number<std::int64_t>(name, value));
+            }
+            else if (name == "--mtu")
+            {
+                options.mtu = tools::parse_number<std::size_t>(name, value);
+            }
+            else if (name == "--group")
+            {
+                options.group = value;
+            }
+            else if (name == "--cpu")
+            {
+                options.cpu = tools::parse_number<unsigned>(name, value);
+            }
+            else if (name == "--seed")
+            {
+                options.seed = tools::parse_number<std::uint64_t>(name, value);
+            }
+            else
+            {
+                throw std::invalid_argument(std::format("unknown option {}", name));
+            }
+        }
+
+        if (options.clients == 0 || options.threads == 0 || options.speed <= 0 || options.rate <= 0 || options.seconds <= 0)
+        {
+            throw std::invalid_argument("--clients, --threads, --speed, --rate and --seconds must be positive");
+        }
+        if (options.loss_rate < 0 || options.loss_rate >= 1 || options.burst_length < 1)
+        {
+            throw std::invalid_argument("--loss-rate must be in [0, 1), --burst-length at least 1");
+        }
+
+        return options;
+    }
+
+    struct Stats
+    {
+        std::uint64_t downstream_packets{0};
+        std::uint64_t downstream_messages{0};
+        std::uint64_t gaps{0};
+        std::uint64_t lost_messages{0};
+        std::uint64_t recovered{0};
+        std::uint64_t given_up{0};
+        std::uint64_t unrecovered_messages{0};
+        std::uint64_t requests{0};
+        std::uint64_t timeouts{0};
+        std::uint64_t responses{0};
+        // responses nobody was waiting for any more (answered after a retry went out)
+        std::uint64_t stale_responses{0};
+        std::uint64_t send_errors{0};
+        // requests and responses went back and forth between these
+        std::optional<Clock::time_point> first_request;
+        Clock::time_point last_activity{};
+        // gap detected -> its last message retransmitted, nanoseconds
+        util::Histogram recovery;
+        // request sent -> answered, nanoseconds
+        util::Histogram round_trip;
+    };
+
+    /// Simulated consumers: one multicast receive fanned out through each client's loss model, each client recovering
+    /// its own gaps. Single threaded, an epoll loop over every socket and the clients' request timers.
+    class Clients
+    {
+      public:
+        Clients(const Options& options, tools::Subscription& downstream, std::uint16_t retransmission_port)
+            : options_{options},
+              downstream_{downstream},
+              server_{.sin_family = AF_INET,
+                      .sin_port = htons(retransmission_port),
+                      .sin_addr = {.s_addr = htonl(INADDR_LOOPBACK)},
+                      .sin_zero = {}},
+              epoll_{epoll_create1(EPOLL_CLOEXEC)},
+              packet_random_{options.seed},
+              // Gilbert-Elliott: leave a burst with 1 / burst_length, enter one so the long run loss is loss_rate
+              enter_burst_{options.loss_rate / (options.burst_length * (1.0 - options.loss_rate))},
+              leave_burst_{1.0 / options.burst_length},
+              stats_{std::make_unique<Stats>()}
+        {
+            watch(downstream_.fd.get(), downstream_tag);
+
+            clients_.reserve(options.clients);
+            for (auto i{0UZ}; i < options.clients; ++i)
+            {
+                clients_.push_back({.random = util::SplitMix64{options.seed + 1 + i}});
+            }
+
+            if (options.shared_socket)
+            {
+                sockets_.push_back(make_socket());
+                watch(sockets_.back().get(), shared_tag);
+            }
+            else
+            {
+                sockets_.reserve(options.clients);
+                for (auto i{0UZ}; i < options.clients; ++i)
+                {
+                    sockets_.push_back(make_socket());
+                    watch(sockets_.back().get(), first_client_tag + i);
+                }
+            }
+        }
+
+        /// Receives the downstream and recovers gaps until end of session and every gap is recovered / given up.
+        void run()
+        {
+            tools::pin(options_.cpu, "clients");
+
+            std::array<epoll_event, 64> events{};
+            for (;;)
+            {
+                const auto now{Clock::now()};
+                expire(now);
+
+                if (ended_at_.has_value() && (idle() || now - *ended_at_ > options_.drain))
+                {
+                    return;
+                }
+
+                const auto ready{epoll_wait(epoll_.get(), events.data(), static_cast<int>(events.size()), wait_ms(now))};
+                if (ready < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    throw std::system_error(errno, std::system_category(), "epoll_wait");
+                }
+
+                for (const auto& event : std::span(events).first(static_cast<std::size_t>(ready)))
+                {
+                    if (event.data.u64 == downstream_tag)
+                    {
+                        receive_downstream();
+                    }
+                    else if (event.data.u64 == shared_tag)
+                    {
+                        receive_responses(sockets_.front().get(), std::nullopt);
+                    }
+                    else
+                    {
+                        const auto client{event.data.u64 - first_client_tag};
+                        receive_responses(sockets_[client].get(), client);
+                    }
+                }
+            }
+        }
+
+        [[nodiscard]]
+        const Stats& stats() const noexcept
+        {
+            return *stats_;
+        }
+
+      private:
+        static constexpr std::uint64_t downstream_tag{0};
+        static constexpr std::uint64_t shared_tag{1};
+        static constexpr std::uint64_t first_client_tag{2};
+        static constexpr auto batch{64UZ};
+        static constexpr auto max_packet{9000UZ};
+
+        struct Gap
+        {
+            SequenceNumber first;
+            SequenceNumber end;
+            Clock::time_point detected;
+        };
+
+        struct Client
+        {
+            util::SplitMix64 random;
+            SequenceNumber expected{1};
+            // front is the one being requested
+            std::deque<Gap> gaps;
+            bool outstanding{false};
+            unsigned attempts{0};
+            // bumped per request sent, so timers / shared socket entries of earlier requests are recognised as stale
+            std::uint64_t token{0};
+            Clock::time_point sent_at{};
+            bool in_burst{false};
+        };
+
+        struct Timer
+        {
+            Clock::time_point deadline;
+            std::size_t client;
+            std::uint64_t token;
+
+            bool operator>(const Timer& other) const noexcept
+            {
+                return deadline > other.deadline;
+            }
+        };
+
+        struct Pending
+        {
+            std::size_t client;
+            std::uint64_t token;
+        };
+
+        const Options& options_;
+        tools::Subscription& downstream_;
+        sockaddr_in server_;
+        util::FileDescriptor epoll_;
+        std::vector<util::FileDescriptor> sockets_;
+        std::vector<Client> clients_;
+        std::priority_queue<Timer, std::vector<Timer>, std::greater<>> timers_;
+        // shared socket only: requests outstanding by starting sequence number, oldest first
+        std::unordered_map<SequenceNumber, std::deque<Pending>> pending_;
+        util::SplitMix64 packet_random_;
+        double enter_burst_;
+        double leave_burst_;
+        std::optional<Clock::time_point> ended_at_;
+        std::unique_ptr<Stats> stats_;
+
+        std::array<char, batch * max_packet> buffers_{};
+
+        static util::FileDescriptor make_socket()
+        {
+            util::FileDescriptor fd(socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0));
+            static_cast<void>(tools::bind_loopback(fd.get()));
+            return fd;
+        }
+
+        void watch(int fd, std::uint64_t tag)
+        {
+            epoll_event event{.events = EPOLLIN, .data = {.u64 = tag}};
+            tools::check(epoll_ctl(epoll_.get(), EPOLL_CTL_ADD, fd, &event), "epoll_ctl");
+        }
+
+        [[nodiscard]]
+        bool idle() const noexcept
+        {
+            return std::ranges::all_of(clients_, [](const Client& client) { return client.gaps.empty(); });
+        }
+
+        [[nodiscard]]
+        int wait_ms(Clock::time_point now) const noexcept
+        {
+            if (timers_.empty())
+            {
+                return 100;
+            }
+            const auto until{std::chrono::ceil<std::chrono::milliseconds>(timers_.top().deadline - now).count()};
+            return static_cast<int>(std::clamp<std::int64_t>(until, 0, 100));
+        }
+
+        // whether `client` loses the data packet `same_loss` was drawn for
+        bool lost(Client& client, bool same_loss) noexcept
+        {
+            switch (options_.loss)
+            {
+            case Loss::random:
+                return client.random.chance(options_.loss_rate);
+            case Loss::burst:
+                client.in_burst = client.random.chance(client.in_burst ? 1.0 - leave_burst_ : enter_burst_);
+                return client.in_burst;
+            case Loss::same:
+                return same_loss;
+            }
+            return false;
+        }
+
+        template <std::size_t N>
+        std::span<mmsghdr> receive(int fd, std::array<iovec, N>& iovs, std::array<mmsghdr, N>& messages)
+        {
+            for (auto i{0UZ}; i < N; ++i)
+            {
+                iovs[i] = {.iov_base = buffers_.data() + (i * max_packet), .iov_len = max_packet};
+                messages[i] = {};
+                messages[i].msg_hdr.msg_iov = &iovs[i];
+                messages[i].msg_hdr.msg_iovlen = 1;
+            }
+
+            const auto received{recvmmsg(fd, messages.data(), N, MSG_DONTWAIT, nullptr)};
+            if (received < 0)
+            {
+                if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                {
+                    throw std::system_error(errno, std::system_category(), "recvmmsg");
+                }
+                return {};
+            }
+            return std::span(messages).first(static_cast<std::size_t>(received));
+        }
+
+        void receive_downstream()
+        {
+            std::array<iovec, batch> iovs{};
+            std::array<mmsghdr, batch> messages{};
+
+            for (auto received{receive(downstream_.fd.get(), iovs, messages)}; !received.empty();
+                 received = receive(downstream_.fd.get(), iovs, messages))
+            {
+                const auto now{Clock::now()};
+                for (auto i{0UZ}; i < received.size(); ++i)
+                {
+                    const std::span packet(static_cast<const char*>(iovs[i].iov_base), received[i].msg_len);
+                    if (packet.size() < mold::types::header::length)
+                    {
+                        continue;
+                    }
+
+                    const auto seq{util::binary_io::read_at_be<SequenceNumber>(packet, mold::types::header::sequence_number_offset)};
+                    const auto count{util::binary_io::read_at_be<MessageCount>(packet, mold::types::header::message_count_offset)};
+
+                    // heartbeats and end of session carry the next sequence number, revealing losses at the tail
+                    if (count == mold::types::header::heartbeat_msg_count || count == mold::types::header::end_of_session_msg_count)
+                    {
+                        if (count == mold::types::header::end_of_session_msg_count && !ended_at_.has_value())
+                        {
+                            ended_at_ = now;
+                        }
+                        for (auto client{0UZ}; client < clients_.size(); ++client)
+                        {
+                            sequenced(client, seq, 0, now);
+                        }
+                        continue;
+                    }
+
+                    ++stats_->downstream_packets;
+                    stats_->downstream_messages += count;
+
+                    const auto same_loss{options_.loss == Loss::same && packet_random_.chance(options_.loss_rate)};
+                    for (auto client{0UZ}; client < clients_.size(); ++client)
+                    {
+                        if (!lost(clients_[client], same_loss))
+                        {
+                            sequenced(client, seq, count, now);
+                        }
+                    }
+                }
+            }
+        }
+
+        // `client` received messages [seq, seq + count)
+        void sequenced(std::size_t index, SequenceNumber seq, MessageCount count, Clock::time_point now)
+        {
+            auto& client{clients_[index]};
+
+            if (seq > client.expected)
+            {
+                client.gaps.push_back({.first = client.expected, .end = seq, .detected = now});
+                ++stats_->gaps;
+                stats_->lost_messages += seq - client.expected;
+            }
+            client.expected = std::max(client.expected, seq + count);
+
+            if (!client.outstanding && !client.gaps.empty())
+            {
+                request(index, now);
+            }
+        }
+
+        void request(std::size_t index, Clock::time_point now)
+        {
+            auto& client{clients_[index]};
+            const auto& gap{client.gaps.front()};
+
+            std::array<char, mold::types::header::length> request{};
+            util::binary_io::write_at(std::span(request), mold::types::header::session_offset, session);
+            util::binary_io::write_at_be(std::span(request), mold::types::header::sequence_number_offset, gap.first);
+            util::binary_io::write_at_be(std::span(request),
+                                         mold::types::header::message_count_offset,
+                                         static_cast<MessageCount>(std::min<SequenceNumber>(gap.end - gap.first,
+                                                                                            mold::types::header::end_of_session_msg_count - 1)));
+
+            const auto fd{options_.shared_socket ? sockets_.front().get() : sockets_[index].get()};
+            if (sendto(fd, request.data(), request.size(), 0, reinterpret_cast<const sockaddr*>(&server_), sizeof(server_)) < 0)
+            {
+                ++stats_->send_errors;
+            }
+
+            client.outstanding = true;
+            client.sent_at = now;
+            ++client.token;
+            timers_.push({.deadline = now + (options_.timeout * (1U << std::min(client.attempts, 16U))), .client = index, .token = client.token});
+            if (options_.shared_socket)
+            {
+                pending_[gap.first].push_back({.client = index, .token = client.token});
+            }
+
+            ++stats_->requests;
+            stats_->first_request = stats_->first_request.value_or(now);
+            stats_->last_activity = now;
+        }
+
+        void expire(Clock::time_point now)
+        {
+            while (!timers_.empty() && timers_.top().deadline <= now)
+            {
+                const auto timer{timers_.top()};
+                timers_.pop();
+
+                auto& client{clients_[timer.client]};
+                if (!client.outstanding || client.token != timer.token)
+                {
+                    continue;
+                }
+
+                client.outstanding = false;
+                ++stats_->timeouts;
+
+                if (client.attempts >= options_.retries)
+                {
+                    const auto& gap{client.gaps.front()};
+                    ++stats_->given_up;
+                    stats_->unrecovered_messages += gap.end - gap.first;
+                    client.gaps.pop_front();
+                    client.attempts = 0;
+                }
+                else
+                {
+                    ++client.attempts;
+                }
+
+                if (!client.gaps.empty())
+                {
+                    request(timer.client, now);
+                }
+            }
+        }
+
+        // the shared socket's outstanding request a response starting at `seq` answers
+        std::optional<std::size_t> match(SequenceNumber seq)
+        {
+            const auto entry{pending_.find(seq)};
+            if (entry == pending_.end())
+            {
+                return std::nullopt;
+            }
+
+            std::optional<std::size_t> matched;
+            auto& waiting{entry->second};
+            while (!waiting.empty() && !matched.has_value())
+            {
+                const auto pending{waiting.front()};
+                waiting.pop_front();
+
+                const auto& client{clients_[pending.client]};
+                if (client.outstanding && client.token == pending.token && client.gaps.front().first == seq)
+                {
+                    matched = pending.client;
+                }
+            }
+
+            if (waiting.empty())
+            {
+                pending_.erase(entry);
+            }
+            return matched;
+        }
+
+        void receive_responses(int fd, std::optional<std::size_t> owner)
+        {
+            std::array<iovec, batch> iovs{};
+            std::array<mmsghdr, batch> messages{};
+
+            for (auto received{receive(fd, iovs, messages)}; !received.empty(); received = receive(fd, iovs, messages))
+            {
+                const auto now{Clock::now()};
+                for (auto i{0UZ}; i < received.size(); ++i)
+                {
+                    const std::span packet(static_cast<const char*>(iovs[i].iov_base), received[i].msg_len);
+                    if (packet.size() < mold::types::header::length)
+                    {
+                        continue;
+                    }
+
+                    ++stats_->responses;
+                    stats_->last_activity = now;
+
+                    const auto seq{util::binary_io::read_at_be<SequenceNumber>(packet, mold::types::header::sequence_number_offset)};
+                    const auto count{util::binary_io::read_at_be<MessageCount>(packet, mold::types::header::message_count_offset)};
+
+                    const auto index{owner.has_value() ? owner : match(seq)};
+                    if (!index.has_value())
+                    {
+                        ++stats_->stale_responses;
+                        continue;
+                    }
+                    retransmitted(*index, seq, count, now);
+                }
+            }
+        }
+
+        void retransmitted(std::size_t index, SequenceNumber seq, MessageCount count, Clock::time_point now)
+        {
+            auto& client{clients_[index]};
+            if (client.gaps.empty() || client.gaps.front().first != seq || count == 0)
+            {
+                ++stats_->stale_responses;
+                return;
+            }
+
+            auto& gap{client.gaps.front()};
+            if (client.outstanding)
+            {
+                stats_->round_trip.record(static_cast<std::uint64_t>(std::chrono::nanoseconds(now - client.sent_at).count()));
+            }
+
+            gap.first = std::min<SequenceNumber>(gap.end, seq + count);
+            client.outstanding = false;
+            client.attempts = 0;
+
+            if (gap.first == gap.end)
+            {
+                stats_->recovery.record(static_cast<std::uint64_t>(std::chrono::nanoseconds(now - gap.detected).count()));
+                ++stats_->recovered;
+                client.gaps.pop_front();
+            }
+
+            if (!client.gaps.empty())
+            {
+                request(index, now);
+            }
+        }
+    };
+
+    // sockets for every client and then some
+    void raise_file_limit(std::size_t needed)
+    {
+        rlimit limit{};
+        tools::check(getrlimit(RLIMIT_NOFILE, &limit), "getrlimit");
+        if (limit.rlim_cur >= needed)
+        {
+            return;
+        }
+
+        limit.rlim_cur = std::min<rlim_t>(limit.rlim_max, needed);
+        tools::check(setrlimit(RLIMIT_NOFILE, &limit), "setrlimit");
+        if (limit.rlim_cur < needed)
+        {
+            throw std::invalid_argument(std::format("{} file descriptors needed, the limit is {}: use --sockets shared or fewer --clients",
+                                                    needed,
+                                                    limit.rlim_cur));
+        }
+    }
+
+    double us(std::uint64_t ns)
+    {
+        return static_cast<double>(ns) / 1e3;
+    }
+
+    void report(const Options& options, const Stats& stats, const Server& server, std::span<const util::metrics::Sample> samples)
+    {
+        util::Histogram::Snapshot recovery;
+        recovery.add(stats.recovery);
+        util::Histogram::Snapshot round_trip;
+        round_trip.add(stats.round_trip);
+
+        const auto window{stats.first_request.has_value()
+                              ? std::max(std::chrono::duration<double>(stats.last_activity - *stats.first_request).count(), 1e-9)
+                              : 1.0};
+
+        std::println("{} clients ({}), {} loss at {}, {} retransmission threads, {:.3f}s of requests",
+                     options.clients,
+                     options.shared_socket ? "one shared socket" : "a socket each",
+                     options.loss == Loss::random ? "random" : options.loss == Loss::burst ? "burst" : "same packet",
+                     options.loss_rate,
+                     options.threads,
+                     window);
+        std::println("downstream: {} packets, {} messages", stats.downstream_packets, stats.downstream_messages);
+        std::println("clients: {} gaps ({} messages) lost, {} recovered, {} given up ({} messages)",
+                     stats.gaps,
+                     stats.lost_messages,
+                     stats.recovered,
+                     stats.given_up,
+                     stats.unrecovered_messages);
+        std::println("requests: {} sent, {} timed out, {} responses ({} stale), {} send errors",
+                     stats.requests,
+                     stats.timeouts,
+                     stats.responses,
+                     stats.stale_responses,
+                     stats.send_errors);
+        std::println("recovery latency us: p50 {:.1f} p90 {:.1f} p99 {:.1f} p99.9 {:.1f} max {:.1f}",
+                     us(recovery.percentile(50.0)),
+                     us(recovery.percentile(90.0)),
+                     us(recovery.percentile(99.0)),
+                     us(recovery.percentile(99.9)),
+                     us(recovery.max()));
+        std::println("request round trip us: p50 {:.1f} p99 {:.1f} max {:.1f}",
+                     us(round_trip.percentile(50.0)),
+                     us(round_trip.percentile(99.0)),
+                     us(round_trip.max()));
+
+        const auto service{server.retransmission_service_time()};
+        std::println("server service time us: p50 {:.1f} p99 {:.1f} max {:.1f}",
+                     us(service.percentile(50.0)),
+                     us(service.percentile(99.0)),
+                     us(service.max()));
+
+        // per retransmission thread, as the feeds counted them
+        struct Thread
+        {
+            std::int64_t requests{0};
+            std::int64_t served{0};
+            std::int64_t out_of_range{0};
+            std::int64_t bad_session{0};
+        };
+        std::map<std::string, Thread> threads;
+        for (const auto& sample : samples)
+        {
+            auto& thread{threads[sample.labels]};
+            if (sample.name == "imr_retransmission_requests_total")
+            {
+                thread.requests = sample.value;
+            }
+            else if (sample.name == "imr_retransmission_served_total")
+            {
+                thread.served = sample.value;
+            }
+            else if (sample.name == "imr_retransmission_out_of_range_total")
+            {
+                thread.out_of_range = sample.value;
+            }
+            else if (sample.name == "imr_retransmission_bad_session_total")
+            {
+                thread.bad_session = sample.value;
+            }
+        }
+
+        std::println("\n{:>14} {:>10} {:>10} {:>10} {:>12} {:>12}", "thread", "requests", "req/s", "served", "out_of_range", "bad_session");
+        for (const auto& [labels, thread] : threads)
+        {
+            if (!labels.starts_with("thread="))
+            {
+                continue;
+            }
+            std::println("{:>14} {:>10} {:>10.0f} {:>10} {:>12} {:>12}",
+                         labels,
+                         thread.requests,
+                         static_cast<double>(thread.requests) / window,
+                         thread.served,
+                         thread.out_of_range,
+                         thread.bad_session);
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const std::span args(argv, static_cast<std::size_t>(argc));
+
+    std::optional<std::filesystem::path> synthetic;
+    int status{0};
+    try
+    {
+        const auto options{parse(args)};
+        raise_file_limit((options.shared_socket ? 1 : options.clients) + 256);
+
+        if (!options.file.has_value())
+        {
+            synthetic = tools::make_synthetic_file("imr-retransmission-load", options.rate, options.seconds);
+        }
+
+        auto downstream{tools::subscribe(options.group)};
+        const auto retransmission_port{tools::free_udp_port()};
+
+        const Server::Config cfg{
+            .mapped_itch_file_cfg = {.path = options.file.value_or(*synthetic), .mmap_flags = MAP_POPULATE},
+            .packet_builder_cfg = {.session = session, .MTU = options.mtu},
+            .downstream_feed_config = {
+                .mcast_group = options.group,
+                .port = downstream.port,
+                .loopback = true,
+                .egress_interface = {.s_addr = htonl(INADDR_LOOPBACK)},
+                .heartbeat_period = std::chrono::milliseconds(100),
+                // stopped once the clients are done, the retransmission feeds stop with the downstream
+                .end_of_session_duration = std::chrono::hours(24),
+                .pacer_cfg = {.playback_speed = options.speed, .skip_before = std::chrono::nanoseconds{0}},
+            },
+            .retransmission_buffer_size = options.buffer,
+            .retransmission_feed_config = {.address = "127.0.0.1", .port = retransmission_port},
+            .num_retransmission_feeds = options.threads,
+            .metrics_cfg = util::metrics::Registry::Config{},
+        };
+
+        Clients clients(options, downstream, retransmission_port);
+        Server server(cfg);
+        server.start();
+        clients.run();
+        server.stop();
+
+        const util::metrics::Reader metrics(server.metrics()->path());
+        report(options, clients.stats(), server, metrics.read());
+    }
+    catch (const std::exception& ex)
+    {
+        std::println(stderr, "{}: {}", args[0], ex.what());
+        status = 1;
+    }
+
+    if (synthetic.has_value())
+    {
+        std::filesystem::remove(*synthetic);
+    }
+    return status;
+}
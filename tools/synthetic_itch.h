@@ -0,0 +1,90 @@
+#pragma once
+
+#include "imr/mold/downstream/pacer.h"
+#include "imr/mold/types.h"
+#include "imr/util/memory_mapped_file.h"
+#include "imr/util/random.h"
+#include "itch/timestamp.h"
+#include "util/binary_io.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <stdexcept>
+
+#include <unistd.h>
+
+// TotalView-like ITCH files for the tools to replay when not given a real one
+namespace imr::tools
+{
+    struct MessageType
+    {
+        char type;
+        // without the length prefix
+        std::size_t size;
+    };
+
+    // TotalView-ITCH 5.0 message sizes and types, weighted like a regular session (adds / deletes dominate)
+    inline constexpr std::array<MessageType, 20> totalview_mix{{
+        {'A', 36}, {'A', 36}, {'A', 36}, {'A', 36}, {'A', 36}, {'A', 36}, {'A', 36}, {'A', 36},
+        {'D', 19}, {'D', 19}, {'D', 19}, {'D', 19}, {'D', 19}, {'D', 19},
+        {'U', 35}, {'U', 35}, {'E', 31}, {'X', 23}, {'I', 50}, {'F', 40},
+    }};
+
+    /** Writes `totalview_mix` messages arriving at `rate` a second (Poisson, so packets bunch like a real feed's) from
+     *  the open for `seconds` of ITCH time to a file under the temp directory named after `name`, and returns its path.
+     *
+     * @throws std::runtime_error if the file can't be written.
+     */
+    inline std::filesystem::path make_synthetic_file(std::string_view name, double rate, double seconds)
+    {
+        auto path{std::filesystem::temp_directory_path() / std::format("{}-{}.itch", name, getpid())};
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+
+        util::SplitMix64 random{42};
+        const auto open{static_cast<double>(mold::downstream::market_open.count())};
+        const auto end{open + (seconds * 1e9)};
+        const auto mean_gap{1e9 / rate};
+
+        std::array<char, sizeof(mold::types::LengthPrefix) + 64> message{};
+        for (auto timestamp{open}; timestamp < end; timestamp += -std::log(1.0 - random.uniform()) * mean_gap)
+        {
+            const auto type{totalview_mix[random.next() % totalview_mix.size()]};
+            const auto body{std::span(message).subspan(sizeof(mold::types::LengthPrefix), type.size)};
+
+            util::binary_io::write_at_be(std::span(message), 0, static_cast<mold::types::LengthPrefix>(type.size));
+            body[0] = type.type;
+            util::binary_io::write_at_be(body, 1, static_cast<std::uint16_t>(1 + (random.next() % 8000)));
+
+            std::array<char, 8> be{};
+            util::binary_io::write_at_be(std::span(be), 0, static_cast<std::uint64_t>(timestamp));
+            std::ranges::copy(std::span(be).last(itch::timestamp_size), body.begin() + itch::timestamp_offset);
+
+            out.write(message.data(), static_cast<std::streamsize>(sizeof(mold::types::LengthPrefix) + type.size));
+        }
+
+        if (!out.flush())
+        {
+            throw std::runtime_error(std::format("couldn't write {}", path.c_str()));
+        }
+        return path;
+    }
+
+    /// Messages in an ITCH file (length prefixed messages back to back).
+    inline std::uint64_t count_messages(const std::filesystem::path& file)
+    {
+        const util::MemoryMappedFile mapped({.path = file});
+        const auto bytes{mapped.as_span()};
+
+        std::uint64_t count{0};
+        for (std::size_t pos{0}; pos + sizeof(mold::types::LengthPrefix) <= bytes.size(); ++count)
+        {
+            pos += sizeof(mold::types::LengthPrefix) + util::binary_io::read_at_be<mold::types::LengthPrefix>(bytes, pos);
+        }
+        return count;
+    }
+}